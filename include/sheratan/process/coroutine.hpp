@@ -0,0 +1,24 @@
+/// \file sheratan/process/coroutine.hpp
+/// \brief Coroutine awaitables interface.
+/// \ingroup sheratan_process
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#ifndef HG_SHERATAN_PROCESS_COROUTINE_HPP
+#define HG_SHERATAN_PROCESS_COROUTINE_HPP
+
+
+#ifdef SHERATAN_TARGET_OS_LINUX
+#  include "sheratan/process/posix/coroutine.hpp"
+#  include "sheratan/process/posix/namespace.hpp"
+#else
+#  error FATAL: Target OS not supported!
+#endif
+
+
+#endif // HG_SHERATAN_PROCESS_COROUTINE_HPP
+
+
+// vim: set ts=2 sw=2 et:
+
+
@@ -0,0 +1,24 @@
+/// \file sheratan/process/exec_ctl.hpp
+/// \brief Exec controller interface.
+/// \ingroup sheratan_process
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#ifndef HG_SHERATAN_PROCESS_EXEC_CTL_HPP
+#define HG_SHERATAN_PROCESS_EXEC_CTL_HPP
+
+
+#ifdef SHERATAN_TARGET_OS_LINUX
+#  include "sheratan/process/posix/exec_ctl.hpp"
+#  include "sheratan/process/posix/namespace.hpp"
+#else
+#  error FATAL: Target OS not supported!
+#endif
+
+
+#endif // HG_SHERATAN_PROCESS_EXEC_CTL_HPP
+
+
+// vim: set ts=2 sw=2 et:
+
+
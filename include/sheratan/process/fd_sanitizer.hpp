@@ -0,0 +1,24 @@
+/// \file sheratan/process/fd_sanitizer.hpp
+/// \brief File descriptor sanitizer interface.
+/// \ingroup sheratan_process
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#ifndef HG_SHERATAN_PROCESS_FD_SANITIZER_HPP
+#define HG_SHERATAN_PROCESS_FD_SANITIZER_HPP
+
+
+#ifdef SHERATAN_TARGET_OS_LINUX
+#  include "sheratan/process/posix/fd_sanitizer.hpp"
+#  include "sheratan/process/posix/namespace.hpp"
+#else
+#  error FATAL: Target OS not supported!
+#endif
+
+
+#endif // HG_SHERATAN_PROCESS_FD_SANITIZER_HPP
+
+
+// vim: set ts=2 sw=2 et:
+
+
@@ -0,0 +1,144 @@
+/// \file sheratan/process/posix/batch_forker.hpp
+/// \brief Batch forker POSIX implementation interface.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#ifndef HG_SHERATAN_PROCESS_POSIX_BATCH_FORKER_HPP
+#define HG_SHERATAN_PROCESS_POSIX_BATCH_FORKER_HPP
+
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+#include "sheratan/process/posix/fwd.hpp"
+#include "sheratan/process/posix/types.hpp"
+#include "sheratan/process/posix/fork_ctl.hpp"
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+/// \brief Batch forker POSIX implementation.
+/// \ingroup sheratan_process_posix
+/// \nosubgrouping
+/// \note Batch forker forks a batch of child processes, which start
+/// together and report their readiness collectively:
+/// -# All the children are forked (prefork routine of fork controller is
+///    executed for each of them). They are blocked on release barrier,
+///    before child routine of fork controller is executed.
+/// -# All the children are released at once, by closing the only remaining
+///    write end of the barrier pipe (single system call for whole batch).
+/// -# Postfork routine of fork controller is executed for each of the
+///    children, which are running already, so that parent-child round trips
+///    (e.g. \c parent_child_sync::wait_for_child) of the batch overlap.
+/// -# Children execute child routine, which calls \c report_ready once the
+///    child is initialized. Readiness is reported over single socket
+///    shared by whole batch.
+/// -# \c fork returns once all the children have reported ready, or once
+///    one of them has failed (i.e. terminated before it reported ready), so
+///    that startup of the batch takes as long as startup of the slowest
+///    child, rather than sum of startups of all the children.
+/// \note Children, which terminate before they report ready, are noticed
+/// via their process file descriptors. In case process file descriptors
+/// are not supported, such failure is noticed only once all the other
+/// children have reported ready, or once the deadline expires.
+/// \note Each child is controlled by its own copy (clone) of the fork
+/// controller, the same way as each process object holds its own copy.
+/// The copies are destroyed once \c fork returns. Since the whole batch
+/// is forked before any postfork routine is executed, children inherit
+/// file descriptors created by prefork routines of their elder siblings.
+class batch_forker : private boost::noncopyable
+{
+  public:
+
+    /// \brief Child process list type definition.
+    typedef std::vector<process *> process_list_type;
+
+  public:
+
+    /// \brief Constructor.
+    /// \param fc Fork controller.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    explicit batch_forker(const fork_ctl &fc);
+
+  public:
+
+    /// \brief Get fork controller.
+    /// \return Fork controller.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \note It is the prototype, which is cloned for each child of the batch.
+    const fork_ctl & get_fork_ctl() const;
+
+    /// \brief Get fork controller.
+    /// \return Fork controller.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    fork_ctl & get_fork_ctl();
+
+  public:
+
+    /// \brief Fork batch of child processes.
+    /// \param children Child process objects.
+    /// \param time System time (UTC), until when to wait for the children to be ready.
+    /// \retval true All the children have reported ready.
+    /// \retval false Some child has terminated before it reported ready, or
+    /// the deadline has expired.
+    /// \par Abrahams exception guarantee:
+    /// weak
+    /// \pre <code>children.empty() == false</code>
+    /// \pre <code>children[i]->valid() == false</code> for all the children.
+    /// \post <code>children[i]->valid() == true</code> for all the children
+    /// (no matter what the return value is).
+    /// \note In case the batch can not be forked, or some postfork routine
+    /// fails, children forked so far are killed and joined before the
+    /// exception is thrown. In case of an error while waiting for the
+    /// children to be ready, they remain valid and running.
+    /// \note Call to this method will never return in child process.
+    bool fork(const process_list_type &children, const system_time_type &time = system_time_type(boost::posix_time::pos_infin));
+
+  public:
+
+    /// \brief Get index of the child within its batch.
+    /// \return Index of the child in the list passed to \c fork.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \pre Called from child routine of the batch.
+    static std::size_t get_index();
+
+    /// \brief Report that the child is ready.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \pre Called from child routine of the batch, at most once.
+    /// \note In case the parent has stopped waiting for the batch already
+    /// (e.g. some other child has failed), readiness is silently dropped.
+    static void report_ready();
+
+  private:
+
+    /// \brief Fork controller.
+    std::auto_ptr<fork_ctl> fork_ctl_;
+};
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+#endif // HG_SHERATAN_PROCESS_POSIX_BATCH_FORKER_HPP
+
+
+// vim: set ts=2 sw=2 et:
@@ -0,0 +1,326 @@
+/// \file sheratan/process/posix/coroutine.hpp
+/// \brief Coroutine awaitables POSIX implementation interface.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+///
+/// Awaitables are available only to programs compiled as C++20 (or newer)
+/// with coroutine support, the rest of the library does not depend on them.
+
+
+#ifndef HG_SHERATAN_PROCESS_POSIX_COROUTINE_HPP
+#define HG_SHERATAN_PROCESS_POSIX_COROUTINE_HPP
+
+
+/// \def SHERATAN_PROCESS_POSIX_COROUTINES
+/// \brief Defined in case coroutine awaitables are available.
+#if defined(__cpp_impl_coroutine) && (__cplusplus >= 202002L)
+#  define SHERATAN_PROCESS_POSIX_COROUTINES 1
+#endif
+
+
+#ifdef SHERATAN_PROCESS_POSIX_COROUTINES
+
+
+#include <coroutine>
+#include <exception>
+
+#include <boost/noncopyable.hpp>
+
+#include "sheratan/process/posix/fwd.hpp"
+#include "sheratan/process/posix/types.hpp"
+#include "sheratan/process/posix/exit_status.hpp"
+#include "sheratan/process/posix/process.hpp"
+#include "sheratan/process/posix/parent_child_sync.hpp"
+#include "sheratan/process/posix/daemonizer.hpp"
+#include "sheratan/process/posix/daemon.hpp"
+#include "sheratan/process/posix/reactor.hpp"
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+/// \brief Awaitable join of a process.
+/// \ingroup sheratan_process_posix
+/// \nosubgrouping
+/// \tparam EventLoop Event loop type (e.g. \c reactor). Event loop must provide
+/// <code>watch_io(file_descriptor_type, io_event_mask_type, handler)</code> and
+/// <code>unwatch_io(file_descriptor_type)</code> methods, where the handler is
+/// callable as <code>handler(file_descriptor_type, io_event_mask_type)</code>.
+/// \note Awaiting coroutine is resumed from within the event loop, once the
+/// process terminates and it is joined. In case the process has no native
+/// handle, it is joined synchronously, without suspending the coroutine.
+template <typename EventLoop>
+class join_awaitable : private boost::noncopyable
+{
+  public:
+
+    /// \brief Constructor.
+    /// \param loop Event loop.
+    /// \param proc Process to be joined.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    join_awaitable(EventLoop &loop, process &proc);
+
+  public:
+
+    /// \brief Determine whether the process has already terminated.
+    /// \retval true Process has been joined already.
+    /// \retval false Coroutine must be suspended.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    bool await_ready();
+
+    /// \brief Suspend coroutine until the process terminates.
+    /// \param handle Handle of awaiting coroutine.
+    /// \retval true Coroutine is suspended.
+    /// \retval false Process has been joined synchronously.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    bool await_suspend(std::coroutine_handle<> handle);
+
+    /// \brief Get result.
+    /// \return Exit status of the process.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \note Exception thrown by join is rethrown here.
+    exit_status await_resume();
+
+  private:
+
+    /// \brief Join terminated process and resume coroutine.
+    /// \param fd Process file descriptor.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    void on_ready(file_descriptor_type fd, io_event_mask_type);
+
+  private:
+
+    /// \brief Event loop.
+    EventLoop &loop_;
+
+    /// \brief Process to be joined.
+    process &proc_;
+
+    /// \brief Handle of awaiting coroutine.
+    std::coroutine_handle<> handle_;
+
+    /// \brief Exit status of the process.
+    exit_status status_;
+
+    /// \brief Exception thrown by join.
+    std::exception_ptr error_;
+};
+
+
+/// \brief Awaitable wait for child by parent-child synchronizer.
+/// \ingroup sheratan_process_posix
+/// \nosubgrouping
+/// \tparam EventLoop Event loop type (see \c join_awaitable).
+/// \note Awaiting coroutine is resumed from within the event loop, once the
+/// child unblocks the parent (or it terminates without doing so, in which case
+/// exception is thrown, the same way as by \c parent_child_sync::wait_for_child).
+/// \note Synchronizer must have a native handle to be watched by the event loop,
+/// i.e. \c FUTEX backend is not supported (use blocking \c wait_for_child instead).
+template <typename EventLoop>
+class wait_for_child_awaitable : private boost::noncopyable
+{
+  public:
+
+    /// \brief Constructor.
+    /// \param loop Event loop.
+    /// \param sync Parent-child synchronizer.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \pre <code>sync.native_handle() != -1</code>
+    wait_for_child_awaitable(EventLoop &loop, parent_child_sync &sync);
+
+  public:
+
+    /// \brief Determine whether the coroutine needs to be suspended.
+    /// \retval false Always.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    bool await_ready() const;
+
+    /// \brief Suspend coroutine until the child unblocks the parent.
+    /// \param handle Handle of awaiting coroutine.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \pre <code>sync.native_handle() != -1</code>
+    void await_suspend(std::coroutine_handle<> handle);
+
+    /// \brief Get result.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \note Exception thrown by wait is rethrown here.
+    void await_resume();
+
+  private:
+
+    /// \brief Consume synchronization data and resume coroutine.
+    /// \param fd Synchronization pipe read-end.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    void on_ready(file_descriptor_type fd, io_event_mask_type);
+
+  private:
+
+    /// \brief Event loop.
+    EventLoop &loop_;
+
+    /// \brief Parent-child synchronizer.
+    parent_child_sync &sync_;
+
+    /// \brief Handle of awaiting coroutine.
+    std::coroutine_handle<> handle_;
+
+    /// \brief Exception thrown by wait.
+    std::exception_ptr error_;
+};
+
+
+/// \brief Awaitable daemonization.
+/// \ingroup sheratan_process_posix
+/// \nosubgrouping
+/// \tparam EventLoop Event loop type (see \c join_awaitable).
+/// \note Daemonization is begun when the coroutine is suspended and it is
+/// ended from within the event loop, once the intermediate (1st) child process
+/// terminates (see \c daemonizer::begin_daemonize and \c daemonizer::end_daemonize).
+/// In case readiness stage is requested, the event loop keeps watching the
+/// daemonizer (see \c daemonizer::native_handle) until the daemon reaches it,
+/// so that the loop is never blocked by the readiness wait.
+template <typename EventLoop>
+class daemonize_awaitable : private boost::noncopyable
+{
+  public:
+
+    /// \brief Constructor.
+    /// \param loop Event loop.
+    /// \param dz Daemonizer.
+    /// \param daemon_process Daemon process object.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    daemonize_awaitable(EventLoop &loop, daemonizer &dz, daemon &daemon_process);
+
+  public:
+
+    /// \brief Determine whether the coroutine needs to be suspended.
+    /// \retval false Always.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    bool await_ready() const;
+
+    /// \brief Begin daemonization and suspend coroutine until it is done.
+    /// \param handle Handle of awaiting coroutine.
+    /// \retval true Coroutine is suspended.
+    /// \retval false Daemonization has been ended synchronously.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    bool await_suspend(std::coroutine_handle<> handle);
+
+    /// \brief Get result.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \note Exception reporting failure of daemonization is rethrown here.
+    void await_resume();
+
+  private:
+
+    /// \brief End daemonization.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    void end();
+
+    /// \brief End daemonization and resume coroutine (unless the daemon is to be waited for).
+    /// \param fd Process file descriptor of intermediate child.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    void on_ready(file_descriptor_type fd, io_event_mask_type);
+
+    /// \brief Continue waiting for daemon readiness and resume coroutine once it is over.
+    /// \param fd Native handle of the daemonizer.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    void on_daemon_ready(file_descriptor_type fd, io_event_mask_type);
+
+    /// \brief Resume coroutine, unless the daemon is to be waited for.
+    /// \param ended Whether the daemonization is ended.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    void resume_unless_waiting(bool ended);
+
+  private:
+
+    /// \brief Event loop.
+    EventLoop &loop_;
+
+    /// \brief Daemonizer.
+    daemonizer &daemonizer_;
+
+    /// \brief Daemon process object.
+    daemon &daemon_;
+
+    /// \brief Intermediate (1st) child process.
+    process *first_child_;
+
+    /// \brief Handle of awaiting coroutine.
+    std::coroutine_handle<> handle_;
+
+    /// \brief Exception reporting failure of daemonization.
+    std::exception_ptr error_;
+};
+
+
+/// \brief Join process asynchronously.
+/// \param loop Event loop.
+/// \param proc Process to be joined.
+/// \return Awaitable, result of which is exit status of the process.
+/// \par Abrahams exception guarantee:
+/// no-throw
+/// \pre <code>proc.valid() == true</code>
+template <typename EventLoop>
+join_awaitable<EventLoop> async_join(EventLoop &loop, process &proc);
+
+/// \brief Wait for child asynchronously.
+/// \param loop Event loop.
+/// \param sync Parent-child synchronizer.
+/// \return Awaitable.
+/// \par Abrahams exception guarantee:
+/// no-throw
+/// \pre <code>sync.native_handle() != -1</code> (synchronizer does not use
+/// \c FUTEX backend)
+template <typename EventLoop>
+wait_for_child_awaitable<EventLoop> async_wait_for_child(EventLoop &loop, parent_child_sync &sync);
+
+/// \brief Daemonize asynchronously.
+/// \param loop Event loop.
+/// \param dz Daemonizer.
+/// \param daemon_process Daemon process object.
+/// \return Awaitable.
+/// \par Abrahams exception guarantee:
+/// no-throw
+template <typename EventLoop>
+daemonize_awaitable<EventLoop> async_daemonize(EventLoop &loop, daemonizer &dz, daemon &daemon_process);
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+#include "sheratan/process/posix/coroutine.ci"
+
+
+#endif // SHERATAN_PROCESS_POSIX_COROUTINES
+
+
+#endif // HG_SHERATAN_PROCESS_POSIX_COROUTINE_HPP
+
+
+// vim: set ts=2 sw=2 et:
@@ -13,6 +13,7 @@
 #include "sheratan/process/posix/fwd.hpp"
 #include "sheratan/process/posix/types.hpp"
 #include "sheratan/process/posix/process_id.hpp"
+#include "sheratan/process/posix/daemonization_report.hpp"
 
 
 namespace sheratan {
@@ -27,6 +28,14 @@ namespace posix {
 /// \nosubgrouping
 class daemon : private boost::noncopyable
 {
+  protected:
+
+    /// \brief Default constructor.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \post <code>this->valid() == false</code>
+    daemon();
+
   public:
 
     /// \brief Virtual destructor.
@@ -44,8 +53,22 @@ class daemon : private boost::noncopyable
     /// \post <code>this->valid() == true</code>
     /// \post <code>this->get_pid() == pid</code>.
     /// \note Only \c daemonizer has access to this method.
+    /// \note Process file descriptor is opened by this method. Since daemon
+    /// is not child of the calling process, there is short window between
+    /// daemon reporting its PID and opening the descriptor, during which the
+    /// daemon may terminate and its PID may be reused. Once opened, however,
+    /// the descriptor refers to the same process for its whole lifetime.
+    /// In case process file descriptors are not supported, daemon falls
+    /// back to PID only.
     void set_pid(process_id pid);
 
+    /// \brief Set daemonization report.
+    /// \param report Daemonization report.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \note Only \c daemonizer has access to this method.
+    void set_report(const daemonization_report &report);
+
     friend class daemonizer;
 
   public:
@@ -56,6 +79,25 @@ class daemon : private boost::noncopyable
     /// no-throw
     process_id get_pid() const;
 
+    /// \brief Get daemonization report.
+    /// \return Timing of daemonization phases.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \note Report is complete once the daemonization is over (i.e. it is
+    /// not complete yet during daemon controller's \c postdaemonize).
+    const daemonization_report & get_report() const;
+
+    /// \brief Get native handle of the daemon.
+    /// \return Process file descriptor, or \c -1 in case daemon is not valid
+    /// or process file descriptors are not supported.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \note Returned descriptor becomes readable when the daemon terminates,
+    /// so it can be multiplexed by \c poll, \c select or \c epoll (although
+    /// daemon can not be waited for, since it is not child of the calling
+    /// process). It remains owned by the daemon object.
+    file_descriptor_type native_handle() const;
+
     /// \brief Determine whether the daemon is valid.
     /// \retval true Daemon with valid process ID.
     /// \retval false Not a process.
@@ -80,13 +122,21 @@ class daemon : private boost::noncopyable
     /// exception with error code "no souch process", although
     /// daemon validity precondition was met. Unfortunately,
     /// there is no way how to really solve this problem - see
-    /// \c daemon::valid() method.
+    /// \c daemon::valid() method. Nevertheless, when process file
+    /// descriptor is available, signal is guaranteed to be never
+    /// delivered to unrelated process reusing daemon's PID.
     void kill(signal_number_type signal);
 
   private:
 
     /// \brief Process ID.
     process_id pid_;
+
+    /// \brief Process file descriptor.
+    file_descriptor_type pidfd_;
+
+    /// \brief Daemonization report.
+    daemonization_report report_;
 };
 
 
@@ -49,6 +49,19 @@ class daemon_template : public daemon
     /// will not be redirected, if ommited.
     /// \param reset_signals_flag Reset all signal handlers to default values
     /// in the daemon process.
+    /// \param inherited_fds File descriptors to be inherited by the daemon
+    /// process (see \c daemonizer).
+    /// \param ready_stage Readiness stage to wait for (see \c daemonizer).
+    /// \param ready_timeout Maximal time to wait for the readiness stage.
+    /// \param mode Daemonization mode (see \c daemonizer).
+    /// \param lock_memory_flag Lock all the memory of the daemon process
+    /// (see \c daemonizer).
+    /// \param transparent_huge_pages Transparent huge pages policy of the
+    /// daemon process (see \c daemonizer).
+    /// \param oom_score_adj OOM score adjustment of the daemon process
+    /// (see \c daemonizer).
+    /// \param prefault_size Size of heap to be prefaulted in the daemon
+    /// process (see \c daemonizer).
     /// \par Abrahams exception guarantee:
     /// strong
     /// \pre All redirection paths must be existing, valid and accessible.
@@ -62,7 +75,15 @@ class daemon_template : public daemon
       const daemonizer::stdin_redirect_type &stdin_redirect = daemonizer::stdin_redirect_type(),
       const daemonizer::stdout_redirect_type &stdout_redirect = daemonizer::stdout_redirect_type(),
       const daemonizer::stderr_redirect_type &stderr_redirect = daemonizer::stderr_redirect_type(),
-      const daemonizer::reset_signals_flag_type &reset_signals_flag = daemonizer::reset_signals_flag_type()
+      const daemonizer::reset_signals_flag_type &reset_signals_flag = daemonizer::reset_signals_flag_type(),
+      const daemonizer::inherited_fds_type &inherited_fds = daemonizer::inherited_fds_type(),
+      const daemonizer::ready_stage_type &ready_stage = daemonizer::ready_stage_type(),
+      const daemonizer::ready_timeout_type &ready_timeout = daemonizer::ready_timeout_type(),
+      const daemonizer::mode_type &mode = daemonizer::mode_type(),
+      const daemonizer::lock_memory_flag_type &lock_memory_flag = daemonizer::lock_memory_flag_type(),
+      const daemonizer::transparent_huge_pages_type &transparent_huge_pages = daemonizer::transparent_huge_pages_type(),
+      const daemonizer::oom_score_adj_type &oom_score_adj = daemonizer::oom_score_adj_type(),
+      const daemonizer::prefault_size_type &prefault_size = daemonizer::prefault_size_type()
     );
 
   public:
@@ -81,6 +102,13 @@ class daemon_template : public daemon
     /// \pre Object must not be created by default constructor.
     daemon_ctl & get_daemon_ctl();
 
+    /// \brief Get reached readiness stages.
+    /// \return Readiness stages reached by the daemon process.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \pre Object must not be created by default constructor.
+    const daemonizer::ready_stage_list_type & get_ready_stages() const;
+
   private:
 
     /// \brief Daemonizer.
@@ -0,0 +1,46 @@
+/// \file sheratan/process/posix/daemonization_mode.hpp
+/// \brief POSIX daemonization mode definition.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#ifndef HG_SHERATAN_PROCESS_POSIX_DAEMONIZATION_MODE_HPP
+#define HG_SHERATAN_PROCESS_POSIX_DAEMONIZATION_MODE_HPP
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+/// \brief Daemonization mode.
+/// \ingroup sheratan_process_posix
+/// \nosubgrouping
+/// \note Process supervisors (service managers, container runtimes) keep
+/// track of the process they have started themselves. Detaching from it
+/// by double fork hides the daemon from them and it is pure startup
+/// overhead, therefore \c FOREGROUND mode is to be used in such case.
+struct daemonization_mode
+{
+  /// \brief Daemonization mode values.
+  typedef enum
+  {
+    DETACHED   = 0,  ///< Double fork, new session, file descriptors closed.
+    FOREGROUND = 1   ///< Daemon routine executed in the calling (supervised) process.
+  } value_type;
+};
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+#endif // HG_SHERATAN_PROCESS_POSIX_DAEMONIZATION_MODE_HPP
+
+
+// vim: set ts=2 sw=2 et:
@@ -0,0 +1,132 @@
+/// \file sheratan/process/posix/daemonization_report.hpp
+/// \brief Daemonization report POSIX implementation interface.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#ifndef HG_SHERATAN_PROCESS_POSIX_DAEMONIZATION_REPORT_HPP
+#define HG_SHERATAN_PROCESS_POSIX_DAEMONIZATION_REPORT_HPP
+
+
+#include <boost/array.hpp>
+
+#include "sheratan/process/posix/types.hpp"
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+class daemonization_resources;
+
+
+/// \brief POSIX daemonization report.
+/// \ingroup sheratan_process_posix
+/// \nosubgrouping
+/// \note Report consists of monotonic clock timestamps, taken at the end
+/// of each daemonization phase, in whichever process the phase is executed.
+/// Timestamps taken by the child process and by the daemon are passed to the
+/// calling process along with the daemon's PID.
+class daemonization_report
+{
+  public:
+
+    /// \brief Daemonization phase.
+    struct phase
+    {
+      /// \brief Daemonization phase values (in order of execution).
+      typedef enum
+      {
+        PREDAEMONIZE = 0,        ///< Daemon controller's \c predaemonize (calling process).
+        INIT_PARENT = 1,         ///< Signal blocking, PID file lock and notification socket (calling process).
+        FIRST_FORK = 2,          ///< First fork, up to the child process running (child process).
+        SETSID = 3,              ///< New session (child process).
+        SECOND_FORK = 4,         ///< Second fork, up to the daemon running (daemon).
+        FD_SANITIZATION = 5,     ///< File creation mask, working directory and closing of file descriptors (daemon).
+        STREAM_REDIRECTION = 6,  ///< Inherited file descriptors set aside and standard streams redirection (daemon).
+        PID_FILE = 7,            ///< PID file written (daemon).
+        PID_REPORT = 8,          ///< Remaining daemon initialization (e.g. memory policy) and PID passed to calling process (calling process).
+        READINESS = 9,           ///< Waiting for the daemon to be ready, if requested (calling process).
+        POSTDAEMONIZE = 10,      ///< Daemon controller's \c postdaemonize (calling process).
+        COUNT = 11               ///< Number of phases.
+      } value_type;
+    };
+
+  public:
+
+    /// \brief Default constructor.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \post <code>this->complete() == false</code>
+    daemonization_report();
+
+  public:
+
+    /// \brief Determine whether all the phases have been recorded.
+    /// \retval true Report is complete.
+    /// \retval false Daemonization has not been completed (yet).
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    bool complete() const;
+
+    /// \brief Get duration of daemonization phase.
+    /// \param p Daemonization phase.
+    /// \return Time elapsed since the end of preceding phase (or since the
+    /// beginning of daemonization), until the end of specified phase.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \pre <code>this->complete() == true</code>
+    /// \pre <code>p < phase::COUNT</code>
+    system_duration_type get_duration(phase::value_type p) const;
+
+    /// \brief Get total duration of daemonization.
+    /// \return Time elapsed since the beginning of daemonization, until the
+    /// end of its last phase.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \pre <code>this->complete() == true</code>
+    system_duration_type get_total() const;
+
+  private:
+
+    /// \brief Monotonic clock timestamps type definition.
+    /// \note First timestamp is taken at the beginning of daemonization,
+    /// timestamp of each phase follows.
+    typedef boost::array<system_duration_type, phase::COUNT + 1> timestamps_type;
+
+  private:
+
+    /// \brief Start recording, forget all the timestamps recorded so far.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    void start();
+
+    /// \brief Record the end of daemonization phase.
+    /// \param p Daemonization phase.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    void mark(phase::value_type p);
+
+    friend class daemonization_resources;
+
+  private:
+
+    /// \brief Monotonic clock timestamps (time since unspecified starting point).
+    timestamps_type timestamps_;
+};
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+#endif // HG_SHERATAN_PROCESS_POSIX_DAEMONIZATION_REPORT_HPP
+
+
+// vim: set ts=2 sw=2 et:
@@ -8,14 +8,22 @@
 #define HG_SHERATAN_PROCESS_POSIX_DAEMONIZER_HPP
 
 
+#include <cstddef>
 #include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include <boost/noncopyable.hpp>
 
 #include "sheratan/utility/explicit_value.hpp"
+#include "sheratan/process/posix/fwd.hpp"
 #include "sheratan/process/posix/types.hpp"
+#include "sheratan/process/posix/exit_status.hpp"
 #include "sheratan/process/posix/process_id.hpp"
 #include "sheratan/process/posix/daemon_ctl.hpp"
+#include "sheratan/process/posix/daemonization_mode.hpp"
+#include "sheratan/process/posix/transparent_huge_pages.hpp"
 
 
 namespace sheratan {
@@ -193,6 +201,268 @@ class daemonizer : private boost::noncopyable
     /// \brief Reset signal dispositions to default flag type definition.
     typedef sheratan::utility::explicit_value<daemonizer::reset_signals_flag_value_traits, daemonizer::reset_signals_flag_value_traits::tag::RESET_SIGNALS_FLAG> reset_signals_flag_type;
 
+    /// \brief Inherited file descriptors value traits.
+    /// \ingroup sheratan_process_posix
+    /// \nosubgrouping
+    struct inherited_fds_value_traits
+    {
+      /// \brief Value type.
+      typedef std::vector<file_descriptor_type> value_type;
+
+      /// \brief Value tag.
+      /// \ingroup sheratan_process_posix
+      /// \nosubgrouping
+      struct tag
+      {
+        /// \brief Value tag values.
+        typedef enum
+        {
+          INHERITED_FDS ///< Inherited file descriptors.
+        } value_type;
+      };
+
+      /// \brief Default value.
+      /// \return Default value.
+      /// \par Abrahams exception guarantee:
+      /// strong
+      static inherited_fds_value_traits::value_type default_value();
+    };
+
+    /// \brief Inherited file descriptors type definition.
+    typedef sheratan::utility::explicit_value<daemonizer::inherited_fds_value_traits, daemonizer::inherited_fds_value_traits::tag::INHERITED_FDS> inherited_fds_type;
+
+    /// \brief Readiness stage value traits.
+    /// \ingroup sheratan_process_posix
+    /// \nosubgrouping
+    struct ready_stage_value_traits
+    {
+      /// \brief Value type.
+      typedef std::string value_type;
+
+      /// \brief Value tag.
+      /// \ingroup sheratan_process_posix
+      /// \nosubgrouping
+      struct tag
+      {
+        /// \brief Value tag values.
+        typedef enum
+        {
+          READY_STAGE ///< Readiness stage.
+        } value_type;
+      };
+
+      /// \brief Default value.
+      /// \return Default value.
+      /// \par Abrahams exception guarantee:
+      /// strong
+      static ready_stage_value_traits::value_type default_value();
+    };
+
+    /// \brief Readiness stage type definition.
+    typedef sheratan::utility::explicit_value<daemonizer::ready_stage_value_traits, daemonizer::ready_stage_value_traits::tag::READY_STAGE> ready_stage_type;
+
+    /// \brief Readiness timeout value traits.
+    /// \ingroup sheratan_process_posix
+    /// \nosubgrouping
+    struct ready_timeout_value_traits
+    {
+      /// \brief Value type.
+      typedef system_duration_type value_type;
+
+      /// \brief Value tag.
+      /// \ingroup sheratan_process_posix
+      /// \nosubgrouping
+      struct tag
+      {
+        /// \brief Value tag values.
+        typedef enum
+        {
+          READY_TIMEOUT ///< Readiness timeout.
+        } value_type;
+      };
+
+      /// \brief Default value.
+      /// \return Default value.
+      /// \par Abrahams exception guarantee:
+      /// strong
+      static ready_timeout_value_traits::value_type default_value();
+    };
+
+    /// \brief Readiness timeout type definition.
+    typedef sheratan::utility::explicit_value<daemonizer::ready_timeout_value_traits, daemonizer::ready_timeout_value_traits::tag::READY_TIMEOUT> ready_timeout_type;
+
+    /// \brief Daemonization mode value traits.
+    /// \ingroup sheratan_process_posix
+    /// \nosubgrouping
+    struct mode_value_traits
+    {
+      /// \brief Value type.
+      typedef daemonization_mode::value_type value_type;
+
+      /// \brief Value tag.
+      /// \ingroup sheratan_process_posix
+      /// \nosubgrouping
+      struct tag
+      {
+        /// \brief Value tag values.
+        typedef enum
+        {
+          MODE ///< Daemonization mode.
+        } value_type;
+      };
+
+      /// \brief Default value.
+      /// \return Default value.
+      /// \par Abrahams exception guarantee:
+      /// strong
+      static mode_value_traits::value_type default_value();
+    };
+
+    /// \brief Daemonization mode type definition.
+    typedef sheratan::utility::explicit_value<daemonizer::mode_value_traits, daemonizer::mode_value_traits::tag::MODE> mode_type;
+
+    /// \brief Lock memory flag value traits.
+    /// \ingroup sheratan_process_posix
+    /// \nosubgrouping
+    struct lock_memory_flag_value_traits
+    {
+      /// \brief Value type.
+      typedef bool value_type;
+
+      /// \brief Value tag.
+      /// \ingroup sheratan_process_posix
+      /// \nosubgrouping
+      struct tag
+      {
+        /// \brief Value tag values.
+        typedef enum
+        {
+          LOCK_MEMORY_FLAG ///< Lock memory flag.
+        } value_type;
+      };
+
+      /// \brief Default value.
+      /// \return Default value.
+      /// \par Abrahams exception guarantee:
+      /// strong
+      static lock_memory_flag_value_traits::value_type default_value();
+    };
+
+    /// \brief Lock all the memory of the daemon flag type definition.
+    typedef sheratan::utility::explicit_value<daemonizer::lock_memory_flag_value_traits, daemonizer::lock_memory_flag_value_traits::tag::LOCK_MEMORY_FLAG> lock_memory_flag_type;
+
+    /// \brief Transparent huge pages policy value traits.
+    /// \ingroup sheratan_process_posix
+    /// \nosubgrouping
+    struct transparent_huge_pages_value_traits
+    {
+      /// \brief Value type.
+      typedef transparent_huge_pages::value_type value_type;
+
+      /// \brief Value tag.
+      /// \ingroup sheratan_process_posix
+      /// \nosubgrouping
+      struct tag
+      {
+        /// \brief Value tag values.
+        typedef enum
+        {
+          TRANSPARENT_HUGE_PAGES ///< Transparent huge pages policy.
+        } value_type;
+      };
+
+      /// \brief Default value.
+      /// \return Default value.
+      /// \par Abrahams exception guarantee:
+      /// strong
+      static transparent_huge_pages_value_traits::value_type default_value();
+    };
+
+    /// \brief Transparent huge pages policy type definition.
+    typedef sheratan::utility::explicit_value<daemonizer::transparent_huge_pages_value_traits, daemonizer::transparent_huge_pages_value_traits::tag::TRANSPARENT_HUGE_PAGES> transparent_huge_pages_type;
+
+    /// \brief OOM score adjustment value traits.
+    /// \ingroup sheratan_process_posix
+    /// \nosubgrouping
+    struct oom_score_adj_value_traits
+    {
+      /// \brief Value type.
+      typedef int value_type;
+
+      /// \brief Value tag.
+      /// \ingroup sheratan_process_posix
+      /// \nosubgrouping
+      struct tag
+      {
+        /// \brief Value tag values.
+        typedef enum
+        {
+          OOM_SCORE_ADJ ///< OOM score adjustment.
+        } value_type;
+      };
+
+      /// \brief Default value.
+      /// \return Default value.
+      /// \par Abrahams exception guarantee:
+      /// strong
+      static oom_score_adj_value_traits::value_type default_value();
+    };
+
+    /// \brief OOM score adjustment type definition.
+    typedef sheratan::utility::explicit_value<daemonizer::oom_score_adj_value_traits, daemonizer::oom_score_adj_value_traits::tag::OOM_SCORE_ADJ> oom_score_adj_type;
+
+    /// \brief Heap prefault size value traits.
+    /// \ingroup sheratan_process_posix
+    /// \nosubgrouping
+    struct prefault_size_value_traits
+    {
+      /// \brief Value type.
+      typedef std::size_t value_type;
+
+      /// \brief Value tag.
+      /// \ingroup sheratan_process_posix
+      /// \nosubgrouping
+      struct tag
+      {
+        /// \brief Value tag values.
+        typedef enum
+        {
+          PREFAULT_SIZE ///< Prefault size.
+        } value_type;
+      };
+
+      /// \brief Default value.
+      /// \return Default value.
+      /// \par Abrahams exception guarantee:
+      /// strong
+      static prefault_size_value_traits::value_type default_value();
+    };
+
+    /// \brief Heap prefault size type definition.
+    typedef sheratan::utility::explicit_value<daemonizer::prefault_size_value_traits, daemonizer::prefault_size_value_traits::tag::PREFAULT_SIZE> prefault_size_type;
+
+    /// \brief Reached readiness stages (pairs <stage name, time of arrival>) type definition.
+    typedef std::vector<std::pair<std::string, system_time_type> > ready_stage_list_type;
+
+    /// \brief Borrowed daemon controller tag.
+    struct borrowed_daemon_ctl_tag
+    {
+    };
+
+  public:
+
+    /// \brief First file descriptor inherited by the daemon process
+    /// (\c SD_LISTEN_FDS_START of socket activation protocol).
+    static const file_descriptor_type LISTEN_FDS_START;
+
+    /// \brief Name of readiness stage reported by \c READY=1 notification,
+    /// which implies all the other stages.
+    static const char READY_STAGE[];
+
+    /// \brief OOM score adjustment, which keeps the one inherited from
+    /// the calling process.
+    static const int OOM_SCORE_ADJ_INHERIT;
+
   public:
 
     /// \brief Default constructor.
@@ -203,7 +473,10 @@ class daemonizer : private boost::noncopyable
     /// \brief Constructor.
     /// \param dc Daemon controller.
     /// \param pid_file Path to the daemon's PID file. No PID file will be
-    /// used, if ommited.
+    /// used, if ommited. PID file is locked by the calling process before
+    /// any process is forked and the lock is handed down to the daemon, so
+    /// that already running instance is detected immediately
+    /// (\c errnum::PIDFILE_LOCKED).
     /// \param pid_file_mode Mode to be used for creation of PID file.
     /// \param working_dir Path to the daemon's working directory. Working
     /// directory will not be changed, if ommited.
@@ -215,8 +488,67 @@ class daemonizer : private boost::noncopyable
     /// will not be redirected, if ommited.
     /// \param reset_signals_flag Reset all signal handlers to default values
     /// in the daemon process.
+    /// \param inherited_fds File descriptors (typically pre-bound listening
+    /// sockets) to be inherited by the daemon process. No file descriptors
+    /// (except for standard streams) are inherited, if ommited.
+    /// \param ready_stage Readiness stage to wait for (\c READY_STAGE or
+    /// name of stage reported by \c readiness_notifier::stage). Daemonization
+    /// is done as soon as the daemon process is started, if ommited.
+    /// \param ready_timeout Maximal time to wait for the readiness stage.
+    /// \param mode Daemonization mode. Daemon is detached from the calling
+    /// process, if ommited.
+    /// \param lock_memory_flag Lock all the current and future memory
+    /// pages of the daemon process in RAM (\c mlockall).
+    /// \param transparent_huge_pages Transparent huge pages policy of the
+    /// daemon process. Policy is not changed, if ommited.
+    /// \param oom_score_adj OOM score adjustment of the daemon process
+    /// (from -1000 to 1000, see \c /proc/[pid]/oom_score_adj). OOM score
+    /// adjustment is inherited from the calling process, if ommited.
+    /// \param prefault_size Size of heap (in bytes) to be allocated and
+    /// touched in the daemon process in advance, so that page faults are
+    /// not taken on its serving path. No heap is prefaulted, if ommited.
     /// \par Abrahams exception guarantee:
     /// strong
+    /// \pre Inherited file descriptors must be open and distinct from
+    /// standard streams.
+    /// \pre OOM score adjustment must be \c OOM_SCORE_ADJ_INHERIT or it
+    /// must be in range from -1000 to 1000.
+    /// \note Inherited file descriptors are passed to the daemon process
+    /// using socket activation protocol: they are moved to file descriptors
+    /// <code>LISTEN_FDS_START</code>, <code>LISTEN_FDS_START + 1</code>, ...
+    /// in the order they are listed, and \c LISTEN_FDS and \c LISTEN_PID
+    /// environment variables are set accordingly before
+    /// \c daemon_ctl::daemonized_child is called. Without inherited file
+    /// descriptors, these environment variables are unset in the daemon.
+    /// \note In case the readiness stage is requested, \c NOTIFY_SOCKET
+    /// environment variable is set in the daemon process and notifications
+    /// sent by the daemon process itself (rather than by its children) are
+    /// accepted (see \c readiness_notifier). Daemon failing to reach the
+    /// readiness stage in time is asked to terminate (\c SIGTERM) and
+    /// daemonization fails.
+    /// \note In \c daemonization_mode::FOREGROUND mode, the calling process
+    /// becomes the daemon process: it neither forks, nor starts new session,
+    /// nor closes file descriptors and file creation mask is kept. Working
+    /// directory, standard streams redirection, PID file, inherited file
+    /// descriptors and signal dispositions are set up the same way as in the
+    /// detached daemon. Socket activation environment variables are kept
+    /// as they are (e.g. set by supervisor) without inherited file
+    /// descriptors and readiness stage is not waited for (notifications are
+    /// sent to supervisor's \c NOTIFY_SOCKET, if any). Other file
+    /// descriptors of the calling process, which occupy the range inherited
+    /// file descriptors are passed in, are not replaced: they are moved
+    /// above the range (with close-on-exec flag set), i.e. they stay open
+    /// under different numbers.
+    /// \note Memory policy (memory lock, transparent huge pages, OOM score
+    /// adjustment and heap prefault) is applied in the daemon process as
+    /// the last step of its initialization, i.e. before the daemon routine
+    /// is entered and before its readiness is waited for. Heap prefault
+    /// turns off both trimming of the heap and serving large allocations
+    /// by \c mmap in the daemon process (\c mallopt), so that prefaulted
+    /// memory is kept and reused rather than returned to the system. In
+    /// case any of the policies can not be applied (e.g. memory lock
+    /// exceeding \c RLIMIT_MEMLOCK, or lowering OOM score adjustment
+    /// without \c CAP_SYS_RESOURCE), daemonization fails.
     explicit daemonizer(
       const daemon_ctl &dc,
       const daemonizer::pid_file_type &pid_file = daemonizer::pid_file_type(),
@@ -225,9 +557,67 @@ class daemonizer : private boost::noncopyable
       const daemonizer::stdin_redirect_type &stdin_redirect = daemonizer::stdin_redirect_type(),
       const daemonizer::stdout_redirect_type &stdout_redirect = daemonizer::stdout_redirect_type(),
       const daemonizer::stderr_redirect_type &stderr_redirect = daemonizer::stderr_redirect_type(),
-      const daemonizer::reset_signals_flag_type &reset_signals_flag = daemonizer::reset_signals_flag_type()
+      const daemonizer::reset_signals_flag_type &reset_signals_flag = daemonizer::reset_signals_flag_type(),
+      const daemonizer::inherited_fds_type &inherited_fds = daemonizer::inherited_fds_type(),
+      const daemonizer::ready_stage_type &ready_stage = daemonizer::ready_stage_type(),
+      const daemonizer::ready_timeout_type &ready_timeout = daemonizer::ready_timeout_type(),
+      const daemonizer::mode_type &mode = daemonizer::mode_type(),
+      const daemonizer::lock_memory_flag_type &lock_memory_flag = daemonizer::lock_memory_flag_type(),
+      const daemonizer::transparent_huge_pages_type &transparent_huge_pages = daemonizer::transparent_huge_pages_type(),
+      const daemonizer::oom_score_adj_type &oom_score_adj = daemonizer::oom_score_adj_type(),
+      const daemonizer::prefault_size_type &prefault_size = daemonizer::prefault_size_type()
     );
 
+    /// \brief Constructor (borrowed daemon controller).
+    /// \param tag Borrowed daemon controller tag.
+    /// \param dc Daemon controller. It is used as it is, rather than cloned.
+    /// \param pid_file See the other constructor.
+    /// \param pid_file_mode See the other constructor.
+    /// \param working_dir See the other constructor.
+    /// \param stdin_redirect See the other constructor.
+    /// \param stdout_redirect See the other constructor.
+    /// \param stderr_redirect See the other constructor.
+    /// \param reset_signals_flag See the other constructor.
+    /// \param inherited_fds See the other constructor.
+    /// \param ready_stage See the other constructor.
+    /// \param ready_timeout See the other constructor.
+    /// \param mode See the other constructor.
+    /// \param lock_memory_flag See the other constructor.
+    /// \param transparent_huge_pages See the other constructor.
+    /// \param oom_score_adj See the other constructor.
+    /// \param prefault_size See the other constructor.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \pre Daemon controller must outlive the daemonizer.
+    /// \note Used by \c static_daemon_template, which holds the daemon
+    /// controller by value.
+    daemonizer(
+      daemonizer::borrowed_daemon_ctl_tag tag,
+      daemon_ctl &dc,
+      const daemonizer::pid_file_type &pid_file,
+      const daemonizer::pid_file_mode_type &pid_file_mode,
+      const daemonizer::working_dir_type &working_dir,
+      const daemonizer::stdin_redirect_type &stdin_redirect,
+      const daemonizer::stdout_redirect_type &stdout_redirect,
+      const daemonizer::stderr_redirect_type &stderr_redirect,
+      const daemonizer::reset_signals_flag_type &reset_signals_flag,
+      const daemonizer::inherited_fds_type &inherited_fds,
+      const daemonizer::ready_stage_type &ready_stage,
+      const daemonizer::ready_timeout_type &ready_timeout,
+      const daemonizer::mode_type &mode,
+      const daemonizer::lock_memory_flag_type &lock_memory_flag,
+      const daemonizer::transparent_huge_pages_type &transparent_huge_pages,
+      const daemonizer::oom_score_adj_type &oom_score_adj,
+      const daemonizer::prefault_size_type &prefault_size
+    );
+
+    /// \brief Destructor.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \note Intermediate (1st) child process of daemonization in progress
+    /// is joined.
+    ~daemonizer();
+
   public:
 
     /// \brief Get daemon controller.
@@ -244,6 +634,16 @@ class daemonizer : private boost::noncopyable
     /// \pre Object must not be created by default constructor.
     daemon_ctl & get_daemon_ctl();
 
+    /// \brief Get reached readiness stages.
+    /// \return Readiness stages reached by the daemon process (in order of
+    /// their arrival) during the last daemonization.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \pre Object must not be created by default constructor.
+    /// \note Only stages reported before the requested readiness stage has
+    /// been reached are listed (the requested stage included).
+    const daemonizer::ready_stage_list_type & get_ready_stages() const;
+
   public:
 
     /// \brief Daemonize.
@@ -254,12 +654,107 @@ class daemonizer : private boost::noncopyable
     /// \note Call to this method will spawn a new process and return
     /// in its calling process. However, it will never return in daemon
     /// process.
+    /// \note In case readiness stage is requested, this method returns
+    /// once the daemon process reaches it.
+    /// \note Timing of daemonization phases is available from the daemon
+    /// process object (see \c daemon::get_report) afterwards.
+    /// \note In \c daemonization_mode::FOREGROUND mode, the daemon process
+    /// is the calling process. Therefore, this method never returns then:
+    /// \c daemon_ctl::postdaemonize is not called and the calling process
+    /// exits with status returned by \c daemon_ctl::daemonized_child.
+    /// \note Calling process is expected to be single-threaded (or its other
+    /// threads are expected to block at least the signals terminating the
+    /// process), see \c begin_daemonize.
     void daemonize(daemon &daemon_process);
 
+    /// \brief Begin daemonization without waiting for its outcome.
+    /// \return Intermediate (1st) child process, termination of which
+    /// completes daemonization.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \pre Object must not be created by default constructor.
+    /// \pre No daemonization is in progress.
+    /// \pre Daemonization mode is \c daemonization_mode::DETACHED.
+    /// \note Caller is expected to wait for the returned process by other
+    /// means (e.g. using \c reactor), join it and pass its exit status to
+    /// \c end_daemonize. Returned process is owned by the daemonizer.
+    /// \note All signals remain blocked in calling thread until the
+    /// intermediate (1st) child process is joined and passed to
+    /// \c end_daemonize, they are delivered before waiting for readiness.
+    /// \note Signals are blocked in the calling thread only, their
+    /// dispositions are not changed. In multithreaded process, signal
+    /// directed to the process (e.g. \c SIGTERM) is delivered to another
+    /// thread, which does not block it, and its default action may terminate
+    /// the calling process in the middle of daemonization (the daemon keeps
+    /// running, while \c daemon_ctl::postdaemonize is not called and PID
+    /// file is not handled). Calling process is thus expected to be
+    /// single-threaded, or its other threads are expected to block such
+    /// signals.
+    process & begin_daemonize();
+
+    /// \brief End daemonization started by \c begin_daemonize.
+    /// \param daemon_process Daemon process object.
+    /// \param first_child_status Exit status of the intermediate (1st) child process.
+    /// \param nonblocking If set, this method will not block.
+    /// \retval true Daemonization is ended.
+    /// \retval false Daemon has not reached requested readiness stage yet
+    /// (non-blocking call only), see \c continue_daemonize.
+    /// \par Abrahams exception guarantee:
+    /// weak
+    /// \pre Intermediate (1st) child process of daemonization is in progress.
+    /// \pre <code>first_child_status.valid() == true</code>
+    /// \note Failure of the daemonization is reported by exception, the same
+    /// way as by \c daemonize method. Daemonization is ended then.
+    /// \note In case readiness stage is requested, blocking call waits until
+    /// the daemon process reaches it.
+    /// \note Daemonization report covers the phases from \c begin_daemonize
+    /// on, waiting for the intermediate (1st) child process is accounted to
+    /// \c daemonization_report::phase::PID_REPORT phase.
+    bool end_daemonize(daemon &daemon_process, const exit_status &first_child_status, bool nonblocking = false);
+
+    /// \brief Continue waiting for daemon to reach requested readiness stage.
+    /// \param daemon_process Daemon process object.
+    /// \param nonblocking If set, this method will not block.
+    /// \retval true Daemonization is ended.
+    /// \retval false Daemon has not reached requested readiness stage yet
+    /// (non-blocking call only).
+    /// \par Abrahams exception guarantee:
+    /// weak
+    /// \pre Previous call to \c end_daemonize (or to this method) returned \c false.
+    /// \note Failure of the daemonization (the daemon exits or it is not
+    /// ready in time) is reported by exception. Daemonization is ended then.
+    bool continue_daemonize(daemon &daemon_process, bool nonblocking = false);
+
+    /// \brief Get native handle of readiness wait.
+    /// \return File descriptor, which becomes readable once the daemon
+    /// reports its readiness stage, exits, or the readiness timeout expires,
+    /// or \c -1 in case no readiness wait is in progress.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \pre Object must not be created by default constructor.
+    /// \note It is intended to be watched by an event loop (e.g. \c reactor),
+    /// which calls \c continue_daemonize then. File descriptor is closed once
+    /// the daemonization is ended, so it must be unwatched beforehand.
+    file_descriptor_type native_handle() const;
+
+  private:
+
+    /// \brief Wait for readiness and finish daemonization in parent process.
+    /// \param daemon_process Daemon process object.
+    /// \param nonblocking If set, this method will not block.
+    /// \retval true Daemonization is ended.
+    /// \retval false Daemon has not reached requested readiness stage yet.
+    /// \par Abrahams exception guarantee:
+    /// weak
+    bool finish_daemonize(daemon &daemon_process, bool nonblocking);
+
   private:
 
     /// \brief Daemonizer resources.
     std::auto_ptr<daemonization_resources> resources_;
+
+    /// \brief Intermediate (1st) child process of daemonization in progress.
+    std::auto_ptr<process> first_child_;
 };
 
 
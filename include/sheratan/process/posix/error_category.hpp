@@ -29,11 +29,14 @@ struct errnum
   /// \brief Process managemet library POSIX implementation error category errnum values.
   typedef enum
   {
-    UNKNOWN        = 0,  ///< Unknown error.
-    POSIX_SYSTEM   = 1,  ///< POSIX/ANSI C system error. Error information item \c posix_errnum is set.
-    BOOST_SYSTEM   = 2,  ///< Boost system error. Error information item \c boost_errnum is set.
-    DAEMON_ERROR   = 3,  ///< Error in daemon process.
-    PIDFILE_LOCKED = 4   ///< Daemon PID file (a.k.a. lock file) already locked.
+    UNKNOWN          = 0, ///< Unknown error.
+    POSIX_SYSTEM     = 1, ///< POSIX/ANSI C system error. Error information item \c posix_errnum is set.
+    BOOST_SYSTEM     = 2, ///< Boost system error. Error information item \c boost_errnum is set.
+    DAEMON_ERROR     = 3, ///< Error in daemon process.
+    PIDFILE_LOCKED   = 4, ///< Daemon PID file (a.k.a. lock file) already locked.
+    HANDOVER_FAILED  = 5, ///< Hot restart successor failed to take over.
+    DAEMON_NOT_READY = 6, ///< Daemon failed to reach requested readiness stage.
+    ZYGOTE_FAILED    = 7  ///< Zygote process failed to initialize or it is gone.
   } value_type;
 };
 
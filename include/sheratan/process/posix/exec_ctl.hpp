@@ -0,0 +1,164 @@
+/// \file sheratan/process/posix/exec_ctl.hpp
+/// \brief POSIX exec controller interface.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#ifndef HG_SHERATAN_PROCESS_POSIX_EXEC_CTL_HPP
+#define HG_SHERATAN_PROCESS_POSIX_EXEC_CTL_HPP
+
+
+#include <string>
+#include <vector>
+
+#include "sheratan/process/posix/fwd.hpp"
+#include "sheratan/process/posix/fork_ctl.hpp"
+#include "sheratan/process/posix/exit_status.hpp"
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+/// \brief POSIX exec controller.
+/// \ingroup sheratan_process_posix
+/// \nosubgrouping
+/// \note Exec controller is fork controller, which child routine
+/// does nothing but executes new program image. It is the only kind
+/// of fork controller, which may be used with spawn methods other than
+/// \c spawn_method::FORK (see \c forker class).
+/// \note Derived classes overriding \c prefork method must call
+/// \c exec_ctl::prefork method, since it prepares argument and
+/// environment vectors for the child. Derived classes must not
+/// override \c child method, since it is not executed at all for
+/// spawn methods other than \c spawn_method::FORK.
+class exec_ctl : public fork_ctl
+{
+  public:
+
+    /// \brief String list type definition.
+    typedef std::vector<std::string> string_list_type;
+
+    /// \brief Exit status of the child process, which failed to execute
+    /// new program image.
+    static const exit_status::value_type EXEC_FAILURE;
+
+  public:
+
+    /// \brief Constructor.
+    /// \param path Path to the program image to be executed.
+    /// \param args Argument vector (including the program name) of the program.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \note Environment of the calling process is inherited.
+    exec_ctl(const std::string &path, const exec_ctl::string_list_type &args);
+
+    /// \brief Constructor.
+    /// \param path Path to the program image to be executed.
+    /// \param args Argument vector (including the program name) of the program.
+    /// \param env Environment of the program (list of \c NAME=value strings).
+    /// \par Abrahams exception guarantee:
+    /// strong
+    exec_ctl(const std::string &path, const exec_ctl::string_list_type &args, const exec_ctl::string_list_type &env);
+
+    /// \brief Copy constructor.
+    /// \param that Other instance to copy from.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    exec_ctl(const exec_ctl &that);
+
+  public:
+
+    virtual fork_ctl * clone() const;
+
+  public:
+
+    virtual void prefork();
+
+    virtual void postfork(process &child_process);
+
+    virtual exit_status::value_type child();
+
+  public:
+
+    /// \brief Get path to the program image.
+    /// \return Path to the program image.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    const std::string & get_path() const;
+
+    /// \brief Get argument vector.
+    /// \return Argument vector.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    const exec_ctl::string_list_type & get_args() const;
+
+    /// \brief Get environment.
+    /// \return Environment.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \pre <code>this->inherits_env() == false</code>
+    const exec_ctl::string_list_type & get_env() const;
+
+    /// \brief Determine whether the environment of calling process is inherited.
+    /// \retval true Environment is inherited.
+    /// \retval false Environment is specified explicitly.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    bool inherits_env() const;
+
+    /// \brief Get \c NULL terminated argument vector.
+    /// \return Argument vector suitable for \c execve.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \pre \c prefork method must have been called.
+    /// \note Returned vector points into this object, it is not
+    /// allocated, which makes it usable after \c vfork.
+    char * const * get_argv() const;
+
+    /// \brief Get \c NULL terminated environment vector.
+    /// \return Environment vector suitable for \c execve.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \pre \c prefork method must have been called.
+    /// \note Returned vector points into this object (or into \c environ,
+    /// if environment is inherited), it is not allocated, which makes it
+    /// usable after \c vfork.
+    char * const * get_envp() const;
+
+  private:
+
+    /// \brief Path to the program image.
+    std::string path_;
+
+    /// \brief Argument vector.
+    exec_ctl::string_list_type args_;
+
+    /// \brief Environment.
+    exec_ctl::string_list_type env_;
+
+    /// \brief Flag determining whether environment is inherited.
+    bool inherit_env_;
+
+    /// \brief \c NULL terminated argument vector.
+    std::vector<char *> argv_;
+
+    /// \brief \c NULL terminated environment vector.
+    std::vector<char *> envp_;
+};
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+#endif // HG_SHERATAN_PROCESS_POSIX_EXEC_CTL_HPP
+
+
+// vim: set ts=2 sw=2 et:
@@ -64,10 +64,11 @@ class exit_status
     /// no-throw
     /// \post <code>after->valid() == true</code>
     /// \post <code>after->get_value() == value</code>
-    /// \note Only \c process has access to this constructor.
+    /// \note Only \c process and \c process_pool have access to this constructor.
     explicit exit_status(exit_status::value_type value);
 
     friend class process;
+    friend class process_pool;
 
   public:
 
@@ -0,0 +1,156 @@
+/// \file sheratan/process/posix/fd_sanitizer.hpp
+/// \brief File descriptor sanitizer POSIX implementation interface.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#ifndef HG_SHERATAN_PROCESS_POSIX_FD_SANITIZER_HPP
+#define HG_SHERATAN_PROCESS_POSIX_FD_SANITIZER_HPP
+
+
+#include <vector>
+
+#include "sheratan/process/posix/types.hpp"
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+/// \brief File descriptor sanitizer POSIX implementation.
+/// \ingroup sheratan_process_posix
+/// \nosubgrouping
+/// \note Sanitizer closes (or marks close-on-exec) all file descriptors
+/// of the calling process, except for the explicitly excluded ones. It is
+/// meant to be used in child process, typically from \c fork_ctl::child.
+/// \note The fastest method available is used: \c close_range(2) over
+/// the gaps between excluded file descriptors (Linux 5.9+, close-on-exec
+/// mode requires Linux 5.11+), then enumeration of <tt>/proc/self/fd</tt>
+/// and, as a last resort, iteration over the whole \c RLIMIT_NOFILE range.
+/// Excluded file descriptors are kept in a bitmap, so the check is O(1).
+class fd_sanitizer
+{
+  public:
+
+    /// \brief Sanitization mode.
+    struct mode
+    {
+      /// \brief Sanitization mode enumeration.
+      typedef enum
+      {
+        CLOSE = 0,        ///< Close file descriptors.
+        CLOSE_ON_EXEC = 1 ///< Set close-on-exec flag on file descriptors.
+      } value_type;
+    };
+
+    /// \brief Sanitization method.
+    struct method
+    {
+      /// \brief Sanitization method enumeration.
+      typedef enum
+      {
+        CLOSE_RANGE = 0, ///< \c close_range(2) system call.
+        PROC_FD = 1,     ///< Enumeration of <tt>/proc/self/fd</tt>.
+        BRUTE_FORCE = 2  ///< Iteration over \c RLIMIT_NOFILE range.
+      } value_type;
+    };
+
+  public:
+
+    /// \brief Default constructor.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \note Standard streams are not excluded by default.
+    fd_sanitizer();
+
+  public:
+
+    /// \brief Exclude file descriptor from sanitization.
+    /// \param fd File descriptor.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \pre <code>fd >= 0</code>
+    void exclude(file_descriptor_type fd);
+
+    /// \brief Exclude standard streams (\c stdin, \c stdout and \c stderr) from sanitization.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    void exclude_std_streams();
+
+    /// \brief Check whether file descriptor is excluded from sanitization.
+    /// \param fd File descriptor.
+    /// \retval true File descriptor is excluded.
+    /// \retval false File descriptor is not excluded.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    bool excluded(file_descriptor_type fd) const;
+
+    /// \brief Sanitize file descriptors of the calling process.
+    /// \param sanitization_mode Sanitization mode.
+    /// \return Sanitization method, which has been used.
+    /// \par Abrahams exception guarantee:
+    /// weak
+    /// \note Closing file descriptor, which is not open, is not an error.
+    method::value_type sanitize(mode::value_type sanitization_mode = mode::CLOSE) const;
+
+    /// \brief Sanitize file descriptors of the calling process using given method.
+    /// \param sanitization_method Sanitization method.
+    /// \param sanitization_mode Sanitization mode.
+    /// \retval true File descriptors have been sanitized.
+    /// \retval false Method is not available, no file descriptor has been touched.
+    /// \par Abrahams exception guarantee:
+    /// weak
+    bool sanitize(method::value_type sanitization_method, mode::value_type sanitization_mode) const;
+
+  private:
+
+    /// \brief Sanitize file descriptors using \c close_range(2).
+    /// \param sanitization_mode Sanitization mode.
+    /// \retval true File descriptors have been sanitized.
+    /// \retval false System call is not available.
+    /// \par Abrahams exception guarantee:
+    /// weak
+    bool sanitize_close_range(mode::value_type sanitization_mode) const;
+
+    /// \brief Sanitize file descriptors listed in <tt>/proc/self/fd</tt>.
+    /// \param sanitization_mode Sanitization mode.
+    /// \retval true File descriptors have been sanitized.
+    /// \retval false Directory is not available.
+    /// \par Abrahams exception guarantee:
+    /// weak
+    bool sanitize_proc_fd(mode::value_type sanitization_mode) const;
+
+    /// \brief Sanitize all file descriptors below \c RLIMIT_NOFILE hard limit.
+    /// \param sanitization_mode Sanitization mode.
+    /// \par Abrahams exception guarantee:
+    /// weak
+    void sanitize_brute_force(mode::value_type sanitization_mode) const;
+
+    /// \brief Sanitize single file descriptor.
+    /// \param fd File descriptor.
+    /// \param sanitization_mode Sanitization mode.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    static void sanitize_fd(file_descriptor_type fd, mode::value_type sanitization_mode);
+
+  private:
+
+    /// \brief Bitmap of excluded file descriptors.
+    std::vector<bool> excluded_;
+};
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+#endif // HG_SHERATAN_PROCESS_POSIX_FD_SANITIZER_HPP
+
+
+// vim: set ts=2 sw=2 et:
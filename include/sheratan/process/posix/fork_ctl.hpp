@@ -56,6 +56,8 @@ class fork_ctl
     /// \return Return value of child process.
     /// \par Abrahams exception guarantee:
     /// strong
+    /// \note File descriptors inherited from the parent process may be
+    /// closed (or marked close-on-exec) here using \c fd_sanitizer.
     virtual exit_status::value_type child() = 0;
 };
 
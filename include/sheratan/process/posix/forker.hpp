@@ -14,6 +14,7 @@
 
 #include "sheratan/process/posix/process_id.hpp"
 #include "sheratan/process/posix/fork_ctl.hpp"
+#include "sheratan/process/posix/spawn_method.hpp"
 
 
 namespace sheratan {
@@ -37,9 +38,13 @@ class forker : private boost::noncopyable
 
     /// \brief Constructor.
     /// \param fc Fork controller.
+    /// \param method Spawn method.
     /// \par Abrahams exception guarantee:
     /// strong
-    explicit forker(const fork_ctl &fc);
+    /// \pre Fork controller must be an instance of \c exec_ctl class
+    /// (or some of its descendants) for other spawn methods than
+    /// \c spawn_method::FORK.
+    explicit forker(const fork_ctl &fc, spawn_method::value_type method = spawn_method::FORK);
 
   public:
 
@@ -57,6 +62,12 @@ class forker : private boost::noncopyable
     /// \pre Object must not be created by default constructor.
     fork_ctl & get_fork_ctl();
 
+    /// \brief Get spawn method.
+    /// \return Spawn method.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    spawn_method::value_type get_spawn_method() const;
+
   public:
 
     /// \brief Fork.
@@ -67,12 +78,29 @@ class forker : private boost::noncopyable
     /// \note Call to this method will spawn a new process and return
     /// in its calling process. However, it will never return in child
     /// process.
+    /// \note For other spawn methods than \c spawn_method::FORK, failure
+    /// of the child process to execute new program image is reported by
+    /// exception thrown from this method.
     void fork(process &child_process);
 
+    /// \brief Fork calling process.
+    /// \param child_process Child process object.
+    /// \retval true Call returned in the child process.
+    /// \retval false Call returned in the parent process.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \post <code>child_process.valid() == true</code> in the parent process.
+    /// \note No fork controller routine is executed, caller is responsible
+    /// for executing them (see \c static_process_template).
+    static bool fork_process(process &child_process);
+
   private:
 
     /// \brief Fork controller.
     std::auto_ptr<fork_ctl> fork_ctl_;
+
+    /// \brief Spawn method.
+    spawn_method::value_type spawn_method_;
 };
 
 
@@ -17,14 +17,30 @@ namespace posix {
 
 class process_id;
 class exit_status;
+class resource_usage;
 class fork_ctl;
+class exec_ctl;
 class process;
+class process_pool;
+class reactor;
+class signal_dispatcher;
 template<typename Tag> class process_template;
+template<typename ForkCtl> class static_process_template;
 class forker;
+class batch_forker;
 class daemon;
 template<typename Tag> class daemon_template;
+template<typename DaemonCtl> class static_daemon_template;
 class daemonizer;
+class daemonization_report;
 class self;
+class fd_sanitizer;
+class hot_restart;
+class readiness_notifier;
+class zygote_ctl;
+class zygote;
+class worker_pool;
+class process_barrier;
 
 
 } // namespace posix
@@ -0,0 +1,157 @@
+/// \file sheratan/process/posix/hot_restart.hpp
+/// \brief Hot restart POSIX implementation interface.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#ifndef HG_SHERATAN_PROCESS_POSIX_HOT_RESTART_HPP
+#define HG_SHERATAN_PROCESS_POSIX_HOT_RESTART_HPP
+
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include "sheratan/process/posix/types.hpp"
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+/// \brief Hot restart POSIX implementation.
+/// \ingroup sheratan_process_posix
+/// \nosubgrouping
+/// \note Hot restart hands file descriptors (typically listening sockets)
+/// and opaque state over from running daemon (predecessor) to its
+/// successor, so that there is no window when the sockets are closed:
+/// -# Predecessor creates hot restart channel (default constructor) and
+///    spawns its successor through \c daemonizer, with successor's end of
+///    the channel (\c get_successor_fd) listed in inherited file
+///    descriptors.
+/// -# Predecessor calls \c handover, file descriptors are passed to the
+///    successor using \c SCM_RIGHTS and they remain open in predecessor.
+/// -# Successor attaches to the channel inherited at
+///    \c daemonizer::LISTEN_FDS_START, calls \c take_over, starts serving
+///    and calls \c report_ready.
+/// -# Predecessor waits for the successor in \c wait_ready, then it drains
+///    pending work and exits.
+class hot_restart : private boost::noncopyable
+{
+  public:
+
+    /// \brief File descriptor list type definition.
+    typedef std::vector<file_descriptor_type> fd_list_type;
+
+    /// \brief Opaque state type definition.
+    typedef std::string state_type;
+
+    /// \brief Maximal number of file descriptors handed over (\c SCM_MAX_FD).
+    static const std::size_t MAX_FDS;
+
+  public:
+
+    /// \brief Default constructor: predecessor.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \note Hot restart channel is created.
+    hot_restart();
+
+    /// \brief Constructor: successor.
+    /// \param fd Successor's end of hot restart channel, inherited from predecessor.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \pre <code>fd >= 0</code>
+    /// \note Ownership of the file descriptor is taken over.
+    explicit hot_restart(file_descriptor_type fd);
+
+    /// \brief Destructor.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    ~hot_restart();
+
+  public:
+
+    /// \brief Get native handle of hot restart channel.
+    /// \return File descriptor of own end of hot restart channel.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    file_descriptor_type native_handle() const;
+
+    /// \brief Get successor's end of hot restart channel.
+    /// \return File descriptor to be inherited by successor, \c -1 after
+    /// handover or in successor.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    file_descriptor_type get_successor_fd() const;
+
+  public:
+
+    /// \brief Hand file descriptors and state over to successor.
+    /// \param fds File descriptors to be handed over.
+    /// \param state Opaque state to be handed over.
+    /// \par Abrahams exception guarantee:
+    /// weak
+    /// \pre Object has been created by default constructor.
+    /// \pre <code>fds.size() <= MAX_FDS</code>
+    /// \note Successor must have already been spawned, successor's end of
+    /// the channel is closed in predecessor at first. Handed over file
+    /// descriptors remain open in predecessor.
+    void handover(const fd_list_type &fds, const state_type &state);
+
+    /// \brief Wait for successor to report it is ready.
+    /// \param time Absolute time to wait until.
+    /// \retval true Successor is ready.
+    /// \retval false Timeout expired.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \pre \c handover has been called.
+    /// \note In case successor closes the channel (e.g. exits) without
+    /// reporting it is ready, \c runtime_error with
+    /// \c errnum::HANDOVER_FAILED code is thrown.
+    bool wait_ready(const system_time_type &time);
+
+    /// \brief Take file descriptors and state over from predecessor.
+    /// \param fds Received file descriptors.
+    /// \param state Received opaque state.
+    /// \par Abrahams exception guarantee:
+    /// weak
+    /// \pre Object has been created by successor constructor.
+    /// \note Received file descriptors have close-on-exec flag set.
+    void take_over(fd_list_type &fds, state_type &state);
+
+    /// \brief Report to predecessor that successor is ready.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \pre Object has been created by successor constructor.
+    void report_ready();
+
+  private:
+
+    /// \brief Own end of hot restart channel.
+    file_descriptor_type fd_;
+
+    /// \brief Successor's end of hot restart channel (in predecessor).
+    file_descriptor_type successor_fd_;
+
+    /// \brief Whether this is predecessor's end of hot restart channel.
+    bool predecessor_;
+};
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+#endif // HG_SHERATAN_PROCESS_POSIX_HOT_RESTART_HPP
+
+
+// vim: set ts=2 sw=2 et:
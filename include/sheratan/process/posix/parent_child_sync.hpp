@@ -13,7 +13,9 @@
 #include <boost/noncopyable.hpp>
 
 #include "sheratan/process/posix/fwd.hpp"
+#include "sheratan/process/posix/types.hpp"
 #include "sheratan/process/posix/exit_status.hpp"
+#include "sheratan/process/posix/parent_child_sync_backend.hpp"
 
 
 namespace sheratan {
@@ -26,14 +28,43 @@ namespace posix {
 /// \brief Parent-child synchronizer.
 /// \ingroup sheratan_process_posix
 /// \nosubgrouping
+/// \note Synchronizer is a single semaphore shared by both sides, each
+/// unblock lets exactly one wait through. Unblocking side must not wait on
+/// the same synchronizer before the other side has passed its wait (use
+/// two synchronizers for bidirectional ping-pong).
 class parent_child_sync : private boost::noncopyable
 {
   public:
 
     /// \brief Default constructor
+    /// \param backend Synchronizer backend.
     /// \par Abrahams exception guarantee:
     /// strong
-    parent_child_sync();
+    /// \note Backend is resolved once the synchronization resources are
+    /// created by \c prefork. Exception is thrown at that point in case
+    /// explicitly requested backend is not available (see \c supports).
+    explicit parent_child_sync(parent_child_sync_backend::value_type backend = parent_child_sync_backend::AUTO);
+
+    /// \brief Destructor.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    ~parent_child_sync();
+
+  public:
+
+    /// \brief Determine whether synchronizer backend is available.
+    /// \param backend Synchronizer backend.
+    /// \retval true Backend is available.
+    /// \retval false Backend is not available.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    static bool supports(parent_child_sync_backend::value_type backend);
+
+    /// \brief Get synchronizer backend.
+    /// \return Synchronizer backend in use (\c AUTO until it is resolved by \c prefork).
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    parent_child_sync_backend::value_type get_backend() const;
 
   public:
 
@@ -103,8 +134,32 @@ class parent_child_sync : private boost::noncopyable
     /// after it was blocked on call to \c wait_for_child method.
     void unblock_parent();
 
+    /// \brief Get native handle.
+    /// \return File descriptor of synchronization pipe read-end or eventfd
+    /// (\c -1 if there is none, \c FUTEX backend has no file descriptor).
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \note File descriptor becomes readable once the other side unblocks,
+    /// so that \c wait_for_parent or \c wait_for_child does not block.
+    /// It is intended to be watched by an event loop (e.g. \c reactor).
+    /// \note \c FUTEX backend always returns \c -1, synchronizer using it
+    /// can not be watched by an event loop (nor awaited by
+    /// \c async_wait_for_child), it can only be waited for by blocking
+    /// \c wait_for_parent or \c wait_for_child.
+    file_descriptor_type native_handle() const;
+
   private:
 
+    /// \brief Wait on synchronization resources of the backend.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    void wait_sync();
+
+    /// \brief Unblock synchronization resources of the backend.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    void unblock_sync();
+
     /// \brief Create parent-child synchronization pipe.
     /// \par Abrahams exception guarantee:
     /// strong
@@ -125,13 +180,67 @@ class parent_child_sync : private boost::noncopyable
     /// strong
     void unblock_sync_pipe();
 
+    /// \brief Create synchronization eventfd.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    void create_sync_eventfd();
+
+    /// \brief Close synchronization eventfd.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    void close_sync_eventfd();
+
+    /// \brief Wait on synchronization eventfd.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    void wait_sync_eventfd();
+
+    /// \brief Unblock synchronization eventfd.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    void unblock_sync_eventfd();
+
+    /// \brief Map synchronization futex.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    void create_sync_futex();
+
+    /// \brief Unmap synchronization futex.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    void close_sync_futex();
+
+    /// \brief Wait on synchronization futex.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    void wait_sync_futex();
+
+    /// \brief Unblock synchronization futex.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    void unblock_sync_futex();
+
   private:
 
+    /// \brief Futex semaphore in shared memory page.
+    struct futex_semaphore;
+
+  private:
+
+    /// \brief Synchronizer backend.
+    parent_child_sync_backend::value_type backend_;
+
     /// \brief Parent-child synchronization pipe read-end.
     std::FILE *sync_pipe_r_;
 
     /// \brief Parent-child synchronization pipe write-end.
     std::FILE *sync_pipe_w_;
+
+    /// \brief Parent-child synchronization eventfd.
+    file_descriptor_type sync_eventfd_;
+
+    /// \brief Parent-child synchronization futex (shared memory mapping).
+    futex_semaphore *sync_futex_;
 };
 
 
@@ -0,0 +1,50 @@
+/// \file sheratan/process/posix/parent_child_sync_backend.hpp
+/// \brief POSIX parent-child synchronizer backend definition.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#ifndef HG_SHERATAN_PROCESS_POSIX_PARENT_CHILD_SYNC_BACKEND_HPP
+#define HG_SHERATAN_PROCESS_POSIX_PARENT_CHILD_SYNC_BACKEND_HPP
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+/// \brief Parent-child synchronizer backend.
+/// \ingroup sheratan_process_posix
+/// \nosubgrouping
+/// \note \c EVENTFD backend synchronizes by a single \c eventfd counter
+/// (semaphore mode), one system call per wait or unblock and no stdio
+/// locking. \c FUTEX backend synchronizes by a counter in shared memory
+/// page, unblock does not enter the kernel at all unless the other side
+/// is already waiting. Futex has no file descriptor, so that it can not
+/// be watched by an event loop.
+struct parent_child_sync_backend
+{
+  /// \brief Parent-child synchronizer backend values.
+  typedef enum
+  {
+    AUTO    = 0,  ///< \c EVENTFD if available, \c PIPE otherwise.
+    PIPE    = 1,  ///< Pipe (one byte per unblock).
+    EVENTFD = 2,  ///< \c eventfd counter.
+    FUTEX   = 3   ///< Futex in shared memory page.
+  } value_type;
+};
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+#endif // HG_SHERATAN_PROCESS_POSIX_PARENT_CHILD_SYNC_BACKEND_HPP
+
+
+// vim: set ts=2 sw=2 et:
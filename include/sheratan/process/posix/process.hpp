@@ -16,6 +16,7 @@
 #include "sheratan/process/posix/types.hpp"
 #include "sheratan/process/posix/process_id.hpp"
 #include "sheratan/process/posix/exit_status.hpp"
+#include "sheratan/process/posix/resource_usage.hpp"
 
 
 namespace sheratan {
@@ -28,9 +29,21 @@ namespace posix {
 /// \brief Process POSIX implementation.
 /// \ingroup sheratan_process_posix
 /// \nosubgrouping
-/// \todo Implement \c timed_join methods.
+/// \note Along with process ID, process holds process file descriptor
+/// (see \c native_handle method) referring to the child process. Waiting
+/// for the process and sending signals to it is done via this descriptor
+/// whenever it is available, so that these operations are not prone to
+/// PID reuse races.
 class process : private boost::noncopyable
 {
+  protected:
+
+    /// \brief Default constructor.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \post <code>this->valid() == false</code>
+    process();
+
   public:
 
     /// \brief Virtual destructor.
@@ -48,10 +61,28 @@ class process : private boost::noncopyable
     /// \pre <code>pid != process_id()</code>
     /// \post <code>this->valid() == true</code>
     /// \post <code>this->get_pid() == pid</code>.
-    /// \note Only \c forker has access to this method.
+    /// \note Only \c forker and \c zygote have access to this method.
+    /// \note Process file descriptor is opened by this method. Since process
+    /// with specified PID is child process, which was not yet waited for,
+    /// the descriptor is guaranteed to refer to it. In case process file
+    /// descriptors are not supported, process falls back to PID only.
     void set_pid(process_id pid);
 
     friend class forker;
+    friend class zygote;
+
+    /// \brief Set status of the process reaped by other means.
+    /// \param status Status of the process in \c waitpid format.
+    /// \return Exit status of the process.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \pre <code>before->valid() == true</code>
+    /// \post <code>after->valid() == false</code> in case the process has terminated.
+    /// \note Only \c process_pool and \c reactor have access to this method.
+    exit_status set_status(int status);
+
+    friend class process_pool;
+    friend class reactor;
 
   public:
 
@@ -61,6 +92,17 @@ class process : private boost::noncopyable
     /// no-throw
     process_id get_pid() const;
 
+    /// \brief Get native handle of the process.
+    /// \return Process file descriptor, or \c -1 in case process is not valid
+    /// or process file descriptors are not supported.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \note Returned descriptor becomes readable when the process terminates,
+    /// so it can be multiplexed by \c poll, \c select or \c epoll. It remains
+    /// owned by the process object and it is closed once the process becomes
+    /// invalid (i.e. after it is joined or detached).
+    file_descriptor_type native_handle() const;
+
     /// \brief Determine whether the process is valid.
     /// \retval true Valid process, which was not yet waited for.
     /// \retval false Not a process.
@@ -105,9 +147,23 @@ class process : private boost::noncopyable
     /// </blockquote>
     exit_status join(bool nonblocking = false, bool stopped = false, bool continued = false);
 
-    # if 0 // NOT IMPLEMENTED
+    /// \brief Wait for the process to complete and get its resource usage.
+    /// \param usage Resource usage of the process (set only in case valid
+    /// exit status is returned).
+    /// \param nonblocking See \c join(bool, bool, bool).
+    /// \param stopped See \c join(bool, bool, bool).
+    /// \param continued See \c join(bool, bool, bool).
+    /// \return Exit status of the process.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \pre <code>before->valid() == true</code>
+    /// \note Resource usage is reported by the kernel when the process is reaped
+    /// (via \c waitid on process file descriptor or \c wait4), so it costs no
+    /// additional system call.
+    exit_status join(resource_usage &usage, bool nonblocking = false, bool stopped = false, bool continued = false);
+
     /// \brief Wait for the process to complete until specified time.
-    /// \param time System time, until when to wait for the process completion.
+    /// \param time System time (UTC), until when to wait for the process completion.
     /// \return Exit status of the process.
     /// \par Abrahams exception guarantee:
     /// strong
@@ -115,10 +171,21 @@ class process : private boost::noncopyable
     /// \post <code>!after->valid() == false</code>: Return value contains
     ///       exit status of completed process.
     /// \post <code>after->valid() == true</code>: Return value is unspecified.
+    /// \note The calling thread is blocked on process file descriptor (see
+    /// \c native_handle method) until either the process terminates or the
+    /// deadline expires, whichever comes first. In case process file
+    /// descriptors are not supported, process status is polled with
+    /// exponentially growing interval (from 1 up to 50 milliseconds),
+    /// so that termination of the process may be noticed up to
+    /// 50 milliseconds late (deadline is still kept precisely). Process
+    /// termination is not waited for by \c SIGCHLD in that case, since it
+    /// would require changing signal disposition or mask of the caller.
+    /// Caller, which owns \c SIGCHLD, may wait for it by itself (e.g. by
+    /// \c signal_dispatcher) and then use non-blocking \c join instead.
+    /// \note Positive infinity means waiting without deadline (as \c join
+    /// does). Deadline in the past means non-blocking check.
     exit_status timed_join(const system_time_type &time);
-    # endif // NOT IMPLEMENTED
 
-    # if 0 // NOT IMPLEMENTED
     /// \brief Wait for the process to complete for specified time.
     /// \param time Duration, while to wait for the process completion.
     /// \return Exit status of the process.
@@ -128,9 +195,11 @@ class process : private boost::noncopyable
     /// \post <code>!after->valid() == false</code>: Return value contains
     ///       exit status of completed process.
     /// \post <code>after->valid() == true</code>: Return value is unspecified.
+    /// \note Duration type must be convertible to
+    /// <code>boost::posix_time::time_duration</code>.
+    /// \note See \c timed_join(const system_time_type &) for details.
     template<typename DurationT>
     exit_status timed_join(const DurationT &time);
-    # endif // NOT IMPLEMENTED
 
     /// \brief Send signal to the process.
     /// \param signal Signal number.
@@ -140,10 +209,31 @@ class process : private boost::noncopyable
     /// \pre Specified signal number must be valid.
     void kill(signal_number_type signal);
 
+  private:
+
+    /// \brief Wait for the process to change its state.
+    /// \param nonblocking See \c join(bool, bool, bool).
+    /// \param stopped See \c join(bool, bool, bool).
+    /// \param continued See \c join(bool, bool, bool).
+    /// \param usage Resource usage of the process (filled in only if not \c NULL).
+    /// \return Exit status of the process.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    exit_status wait(bool nonblocking, bool stopped, bool continued, struct rusage *usage);
+
+    /// \brief Release process ID and process file descriptor.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \post <code>this->valid() == false</code>
+    void reset();
+
   private:
 
     /// \brief Process ID.
     process_id pid_;
+
+    /// \brief Process file descriptor.
+    file_descriptor_type pidfd_;
 };
 
 
@@ -0,0 +1,202 @@
+/// \file sheratan/process/posix/process_barrier.hpp
+/// \brief Process barrier POSIX implementation interface.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#ifndef HG_SHERATAN_PROCESS_POSIX_PROCESS_BARRIER_HPP
+#define HG_SHERATAN_PROCESS_POSIX_PROCESS_BARRIER_HPP
+
+
+#include <cstddef>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+#include "sheratan/process/posix/fwd.hpp"
+#include "sheratan/process/posix/types.hpp"
+#include "sheratan/process/posix/exit_status.hpp"
+#include "sheratan/process/posix/process_id.hpp"
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+/// \brief Process barrier POSIX implementation.
+/// \ingroup sheratan_process_posix
+/// \nosubgrouping
+/// \note Process barrier is a reusable, generation-counted barrier for
+/// fixed number of parties (parent and its forked children), placed in
+/// shared memory mapped before the fork. Parties rendezvous on it in
+/// consecutive phases (e.g. init, warm, serve), each phase completes once
+/// all the parties have called \c wait.
+/// \note Waiting is done on a futex in shared memory, last party to arrive
+/// wakes all the others by single system call.
+/// \note Participants are registered by their process IDs: the creator of
+/// the barrier at construction, forked children by \c postfork (in parent)
+/// and by \c child (in child). Termination of parties is not signalled,
+/// it is polled: each time waiting takes longer than the check interval,
+/// the waiter checks whether any of the registered parties, which have not
+/// arrived yet, has terminated (its process file descriptor is readable).
+/// Such party would never arrive, so the barrier is broken and all the
+/// waits fail, instead of deadlock.
+/// \note Each process holds process file descriptors of the other parties:
+/// parent opens them for its children in \c postfork (child is not reaped
+/// yet), child opens one for its parent in \c child and inherits those of
+/// its elder siblings. Such party is recognized even once it is reaped and
+/// its PID is reused. Process file descriptor of party registered by some
+/// other process (e.g. younger sibling) is opened by its PID once the party
+/// is checked for the first time, i.e. party, which is reaped and its PID
+/// reused before that, is not recognized (as well as any party, in case
+/// process file descriptors are not supported).
+class process_barrier : private boost::noncopyable
+{
+  public:
+
+    /// \brief Constructor.
+    /// \param parties Number of parties (including the calling process).
+    /// \param check_interval Interval of checks for terminated parties.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \pre <code>parties > 0</code>
+    /// \pre <code>check_interval > 0</code>
+    /// \post Calling process is registered as one of the parties.
+    explicit process_barrier(std::size_t parties, const system_duration_type &check_interval = boost::posix_time::milliseconds(10));
+
+    /// \brief Destructor.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \note Shared memory is unmapped from the calling process only,
+    /// barrier remains usable by other processes.
+    ~process_barrier();
+
+  public:
+
+    /// \brief Prefork (parent) callback.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \pre There is a vacant slot for the child to be forked.
+    void prefork();
+
+    /// \brief Postfork (parent) callback.
+    /// \param child_process Forked child process.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \note Child is registered as one of the parties, its process file
+    /// descriptor is held by the calling process.
+    void postfork(process &child_process);
+
+    /// \brief Child process callback.
+    /// \return Child execution status:
+    /// - <code>exit_status::SUCCESS</code>: Success.
+    /// - otherwise: Failure.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \note Child is registered as one of the parties (whichever of parent
+    /// and child is first). Process file descriptor of its parent is held by
+    /// the child.
+    exit_status::value_type child();
+
+  public:
+
+    /// \brief Wait until all the parties arrive.
+    /// \retval true All the parties have arrived, phase is complete.
+    /// \retval false Barrier is broken (some party has terminated before it arrived).
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \pre Calling process is registered as one of the parties (or there
+    /// is a vacant slot to register it).
+    /// \note Once broken, barrier remains broken, all the subsequent
+    /// waits fail immediately.
+    bool wait();
+
+    /// \brief Get number of parties.
+    /// \return Number of parties.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    std::size_t get_parties() const;
+
+    /// \brief Get generation of the barrier.
+    /// \return Number of completed phases.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    std::size_t get_generation() const;
+
+    /// \brief Determine whether the barrier is broken.
+    /// \retval true Barrier is broken.
+    /// \retval false Barrier is not broken.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    bool broken() const;
+
+  private:
+
+    /// \brief Register process as one of the parties.
+    /// \param pid Process ID.
+    /// \return Index of the slot of the party.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    std::size_t attach(process_id::value_type pid);
+
+    /// \brief Determine whether some party, which has not arrived yet, has terminated.
+    /// \param generation Generation being waited for.
+    /// \retval true Some party has terminated.
+    /// \retval false All the parties are alive or have already arrived.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \note Process file descriptors of the parties, which are not held
+    /// yet, are opened.
+    bool party_terminated(int generation);
+
+  private:
+
+    /// \brief Shared state of the barrier.
+    struct shared_state;
+
+    /// \brief Slot of the party.
+    struct party_slot;
+
+  private:
+
+    /// \brief Number of parties.
+    std::size_t parties_;
+
+    /// \brief Interval of checks for terminated parties.
+    system_duration_type check_interval_;
+
+    /// \brief Size of shared memory mapping.
+    std::size_t size_;
+
+    /// \brief Shared state (shared memory mapping).
+    shared_state *state_;
+
+    /// \brief Slots of the parties (within shared memory mapping).
+    party_slot *slots_;
+
+    /// \brief Process ID of the process, which owns \c slot_ (\c 0 if none).
+    process_id::value_type slot_pid_;
+
+    /// \brief Index of the slot of the calling process.
+    std::size_t slot_;
+
+    /// \brief Process file descriptors of the parties held by the calling process (indexed by slots).
+    std::vector<file_descriptor_type> pidfds_;
+};
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+#endif // HG_SHERATAN_PROCESS_POSIX_PROCESS_BARRIER_HPP
+
+
+// vim: set ts=2 sw=2 et:
@@ -58,12 +58,13 @@ class process_id
     /// \par Abrahams exception guarantee:
     /// no-throw
     /// \post <code>after->get_value() == id</code>
-    /// \note Only \c self, \c forker and \c daemonizer have access to this constructor.
+    /// \note Only \c self, \c forker, \c daemonizer and \c zygote have access to this constructor.
     explicit process_id(process_id::value_type id);
 
     friend class self;
     friend class forker;
     friend class daemonizer;
+    friend class zygote;
 
   public:
 
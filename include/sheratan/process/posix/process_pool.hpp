@@ -0,0 +1,221 @@
+/// \file sheratan/process/posix/process_pool.hpp
+/// \brief Process pool POSIX implementaton interface.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#ifndef HG_SHERATAN_PROCESS_POSIX_PROCESS_POOL_HPP
+#define HG_SHERATAN_PROCESS_POSIX_PROCESS_POOL_HPP
+
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+#include <boost/unordered_map.hpp>
+
+#include "sheratan/process/posix/fwd.hpp"
+#include "sheratan/process/posix/process_id.hpp"
+#include "sheratan/process/posix/exit_status.hpp"
+#include "sheratan/process/posix/resource_usage.hpp"
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+/// \brief Process pool POSIX implementation.
+/// \ingroup sheratan_process_posix
+/// \nosubgrouping
+/// \note Process pool reaps completed processes in batches using
+/// <code>waitid(P_ALL)</code> (or <code>waitid(P_PGID)</code>, in case
+/// it is restricted to a process group), so that the cost of reaping does
+/// not depend on number of processes in the pool. Reaped process IDs are
+/// mapped back to process objects using hash table.
+/// \note Process pool does not own process objects, it only refers to
+/// them. Process must be removed from the pool before it is joined by
+/// other means, detached or destroyed.
+/// \note Process pool reaps any child process of the calling process
+/// (or any child process in the process group), which has completed. Child
+/// processes, which are not part of the pool, are reported with \c NULL
+/// process pointer. Therefore, the pool should own all child processes of
+/// the calling process (or all processes in the process group).
+/// \note Resource usage of all reaped child processes is accumulated by
+/// the pool, so that fleet-wide cost can be read without parsing \c /proc.
+class process_pool : private boost::noncopyable
+{
+  public:
+
+    /// \brief Reaped process type definition.
+    /// \note Pair of (formerly valid) process and its exit status. Process
+    /// is \c NULL in case reaped child process was not part of the pool.
+    typedef std::pair<process *, exit_status> reaped_type;
+
+    /// \brief Reaped process list type definition.
+    typedef std::vector<reaped_type> reaped_list_type;
+
+  public:
+
+    /// \brief Default constructor.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \post <code>this->empty() == true</code>
+    /// \note Process pool reaps any child process.
+    process_pool();
+
+    /// \brief Constructor.
+    /// \param pgid Process group ID.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \pre <code>pgid != process_id()</code>
+    /// \post <code>this->empty() == true</code>
+    /// \note Process pool reaps only child processes in specified process group.
+    explicit process_pool(const process_id &pgid);
+
+    /// \brief Destructor.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    ~process_pool();
+
+  public:
+
+    /// \brief Add process to the pool.
+    /// \param proc Process to be added.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \pre <code>proc.valid() == true</code>
+    /// \pre Process is not part of the pool.
+    /// \post <code>this->contains(proc) == true</code>
+    void add(process &proc);
+
+    /// \brief Remove process from the pool.
+    /// \param proc Process to be removed.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \post <code>this->contains(proc) == false</code>
+    /// \note Removing process, which is not part of the pool, has no effect.
+    void remove(process &proc);
+
+    /// \brief Determine whether the process is part of the pool.
+    /// \param proc Process.
+    /// \retval true Process is part of the pool.
+    /// \retval false Process is not part of the pool.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    bool contains(const process &proc) const;
+
+    /// \brief Get number of processes in the pool.
+    /// \return Number of processes in the pool.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    std::size_t size() const;
+
+    /// \brief Determine whether the pool is empty.
+    /// \retval true Pool is empty.
+    /// \retval false Pool is not empty.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    bool empty() const;
+
+    /// \brief Get process group ID.
+    /// \return Process group ID, or invalid process ID in case the pool
+    /// reaps any child process.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    process_id get_pgid() const;
+
+  public:
+
+    /// \brief Wait for any process to complete.
+    /// \param nonblocking If set, this method will not block. In case no
+    /// process has completed, pair of \c NULL process and invalid exit status
+    /// is returned instead.
+    /// \return Completed process and its exit status.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \pre <code>before->empty() == false</code>
+    /// \post Completed process is not part of the pool and it is not valid.
+    reaped_type join_any(bool nonblocking = false);
+
+    /// \brief Reap all processes, which have already completed.
+    /// \param reaped List, where reaped processes are appended.
+    /// \return Number of reaped processes.
+    /// \par Abrahams exception guarantee:
+    /// weak
+    /// \post Reaped processes are not part of the pool and they are not valid.
+    /// \note This method never blocks. It calls <code>waitid(WNOHANG)</code>
+    /// repeatedly until there is no more completed child process.
+    /// \note In case of an error, processes reaped so far are appended
+    /// to the list before the exception is thrown.
+    std::size_t reap_ready(reaped_list_type &reaped);
+
+  public:
+
+    /// \brief Get accumulated resource usage.
+    /// \return Resource usage accumulated over all child processes reaped by
+    /// the pool (including those, which were not part of the pool).
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \note See \c resource_usage::operator+= for accumulation rules.
+    const resource_usage & get_resource_usage() const;
+
+    /// \brief Get number of reaped child processes.
+    /// \return Number of child processes, over which resource usage is accumulated.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    std::size_t get_reaped_count() const;
+
+    /// \brief Reset accumulated resource usage.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \post <code>this->get_reaped_count() == 0</code>
+    void reset_resource_usage();
+
+  private:
+
+    /// \brief Reap single completed child process.
+    /// \param nonblocking Whether to block.
+    /// \param reaped Reaped process and its exit status.
+    /// \retval true Child process was reaped.
+    /// \retval false No child process has completed (non-blocking call only),
+    /// or there are no more child processes.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    bool reap_one(bool nonblocking, reaped_type &reaped);
+
+  private:
+
+    /// \brief Process map type definition.
+    typedef boost::unordered_map<process_id::value_type, process *> process_map_type;
+
+  private:
+
+    /// \brief Process group ID.
+    process_id pgid_;
+
+    /// \brief Map of processes in the pool indexed by their process IDs.
+    process_map_type processes_;
+
+    /// \brief Accumulated resource usage of reaped child processes.
+    resource_usage usage_;
+
+    /// \brief Number of reaped child processes.
+    std::size_t reaped_count_;
+};
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+#endif // HG_SHERATAN_PROCESS_POSIX_PROCESS_POOL_HPP
+
+
+// vim: set ts=2 sw=2 et:
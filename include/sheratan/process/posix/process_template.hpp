@@ -36,11 +36,15 @@ class process_template : public process
 
     /// \brief Constructor.
     /// \param fc Fork controller.
+    /// \param method Spawn method.
     /// \par Abrahams exception guarantee:
     /// strong
+    /// \pre Fork controller must be an instance of \c exec_ctl class
+    /// (or some of its descendants) for other spawn methods than
+    /// \c spawn_method::FORK.
     /// \post <code>this->valid() == true</code>
     /// \post <code>this->get_id() != process_id()</code>.
-    explicit process_template(const fork_ctl &fc);
+    explicit process_template(const fork_ctl &fc, spawn_method::value_type method = spawn_method::FORK);
 
   public:
 
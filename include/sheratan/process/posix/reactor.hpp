@@ -0,0 +1,444 @@
+/// \file sheratan/process/posix/reactor.hpp
+/// \brief Reactor POSIX implementaton interface.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#ifndef HG_SHERATAN_PROCESS_POSIX_REACTOR_HPP
+#define HG_SHERATAN_PROCESS_POSIX_REACTOR_HPP
+
+
+#include <cstddef>
+#include <memory>
+#include <set>
+
+#include <boost/noncopyable.hpp>
+#include <boost/function.hpp>
+#include <boost/unordered_map.hpp>
+
+#include "sheratan/process/posix/fwd.hpp"
+#include "sheratan/process/posix/types.hpp"
+#include "sheratan/process/posix/exit_status.hpp"
+#include "sheratan/process/posix/reactor_backend.hpp"
+#include "sheratan/process/posix/signal_dispatcher.hpp"
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+class reactor_engine;
+
+
+/// \brief I/O events.
+/// \ingroup sheratan_process_posix
+/// \nosubgrouping
+struct io_events
+{
+  /// \brief I/O event values.
+  typedef enum
+  {
+    NONE     = 0,  ///< No event.
+    READABLE = 1,  ///< File descriptor is readable.
+    WRITABLE = 2,  ///< File descriptor is writable.
+    HANGUP   = 4,  ///< Peer closed its end of the channel (reported even if not requested).
+    FAILURE  = 8   ///< Error condition (reported even if not requested).
+  } value_type;
+};
+
+/// \brief I/O event mask type definition.
+typedef int io_event_mask_type;
+
+
+/// \brief Reactor POSIX implementation.
+/// \ingroup sheratan_process_posix
+/// \nosubgrouping
+/// \note Reactor multiplexes child processes (via their process file
+/// descriptors), arbitrary file descriptors (e.g. synchronization and
+/// return code pipes), signals (via \c signalfd) and timers (via
+/// \c timerfd) in single \c epoll set or \c io_uring instance (see
+/// \c reactor_backend), so that single thread can supervise thousands
+/// of child processes without busy polling. Only descriptors watched by
+/// reactor are waited for by the selected backend.
+/// \note Handlers are invoked from within \c run and \c run_one methods,
+/// in the calling thread. Handlers may add and remove watches (including
+/// their own). Exception thrown from a handler is propagated to the caller
+/// of \c run or \c run_one, the reactor remains usable.
+/// \note Watched signals (and \c SIGCHLD, in case any process is watched
+/// for being stopped or continued) are blocked in the thread, which added
+/// the watch, so that they are delivered via \c signalfd of internal
+/// \c signal_dispatcher. In multi-threaded program, they must be blocked
+/// in all other threads as well. Signals blocked by the reactor are
+/// unblocked again when it is destroyed.
+class reactor : private boost::noncopyable
+{
+  public:
+
+    /// \brief Process state change handler type definition.
+    /// \note Handler is passed process, which has changed its state, and its exit status.
+    typedef boost::function<void (process &, const exit_status &)> process_handler_type;
+
+    /// \brief I/O readiness handler type definition.
+    /// \note Handler is passed file descriptor and mask of I/O events (see \c io_events).
+    typedef boost::function<void (file_descriptor_type, io_event_mask_type)> io_handler_type;
+
+    /// \brief Signal handler type definition.
+    /// \note Handler is passed signal number.
+    typedef boost::function<void (signal_number_type)> signal_handler_type;
+
+    /// \brief Timer handler type definition.
+    typedef boost::function<void ()> timer_handler_type;
+
+    /// \brief Timer ID type definition.
+    /// \note Timer IDs are not reused by the reactor (\c 0 is never used).
+    typedef unsigned long timer_id_type;
+
+  public:
+
+    /// \brief Constructor.
+    /// \param backend Reactor backend.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \post <code>this->empty() == true</code>
+    /// \note Exception is thrown in case explicitly requested backend is
+    /// not available (see \c supports).
+    explicit reactor(reactor_backend::value_type backend = reactor_backend::AUTO);
+
+    /// \brief Destructor.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \note Watched processes are not joined, nor detached.
+    ~reactor();
+
+  public:
+
+    /// \brief Determine whether reactor backend is available.
+    /// \param backend Reactor backend.
+    /// \retval true Backend is available.
+    /// \retval false Backend is not available.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    static bool supports(reactor_backend::value_type backend);
+
+    /// \brief Get reactor backend.
+    /// \return Reactor backend in use (never \c AUTO).
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    reactor_backend::value_type get_backend() const;
+
+  public:
+
+    /// \brief Watch process.
+    /// \param proc Process to be watched.
+    /// \param on_exit Handler invoked once the process terminates (after it has been joined).
+    /// \param on_stop Handler invoked whenever the process is stopped (optional).
+    /// \param on_continue Handler invoked whenever the process is continued (optional).
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \pre <code>proc.valid() == true</code>
+    /// \pre <code>proc.native_handle() != -1</code>
+    /// \pre Process is not watched yet.
+    /// \note Process is joined by the reactor, once it terminates, and then
+    /// the watch is removed automatically. Process must be unwatched before
+    /// it is joined by other means, detached or destroyed.
+    /// \note Stop and continue notifications rely on \c SIGCHLD, which is
+    /// blocked and watched by the reactor, as long as there are such watches.
+    void watch_process(
+      process &proc,
+      const process_handler_type &on_exit,
+      const process_handler_type &on_stop = process_handler_type(),
+      const process_handler_type &on_continue = process_handler_type()
+    );
+
+    /// \brief Stop watching process.
+    /// \param proc Watched process.
+    /// \return Exit status of the process, in case it was reaped in the meantime
+    /// (\c io_uring backend reaps processes asynchronously), invalid exit status otherwise.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \note Unwatching process, which is not watched, has no effect.
+    /// \note Process reaped in the meantime becomes joined, its exit handler
+    /// is not invoked.
+    exit_status unwatch_process(process &proc);
+
+    /// \brief Watch file descriptor.
+    /// \param fd File descriptor to be watched.
+    /// \param events Mask of I/O events to be watched for (see \c io_events).
+    /// \param on_ready Handler invoked whenever some of the events occurs.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \pre File descriptor is not watched yet.
+    /// \note Watch is level-triggered, i.e. the handler is invoked repeatedly,
+    /// as long as the file descriptor is ready.
+    /// \note File descriptor is not owned by the reactor. It must be unwatched
+    /// before it is closed.
+    void watch_io(file_descriptor_type fd, io_event_mask_type events, const io_handler_type &on_ready);
+
+    /// \brief Change I/O events watched for file descriptor.
+    /// \param fd Watched file descriptor.
+    /// \param events Mask of I/O events to be watched for (see \c io_events).
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \pre File descriptor is watched.
+    void modify_io(file_descriptor_type fd, io_event_mask_type events);
+
+    /// \brief Stop watching file descriptor.
+    /// \param fd Watched file descriptor.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \note Unwatching file descriptor, which is not watched, has no effect.
+    void unwatch_io(file_descriptor_type fd);
+
+    /// \brief Watch signal.
+    /// \param signal Signal number.
+    /// \param on_signal Handler invoked whenever the signal is delivered.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \pre Signal is not watched yet.
+    /// \pre Specified signal number must be valid.
+    /// \note Signal is blocked in the calling thread.
+    void watch_signal(signal_number_type signal, const signal_handler_type &on_signal);
+
+    /// \brief Stop watching signal.
+    /// \param signal Signal number.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \note Signal blocked by the reactor is unblocked, its pending instances are discarded.
+    /// \note Unwatching signal, which is not watched, has no effect.
+    void unwatch_signal(signal_number_type signal);
+
+    /// \brief Add timer.
+    /// \param interval Time interval, after which the timer expires.
+    /// \param on_expiry Handler invoked when the timer expires.
+    /// \param periodic If set, timer is rearmed with the same interval after each expiry,
+    /// otherwise it is removed automatically after it expires.
+    /// \return Timer ID.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \pre <code>interval > 0</code>
+    /// \note Timer is based on monotonic clock.
+    timer_id_type add_timer(const system_duration_type &interval, const timer_handler_type &on_expiry, bool periodic = false);
+
+    /// \brief Cancel timer.
+    /// \param timer_id Timer ID.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \note Cancelling timer, which has already expired, has no effect.
+    void cancel_timer(timer_id_type timer_id);
+
+  public:
+
+    /// \brief Dispatch events until stopped or there is nothing to watch.
+    /// \par Abrahams exception guarantee:
+    /// weak
+    /// \post <code>this->stopped() == true || this->empty() == true</code>
+    /// \note Stopped state of the reactor is reset at the beginning of this method.
+    void run();
+
+    /// \brief Wait for events and dispatch them.
+    /// \param nonblocking If set, this method will not block.
+    /// \return Number of dispatched events.
+    /// \par Abrahams exception guarantee:
+    /// weak
+    /// \note Single call dispatches all events reported by single wait
+    /// (this might be more than one event).
+    std::size_t run_one(bool nonblocking = false);
+
+    /// \brief Stop dispatching events.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \post <code>this->stopped() == true</code>
+    /// \note This method is intended to be called from within a handler.
+    /// \c run method returns after handlers of current wait are dispatched.
+    void stop();
+
+    /// \brief Determine whether the reactor was stopped.
+    /// \retval true Reactor was stopped.
+    /// \retval false Reactor was not stopped.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    bool stopped() const;
+
+    /// \brief Get number of watches.
+    /// \return Number of watched processes, file descriptors, signals and timers.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    std::size_t size() const;
+
+    /// \brief Determine whether there is nothing to watch.
+    /// \retval true There is nothing to watch.
+    /// \retval false There is something to watch.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    bool empty() const;
+
+  private:
+
+    /// \brief Watch kind.
+    /// \ingroup sheratan_process_posix
+    /// \nosubgrouping
+    struct watch_kind
+    {
+      /// \brief Watch kind values.
+      typedef enum
+      {
+        PROCESS = 0,  ///< Process file descriptor.
+        IO,           ///< Arbitrary file descriptor.
+        SIGNAL,       ///< Signal file descriptor.
+        TIMER         ///< Timer file descriptor.
+      } value_type;
+    };
+
+    /// \brief Watch of single file descriptor.
+    /// \ingroup sheratan_process_posix
+    /// \nosubgrouping
+    struct watch
+    {
+      /// \brief Watch kind.
+      watch_kind::value_type kind;
+
+      /// \brief Watched process (process watch only).
+      process *proc;
+
+      /// \brief Exit handler (process watch only).
+      process_handler_type on_exit;
+
+      /// \brief Stop handler (process watch only).
+      process_handler_type on_stop;
+
+      /// \brief Continue handler (process watch only).
+      process_handler_type on_continue;
+
+      /// \brief I/O readiness handler (I/O watch only).
+      io_handler_type on_ready;
+
+      /// \brief Timer handler (timer watch only).
+      timer_handler_type on_expiry;
+
+      /// \brief Whether the timer is periodic (timer watch only).
+      bool periodic;
+
+      /// \brief Timer ID (timer watch only).
+      timer_id_type timer_id;
+    };
+
+    /// \brief Watch map type definition.
+    typedef boost::unordered_map<file_descriptor_type, watch> watch_map_type;
+
+    /// \brief Signal subscription map type definition.
+    typedef boost::unordered_map<signal_number_type, signal_dispatcher::subscription_id_type> signal_map_type;
+
+    /// \brief Process watch map type definition.
+    typedef boost::unordered_map<const process *, file_descriptor_type> process_map_type;
+
+    /// \brief Timer map type definition.
+    typedef boost::unordered_map<timer_id_type, file_descriptor_type> timer_map_type;
+
+  private:
+
+    /// \brief Add file descriptor into the engine.
+    /// \param fd File descriptor.
+    /// \param events Mask of I/O events.
+    /// \param w Watch of the file descriptor.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    void add_watch(file_descriptor_type fd, io_event_mask_type events, const watch &w);
+
+    /// \brief Remove file descriptor from the engine.
+    /// \param fd File descriptor.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \return Exit status of watched process, in case it was reaped by the engine
+    /// in the meantime (process watch only), invalid exit status otherwise.
+    /// \note File descriptors owned by the reactor (i.e. all but I/O watches)
+    /// are closed after they are removed from the engine.
+    exit_status remove_watch(file_descriptor_type fd);
+
+    /// \brief Get signal dispatcher, create it in case it does not exist yet.
+    /// \return Signal dispatcher.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    signal_dispatcher & get_signal_dispatcher();
+
+    /// \brief Subscribe to \c SIGCHLD in case any process is watched for
+    /// being stopped or continued, cancel the subscription otherwise.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    void update_job_control();
+
+    /// \brief Dispatch event of single file descriptor.
+    /// \param fd File descriptor.
+    /// \param events Mask of I/O events.
+    /// \param reaped Whether the process was reaped by the engine (process watch only).
+    /// \param status Status of the process reaped by the engine (process watch only).
+    /// \par Abrahams exception guarantee:
+    /// weak
+    void dispatch(file_descriptor_type fd, io_event_mask_type events, bool reaped, int status);
+
+    /// \brief Dispatch termination of watched process.
+    /// \param fd Process file descriptor.
+    /// \param reaped Whether the process was reaped by the engine.
+    /// \param status Status of the process reaped by the engine in \c waitpid format.
+    /// \par Abrahams exception guarantee:
+    /// weak
+    void dispatch_process(file_descriptor_type fd, bool reaped, int status);
+
+    /// \brief Dispatch state changes of processes watched for being stopped or continued.
+    /// \par Abrahams exception guarantee:
+    /// weak
+    void dispatch_sigchld();
+
+    /// \brief Dispatch timer expiry.
+    /// \param fd Timer file descriptor.
+    /// \par Abrahams exception guarantee:
+    /// weak
+    void dispatch_timer(file_descriptor_type fd);
+
+  private:
+
+    /// \brief Engine waiting for events.
+    std::auto_ptr<reactor_engine> engine_;
+
+    /// \brief Signal dispatcher (\c NULL if no signal has been watched yet).
+    std::auto_ptr<signal_dispatcher> signal_dispatcher_;
+
+    /// \brief Watches indexed by file descriptor.
+    watch_map_type watches_;
+
+    /// \brief Watched signals.
+    signal_map_type signals_;
+
+    /// \brief Watched file descriptors indexed by watched processes.
+    process_map_type processes_;
+
+    /// \brief Process file descriptors of processes watched for being stopped or continued.
+    std::set<file_descriptor_type> job_control_watches_;
+
+    /// \brief Subscription of \c SIGCHLD driving job control (\c 0 if there is none).
+    signal_dispatcher::subscription_id_type sigchld_subscription_;
+
+    /// \brief Timer file descriptors indexed by timer IDs.
+    timer_map_type timers_;
+
+    /// \brief Timer ID to be assigned to the next timer.
+    timer_id_type next_timer_id_;
+
+    /// \brief Whether the reactor was stopped.
+    bool stopped_;
+};
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+#endif // HG_SHERATAN_PROCESS_POSIX_REACTOR_HPP
+
+
+// vim: set ts=2 sw=2 et:
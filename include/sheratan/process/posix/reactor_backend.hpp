@@ -0,0 +1,51 @@
+/// \file sheratan/process/posix/reactor_backend.hpp
+/// \brief POSIX reactor backend definition.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#ifndef HG_SHERATAN_PROCESS_POSIX_REACTOR_BACKEND_HPP
+#define HG_SHERATAN_PROCESS_POSIX_REACTOR_BACKEND_HPP
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+/// \brief Reactor backend.
+/// \ingroup sheratan_process_posix
+/// \nosubgrouping
+/// \note \c IO_URING backend reaps terminated child processes directly
+/// by \c IORING_OP_WAITID requests (Linux 6.7 and newer, older kernels
+/// poll process file descriptors instead) and re-arms all readiness
+/// watches together with waiting for events in single system call.
+/// \note Backend affects reactor watches only. Blocking waits outside of
+/// reactor (\c parent_child_sync waits, daemonization return code pipe
+/// reads, \c process::join) remain plain system calls regardless of
+/// backend. To multiplex them, watch their native handles by reactor.
+struct reactor_backend
+{
+  /// \brief Reactor backend values.
+  typedef enum
+  {
+    AUTO     = 0,  ///< \c IO_URING if available, \c EPOLL otherwise.
+    EPOLL    = 1,  ///< \c epoll set.
+    IO_URING = 2   ///< \c io_uring submission and completion queues.
+  } value_type;
+};
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+#endif // HG_SHERATAN_PROCESS_POSIX_REACTOR_BACKEND_HPP
+
+
+// vim: set ts=2 sw=2 et:
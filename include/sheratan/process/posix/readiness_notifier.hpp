@@ -0,0 +1,103 @@
+/// \file sheratan/process/posix/readiness_notifier.hpp
+/// \brief Readiness notifier POSIX implementation interface.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#ifndef HG_SHERATAN_PROCESS_POSIX_READINESS_NOTIFIER_HPP
+#define HG_SHERATAN_PROCESS_POSIX_READINESS_NOTIFIER_HPP
+
+
+#include <string>
+
+#include <boost/noncopyable.hpp>
+
+#include "sheratan/process/posix/types.hpp"
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+/// \brief Readiness notifier POSIX implementation.
+/// \ingroup sheratan_process_posix
+/// \nosubgrouping
+/// \note Notifications are sent as datagrams in \c sd_notify format
+/// (newline-separated \c KEY=VALUE assignments) to the socket named by
+/// \c NOTIFY_SOCKET environment variable, which is set by \c daemonizer
+/// in case it is asked to wait for daemon readiness. Service manager
+/// supporting \c sd_notify protocol (e.g. systemd with \c Type=notify)
+/// is notified the very same way.
+/// \note Without \c NOTIFY_SOCKET environment variable, notifications
+/// are silently discarded.
+class readiness_notifier : private boost::noncopyable
+{
+  public:
+
+    /// \brief Default constructor.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \note Notification socket is taken from \c NOTIFY_SOCKET environment
+    /// variable: absolute path or abstract socket name prefixed by \c '@'.
+    readiness_notifier();
+
+    /// \brief Destructor.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    ~readiness_notifier();
+
+  public:
+
+    /// \brief Check whether notifications are delivered anywhere.
+    /// \retval true Notification socket is set.
+    /// \retval false Notifications are discarded.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    bool enabled() const;
+
+  public:
+
+    /// \brief Send raw notification.
+    /// \param state Newline-separated \c KEY=VALUE assignments.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    void notify(const std::string &state);
+
+    /// \brief Report that named readiness stage has been reached.
+    /// \param name Stage name.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \pre \p name must not be empty and it must not contain newline.
+    /// \note Sent as \c STAGE=name assignment.
+    void stage(const std::string &name);
+
+    /// \brief Report that the daemon is ready.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \note Sent as \c READY=1 assignment, it implies all the stages.
+    void ready();
+
+  private:
+
+    /// \brief Notification socket.
+    file_descriptor_type fd_;
+
+    /// \brief Notification socket address (\c sockaddr_un, as raw bytes).
+    std::string address_;
+};
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+#endif // HG_SHERATAN_PROCESS_POSIX_READINESS_NOTIFIER_HPP
+
+
+// vim: set ts=2 sw=2 et:
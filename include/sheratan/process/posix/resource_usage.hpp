@@ -0,0 +1,168 @@
+/// \file sheratan/process/posix/resource_usage.hpp
+/// \brief Process resource usage POSIX implementation interface.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#ifndef HG_SHERATAN_PROCESS_POSIX_RESOURCE_USAGE_HPP
+#define HG_SHERATAN_PROCESS_POSIX_RESOURCE_USAGE_HPP
+
+
+#include <sys/resource.h>
+
+#include "sheratan/process/posix/types.hpp"
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+namespace test {
+
+
+class accessor;
+
+
+}
+
+
+/// \brief POSIX process resource usage.
+/// \ingroup sheratan_process_posix
+/// \nosubgrouping
+/// \note Resource usage of a child process is reported by the kernel when
+/// the child is waited for (see \c process::join and \c process_pool). It
+/// includes resources used by all descendants of the child, which were
+/// waited for by the child.
+class resource_usage
+{
+  friend class test::accessor;
+
+  public:
+
+    /// \brief Counter type definition.
+    typedef long counter_type;
+
+  public:
+
+    /// \brief Default constructor.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \post All times and counters are zero.
+    resource_usage();
+
+  private:
+
+    /// \brief Constructor.
+    /// \param usage Resource usage reported by the kernel.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \note Only \c process and \c process_pool have access to this constructor.
+    explicit resource_usage(const struct rusage &usage);
+
+    friend class process;
+    friend class process_pool;
+
+  public:
+
+    /// \brief Accumulate resource usage.
+    /// \param other Resource usage to be added.
+    /// \return This instance.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \note Times and counters are summed up, while maximum resident set
+    /// size is the maximum of both.
+    resource_usage & operator+=(const resource_usage &other);
+
+  public:
+
+    /// \brief Get user CPU time.
+    /// \return Time spent executing in user mode.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    system_duration_type get_user_time() const;
+
+    /// \brief Get system CPU time.
+    /// \return Time spent executing in kernel mode.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    system_duration_type get_system_time() const;
+
+    /// \brief Get maximum resident set size.
+    /// \return Maximum resident set size in kilobytes.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    counter_type get_max_rss() const;
+
+    /// \brief Get number of minor page faults.
+    /// \return Number of page faults serviced without any I/O activity.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    counter_type get_minor_faults() const;
+
+    /// \brief Get number of major page faults.
+    /// \return Number of page faults serviced, which required I/O activity.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    counter_type get_major_faults() const;
+
+    /// \brief Get number of voluntary context switches.
+    /// \return Number of times the process yielded processor before its time
+    /// slice was completed (usually to wait for a resource).
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    counter_type get_voluntary_context_switches() const;
+
+    /// \brief Get number of involuntary context switches.
+    /// \return Number of times the process was preempted.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    counter_type get_involuntary_context_switches() const;
+
+  private:
+
+    /// \brief User CPU time in microseconds.
+    counter_type user_time_us_;
+
+    /// \brief System CPU time in microseconds.
+    counter_type system_time_us_;
+
+    /// \brief Maximum resident set size in kilobytes.
+    counter_type max_rss_;
+
+    /// \brief Number of minor page faults.
+    counter_type minor_faults_;
+
+    /// \brief Number of major page faults.
+    counter_type major_faults_;
+
+    /// \brief Number of voluntary context switches.
+    counter_type voluntary_context_switches_;
+
+    /// \brief Number of involuntary context switches.
+    counter_type involuntary_context_switches_;
+};
+
+
+/// \brief Sum resource usages.
+/// \param ru1 First resource usage.
+/// \param ru2 Second resource usage.
+/// \return Accumulated resource usage (see \c resource_usage::operator+=).
+/// \par Abrahams exception guarantee:
+/// no-throw
+resource_usage operator+(const resource_usage &ru1, const resource_usage &ru2);
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+#endif // HG_SHERATAN_PROCESS_POSIX_RESOURCE_USAGE_HPP
+
+
+// vim: set ts=2 sw=2 et:
@@ -0,0 +1,187 @@
+/// \file sheratan/process/posix/signal_dispatcher.hpp
+/// \brief Signal dispatcher POSIX implementaton interface.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#ifndef HG_SHERATAN_PROCESS_POSIX_SIGNAL_DISPATCHER_HPP
+#define HG_SHERATAN_PROCESS_POSIX_SIGNAL_DISPATCHER_HPP
+
+
+#include <cstddef>
+#include <map>
+#include <set>
+
+#include <boost/noncopyable.hpp>
+#include <boost/function.hpp>
+
+#include "sheratan/process/posix/types.hpp"
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+/// \brief Signal dispatcher POSIX implementation.
+/// \ingroup sheratan_process_posix
+/// \nosubgrouping
+/// \note Subscribed signals are blocked in the thread, which subscribed
+/// them, and they are delivered via \c signalfd instead. Signals are
+/// dispatched synchronously (and in batches) by \c dispatch method, so
+/// that subscribers are not restricted to async-signal-safe functions.
+/// In multi-threaded program, subscribed signals must be blocked in all
+/// other threads as well. Signals blocked by the dispatcher are unblocked
+/// again once they have no subscriber (or when the dispatcher is destroyed).
+/// \note Signal mask is inherited by child processes (both forked and
+/// exec'd), so that children created while some signals are subscribed
+/// start with them blocked. Child, which does not use the dispatcher (copy),
+/// should restore its signal mask (e.g. in \c fork_ctl::child) before it
+/// relies on default actions of those signals.
+/// \note Multiple instances of the same signal, which occur before they
+/// are dispatched, coalesce (except for real-time signals).
+class signal_dispatcher : private boost::noncopyable
+{
+  public:
+
+    /// \brief Signal handler type definition.
+    /// \note Handler is passed signal number.
+    typedef boost::function<void (signal_number_type)> handler_type;
+
+    /// \brief Subscription ID type definition.
+    /// \note Valid subscription IDs are never \c 0.
+    typedef unsigned long subscription_id_type;
+
+  public:
+
+    /// \brief Default constructor.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \post <code>this->empty() == true</code>
+    signal_dispatcher();
+
+    /// \brief Destructor.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    ~signal_dispatcher();
+
+  public:
+
+    /// \brief Subscribe to signal.
+    /// \param signal Signal number.
+    /// \param handler Handler invoked whenever the signal is dispatched.
+    /// \return Subscription ID.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \pre Specified signal number must be valid.
+    /// \note Signal is blocked in the calling thread.
+    /// \note There may be more subscribers of the same signal, they are
+    /// invoked in order of their subscription.
+    subscription_id_type subscribe(signal_number_type signal, const handler_type &handler);
+
+    /// \brief Cancel subscription.
+    /// \param subscription_id Subscription ID.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \note Signal blocked by the dispatcher is unblocked once it has no
+    /// subscriber, its pending instances are discarded.
+    /// \note Cancelling subscription, which does not exist, has no effect.
+    void unsubscribe(subscription_id_type subscription_id);
+
+    /// \brief Determine whether there is a subscriber of signal.
+    /// \param signal Signal number.
+    /// \retval true Signal has at least one subscriber.
+    /// \retval false Signal has no subscriber.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    bool subscribed(signal_number_type signal) const;
+
+  public:
+
+    /// \brief Dispatch pending signals.
+    /// \param nonblocking If set, this method will not block.
+    /// \return Number of dispatched signals.
+    /// \par Abrahams exception guarantee:
+    /// weak
+    /// \note All pending signals are read at first, then their subscribers
+    /// are invoked. Subscribers may subscribe and unsubscribe (including
+    /// themselves). Signals without subscribers are discarded.
+    /// \note Blocking call returns once at least one signal is dispatched
+    /// (or when it is interrupted by unblocked signal).
+    std::size_t dispatch(bool nonblocking = false);
+
+    /// \brief Get native handle.
+    /// \return File descriptor of \c signalfd.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \note File descriptor becomes readable once some of the subscribed
+    /// signals is pending. It is intended to be watched by an event loop
+    /// (e.g. \c reactor), which calls \c dispatch method then.
+    file_descriptor_type native_handle() const;
+
+    /// \brief Get number of subscriptions.
+    /// \return Number of subscriptions.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    std::size_t size() const;
+
+    /// \brief Determine whether there is no subscription.
+    /// \retval true There is no subscription.
+    /// \retval false There is some subscription.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    bool empty() const;
+
+  private:
+
+    /// \brief Subscription.
+    /// \ingroup sheratan_process_posix
+    /// \nosubgrouping
+    struct subscription
+    {
+      /// \brief Signal number.
+      signal_number_type signal;
+
+      /// \brief Signal handler.
+      handler_type handler;
+    };
+
+    /// \brief Subscription map type definition.
+    typedef std::map<subscription_id_type, subscription> subscription_map_type;
+
+  private:
+
+    /// \brief Update set of signals delivered via \c signalfd.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    void update_mask();
+
+  private:
+
+    /// \brief File descriptor of \c signalfd.
+    file_descriptor_type signal_fd_;
+
+    /// \brief Subscriptions ordered by their IDs.
+    subscription_map_type subscriptions_;
+
+    /// \brief Signals blocked by the dispatcher.
+    std::set<signal_number_type> blocked_signals_;
+
+    /// \brief ID of next subscription.
+    subscription_id_type next_subscription_id_;
+};
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+#endif // HG_SHERATAN_PROCESS_POSIX_SIGNAL_DISPATCHER_HPP
+
+
+// vim: set ts=2 sw=2 et:
@@ -0,0 +1,50 @@
+/// \file sheratan/process/posix/spawn_method.hpp
+/// \brief POSIX spawn method definition.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#ifndef HG_SHERATAN_PROCESS_POSIX_SPAWN_METHOD_HPP
+#define HG_SHERATAN_PROCESS_POSIX_SPAWN_METHOD_HPP
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+/// \brief Spawn method.
+/// \ingroup sheratan_process_posix
+/// \nosubgrouping
+/// \note All methods except \c FORK share address space of the parent
+/// until the child executes new program image, so they do not copy page
+/// tables of the parent. Therefore, their cost does not grow with resident
+/// set size of the parent. On the other hand, they can only be used with
+/// fork controllers, which execute new program image in the child process
+/// (see \c exec_ctl class).
+struct spawn_method
+{
+  /// \brief Spawn method values.
+  typedef enum
+  {
+    FORK           = 0,  ///< Plain \c fork, child routine of fork controller is executed in the child.
+    VFORK          = 1,  ///< \c vfork followed by \c execve.
+    CLONE_VM_VFORK = 2,  ///< \c clone with <code>CLONE_VM | CLONE_VFORK</code> followed by \c execve.
+    POSIX_SPAWN    = 3   ///< \c posix_spawn.
+  } value_type;
+};
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+#endif // HG_SHERATAN_PROCESS_POSIX_SPAWN_METHOD_HPP
+
+
+// vim: set ts=2 sw=2 et:
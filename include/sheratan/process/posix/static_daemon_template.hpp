@@ -0,0 +1,146 @@
+/// \file sheratan/process/posix/static_daemon_template.hpp
+/// \brief POSIX static daemon template interface.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#ifndef HG_SHERATAN_PROCESS_POSIX_STATIC_DAEMON_TEMPLATE_HPP
+#define HG_SHERATAN_PROCESS_POSIX_STATIC_DAEMON_TEMPLATE_HPP
+
+
+#include "sheratan/process/posix/daemon.hpp"
+#include "sheratan/process/posix/daemonizer.hpp"
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+/// \brief Static daemon template POSIX implementation.
+/// \ingroup sheratan_process_posix
+/// \nosubgrouping
+/// \note Unlike \c daemon_template, daemon controller is held by value
+/// and lent to the daemonizer, rather than cloned on the heap. Processes
+/// forked during daemonization are controlled statically as well (see
+/// \c static_process_template). Daemon controller routines are still
+/// called through \c daemon_ctl interface, since daemonization itself is
+/// not a template.
+template<typename DaemonCtl>
+class static_daemon_template : public daemon
+{
+  public:
+
+    /// \brief Daemon controller type definition.
+    typedef DaemonCtl daemon_ctl_type;
+
+  public:
+
+    /// \brief Default constructor.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \post <code>this->valid() == false</code>
+    /// \post <code>this->get_pid() == process_id()</code>.
+    static_daemon_template();
+
+    /// \brief Constructor.
+    /// \param dc Daemon controller (copied into the object).
+    /// \param pid_file Path to the daemon's PID file. No PID file will be
+    /// used, if ommited.
+    /// \param pid_file_mode Mode to be used for creation of PID file.
+    /// \param working_dir Path to the daemon's working directory. Working
+    /// directory will not be changed, if ommited.
+    /// \param stdin_redirect Standard input redirection path. Standard input
+    /// will not be redirected, if ommited.
+    /// \param stdout_redirect Standard output redirection path. Standard output
+    /// will not be redirected, if ommited.
+    /// \param stderr_redirect Standard error redirection path. Standard error
+    /// will not be redirected, if ommited.
+    /// \param reset_signals_flag Reset all signal handlers to default values
+    /// in the daemon process.
+    /// \param inherited_fds File descriptors to be inherited by the daemon
+    /// process (see \c daemonizer).
+    /// \param ready_stage Readiness stage to wait for (see \c daemonizer).
+    /// \param ready_timeout Maximal time to wait for the readiness stage.
+    /// \param mode Daemonization mode (see \c daemonizer).
+    /// \param lock_memory_flag Lock all the memory of the daemon process
+    /// (see \c daemonizer).
+    /// \param transparent_huge_pages Transparent huge pages policy of the
+    /// daemon process (see \c daemonizer).
+    /// \param oom_score_adj OOM score adjustment of the daemon process
+    /// (see \c daemonizer).
+    /// \param prefault_size Size of heap to be prefaulted in the daemon
+    /// process (see \c daemonizer).
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \pre All redirection paths must be existing, valid and accessible.
+    /// \post <code>this->valid() == true</code>
+    /// \post <code>this->get_pid() != process_id()</code>.
+    explicit static_daemon_template(
+      const DaemonCtl &dc,
+      const daemonizer::pid_file_type &pid_file = daemonizer::pid_file_type(),
+      const daemonizer::pid_file_mode_type &pid_file_mode = daemonizer::pid_file_mode_type(),
+      const daemonizer::working_dir_type &working_dir = daemonizer::working_dir_type(),
+      const daemonizer::stdin_redirect_type &stdin_redirect = daemonizer::stdin_redirect_type(),
+      const daemonizer::stdout_redirect_type &stdout_redirect = daemonizer::stdout_redirect_type(),
+      const daemonizer::stderr_redirect_type &stderr_redirect = daemonizer::stderr_redirect_type(),
+      const daemonizer::reset_signals_flag_type &reset_signals_flag = daemonizer::reset_signals_flag_type(),
+      const daemonizer::inherited_fds_type &inherited_fds = daemonizer::inherited_fds_type(),
+      const daemonizer::ready_stage_type &ready_stage = daemonizer::ready_stage_type(),
+      const daemonizer::ready_timeout_type &ready_timeout = daemonizer::ready_timeout_type(),
+      const daemonizer::mode_type &mode = daemonizer::mode_type(),
+      const daemonizer::lock_memory_flag_type &lock_memory_flag = daemonizer::lock_memory_flag_type(),
+      const daemonizer::transparent_huge_pages_type &transparent_huge_pages = daemonizer::transparent_huge_pages_type(),
+      const daemonizer::oom_score_adj_type &oom_score_adj = daemonizer::oom_score_adj_type(),
+      const daemonizer::prefault_size_type &prefault_size = daemonizer::prefault_size_type()
+    );
+
+  public:
+
+    /// \brief Get daemon controller.
+    /// \return Daemon controller.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    const DaemonCtl & get_daemon_ctl() const;
+
+    /// \brief Get daemon controller.
+    /// \return Daemon controller.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    DaemonCtl & get_daemon_ctl();
+
+    /// \brief Get reached readiness stages.
+    /// \return Readiness stages reached by the daemon process.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \pre Object must not be created by default constructor.
+    const daemonizer::ready_stage_list_type & get_ready_stages() const;
+
+  private:
+
+    /// \brief Daemon controller.
+    DaemonCtl daemon_ctl_;
+
+    /// \brief Daemonizer (borrowing the daemon controller).
+    daemonizer daemonizer_;
+};
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+#include "sheratan/process/posix/static_daemon_template.ci"
+
+
+#endif // HG_SHERATAN_PROCESS_POSIX_STATIC_DAEMON_TEMPLATE_HPP
+
+
+// vim: set ts=2 sw=2 et:
+
+
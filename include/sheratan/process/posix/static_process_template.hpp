@@ -0,0 +1,91 @@
+/// \file sheratan/process/posix/static_process_template.hpp
+/// \brief POSIX static process template interface.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#ifndef HG_SHERATAN_PROCESS_POSIX_STATIC_PROCESS_TEMPLATE_HPP
+#define HG_SHERATAN_PROCESS_POSIX_STATIC_PROCESS_TEMPLATE_HPP
+
+
+#include "sheratan/process/posix/process.hpp"
+#include "sheratan/process/posix/forker.hpp"
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+/// \brief Static process template POSIX implementation.
+/// \ingroup sheratan_process_posix
+/// \nosubgrouping
+/// \note Unlike \c process_template, fork controller is held by value
+/// (it is not cloned on the heap) and its routines are dispatched statically,
+/// so they can be inlined. Fork controller does not need to be derived from
+/// \c fork_ctl, it just has to provide \c prefork, \c postfork and \c child
+/// routines of the same signatures. In case it is derived from \c fork_ctl,
+/// the routines are still called without virtual dispatch.
+/// \note Only \c spawn_method::FORK spawn method is supported.
+template<typename ForkCtl>
+class static_process_template : public process
+{
+  public:
+
+    /// \brief Fork controller type definition.
+    typedef ForkCtl fork_ctl_type;
+
+  public:
+
+    /// \brief Default constructor.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \post <code>this->valid() == false</code>
+    /// \post <code>this->get_id() == process_id()</code>.
+    static_process_template();
+
+    /// \brief Constructor.
+    /// \param fc Fork controller (copied into the object).
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \post <code>this->valid() == true</code>
+    /// \post <code>this->get_id() != process_id()</code>.
+    explicit static_process_template(const ForkCtl &fc);
+
+  public:
+
+    /// \brief Get fork controller.
+    /// \return Fork controller.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    const ForkCtl & get_fork_ctl() const;
+
+    /// \brief Get fork controller.
+    /// \return Fork controller.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    ForkCtl & get_fork_ctl();
+
+  private:
+
+    /// \brief Fork controller.
+    ForkCtl fork_ctl_;
+};
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+#include "sheratan/process/posix/static_process_template.ci"
+
+
+#endif // HG_SHERATAN_PROCESS_POSIX_STATIC_PROCESS_TEMPLATE_HPP
+
+
+// vim: set ts=2 sw=2 et:
@@ -0,0 +1,54 @@
+/// \file sheratan/process/posix/terminate.hpp
+/// \brief Process termination POSIX implementation interface.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#ifndef HG_SHERATAN_PROCESS_POSIX_TERMINATE_HPP
+#define HG_SHERATAN_PROCESS_POSIX_TERMINATE_HPP
+
+
+#include <signal.h>
+
+#include "sheratan/process/posix/fwd.hpp"
+#include "sheratan/process/posix/types.hpp"
+#include "sheratan/process/posix/exit_status.hpp"
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+/// \brief Terminate process gracefully, kill it once grace period expires.
+/// \param proc Process to be terminated.
+/// \param grace_period Time given to the process to exit after it is sent
+/// the termination signal.
+/// \param signal Termination signal.
+/// \return Exit status of the process.
+/// \par Abrahams exception guarantee:
+/// weak
+/// \pre <code>proc.valid() == true</code>
+/// \post <code>proc.valid() == false</code>
+/// \note Process is sent \p signal and it is waited for (on its process file
+/// descriptor, see \c process::timed_join). In case it does not exit within
+/// the grace period, it is sent \c SIGKILL right then and joined. Therefore,
+/// the call takes only as long as the process takes to exit.
+/// \note In case the process has already terminated, its exit status is
+/// returned immediately.
+exit_status terminate(process &proc, const system_duration_type &grace_period, signal_number_type signal = SIGTERM);
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+#endif // HG_SHERATAN_PROCESS_POSIX_TERMINATE_HPP
+
+
+// vim: set ts=2 sw=2 et:
@@ -0,0 +1,47 @@
+/// \file sheratan/process/posix/transparent_huge_pages.hpp
+/// \brief POSIX transparent huge pages policy definition.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#ifndef HG_SHERATAN_PROCESS_POSIX_TRANSPARENT_HUGE_PAGES_HPP
+#define HG_SHERATAN_PROCESS_POSIX_TRANSPARENT_HUGE_PAGES_HPP
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+/// \brief Transparent huge pages policy.
+/// \ingroup sheratan_process_posix
+/// \nosubgrouping
+/// \note Policy is set by \c PR_SET_THP_DISABLE process control operation
+/// (Linux only), it is inherited by child processes and kept across
+/// \c execve. Whether huge pages are actually used, depends on system-wide
+/// setting as well (\c /sys/kernel/mm/transparent_hugepage/enabled).
+struct transparent_huge_pages
+{
+  /// \brief Transparent huge pages policy values.
+  typedef enum
+  {
+    INHERIT  = 0,  ///< Policy is not changed.
+    DISABLED = 1,  ///< Transparent huge pages are disabled for the process.
+    ENABLED  = 2   ///< Transparent huge pages are allowed for the process.
+  } value_type;
+};
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+#endif // HG_SHERATAN_PROCESS_POSIX_TRANSPARENT_HUGE_PAGES_HPP
+
+
+// vim: set ts=2 sw=2 et:
@@ -21,6 +21,9 @@ namespace posix {
 /// \brief System time type definition.
 typedef boost::posix_time::ptime system_time_type;
 
+/// \brief System time duration type definition.
+typedef boost::posix_time::time_duration system_duration_type;
+
 /// \brief Signal number type definition.
 typedef int signal_number_type;
 
@@ -0,0 +1,278 @@
+/// \file sheratan/process/posix/worker_pool.hpp
+/// \brief Worker pool POSIX implementation interface.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#ifndef HG_SHERATAN_PROCESS_POSIX_WORKER_POOL_HPP
+#define HG_SHERATAN_PROCESS_POSIX_WORKER_POOL_HPP
+
+
+#include <cstddef>
+#include <memory>
+
+#include <signal.h>
+
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+#include "sheratan/process/posix/fwd.hpp"
+#include "sheratan/process/posix/types.hpp"
+#include "sheratan/process/posix/exit_status.hpp"
+#include "sheratan/process/posix/fork_ctl.hpp"
+#include "sheratan/process/posix/process.hpp"
+#include "sheratan/process/posix/reactor.hpp"
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+/// \brief Worker pool POSIX implementation.
+/// \ingroup sheratan_process_posix
+/// \nosubgrouping
+/// \note Worker pool keeps fixed number of worker processes, forked using
+/// the same fork controller, alive (prefork pool):
+/// -# \c start forks all the workers and watches them by the reactor.
+/// -# Once a worker terminates, the reactor reaps it (via its process file
+///    descriptor, without polling) and the pool respawns it. Worker, which
+///    has terminated before it has run for minimal uptime, is considered
+///    crashed: it is respawned after delay, which doubles with each
+///    consecutive crash (from minimal up to maximal backoff). Worker
+///    respawned after it has run long enough, is respawned immediately.
+/// -# \c shutdown signals all the workers at once and dispatches the
+///    reactor until all of them terminate. Workers, which do not terminate
+///    within grace period, are killed.
+/// \note Workers are respawned only as the reactor is dispatched (see
+/// \c reactor::run), pool does not run its own event loop except for
+/// \c shutdown.
+/// \note Process file descriptors must be supported (see
+/// \c reactor::watch_process).
+class worker_pool : private boost::noncopyable
+{
+  public:
+
+    /// \brief Exit handler type definition.
+    /// \note Handler is passed index of the worker and its exit status.
+    typedef boost::function<void (std::size_t, const exit_status &)> exit_handler_type;
+
+  public:
+
+    /// \brief Constructor.
+    /// \param r Reactor watching the workers.
+    /// \param fc Fork controller of the workers.
+    /// \param size Number of workers.
+    /// \param min_uptime Minimal uptime, worker terminated earlier is considered crashed.
+    /// \param backoff_min Respawn delay after the first consecutive crash.
+    /// \param backoff_max Maximal respawn delay.
+    /// \param on_exit Handler invoked whenever a worker terminates (optional).
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \pre <code>size > 0</code>
+    /// \pre <code>backoff_min > 0</code>
+    /// \pre <code>backoff_max >= backoff_min</code>
+    /// \post <code>this->running() == 0</code>
+    /// \note Reactor must outlive the pool.
+    worker_pool(
+      reactor &r,
+      const fork_ctl &fc,
+      std::size_t size,
+      const system_duration_type &min_uptime = boost::posix_time::seconds(1),
+      const system_duration_type &backoff_min = boost::posix_time::milliseconds(100),
+      const system_duration_type &backoff_max = boost::posix_time::seconds(30),
+      const exit_handler_type &on_exit = exit_handler_type()
+    );
+
+    /// \brief Destructor.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \note Workers, which are still running, are killed (\c SIGKILL)
+    /// and joined without grace period.
+    ~worker_pool();
+
+  public:
+
+    /// \brief Fork all the workers.
+    /// \par Abrahams exception guarantee:
+    /// weak
+    /// \pre Pool has not been started yet.
+    /// \post <code>this->running() == this->size()</code>
+    /// \note In case of an error, workers forked so far keep running
+    /// (until \c shutdown is called, or the pool is destroyed).
+    void start();
+
+    /// \brief Send signal to all the running workers.
+    /// \param signal Signal number.
+    /// \par Abrahams exception guarantee:
+    /// weak
+    /// \pre Specified signal number must be valid.
+    /// \note Workers, which have terminated, but have not been reaped yet,
+    /// are skipped.
+    void broadcast(signal_number_type signal);
+
+    /// \brief Shut the pool down.
+    /// \param signal Signal sent to the workers.
+    /// \param grace Grace period, after which remaining workers are killed (\c SIGKILL).
+    /// \par Abrahams exception guarantee:
+    /// weak
+    /// \pre <code>grace > 0</code>
+    /// \post <code>this->running() == 0</code>
+    /// \note Pending respawns are cancelled and all the workers are signaled
+    /// at once. Then the reactor is dispatched (other watches of the reactor
+    /// are dispatched as well) until all of them terminate.
+    /// \note Pool, which has been shut down, does not respawn workers
+    /// anymore. Shutting it down again has no effect.
+    void shutdown(signal_number_type signal = SIGTERM, const system_duration_type &grace = boost::posix_time::seconds(10));
+
+  public:
+
+    /// \brief Get number of workers.
+    /// \return Number of workers the pool keeps alive.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    std::size_t size() const;
+
+    /// \brief Get number of running workers.
+    /// \return Number of workers, which have not been reaped yet.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    std::size_t running() const;
+
+    /// \brief Get worker process.
+    /// \param index Index of the worker.
+    /// \return Worker process, invalid while the worker is not running.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \pre <code>index < this->size()</code>
+    const process & get_worker(std::size_t index) const;
+
+    /// \brief Get number of respawns.
+    /// \return Number of workers respawned since the pool has been started.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    std::size_t get_respawn_count() const;
+
+  private:
+
+    /// \brief Worker slot.
+    /// \ingroup sheratan_process_posix
+    /// \nosubgrouping
+    struct slot : private boost::noncopyable
+    {
+      /// \brief Default constructor.
+      /// \par Abrahams exception guarantee:
+      /// strong
+      slot();
+
+      /// \brief Worker process (invalid while the worker is not running).
+      /// \note Process object is replaced each time the worker is forked.
+      std::auto_ptr<process> proc;
+
+      /// \brief Time the worker has been forked.
+      system_time_type started;
+
+      /// \brief Number of consecutive crashes.
+      unsigned int crashes;
+
+      /// \brief Whether respawn is pending.
+      bool respawn_pending;
+
+      /// \brief Respawn timer (valid only while respawn is pending).
+      reactor::timer_id_type respawn_timer;
+    };
+
+    /// \brief Slot list type definition.
+    typedef boost::ptr_vector<slot> slot_list_type;
+
+  private:
+
+    /// \brief Fork worker and watch it.
+    /// \param index Index of the worker.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    void spawn(std::size_t index);
+
+    /// \brief Respawn worker, schedule another respawn if it fails.
+    /// \param index Index of the worker.
+    /// \par Abrahams exception guarantee:
+    /// weak
+    void respawn(std::size_t index);
+
+    /// \brief Respawn worker immediately, or schedule its respawn after backoff delay.
+    /// \param index Index of the worker.
+    /// \par Abrahams exception guarantee:
+    /// weak
+    void schedule_respawn(std::size_t index);
+
+    /// \brief Handle termination of worker.
+    /// \param index Index of the worker.
+    /// \param proc Worker process.
+    /// \param status Exit status of the worker.
+    /// \par Abrahams exception guarantee:
+    /// weak
+    void on_worker_exit(std::size_t index, process &proc, const exit_status &status);
+
+    /// \brief Kill workers, which have not terminated within grace period.
+    /// \par Abrahams exception guarantee:
+    /// weak
+    void on_grace_expired();
+
+  private:
+
+    /// \brief Reactor watching the workers.
+    reactor &reactor_;
+
+    /// \brief Fork controller of the workers.
+    std::auto_ptr<fork_ctl> fork_ctl_;
+
+    /// \brief Minimal uptime of worker, which has not crashed.
+    system_duration_type min_uptime_;
+
+    /// \brief Respawn delay after the first consecutive crash.
+    system_duration_type backoff_min_;
+
+    /// \brief Maximal respawn delay.
+    system_duration_type backoff_max_;
+
+    /// \brief Exit handler.
+    exit_handler_type on_exit_;
+
+    /// \brief Worker slots.
+    slot_list_type slots_;
+
+    /// \brief Number of running workers.
+    std::size_t running_;
+
+    /// \brief Number of respawns.
+    std::size_t respawn_count_;
+
+    /// \brief Whether the pool has been started.
+    bool started_;
+
+    /// \brief Whether the pool is being shut down (or it has been shut down).
+    bool shutting_down_;
+
+    /// \brief Whether grace period of shutdown is running.
+    bool grace_pending_;
+
+    /// \brief Grace period timer (valid only while grace period is running).
+    reactor::timer_id_type grace_timer_;
+};
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+#endif // HG_SHERATAN_PROCESS_POSIX_WORKER_POOL_HPP
+
+
+// vim: set ts=2 sw=2 et:
@@ -0,0 +1,119 @@
+/// \file sheratan/process/posix/zygote.hpp
+/// \brief Zygote POSIX implementation interface.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#ifndef HG_SHERATAN_PROCESS_POSIX_ZYGOTE_HPP
+#define HG_SHERATAN_PROCESS_POSIX_ZYGOTE_HPP
+
+
+#include <cstddef>
+#include <string>
+
+#include <boost/noncopyable.hpp>
+
+#include "sheratan/process/posix/fwd.hpp"
+#include "sheratan/process/posix/types.hpp"
+#include "sheratan/process/posix/process_template.hpp"
+#include "sheratan/process/posix/zygote_ctl.hpp"
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+/// \brief Zygote POSIX implementation.
+/// \ingroup sheratan_process_posix
+/// \nosubgrouping
+/// \note Zygote is pre-initialized template process, which forks workers
+/// on request, so that workers need not initialize themselves:
+/// -# Zygote process is forked (through \c forker) by the constructor,
+///    it executes \c init routine of zygote controller and starts serving
+///    requests received over control socket.
+/// -# Each call to \c spawn sends request to the zygote, which forks the
+///    worker. Worker executes \c worker routine of zygote controller and
+///    it shares state initialized by the zygote copy-on-write.
+/// -# Destructor shuts control socket down, zygote exits and it is joined.
+/// \note Workers are forked by \c clone with \c CLONE_PARENT flag, therefore
+/// they are children of the process owning the zygote (rather than children
+/// of the zygote) and they are handled by ordinary \c process objects:
+/// they are joined, signaled and referred to by process file descriptor
+/// just like processes created by \c forker.
+/// \note Workers are created by raw \c clone system call, so fork handlers
+/// (see \c pthread_atfork) are not executed in the zygote. Zygote is single
+/// threaded, unless its controller starts threads, which it must not do.
+/// \note Spawning is not thread safe, calls to \c spawn must be serialized.
+class zygote : private boost::noncopyable
+{
+  public:
+
+    /// \brief Request type definition.
+    typedef std::string request_type;
+
+    /// \brief Maximal size of request.
+    static const std::size_t MAX_REQUEST;
+
+  public:
+
+    /// \brief Constructor.
+    /// \param zc Zygote controller.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \post <code>this->get_process().valid() == true</code>
+    /// \note Constructor returns once the zygote is initialized. In case
+    /// its initialization fails, \c runtime_error with
+    /// \c errnum::ZYGOTE_FAILED code is thrown.
+    explicit zygote(const zygote_ctl &zc);
+
+    /// \brief Destructor.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \note Zygote is shut down and joined. Workers it has spawned are not
+    /// affected.
+    ~zygote();
+
+  public:
+
+    /// \brief Get zygote process.
+    /// \return Zygote process.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    const process & get_process() const;
+
+    /// \brief Spawn worker.
+    /// \param worker Worker process object.
+    /// \param request Request passed to \c worker routine of zygote controller.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \pre <code>worker.valid() == false</code>
+    /// \pre <code>request.size() <= MAX_REQUEST</code>
+    /// \post <code>worker.valid() == true</code>
+    /// \note In case the zygote is gone, \c runtime_error with
+    /// \c errnum::ZYGOTE_FAILED code is thrown.
+    void spawn(process &worker, const request_type &request = request_type());
+
+  private:
+
+    /// \brief Own end of control socket.
+    file_descriptor_type fd_;
+
+    /// \brief Zygote process.
+    process_template<struct zygote_process_tag> process_;
+};
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+#endif // HG_SHERATAN_PROCESS_POSIX_ZYGOTE_HPP
+
+
+// vim: set ts=2 sw=2 et:
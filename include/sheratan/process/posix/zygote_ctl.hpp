@@ -0,0 +1,78 @@
+/// \file sheratan/process/posix/zygote_ctl.hpp
+/// \brief POSIX zygote controller interface.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#ifndef HG_SHERATAN_PROCESS_POSIX_ZYGOTE_CTL_HPP
+#define HG_SHERATAN_PROCESS_POSIX_ZYGOTE_CTL_HPP
+
+
+#include <string>
+
+#include "sheratan/process/posix/fwd.hpp"
+#include "sheratan/process/posix/exit_status.hpp"
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+/// \brief POSIX zygote controller.
+/// \ingroup sheratan_process_posix
+/// \nosubgrouping
+class zygote_ctl
+{
+  public:
+
+    /// \brief Virtual destructor.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    virtual ~zygote_ctl() = 0;
+
+  public:
+
+    /// \brief Clone.
+    /// \return Pointer to newly created instance.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    virtual zygote_ctl * clone() const = 0;
+
+  public:
+
+    /// \brief Zygote initialization routine.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \note This routine is executed once, in the zygote process, before
+    /// any worker is spawned. State initialized here (configuration, caches,
+    /// plugins, ...) is shared copy-on-write by all the workers.
+    /// \note In case this routine throws an exception, the zygote exits and
+    /// \c zygote constructor throws \c runtime_error with
+    /// \c errnum::ZYGOTE_FAILED code.
+    virtual void init() = 0;
+
+    /// \brief Worker process routine.
+    /// \param request Request the worker has been spawned with.
+    /// \return Return value of worker process.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \note This routine is executed in the worker process, on the very
+    /// same object \c init has been executed on.
+    virtual exit_status::value_type worker(const std::string &request) = 0;
+};
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+#endif // HG_SHERATAN_PROCESS_POSIX_ZYGOTE_CTL_HPP
+
+
+// vim: set ts=2 sw=2 et:
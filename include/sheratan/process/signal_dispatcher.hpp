@@ -0,0 +1,24 @@
+/// \file sheratan/process/signal_dispatcher.hpp
+/// \brief Signal dispatcher interface.
+/// \ingroup sheratan_process
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#ifndef HG_SHERATAN_PROCESS_SIGNAL_DISPATCHER_HPP
+#define HG_SHERATAN_PROCESS_SIGNAL_DISPATCHER_HPP
+
+
+#ifdef SHERATAN_TARGET_OS_LINUX
+#  include "sheratan/process/posix/signal_dispatcher.hpp"
+#  include "sheratan/process/posix/namespace.hpp"
+#else
+#  error FATAL: Target OS not supported!
+#endif
+
+
+#endif // HG_SHERATAN_PROCESS_SIGNAL_DISPATCHER_HPP
+
+
+// vim: set ts=2 sw=2 et:
+
+
@@ -0,0 +1,24 @@
+/// \file sheratan/process/spawn_method.hpp
+/// \brief Spawn method definition.
+/// \ingroup sheratan_process
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#ifndef HG_SHERATAN_PROCESS_SPAWN_METHOD_HPP
+#define HG_SHERATAN_PROCESS_SPAWN_METHOD_HPP
+
+
+#ifdef SHERATAN_TARGET_OS_LINUX
+#  include "sheratan/process/posix/spawn_method.hpp"
+#  include "sheratan/process/posix/namespace.hpp"
+#else
+#  error FATAL: Target OS not supported!
+#endif
+
+
+#endif // HG_SHERATAN_PROCESS_SPAWN_METHOD_HPP
+
+
+// vim: set ts=2 sw=2 et:
+
+
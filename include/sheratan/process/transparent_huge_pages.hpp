@@ -0,0 +1,24 @@
+/// \file sheratan/process/transparent_huge_pages.hpp
+/// \brief Transparent huge pages policy definition.
+/// \ingroup sheratan_process
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#ifndef HG_SHERATAN_PROCESS_TRANSPARENT_HUGE_PAGES_HPP
+#define HG_SHERATAN_PROCESS_TRANSPARENT_HUGE_PAGES_HPP
+
+
+#ifdef SHERATAN_TARGET_OS_LINUX
+#  include "sheratan/process/posix/transparent_huge_pages.hpp"
+#  include "sheratan/process/posix/namespace.hpp"
+#else
+#  error FATAL: Target OS not supported!
+#endif
+
+
+#endif // HG_SHERATAN_PROCESS_TRANSPARENT_HUGE_PAGES_HPP
+
+
+// vim: set ts=2 sw=2 et:
+
+
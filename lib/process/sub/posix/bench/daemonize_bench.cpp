@@ -0,0 +1,278 @@
+/// \file process/sub/posix/bench/daemonize_bench.cpp
+/// \brief Daemonization modes POSIX implementation benchmark.
+/// \ingroup sheratan_process_posix_bench
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+///
+/// Measures startup latency of a daemon for all daemonization modes: time
+/// from the moment supervisor spawns the (supervised) process, which then
+/// daemonizes itself, until the daemon routine is entered. Then it measures
+/// how long it takes to refuse start of a daemon, which PID file is locked.
+/// Finally, it breaks detached daemonization down into its phases.
+///
+/// Usage: <code>daemonize_bench [iterations]</code>
+
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+
+#include "sheratan/errhdl/exception.hpp"
+#include "sheratan/process/posix/daemon_ctl.hpp"
+#include "sheratan/process/posix/daemonizer.hpp"
+#include "sheratan/process/posix/daemon_template.hpp"
+#include "sheratan/process/posix/fork_ctl.hpp"
+#include "sheratan/process/posix/process_template.hpp"
+
+
+namespace {
+
+
+/// \brief Benchmark supervised process type definition.
+typedef sheratan::process_impl::posix::process_template<struct bench_supervised_process_tag> bench_supervised_process;
+
+/// \brief Benchmark daemon type definition.
+typedef sheratan::process_impl::posix::daemon_template<struct bench_daemon_tag> bench_daemon;
+
+/// \brief Benchmarked daemonization modes.
+static const sheratan::process_impl::posix::daemonization_mode::value_type daemonization_modes[] = {
+  sheratan::process_impl::posix::daemonization_mode::DETACHED,
+  sheratan::process_impl::posix::daemonization_mode::FOREGROUND
+};
+
+/// \brief Names of benchmarked daemonization modes.
+static const char * const daemonization_mode_names[] = {
+  "detached",
+  "foreground"
+};
+
+/// \brief Names of daemonization phases.
+static const char * const daemonization_phase_names[] = {
+  "predaemonize",
+  "init parent",
+  "1st fork",
+  "setsid",
+  "2nd fork",
+  "fd sanitize",
+  "redirect",
+  "pid file",
+  "pid report",
+  "readiness",
+  "postdaemonize"
+};
+
+/// \brief PID file locked by benchmark process.
+static const char locked_pid_file[] = "/tmp/sheratan_process_posix_daemonize_bench.pid";
+
+/// \brief Get monotonic time.
+/// \return Monotonic time in microseconds.
+static double now_us()
+{
+  struct timespec ts;
+  ::clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+
+/// \brief Daemon controller of daemon, which reports the time its routine is entered.
+/// \note Time is written into the first inherited file descriptor.
+class bench_daemon_ctl : public sheratan::process_impl::posix::daemon_ctl
+{
+  public:
+
+    virtual sheratan::process_impl::posix::daemon_ctl * clone() const
+    {
+      return new bench_daemon_ctl(*this);
+    }
+
+    virtual void predaemonize()
+    {
+    }
+
+    virtual void postdaemonize(sheratan::process_impl::posix::daemon &)
+    {
+    }
+
+    virtual sheratan::process_impl::posix::exit_status::value_type daemonized_child()
+    {
+      double entered = now_us();
+      if(::write(sheratan::process_impl::posix::daemonizer::LISTEN_FDS_START, &entered, sizeof(entered)) != sizeof(entered)) {
+        return EXIT_FAILURE;
+      }
+      return EXIT_SUCCESS;
+    }
+};
+
+
+/// \brief Fork controller of supervised process, which daemonizes itself.
+class bench_supervised_fork_ctl : public sheratan::process_impl::posix::fork_ctl
+{
+  public:
+
+    bench_supervised_fork_ctl(sheratan::process_impl::posix::daemonization_mode::value_type mode, int pipe_fd)
+    : mode_(mode)
+    , pipe_fd_(pipe_fd)
+    {
+    }
+
+    virtual sheratan::process_impl::posix::fork_ctl * clone() const
+    {
+      return new bench_supervised_fork_ctl(*this);
+    }
+
+    virtual void prefork()
+    {
+    }
+
+    virtual void postfork(sheratan::process_impl::posix::process &)
+    {
+    }
+
+    virtual sheratan::process_impl::posix::exit_status::value_type child()
+    {
+      try {
+        sheratan::process_impl::posix::daemonizer::inherited_fds_type::value_type inherited_fds;
+        inherited_fds.push_back(this->pipe_fd_);
+        bench_daemon daemon_process(
+          bench_daemon_ctl(),
+          sheratan::process_impl::posix::daemonizer::pid_file_type(),
+          sheratan::process_impl::posix::daemonizer::pid_file_mode_type(),
+          sheratan::process_impl::posix::daemonizer::working_dir_type(),
+          sheratan::process_impl::posix::daemonizer::stdin_redirect_type(),
+          sheratan::process_impl::posix::daemonizer::stdout_redirect_type(),
+          sheratan::process_impl::posix::daemonizer::stderr_redirect_type(),
+          sheratan::process_impl::posix::daemonizer::reset_signals_flag_type(),
+          sheratan::process_impl::posix::daemonizer::inherited_fds_type(inherited_fds),
+          sheratan::process_impl::posix::daemonizer::ready_stage_type(),
+          sheratan::process_impl::posix::daemonizer::ready_timeout_type(),
+          sheratan::process_impl::posix::daemonizer::mode_type(this->mode_)
+        );
+      } catch(...) {
+        return EXIT_FAILURE;
+      }
+      return EXIT_SUCCESS;
+    }
+
+  private:
+
+    /// \brief Daemonization mode.
+    sheratan::process_impl::posix::daemonization_mode::value_type mode_;
+
+    /// \brief Write end of pipe to be inherited by the daemon.
+    int pipe_fd_;
+};
+
+
+} // anonymous namespace
+
+
+int main(int argc, char *argv[])
+{
+  int iterations = 200;
+  if(argc > 1) {
+    iterations = std::atoi(argv[1]);
+  }
+
+  std::cout << std::setw(12) << "mode" << std::setw(16) << "latency [us]" << "   (mean latency of daemon start or its refusal, " << iterations << " iterations)" << std::endl;
+
+  for(std::size_t m = 0; m < sizeof(daemonization_modes) / sizeof(daemonization_modes[0]); ++m) {
+    double elapsed = 0;
+    for(int i = 0; i < iterations; ++i) {
+      int pipe_fd[2];
+      if(::pipe(pipe_fd) != 0) {
+        return EXIT_FAILURE;
+      }
+      // output must not be written twice by the supervised process
+      std::cout.flush();
+      double start = now_us();
+      bench_supervised_fork_ctl fc(daemonization_modes[m], pipe_fd[1]);
+      bench_supervised_process supervised(fc);
+      ::close(pipe_fd[1]);
+      double entered = 0;
+      bool reported = (::read(pipe_fd[0], &entered, sizeof(entered)) == sizeof(entered));
+      ::close(pipe_fd[0]);
+      supervised.join();
+      if(!reported) {
+        std::cerr << "daemon failed to start" << std::endl;
+        return EXIT_FAILURE;
+      }
+      elapsed += entered - start;
+    }
+    std::cout << std::setw(12) << daemonization_mode_names[m] << std::setw(16) << std::fixed << std::setprecision(1) << (elapsed / iterations) << std::endl;
+  }
+
+  // lock PID file as if another instance was running; process-associated
+  // lock would be released as soon as daemonizer closes its descriptor
+  int pidfile_fd = ::open(locked_pid_file, O_RDWR|O_CREAT, 0600);
+  struct flock pidfile_flock;
+  pidfile_flock.l_type = F_WRLCK;
+  pidfile_flock.l_start = 0;
+  pidfile_flock.l_whence = SEEK_SET;
+  pidfile_flock.l_len = 0;
+  pidfile_flock.l_pid = 0;
+  if((pidfile_fd < 0) || (::fcntl(pidfile_fd, F_OFD_SETLK, &pidfile_flock) != 0)) {
+    return EXIT_FAILURE;
+  }
+  bench_daemon_ctl dc;
+  double elapsed = 0;
+  for(int i = 0; i < iterations; ++i) {
+    double start = now_us();
+    try {
+      bench_daemon daemon_process(dc, sheratan::process_impl::posix::daemonizer::pid_file_type(locked_pid_file));
+      std::cerr << "duplicate daemon started" << std::endl;
+      return EXIT_FAILURE;
+    } catch(sheratan::errhdl::runtime_error &) {
+      // refused as expected
+    }
+    elapsed += now_us() - start;
+  }
+  ::close(pidfile_fd);
+  ::unlink(locked_pid_file);
+  std::cout << std::setw(12) << "duplicate" << std::setw(16) << std::fixed << std::setprecision(1) << (elapsed / iterations) << std::endl;
+
+  // daemonize directly, collecting daemonization reports
+  double phase_elapsed[sheratan::process_impl::posix::daemonization_report::phase::COUNT] = {0};
+  for(int i = 0; i < iterations; ++i) {
+    int pipe_fd[2];
+    if(::pipe(pipe_fd) != 0) {
+      return EXIT_FAILURE;
+    }
+    sheratan::process_impl::posix::daemonizer::inherited_fds_type::value_type inherited_fds;
+    inherited_fds.push_back(pipe_fd[1]);
+    std::cout.flush();
+    bench_daemon daemon_process(
+      dc,
+      sheratan::process_impl::posix::daemonizer::pid_file_type(),
+      sheratan::process_impl::posix::daemonizer::pid_file_mode_type(),
+      sheratan::process_impl::posix::daemonizer::working_dir_type(),
+      sheratan::process_impl::posix::daemonizer::stdin_redirect_type(),
+      sheratan::process_impl::posix::daemonizer::stdout_redirect_type(),
+      sheratan::process_impl::posix::daemonizer::stderr_redirect_type(),
+      sheratan::process_impl::posix::daemonizer::reset_signals_flag_type(),
+      sheratan::process_impl::posix::daemonizer::inherited_fds_type(inherited_fds)
+    );
+    ::close(pipe_fd[1]);
+    double entered = 0;
+    bool reported = (::read(pipe_fd[0], &entered, sizeof(entered)) == sizeof(entered));
+    ::close(pipe_fd[0]);
+    if(!reported || !daemon_process.get_report().complete()) {
+      std::cerr << "daemon failed to start" << std::endl;
+      return EXIT_FAILURE;
+    }
+    for(int p = 0; p < sheratan::process_impl::posix::daemonization_report::phase::COUNT; ++p) {
+      phase_elapsed[p] += daemon_process.get_report().get_duration(static_cast<sheratan::process_impl::posix::daemonization_report::phase::value_type>(p)).total_microseconds();
+    }
+  }
+  std::cout << std::endl << std::setw(14) << "phase" << std::setw(16) << "duration [us]" << "   (mean duration of detached daemonization phase)" << std::endl;
+  for(int p = 0; p < sheratan::process_impl::posix::daemonization_report::phase::COUNT; ++p) {
+    std::cout << std::setw(14) << daemonization_phase_names[p] << std::setw(16) << std::fixed << std::setprecision(1) << (phase_elapsed[p] / iterations) << std::endl;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+
+// vim: set ts=2 sw=2 et:
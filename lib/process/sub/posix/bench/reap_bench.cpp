@@ -0,0 +1,172 @@
+/// \file process/sub/posix/bench/reap_bench.cpp
+/// \brief Reaping of child processes POSIX implementation benchmark.
+/// \ingroup sheratan_process_posix_bench
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+///
+/// Measures throughput of reaping short-lived child processes, which are
+/// spawned in batches and exit immediately, by plain loop joining them
+/// one by one (i.e. \c waitpid loop) and by the reactor with each of its
+/// backends. Time is measured from the moment the whole batch is spawned
+/// until all its children are reaped.
+///
+/// Usage: <code>reap_bench [children [batch-size]]</code>
+
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+#include <time.h>
+
+#include <boost/bind/bind.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+
+#include "sheratan/process/posix/fork_ctl.hpp"
+#include "sheratan/process/posix/process_template.hpp"
+#include "sheratan/process/posix/reactor.hpp"
+
+
+namespace {
+
+
+/// \brief Benchmark process type definition.
+typedef sheratan::process_impl::posix::process_template<struct bench_reap_process_tag> bench_reap_process;
+
+/// \brief Benchmark process list type definition.
+typedef boost::ptr_vector<bench_reap_process> bench_reap_process_list;
+
+
+/// \brief Fork controller of child process, which exits immediately.
+class bench_reap_fork_ctl : public sheratan::process_impl::posix::fork_ctl
+{
+  public:
+
+    virtual sheratan::process_impl::posix::fork_ctl * clone() const
+    {
+      return new bench_reap_fork_ctl(*this);
+    }
+
+    virtual void prefork()
+    {
+    }
+
+    virtual void postfork(sheratan::process_impl::posix::process &)
+    {
+    }
+
+    virtual sheratan::process_impl::posix::exit_status::value_type child()
+    {
+      return 0;
+    }
+};
+
+
+/// \brief Reaping method.
+struct reap_method
+{
+  /// \brief Reaping method values.
+  typedef enum
+  {
+    JOIN = 0,         ///< Join children one by one.
+    REACTOR_EPOLL,    ///< Reactor with epoll backend.
+    REACTOR_IO_URING  ///< Reactor with io_uring backend.
+  } value_type;
+};
+
+/// \brief Names of reaping methods.
+static const char * const reap_method_names[] = {
+  "join",
+  "reactor_epoll",
+  "reactor_io_uring"
+};
+
+
+/// \brief Get monotonic time.
+/// \return Monotonic time in microseconds.
+static double now_us()
+{
+  struct timespec ts;
+  ::clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/// \brief Count reaped child.
+/// \param reaped Counter of reaped children.
+static void on_exit(int *reaped, sheratan::process_impl::posix::process &, const sheratan::process_impl::posix::exit_status &)
+{
+  ++(*reaped);
+}
+
+/// \brief Reap batch of children.
+/// \param method Reaping method.
+/// \param children Children to be reaped.
+/// \return Time spent reaping in microseconds.
+static double reap(reap_method::value_type method, bench_reap_process_list &children)
+{
+  double start = 0.0;
+  if(method == reap_method::JOIN) {
+    start = now_us();
+    for(std::size_t i = 0; i < children.size(); ++i) {
+      children[i].join();
+    }
+    return now_us() - start;
+  }
+
+  // reactor is created in advance, so that its setup is not measured
+  sheratan::process_impl::posix::reactor r(
+    (method == reap_method::REACTOR_EPOLL) ?
+      sheratan::process_impl::posix::reactor_backend::EPOLL :
+      sheratan::process_impl::posix::reactor_backend::IO_URING
+  );
+  int reaped = 0;
+  start = now_us();
+  for(std::size_t i = 0; i < children.size(); ++i) {
+    r.watch_process(children[i], boost::bind(&on_exit, &reaped, boost::placeholders::_1, boost::placeholders::_2));
+  }
+  r.run();
+  return now_us() - start;
+}
+
+
+} // anonymous namespace
+
+
+int main(int argc, char *argv[])
+{
+  int count = 10000;
+  int batch = 1000;
+  if(argc > 1) {
+    count = std::atoi(argv[1]);
+  }
+  if(argc > 2) {
+    batch = std::atoi(argv[2]);
+  }
+
+  std::cout << std::setw(18) << "method" << std::setw(16) << "reap [us]" << std::setw(16) << "children/s"
+    << "   (" << count << " children, batches of " << batch << ")" << std::endl;
+
+  for(std::size_t m = 0; m < sizeof(reap_method_names) / sizeof(reap_method_names[0]); ++m) {
+    reap_method::value_type method = static_cast<reap_method::value_type>(m);
+    if((method == reap_method::REACTOR_IO_URING) && (!sheratan::process_impl::posix::reactor::supports(sheratan::process_impl::posix::reactor_backend::IO_URING))) {
+      std::cout << std::setw(18) << reap_method_names[m] << std::setw(16) << "n/a" << std::endl;
+      continue;
+    }
+
+    double elapsed = 0.0;
+    for(int done = 0; done < count; done += batch) {
+      bench_reap_process_list children;
+      for(int i = 0; (i < batch) && (done + i < count); ++i) {
+        children.push_back(new bench_reap_process(bench_reap_fork_ctl()));
+      }
+      elapsed += reap(method, children);
+    }
+    std::cout << std::setw(18) << reap_method_names[m]
+      << std::setw(16) << std::fixed << std::setprecision(2) << (elapsed / count)
+      << std::setw(16) << std::fixed << std::setprecision(0) << (count / (elapsed / 1e6)) << std::endl;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+
+// vim: set ts=2 sw=2 et:
@@ -0,0 +1,305 @@
+/// \file process/sub/posix/bench/spawn_bench.cpp
+/// \brief Spawn methods POSIX implementation benchmark.
+/// \ingroup sheratan_process_posix_bench
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+///
+/// Measures latency of spawning a child process executing \c /bin/true
+/// (from the spawn until the child is joined) for all spawn methods,
+/// depending on resident set size of the parent process. Then it compares
+/// latency of forking a child process, which exits immediately, controlled
+/// by cloned (\c process_template) and by static (\c static_process_template)
+/// fork controller, and of spawning it by a \c zygote. Finally, it measures
+/// startup of a batch of children, each of them initializing itself for
+/// a millisecond, started one by one (waiting for each child to be ready)
+/// and started by \c batch_forker.
+///
+/// Usage: <code>spawn_bench [iterations [rss-MiB ...]]</code>
+
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <time.h>
+#include <unistd.h>
+
+#include <boost/ptr_container/ptr_vector.hpp>
+
+#include "sheratan/process/posix/batch_forker.hpp"
+#include "sheratan/process/posix/exec_ctl.hpp"
+#include "sheratan/process/posix/fork_ctl.hpp"
+#include "sheratan/process/posix/parent_child_sync.hpp"
+#include "sheratan/process/posix/process_template.hpp"
+#include "sheratan/process/posix/static_process_template.hpp"
+#include "sheratan/process/posix/zygote.hpp"
+
+
+namespace {
+
+
+/// \brief Benchmark process type definition.
+typedef sheratan::process_impl::posix::process_template<struct bench_spawn_process_tag> bench_spawn_process;
+
+/// \brief Benchmarked spawn methods.
+static const sheratan::process_impl::posix::spawn_method::value_type spawn_methods[] = {
+  sheratan::process_impl::posix::spawn_method::FORK,
+  sheratan::process_impl::posix::spawn_method::VFORK,
+  sheratan::process_impl::posix::spawn_method::CLONE_VM_VFORK,
+  sheratan::process_impl::posix::spawn_method::POSIX_SPAWN
+};
+
+/// \brief Names of benchmarked spawn methods.
+static const char * const spawn_method_names[] = {
+  "fork",
+  "vfork",
+  "clone_vfork",
+  "posix_spawn"
+};
+
+/// \brief Fork controller of child process, which exits immediately.
+class bench_fork_ctl : public sheratan::process_impl::posix::fork_ctl
+{
+  public:
+
+    virtual sheratan::process_impl::posix::fork_ctl * clone() const
+    {
+      return new bench_fork_ctl(*this);
+    }
+
+    virtual void prefork()
+    {
+    }
+
+    virtual void postfork(sheratan::process_impl::posix::process &)
+    {
+    }
+
+    virtual sheratan::process_impl::posix::exit_status::value_type child()
+    {
+      return EXIT_SUCCESS;
+    }
+};
+
+/// \brief Zygote controller of worker process, which exits immediately.
+class bench_zygote_ctl : public sheratan::process_impl::posix::zygote_ctl
+{
+  public:
+
+    virtual sheratan::process_impl::posix::zygote_ctl * clone() const
+    {
+      return new bench_zygote_ctl(*this);
+    }
+
+    virtual void init()
+    {
+    }
+
+    virtual sheratan::process_impl::posix::exit_status::value_type worker(const std::string &)
+    {
+      return EXIT_SUCCESS;
+    }
+};
+
+/// \brief Number of children started in a batch.
+static const std::size_t batch_size = 64;
+
+/// \brief Initialization time of child started in a batch [us].
+static const useconds_t batch_init_us = 1000;
+
+/// \brief Fork controller of child, which initializes itself and reports ready.
+/// \note Readiness is reported either through \c parent_child_sync (child
+/// started one by one), or through \c batch_forker.
+class bench_init_fork_ctl : public sheratan::process_impl::posix::fork_ctl
+{
+  public:
+
+    explicit bench_init_fork_ctl(bool batch)
+    : batch_(batch)
+    , sync_()
+    {
+    }
+
+    bench_init_fork_ctl(const bench_init_fork_ctl &other)
+    : sheratan::process_impl::posix::fork_ctl()
+    , batch_(other.batch_)
+    , sync_()
+    {
+    }
+
+    virtual sheratan::process_impl::posix::fork_ctl * clone() const
+    {
+      return new bench_init_fork_ctl(*this);
+    }
+
+    virtual void prefork()
+    {
+      if(!this->batch_) {
+        this->sync_.prefork();
+      }
+    }
+
+    virtual void postfork(sheratan::process_impl::posix::process &)
+    {
+      if(!this->batch_) {
+        this->sync_.wait_for_child();
+        this->sync_.finalize();
+      }
+    }
+
+    virtual sheratan::process_impl::posix::exit_status::value_type child()
+    {
+      ::usleep(batch_init_us);
+      if(this->batch_) {
+        sheratan::process_impl::posix::batch_forker::report_ready();
+      }
+      else {
+        this->sync_.unblock_parent();
+      }
+      return EXIT_SUCCESS;
+    }
+
+  private:
+
+    /// \brief Whether the child is started in a batch.
+    bool batch_;
+
+    /// \brief Parent-child synchronizer (child started one by one).
+    sheratan::process_impl::posix::parent_child_sync sync_;
+};
+
+/// \brief Benchmark process with cloned fork controller type definition.
+typedef sheratan::process_impl::posix::process_template<struct bench_fork_process_tag> bench_fork_process;
+
+/// \brief Benchmark process with static fork controller type definition.
+typedef sheratan::process_impl::posix::static_process_template<bench_fork_ctl> bench_static_fork_process;
+
+/// \brief Get monotonic time.
+/// \return Monotonic time in microseconds.
+static double now_us()
+{
+  struct timespec ts;
+  ::clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+
+} // anonymous namespace
+
+
+int main(int argc, char *argv[])
+{
+  int iterations = 200;
+  std::vector<std::size_t> rss_sizes;
+  if(argc > 1) {
+    iterations = std::atoi(argv[1]);
+  }
+  for(int i = 2; i < argc; ++i) {
+    rss_sizes.push_back(static_cast<std::size_t>(std::atoi(argv[i])));
+  }
+  if(rss_sizes.empty()) {
+    rss_sizes.push_back(0);
+    rss_sizes.push_back(128);
+    rss_sizes.push_back(512);
+    rss_sizes.push_back(2048);
+  }
+
+  sheratan::process_impl::posix::exec_ctl::string_list_type args;
+  args.push_back("true");
+  sheratan::process_impl::posix::exec_ctl ec("/bin/true", args);
+
+  std::cout << std::setw(10) << "rss [MiB]";
+  for(std::size_t m = 0; m < sizeof(spawn_methods) / sizeof(spawn_methods[0]); ++m) {
+    std::cout << std::setw(16) << spawn_method_names[m];
+  }
+  std::cout << "   (mean spawn+join latency [us], " << iterations << " iterations)" << std::endl;
+
+  for(std::size_t r = 0; r < rss_sizes.size(); ++r) {
+    // grow resident set (every page must be touched to become resident)
+    std::vector<char> ballast(rss_sizes[r] * 1024 * 1024);
+    if(!ballast.empty()) {
+      std::memset(&(ballast[0]), 1, ballast.size());
+    }
+
+    std::cout << std::setw(10) << rss_sizes[r];
+    for(std::size_t m = 0; m < sizeof(spawn_methods) / sizeof(spawn_methods[0]); ++m) {
+      double start = now_us();
+      for(int i = 0; i < iterations; ++i) {
+        bench_spawn_process child(ec, spawn_methods[m]);
+        child.join();
+      }
+      double elapsed = now_us() - start;
+      std::cout << std::setw(16) << std::fixed << std::setprecision(1) << (elapsed / iterations);
+    }
+    std::cout << std::endl;
+  }
+
+  // output must not be written twice by the child processes
+  std::cout.flush();
+  bench_fork_ctl fc;
+  double start = now_us();
+  for(int i = 0; i < iterations; ++i) {
+    bench_fork_process child(fc);
+    child.join();
+  }
+  double cloned_elapsed = now_us() - start;
+  start = now_us();
+  for(int i = 0; i < iterations; ++i) {
+    bench_static_fork_process child(fc);
+    child.join();
+  }
+  double static_elapsed = now_us() - start;
+  sheratan::process_impl::posix::zygote z((bench_zygote_ctl()));
+  start = now_us();
+  for(int i = 0; i < iterations; ++i) {
+    bench_fork_process child;
+    z.spawn(child);
+    child.join();
+  }
+  double zygote_elapsed = now_us() - start;
+  std::cout << std::endl << std::setw(10) << "fork_ctl" << std::setw(16) << "cloned" << std::setw(16) << "static" << std::setw(16) << "zygote" << "   (mean fork+join latency [us], " << iterations << " iterations)" << std::endl;
+  std::cout << std::setw(10) << "" << std::setw(16) << std::fixed << std::setprecision(1) << (cloned_elapsed / iterations) << std::setw(16) << (static_elapsed / iterations) << std::setw(16) << (zygote_elapsed / iterations) << std::endl;
+
+  // batch startup is measured until all the children are ready
+  double sequential_elapsed = 0;
+  double batch_elapsed = 0;
+  int batch_iterations = std::max(iterations / 20, 1);
+  for(int i = 0; i < batch_iterations; ++i) {
+    boost::ptr_vector<bench_fork_process> children;
+    start = now_us();
+    for(std::size_t c = 0; c < batch_size; ++c) {
+      children.push_back(new bench_fork_process(bench_init_fork_ctl(false)));
+    }
+    sequential_elapsed += now_us() - start;
+    for(std::size_t c = 0; c < batch_size; ++c) {
+      children[c].join();
+    }
+
+    children.clear();
+    sheratan::process_impl::posix::batch_forker::process_list_type batch;
+    for(std::size_t c = 0; c < batch_size; ++c) {
+      children.push_back(new bench_fork_process());
+      batch.push_back(&children.back());
+    }
+    sheratan::process_impl::posix::batch_forker batch_forker((bench_init_fork_ctl(true)));
+    start = now_us();
+    if(!batch_forker.fork(batch)) {
+      std::cerr << "batch failed to start" << std::endl;
+      return EXIT_FAILURE;
+    }
+    batch_elapsed += now_us() - start;
+    for(std::size_t c = 0; c < batch_size; ++c) {
+      children[c].join();
+    }
+  }
+  std::cout << std::endl << std::setw(10) << "children" << std::setw(16) << "sequential" << std::setw(16) << "batch" << "   (mean startup latency [us], " << batch_iterations << " iterations)" << std::endl;
+  std::cout << std::setw(10) << batch_size << std::setw(16) << std::fixed << std::setprecision(1) << (sequential_elapsed / batch_iterations) << std::setw(16) << (batch_elapsed / batch_iterations) << std::endl;
+
+  return EXIT_SUCCESS;
+}
+
+
+// vim: set ts=2 sw=2 et:
@@ -0,0 +1,160 @@
+/// \file process/sub/posix/bench/sync_bench.cpp
+/// \brief Parent-child synchronization POSIX implementation benchmark.
+/// \ingroup sheratan_process_posix_bench
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+///
+/// Measures ping-pong latency between parent and child process with each
+/// of the parent-child synchronizer backends. Parent unblocks the child
+/// and waits until the child unblocks it back (two synchronizers, one for
+/// each direction), round trip time is averaged over all the rounds.
+///
+/// Usage: <code>sync_bench [rounds]</code>
+
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+#include <time.h>
+
+#include "sheratan/process/posix/fork_ctl.hpp"
+#include "sheratan/process/posix/parent_child_sync.hpp"
+#include "sheratan/process/posix/process_template.hpp"
+
+
+namespace {
+
+
+/// \brief Benchmark process type definition.
+typedef sheratan::process_impl::posix::process_template<struct bench_sync_process_tag> bench_sync_process;
+
+
+/// \brief Fork controller of child process, which answers each ping by pong.
+class bench_sync_fork_ctl : public sheratan::process_impl::posix::fork_ctl
+{
+  public:
+
+    bench_sync_fork_ctl(sheratan::process_impl::posix::parent_child_sync_backend::value_type backend, int rounds)
+    : backend_(backend)
+    , rounds_(rounds)
+    , ping_(backend)
+    , pong_(backend)
+    {
+    }
+
+    bench_sync_fork_ctl(const bench_sync_fork_ctl &that)
+    : sheratan::process_impl::posix::fork_ctl()
+    , backend_(that.backend_)
+    , rounds_(that.rounds_)
+    , ping_(that.backend_)
+    , pong_(that.backend_)
+    {
+    }
+
+    virtual sheratan::process_impl::posix::fork_ctl * clone() const
+    {
+      return new bench_sync_fork_ctl(*this);
+    }
+
+    virtual void prefork()
+    {
+      this->ping_.prefork();
+      this->pong_.prefork();
+    }
+
+    virtual void postfork(sheratan::process_impl::posix::process &)
+    {
+    }
+
+    virtual sheratan::process_impl::posix::exit_status::value_type child()
+    {
+      for(int i = 0; i < this->rounds_; ++i) {
+        this->ping_.wait_for_parent();
+        this->pong_.unblock_parent();
+      }
+      return 0;
+    }
+
+  public:
+
+    /// \brief Synchronizer backend.
+    sheratan::process_impl::posix::parent_child_sync_backend::value_type backend_;
+
+    /// \brief Number of rounds.
+    int rounds_;
+
+    /// \brief Parent-to-child synchronizer.
+    sheratan::process_impl::posix::parent_child_sync ping_;
+
+    /// \brief Child-to-parent synchronizer.
+    sheratan::process_impl::posix::parent_child_sync pong_;
+};
+
+
+/// \brief Names of synchronizer backends.
+static const char * const backend_names[] = {
+  "auto",
+  "pipe",
+  "eventfd",
+  "futex"
+};
+
+
+/// \brief Get monotonic time.
+/// \return Current monotonic time [us].
+static double now_us()
+{
+  struct timespec ts;
+  ::clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/// \brief Play ping-pong with child process.
+/// \param backend Synchronizer backend.
+/// \param rounds Number of rounds.
+/// \return Elapsed time [us].
+static double ping_pong(sheratan::process_impl::posix::parent_child_sync_backend::value_type backend, int rounds)
+{
+  bench_sync_process child((bench_sync_fork_ctl(backend, rounds)));
+  bench_sync_fork_ctl &fc = dynamic_cast<bench_sync_fork_ctl &>(child.get_fork_ctl());
+  double start = now_us();
+  for(int i = 0; i < rounds; ++i) {
+    fc.ping_.unblock_child();
+    fc.pong_.wait_for_child();
+  }
+  double elapsed = now_us() - start;
+  child.join();
+  return elapsed;
+}
+
+
+} // anonymous namespace
+
+
+int main(int argc, char *argv[])
+{
+  int rounds = 100000;
+  if(argc > 1) {
+    rounds = std::atoi(argv[1]);
+  }
+
+  std::cout << std::setw(10) << "backend" << std::setw(16) << "round trip [us]" << std::setw(16) << "rounds/s"
+    << "   (" << rounds << " rounds)" << std::endl;
+
+  for(std::size_t b = 1; b < sizeof(backend_names) / sizeof(backend_names[0]); ++b) {
+    sheratan::process_impl::posix::parent_child_sync_backend::value_type backend = static_cast<sheratan::process_impl::posix::parent_child_sync_backend::value_type>(b);
+    if(!sheratan::process_impl::posix::parent_child_sync::supports(backend)) {
+      std::cout << std::setw(10) << backend_names[b] << std::setw(16) << "n/a" << std::endl;
+      continue;
+    }
+    double elapsed = ping_pong(backend, rounds);
+    std::cout << std::setw(10) << backend_names[b]
+      << std::setw(16) << std::fixed << std::setprecision(2) << (elapsed / rounds)
+      << std::setw(16) << std::fixed << std::setprecision(0) << (rounds / (elapsed / 1e6)) << std::endl;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+
+// vim: set ts=2 sw=2 et:
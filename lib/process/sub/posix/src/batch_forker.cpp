@@ -0,0 +1,326 @@
+/// \file process/sub/posix/src/batch_forker.cpp
+/// \brief POSIX batch forker implementation.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+// pipe2(2): http://man7.org/linux/man-pages/man2/pipe.2.html
+// socketpair(2): http://man7.org/linux/man-pages/man2/socketpair.2.html
+// read(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/read.html
+// recv(2): http://man7.org/linux/man-pages/man2/recv.2.html
+// send(2): http://man7.org/linux/man-pages/man2/send.2.html
+// poll(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/poll.html
+// close(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/close.html
+
+
+#include <cerrno>
+#include <cstdlib>
+#include <vector>
+
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+
+#include <boost/ptr_container/ptr_vector.hpp>
+
+#include "sheratan/errhdl/assert.hpp"
+#include "sheratan/process/posix/error_category.hpp"
+#include "sheratan/process/posix/forker.hpp"
+#include "sheratan/process/posix/process.hpp"
+#include "sheratan/process/posix/batch_forker.hpp"
+#include "posix_error.hpp"
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+namespace {
+
+
+/// \brief Readiness record (index of the child, which is ready).
+typedef uint32_t ready_record_type;
+
+/// \brief Whether this process is a child of the batch.
+static bool child_in_batch = false;
+
+/// \brief Index of this child within its batch.
+static std::size_t child_index = 0;
+
+/// \brief Readiness socket of this child (\c -1 once the readiness is reported).
+static file_descriptor_type child_ready_fd = -1;
+
+
+/// \brief Close both ends of pipe (or socket pair).
+/// \param fds Pipe (or socket pair).
+/// \par Abrahams exception guarantee:
+/// no-throw
+static void close_pipe(file_descriptor_type fds[2])
+{
+  for(int i = 0; i < 2; ++i) {
+    if(fds[i] != -1) {
+      ::close(fds[i]);
+      fds[i] = -1;
+    }
+  }
+}
+
+/// \brief Wait until release barrier is opened.
+/// \param fd Read end of release pipe.
+/// \par Abrahams exception guarantee:
+/// no-throw
+/// \note Barrier is opened once all the write ends of release pipe are
+/// closed, all the children waiting on it are woken up at once.
+static void wait_release(file_descriptor_type fd)
+{
+  char data;
+  ssize_t rc_read;
+  do {
+    rc_read = ::read(fd, &data, sizeof(data));
+  } while((rc_read < 0) && (errno == EINTR));
+}
+
+/// \brief Receive all the readiness records available.
+/// \param fd Parent end of readiness socket pair.
+/// \param ready Readiness of the children.
+/// \param closed Set to \c true once all the children have closed their
+/// end of readiness socket pair (i.e. no more records are going to arrive).
+/// \return Number of newly ready children.
+/// \par Abrahams exception guarantee:
+/// strong
+static std::size_t read_ready(file_descriptor_type fd, std::vector<bool> &ready, bool &closed)
+{
+  std::size_t ret = 0;
+  for(;;) {
+    // each record is a single message
+    ready_record_type record;
+    ssize_t rc_recv = ::recv(fd, &record, sizeof(record), MSG_DONTWAIT);
+    if(rc_recv < 0) {
+      if(errno == EINTR) {
+        continue;
+      }
+      if(errno == EAGAIN) {
+        break;
+      }
+      throw_posix_error(errno);
+    }
+    if(rc_recv == 0) {
+      closed = true;
+      break;
+    }
+    if((rc_recv == static_cast<ssize_t>(sizeof(record))) && (record < ready.size()) && (!ready[record])) {
+      ready[record] = true;
+      ++ret;
+    }
+  }
+  return ret;
+}
+
+
+} // anonymous namespace
+
+
+batch_forker::batch_forker(const fork_ctl &fc)
+: fork_ctl_(fc.clone())
+{
+}
+
+const fork_ctl & batch_forker::get_fork_ctl() const
+{
+  return *this->fork_ctl_;
+}
+
+fork_ctl & batch_forker::get_fork_ctl()
+{
+  return *this->fork_ctl_;
+}
+
+bool batch_forker::fork(const batch_forker::process_list_type &children, const system_time_type &time)
+{
+  SHERATAN_CHECK(!children.empty());
+  SHERATAN_CHECK(!time.is_not_a_date_time());
+  for(process_list_type::const_iterator i = children.begin(); i != children.end(); ++i) {
+    SHERATAN_CHECK((*i != NULL) && (!(*i)->valid()));
+  }
+
+  // channels of whole batch: release barrier and readiness reports
+  // (readiness is reported over a socket, so that a child reporting after
+  // the parent has stopped waiting is not killed by SIGPIPE)
+  file_descriptor_type release_pipe[2] = {-1, -1};
+  file_descriptor_type ready_socket[2] = {-1, -1};
+  if((::pipe2(release_pipe, O_CLOEXEC) != 0) || (::socketpair(AF_UNIX, SOCK_SEQPACKET|SOCK_CLOEXEC, 0, ready_socket) != 0)) {
+    int saved_errnum = errno;
+    close_pipe(release_pipe);
+    close_pipe(ready_socket);
+    throw_posix_error(saved_errnum);
+  }
+
+  // each child is controlled by its own copy of fork controller, so that per-child state is not shared
+  boost::ptr_vector<fork_ctl> ctls;
+  std::size_t forked = 0;
+  try {
+    ctls.reserve(children.size());
+    for(std::size_t i = 0; i < children.size(); ++i) {
+      ctls.push_back(this->fork_ctl_->clone());
+    }
+
+    // children are blocked on the barrier, so postfork routines (which may
+    // wait for the child routine) are executed once the whole batch is released
+    for(std::size_t i = 0; i < children.size(); ++i) {
+      ctls[i].prefork();
+      if(forker::fork_process(*children[i])) {
+        // child: wait for the whole batch, then run
+        ::close(release_pipe[1]);
+        ::close(ready_socket[0]);
+        child_in_batch = true;
+        child_index = i;
+        child_ready_fd = ready_socket[1];
+        wait_release(release_pipe[0]);
+        ::close(release_pipe[0]);
+        std::exit(ctls[i].child());
+      }
+      ++forked;
+    }
+
+    // release all the children at once
+    ::close(release_pipe[0]);
+    ::close(release_pipe[1]);
+    release_pipe[0] = -1;
+    release_pipe[1] = -1;
+    ::close(ready_socket[1]);
+    ready_socket[1] = -1;
+
+    // postfork routines of all the children overlap, since they are running already
+    for(std::size_t i = 0; i < children.size(); ++i) {
+      ctls[i].postfork(*children[i]);
+    }
+  }
+  catch(...) {
+    // exception thrown in child is propagated to the caller in child, as by forker
+    if(child_in_batch) {
+      throw;
+    }
+    // children are killed (before the barrier would release them, unless it is released already)
+    for(std::size_t i = 0; i < forked; ++i) {
+      try {
+        children[i]->kill(SIGKILL);
+        children[i]->join();
+      }
+      catch(...) {
+        children[i]->detach();
+      }
+    }
+    close_pipe(release_pipe);
+    close_pipe(ready_socket);
+    throw;
+  }
+
+  bool ret = false;
+  try {
+    std::vector<bool> ready(children.size(), false);
+    bool closed = false;
+    std::size_t ready_count = read_ready(ready_socket[0], ready, closed);
+    std::vector<struct pollfd> pfds;
+    std::vector<std::size_t> pfd_children;
+    while((ready_count < children.size()) && (!closed)) {
+      // watch readiness pipe and termination of children, which are not ready yet
+      pfds.clear();
+      pfd_children.clear();
+      struct pollfd pfd;
+      pfd.fd = ready_socket[0];
+      pfd.events = POLLIN;
+      pfd.revents = 0;
+      pfds.push_back(pfd);
+      for(std::size_t i = 0; i < children.size(); ++i) {
+        if((!ready[i]) && (children[i]->native_handle() != -1)) {
+          pfd.fd = children[i]->native_handle();
+          pfds.push_back(pfd);
+          pfd_children.push_back(i);
+        }
+      }
+
+      // compute remaining time, rounded up to milliseconds
+      int timeout = -1;
+      if(!time.is_pos_infinity()) {
+        system_duration_type remaining = time - boost::posix_time::microsec_clock::universal_time();
+        timeout = 0;
+        if(!remaining.is_negative()) {
+          timeout = static_cast<int>((remaining.total_microseconds() + 999) / 1000);
+        }
+      }
+
+      int rc_poll = ::poll(&pfds[0], pfds.size(), timeout);
+      if(rc_poll < 0) {
+        if(errno == EINTR) {
+          continue;
+        }
+        throw_posix_error(errno);
+      }
+      if(rc_poll == 0) {
+        break;
+      }
+
+      // readiness is reported before the child terminates, so it is read at first
+      ready_count += read_ready(ready_socket[0], ready, closed);
+      bool failed = false;
+      for(std::size_t i = 1; i < pfds.size(); ++i) {
+        if(((pfds[i].revents & (POLLIN|POLLHUP)) != 0) && (!ready[pfd_children[i - 1]])) {
+          failed = true;
+        }
+      }
+      if(failed) {
+        break;
+      }
+    }
+    ret = (ready_count == children.size());
+  }
+  catch(...) {
+    ::close(ready_socket[0]);
+    throw;
+  }
+  ::close(ready_socket[0]);
+
+  return ret;
+}
+
+std::size_t batch_forker::get_index()
+{
+  SHERATAN_CHECK(child_in_batch);
+
+  return child_index;
+}
+
+void batch_forker::report_ready()
+{
+  SHERATAN_CHECK(child_in_batch);
+  SHERATAN_CHECK(child_ready_fd != -1);
+
+  ready_record_type record = static_cast<ready_record_type>(child_index);
+  ssize_t rc_send;
+  do {
+    rc_send = ::send(child_ready_fd, &record, sizeof(record), MSG_NOSIGNAL);
+  } while((rc_send < 0) && (errno == EINTR));
+  // parent, which has stopped waiting for the batch, does not care anymore
+  // (depending on timing, its closed socket is reported by any of these)
+  if((rc_send < 0) && (errno != EPIPE) && (errno != ECONNRESET) && (errno != ECONNREFUSED) && (errno != ENOTCONN)) {
+    throw_posix_error(errno);
+  }
+  ::close(child_ready_fd);
+  child_ready_fd = -1;
+}
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+// vim: set ts=2 sw=2 et:
@@ -6,6 +6,8 @@
 
 // waitpid(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/wait.html
 // kill(2): http://pubs.opengroup.org/onlinepubs/009604599/functions/kill.html
+// pidfd_open(2): http://man7.org/linux/man-pages/man2/pidfd_open.2.html
+// pidfd_send_signal(2): http://man7.org/linux/man-pages/man2/pidfd_send_signal.2.html
 
 
 #include <cerrno>
@@ -16,6 +18,7 @@
 #include "sheratan/errhdl/throw.hpp"
 #include "sheratan/process/posix/error_category.hpp"
 #include "sheratan/process/posix/daemon.hpp"
+#include "pidfd.hpp"
 
 
 namespace sheratan {
@@ -25,13 +28,28 @@ namespace process_impl {
 namespace posix {
 
 
+daemon::daemon()
+: pid_()
+, pidfd_(pidfd::INVALID)
+, report_()
+{
+}
+
 daemon::~daemon()
 {
+  pidfd::close(this->pidfd_);
 }
 
 void daemon::set_pid(process_id pid)
 {
+  pidfd::close(this->pidfd_);
   this->pid_ = process_id(pid);
+  this->pidfd_ = pidfd::open(this->pid_.get_value());
+}
+
+void daemon::set_report(const daemonization_report &report)
+{
+  this->report_ = report;
 }
 
 process_id daemon::get_pid() const
@@ -39,6 +57,16 @@ process_id daemon::get_pid() const
   return this->pid_;
 }
 
+const daemonization_report & daemon::get_report() const
+{
+  return this->report_;
+}
+
+file_descriptor_type daemon::native_handle() const
+{
+  return this->pidfd_;
+}
+
 bool daemon::valid() const
 {
   if(this->pid_ == process_id()) {
@@ -51,8 +79,14 @@ void daemon::kill(signal_number_type signal)
 {
   SHERATAN_CHECK(this->valid());
 
-  // this is *NOT* recursive call - syscall kill(2) is called
-  int rc_kill = ::kill(this->pid_.get_value(), signal);
+  int rc_kill;
+  if(this->pidfd_ != pidfd::INVALID) {
+    rc_kill = pidfd::send_signal(this->pidfd_, signal);
+  }
+  else {
+    // this is *NOT* recursive call - syscall kill(2) is called
+    rc_kill = ::kill(this->pid_.get_value(), signal);
+  }
   if(rc_kill != 0) {
     int saved_errnum = errno;
     sheratan::errhdl::runtime_error ex_to_throw;
@@ -8,7 +8,7 @@
 #include "sheratan/errhdl/assert.hpp"
 #include "sheratan/errhdl/throw.hpp"
 #include "sheratan/process/posix/error_category.hpp"
-#include "sheratan/process/posix/process_template.hpp"
+#include "sheratan/process/posix/static_process_template.hpp"
 #include "daemonization_ctl_1st.hpp"
 #include "daemonization_ctl_2nd.hpp"
 #include "daemonization_resources.hpp"
@@ -22,7 +22,7 @@ namespace posix {
 
 
 /// \brief Second child process type definition.
-typedef process_template<struct second_child_tag> second_child_process;
+typedef static_process_template<daemonization_ctl_2nd> second_child_process;
 
 
 daemonization_ctl_1st::daemonization_ctl_1st(daemonization_resources &resources)
@@ -49,17 +49,17 @@ void daemonization_ctl_1st::prefork()
   this->resources_.create_rc_pipe(daemonization_resources::pipe_id::DAEMON);
 }
 
-void daemonization_ctl_1st::postfork(process &child_process)
+void daemonization_ctl_1st::postfork(process &)
 {
   // close write end of child pipe
   this->resources_.close_rc_pipe(daemonization_resources::pipe_id::CHILD, daemonization_resources::pipe_end::WRITE);
 
   // close write end of daemon pipe
   this->resources_.close_rc_pipe(daemonization_resources::pipe_id::DAEMON, daemonization_resources::pipe_end::WRITE);
+}
 
-  // join child (always exists and exit status contains information about both child and daemon)
-  exit_status status = child_process.join();
-
+void daemonization_ctl_1st::complete(daemonization_resources &resources, const exit_status &status)
+{
   // handle errors
   SHERATAN_CHECK(status.valid());
   if(status.get_status() != exit_status::SUCCESS) {
@@ -67,7 +67,7 @@ void daemonization_ctl_1st::postfork(process &child_process)
     sheratan::errhdl::exception *child_ex_to_throw = NULL;
     sheratan::errhdl::logic_error child_logic_ex_to_throw;
     sheratan::errhdl::runtime_error child_runtime_ex_to_throw;
-    child_ex_to_throw = this->resources_.retrieve_ex(daemonization_resources::pipe_id::CHILD, child_logic_ex_to_throw, child_runtime_ex_to_throw);
+    child_ex_to_throw = resources.retrieve_ex(daemonization_resources::pipe_id::CHILD, child_logic_ex_to_throw, child_runtime_ex_to_throw);
     // check error code
     sheratan::errhdl::error_code ec = get_code(*child_ex_to_throw);
     if((ec.get_category() == sheratan::process_impl::posix::get_error_category()) && (ec.get_errnum() == errnum::DAEMON_ERROR)) {
@@ -75,7 +75,7 @@ void daemonization_ctl_1st::postfork(process &child_process)
       sheratan::errhdl::exception *daemon_ex_to_throw = NULL;
       sheratan::errhdl::logic_error daemon_logic_ex_to_throw;
       sheratan::errhdl::runtime_error daemon_runtime_ex_to_throw;
-      daemon_ex_to_throw = this->resources_.retrieve_ex(daemonization_resources::pipe_id::DAEMON, daemon_logic_ex_to_throw, daemon_runtime_ex_to_throw);
+      daemon_ex_to_throw = resources.retrieve_ex(daemonization_resources::pipe_id::DAEMON, daemon_logic_ex_to_throw, daemon_runtime_ex_to_throw);
       // add it into child exception as a cause
       *child_ex_to_throw << sheratan::errhdl::error_info::cause(sheratan::errhdl::error_info::cause_type(daemon_ex_to_throw->clone(), sheratan::errhdl::exception::destroy));
     }
@@ -92,14 +92,19 @@ void daemonization_ctl_1st::postfork(process &child_process)
   }
 
   // retrieve and store daemon's PID
-  this->resources_.retrieve_daemon_pid(daemonization_resources::pipe_id::DAEMON);
+  resources.retrieve_daemon_pid(daemonization_resources::pipe_id::DAEMON);
+  resources.mark(daemonization_report::phase::PID_REPORT);
 }
 
 exit_status::value_type daemonization_ctl_1st::child()
 {
   try {
+    // child process is running, first fork is over
+    this->resources_.mark(daemonization_report::phase::FIRST_FORK);
+
     // execute common daemon initialization procedure
     this->resources_.daemon_init_child();
+    this->resources_.mark(daemonization_report::phase::SETSID);
 
     // start daemon process (a.k.a. 2nd child)
     second_child_process second_child(daemonization_ctl_2nd(this->resources_));
@@ -31,6 +31,8 @@ class daemonization_ctl_1st : public fork_ctl
     /// \param resources Daemonization resources.
     /// \par Abrahams exception guarantee:
     /// strong
+    /// \note Child is joined by the caller, which completes daemonization
+    /// then (see \c complete).
     daemonization_ctl_1st(daemonization_resources &resources);
 
     /// \brief Copy constructor.
@@ -51,6 +53,18 @@ class daemonization_ctl_1st : public fork_ctl
 
     virtual exit_status::value_type child();
 
+  public:
+
+    /// \brief Complete daemonization in parent process.
+    /// \param resources Daemonization resources.
+    /// \param status Exit status of 1st child.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \pre <code>status.valid() == true</code>
+    /// \note Exception reported by 1st child (and daemon) is rethrown, daemon's
+    /// process ID is retrieved otherwise.
+    static void complete(daemonization_resources &resources, const exit_status &status);
+
   private:
 
     /// \brief Daemonization resources.
@@ -5,22 +5,24 @@
 
 
 // pipe(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/pipe.html
-// sigaction(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/sigaction.html
-// sigemptyset(3): http://pubs.opengroup.org/onlinepubs/009695399/functions/sigemptyset.html
-// sleep(3): http://pubs.opengroup.org/onlinepubs/009695399/functions/sleep.html
+// poll(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/poll.html
 
 
 #include <cerrno>
 #include <cstdio>
 
+#include <poll.h>
 #include <signal.h>
 
+#include <boost/bind/bind.hpp>
+
 #include "sheratan/errhdl/exception.hpp"
 #include "sheratan/errhdl/assert.hpp"
 #include "sheratan/errhdl/throw.hpp"
 #include "sheratan/process/posix/error_category.hpp"
 #include "sheratan/process/posix/self.hpp"
 #include "sheratan/process/posix/process.hpp"
+#include "sheratan/process/posix/terminate.hpp"
 
 #include "daemonization_ctl_2nd.hpp"
 #include "daemonization_resources.hpp"
@@ -33,16 +35,30 @@ namespace process_impl {
 namespace posix {
 
 
+namespace {
+
+
+/// \brief Time (in seconds) given to the daemon to exit after it is asked to terminate.
+static const long daemon_termination_grace_period = 5;
+
+
+} // anonymous namespace
+
+
 daemonization_ctl_2nd::daemonization_ctl_2nd(daemonization_resources &resources)
 : resources_(resources)
 , sync_pipe_r_(NULL)
 , sync_pipe_w_(NULL)
+, sigchld_dispatcher_()
+, sigchld_delivered_(false)
 { }
 
 daemonization_ctl_2nd::daemonization_ctl_2nd(const daemonization_ctl_2nd &that)
 : resources_(that.resources_)
 , sync_pipe_r_(NULL)  // each copy must contain its own distinct synchronization pipe
 , sync_pipe_w_(NULL)  // each copy must contain its own distinct synchronization pipe 
+, sigchld_dispatcher_()
+, sigchld_delivered_(false)
 {
 }
 
@@ -67,7 +83,7 @@ void daemonization_ctl_2nd::prefork()
   // create synchronization pipe
   this->create_sync_pipe();
 
-  // set up SIGCHLD handler
+  // subscribe to SIGCHLD
   this->setup_sigchld();
 }
 
@@ -78,31 +94,8 @@ void daemonization_ctl_2nd::postfork(process &child_process)
     this->resources_.close_rc_pipe(daemonization_resources::pipe_id::DAEMON, daemonization_resources::pipe_end::WRITE);
 
     // wait for daemon to initalize (or fail)
-    while(1) {
-      try {
-        // daemon will either call unblock_sync_pipe (in which case this call returns successfully),
-        // or it will die before calling unblock_parent (in which case an exception will be thrown).
-        this->wait_sync_pipe();
-        break;
-      }
-      catch(sheratan::errhdl::runtime_error &ex) {
-        sheratan::errhdl::error_code ec = get_code(ex);
-        // EINTR: daemon exited due to some error before calling unblock_parent
-        if((ec.get_category() == sheratan::process_impl::posix::get_error_category()) && (ec.get_errnum() == errnum::POSIX_SYSTEM) && (get_posix_errnum(ex) == EINTR)) {
-          SHERATAN_CHECK(child_process.valid());
-          exit_status es = child_process.join(true);
-          if(es.valid()) {
-            // valid exit status means that daemon exited prematurely due to some error
-            SHERATAN_THROW_EXCEPTION(sheratan::errhdl::runtime_error(), sheratan::errhdl::error_code(errnum::DAEMON_ERROR, get_error_category()));
-            break;
-          }
-        }
-        // some other error occured
-        else {
-          throw;
-        }
-      }
-    }
+    this->wait_daemon(child_process);
+    this->sigchld_dispatcher_.reset();
 
     // close write end of child pipe
     this->resources_.close_rc_pipe(daemonization_resources::pipe_id::CHILD, daemonization_resources::pipe_end::WRITE);
@@ -110,24 +103,11 @@ void daemonization_ctl_2nd::postfork(process &child_process)
   catch(...) {
     // attempt to kill daemon process (a.k.a. 2nd child) if still running
     if(child_process.valid()) {
-      // exit status
-      exit_status status;
-      // at first, ask politely
-      child_process.kill(SIGTERM);
-      ::sleep(1);
-      // get result
-      status = child_process.join(true);
-      // if it does not work
-      if(!status.valid()) {
-        // try to give it little more time
-        ::sleep(5);
-        status = child_process.join(true);
-        // if it still does not work
-        if(!status.valid()) {
-          // stop being polite and just plain kill it
-          child_process.kill(SIGKILL);
-          status = child_process.join();
-        }
+      try {
+        terminate(child_process, boost::posix_time::seconds(daemon_termination_grace_period));
+      }
+      catch(...) {
+        // original error is to be reported
       }
     }
     throw;
@@ -137,6 +117,12 @@ void daemonization_ctl_2nd::postfork(process &child_process)
 exit_status::value_type daemonization_ctl_2nd::child()
 {
   try {
+    // daemon process is running, second fork is over
+    this->resources_.mark(daemonization_report::phase::SECOND_FORK);
+
+    // SIGCHLD is of interest to parent process only
+    this->sigchld_dispatcher_.reset();
+
     // close write end of child pipe
     this->resources_.close_rc_pipe(daemonization_resources::pipe_id::CHILD, daemonization_resources::pipe_end::WRITE);
 
@@ -158,6 +144,9 @@ exit_status::value_type daemonization_ctl_2nd::child()
     // close synchronization pipe
     this->close_sync_pipe();
 
+    // pass inherited file descriptors, all the daemonization file descriptors are closed now
+    this->resources_.daemon_init_inherited_fds();
+
     // let user's daemon controller know that daemonization is done and this is a daemon process
     return this->resources_.get_daemon_ctl().daemonized_child();
   }
@@ -297,27 +286,62 @@ void daemonization_ctl_2nd::unblock_sync_pipe()
 
 void daemonization_ctl_2nd::setup_sigchld()
 {
-  // install SIGCHLD handler
-  struct sigaction signal_sigaction;
-  signal_sigaction.sa_handler = daemonization_ctl_2nd::sigchld_handler;
-  if(::sigemptyset(&signal_sigaction.sa_mask) != 0) {
-    int saved_errnum = errno;
-    sheratan::errhdl::runtime_error ex_to_throw;
-    ex_to_throw << error_category::error_info::posix_errnum(saved_errnum);
-    SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
-  }
-  signal_sigaction.sa_flags = 0;
-  if(::sigaction(SIGCHLD, &signal_sigaction, NULL) != 0) {
-    int saved_errnum = errno;
-    sheratan::errhdl::runtime_error ex_to_throw;
-    ex_to_throw << error_category::error_info::posix_errnum(saved_errnum);
-    SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
-  }
+  SHERATAN_CHECK(this->sigchld_dispatcher_.get() == NULL);
+
+  std::auto_ptr<signal_dispatcher> dispatcher(new signal_dispatcher());
+  dispatcher->subscribe(SIGCHLD, boost::bind(&daemonization_ctl_2nd::on_sigchld, this));
+  this->sigchld_delivered_ = false;
+  this->sigchld_dispatcher_ = dispatcher;
+}
+
+void daemonization_ctl_2nd::on_sigchld()
+{
+  this->sigchld_delivered_ = true;
 }
 
-void daemonization_ctl_2nd::sigchld_handler(int)
+void daemonization_ctl_2nd::wait_daemon(process &child_process)
 {
-  // nop
+  SHERATAN_CHECK(this->sigchld_dispatcher_.get() != NULL);
+
+  while(1) {
+    struct pollfd fds[2];
+    fds[0].fd = ::fileno(this->sync_pipe_r_);
+    fds[0].events = POLLIN;
+    fds[0].revents = 0;
+    fds[1].fd = this->sigchld_dispatcher_->native_handle();
+    fds[1].events = POLLIN;
+    fds[1].revents = 0;
+    if(::poll(fds, 2, -1) == -1) {
+      if(errno == EINTR) {
+        continue;
+      }
+      int saved_errnum = errno;
+      sheratan::errhdl::runtime_error ex_to_throw;
+      ex_to_throw << error_category::error_info::posix_errnum(saved_errnum);
+      SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
+    }
+
+    // daemon called unblock_sync_pipe (synchronization pipe is never closed
+    // by the daemon, since this process holds its write end as well)
+    if(fds[0].revents != 0) {
+      this->wait_sync_pipe();
+      return;
+    }
+
+    // some child changed its state, check whether the daemon exited before calling unblock_sync_pipe
+    if(fds[1].revents != 0) {
+      this->sigchld_dispatcher_->dispatch(true);
+      if(this->sigchld_delivered_) {
+        this->sigchld_delivered_ = false;
+        SHERATAN_CHECK(child_process.valid());
+        exit_status es = child_process.join(true);
+        if(es.valid()) {
+          // valid exit status means that daemon exited prematurely due to some error
+          SHERATAN_THROW_EXCEPTION(sheratan::errhdl::runtime_error(), sheratan::errhdl::error_code(errnum::DAEMON_ERROR, get_error_category()));
+        }
+      }
+    }
+  }
 }
 
 
@@ -8,9 +8,13 @@
 #define HGI_SHERATAN_PROCESS_POSIX_DAEMONIZATION_CTL_2ND_HPP
 
 
+#include <cstdio>
+#include <memory>
+
 #include "sheratan/process/posix/fwd.hpp"
 #include "sheratan/process/posix/fork_ctl.hpp"
 #include "sheratan/process/posix/parent_child_sync.hpp"
+#include "sheratan/process/posix/signal_dispatcher.hpp"
 #include "daemonization_fwd.hpp"
 
 
@@ -79,15 +83,24 @@ class daemonization_ctl_2nd : public fork_ctl
     /// strong
     void unblock_sync_pipe();
 
-    /// \brief Set up SIGCHLD handler.
+    /// \brief Subscribe to SIGCHLD.
     /// \par Abrahams exception guarantee:
     /// strong
     void setup_sigchld();
 
-    /// \brief SIGCHLD handler.
+    /// \brief Record delivery of SIGCHLD.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    void on_sigchld();
+
+    /// \brief Wait for daemon to initialize (or fail).
+    /// \param child_process Daemon process.
     /// \par Abrahams exception guarantee:
     /// strong
-    static void sigchld_handler(int);
+    /// \note Synchronization pipe and SIGCHLD are waited for at once, so that
+    /// premature termination of the daemon is detected without relying on
+    /// interrupted system calls.
+    void wait_daemon(process &child_process);
 
   private:
 
@@ -99,6 +112,12 @@ class daemonization_ctl_2nd : public fork_ctl
 
     /// \brief Synchronization pipe write-end.
     std::FILE *sync_pipe_w_;
+
+    /// \brief Dispatcher of SIGCHLD.
+    std::auto_ptr<signal_dispatcher> sigchld_dispatcher_;
+
+    /// \brief Whether SIGCHLD has been delivered since it was last checked.
+    bool sigchld_delivered_;
 };
 
 
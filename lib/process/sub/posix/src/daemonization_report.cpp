@@ -0,0 +1,91 @@
+/// \file process/sub/posix/src/daemonization_report.cpp
+/// \brief POSIX daemonization report implementation.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+// clock_gettime(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/clock_gettime.html
+
+
+#include <time.h>
+
+#include "sheratan/errhdl/assert.hpp"
+#include "sheratan/process/posix/daemonization_report.hpp"
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+namespace {
+
+
+/// \brief Get monotonic clock time.
+/// \return Time since unspecified starting point.
+/// \par Abrahams exception guarantee:
+/// no-throw
+static system_duration_type monotonic_now()
+{
+  struct timespec ts;
+  ::clock_gettime(CLOCK_MONOTONIC, &ts);
+  return boost::posix_time::seconds(ts.tv_sec) + boost::posix_time::microseconds(ts.tv_nsec / 1000);
+}
+
+
+} // anonymous namespace
+
+
+daemonization_report::daemonization_report()
+: timestamps_()
+{
+  this->timestamps_.fill(system_duration_type(boost::posix_time::not_a_date_time));
+}
+
+bool daemonization_report::complete() const
+{
+  for(timestamps_type::const_iterator i = this->timestamps_.begin(); i != this->timestamps_.end(); ++i) {
+    if(i->is_not_a_date_time()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+system_duration_type daemonization_report::get_duration(daemonization_report::phase::value_type p) const
+{
+  SHERATAN_CHECK(p < daemonization_report::phase::COUNT);
+  SHERATAN_CHECK(this->complete());
+
+  return this->timestamps_[p + 1] - this->timestamps_[p];
+}
+
+system_duration_type daemonization_report::get_total() const
+{
+  SHERATAN_CHECK(this->complete());
+
+  return this->timestamps_[daemonization_report::phase::COUNT] - this->timestamps_[0];
+}
+
+void daemonization_report::start()
+{
+  this->timestamps_.fill(system_duration_type(boost::posix_time::not_a_date_time));
+  this->timestamps_[0] = monotonic_now();
+}
+
+void daemonization_report::mark(daemonization_report::phase::value_type p)
+{
+  this->timestamps_[p + 1] = monotonic_now();
+}
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+// vim: set ts=2 sw=2 et:
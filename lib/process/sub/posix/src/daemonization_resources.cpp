@@ -4,10 +4,13 @@
 /// \author Marek Balint \c (mareq[A]balint[D]eu)
 
 
-// pipe(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/pipe.html
+// pipe2(2): http://man7.org/linux/man-pages/man2/pipe2.2.html
+// writev(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/writev.html
+// read(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/read.html
 // sigemptyset(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/sigemptyset.html
 // sigaction(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/sigaction.html
-// getrlimit(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/getrlimit.html
+// sigfillset(3): http://pubs.opengroup.org/onlinepubs/009695399/functions/sigfillset.html
+// pthread_sigmask(3): http://pubs.opengroup.org/onlinepubs/009695399/functions/pthread_sigmask.html
 // setsid(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/setsid.html
 // umask(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/umask.html
 // chdir(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/chdir.html
@@ -15,24 +18,64 @@
 // open(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/open.html
 // dup2(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/dup2.html 
 // fcntl(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/fcntl.html
+// fcntl_locking(2): http://man7.org/linux/man-pages/man2/fcntl_locking.2.html
 // ftruncate(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/ftruncate.html
-
-
+// setenv(3): http://pubs.opengroup.org/onlinepubs/009695399/functions/setenv.html
+// unsetenv(3): http://pubs.opengroup.org/onlinepubs/009695399/functions/unsetenv.html
+// sd_listen_fds(3): http://man7.org/linux/man-pages/man3/sd_listen_fds.3.html
+// sd_notify(3): http://man7.org/linux/man-pages/man3/sd_notify.3.html
+// socket(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/socket.html
+// bind(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/bind.html
+// recvmsg(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/recvmsg.html
+// unix(7): http://man7.org/linux/man-pages/man7/unix.7.html
+// poll(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/poll.html
+// epoll(7): http://man7.org/linux/man-pages/man7/epoll.7.html
+// timerfd_create(2): http://man7.org/linux/man-pages/man2/timerfd_create.2.html
+// prctl(2): http://man7.org/linux/man-pages/man2/prctl.2.html
+// proc(5): http://man7.org/linux/man-pages/man5/proc.5.html
+// mallopt(3): http://man7.org/linux/man-pages/man3/mallopt.3.html
+// mlockall(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/mlockall.html
+
+
+#include <algorithm>
 #include <cerrno>
+#include <climits>
+#include <cstddef>
 #include <cstdlib>
 #include <cstdio>
+#include <cstring>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
 
 #include <unistd.h>
 #include <signal.h>
+#include <pthread.h>
 #include <fcntl.h>
+#include <poll.h>
+#include <malloc.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
 #include <sys/stat.h>
+#include <sys/timerfd.h>
 #include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/uio.h>
+
+#include <boost/cstdint.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
 
 #include "sheratan/errhdl/assert.hpp"
 #include "sheratan/errhdl/throw.hpp"
 #include "sheratan/errhdl/default_category.hpp"
 #include "sheratan/process/posix/error_category.hpp"
+#include "sheratan/process/posix/fd_sanitizer.hpp"
 #include "daemonization_resources.hpp"
+#include "pidfd.hpp"
+#include "posix_error.hpp"
 
 
 namespace sheratan {
@@ -55,52 +98,102 @@ namespace posix {
 
 daemonization_resources::daemonization_resources()
 : daemon_ctl_()
+, borrowed_daemon_ctl_(NULL)
 , pid_file_()
 , pid_file_mode_()
+, pidfile_fd_(-1)
 , working_dir_()
 , stdin_redirect_()
 , stdout_redirect_()
 , stderr_redirect_()
 , reset_signals_flag_()
+, inherited_fds_()
+, mode_()
+, ready_stage_()
+, ready_timeout_()
+, ready_stages_()
+, ready_wait_(false)
+, ready_fd_(-1)
+, ready_timer_fd_(-1)
+, daemon_pidfd_(pidfd::INVALID)
+, daemon_exited_(false)
+, lock_memory_flag_()
+, transparent_huge_pages_()
+, oom_score_adj_()
+, prefault_size_()
+, notify_fd_(-1)
+, notify_socket_()
+, report_()
 , daemon_pid_()
 , rc_pipe_r_()
 , rc_pipe_w_()
+, original_sigmask_()
+, sigmask_saved_(false)
 {
   /// \todo Old versions of Boost does not define <code>boost::array::fill</code>
   /// method. Now deprecated method <code>boost::array::assign</code>
   /// needs to be used in old version.
-  this->rc_pipe_r_.fill(NULL);
-  this->rc_pipe_w_.fill(NULL);
+  this->rc_pipe_r_.fill(-1);
+  this->rc_pipe_w_.fill(-1);
 }
 
 daemonization_resources::daemonization_resources(
   const daemon_ctl &dc,
+  daemon_ctl *borrowed_dc,
   const daemonizer::pid_file_type &pid_file,
   const daemonizer::pid_file_mode_type &pid_file_mode,
   const daemonizer::working_dir_type &working_dir,
   const daemonizer::stdin_redirect_type &stdin_redirect,
   const daemonizer::stdout_redirect_type &stdout_redirect,
   const daemonizer::stderr_redirect_type &stderr_redirect,
-  const daemonizer::reset_signals_flag_type &reset_signals_flag
+  const daemonizer::reset_signals_flag_type &reset_signals_flag,
+  const daemonizer::inherited_fds_type &inherited_fds,
+  const daemonizer::ready_stage_type &ready_stage,
+  const daemonizer::ready_timeout_type &ready_timeout,
+  const daemonizer::mode_type &mode,
+  const daemonizer::lock_memory_flag_type &lock_memory_flag,
+  const daemonizer::transparent_huge_pages_type &transparent_huge_pages,
+  const daemonizer::oom_score_adj_type &oom_score_adj,
+  const daemonizer::prefault_size_type &prefault_size
 )
-: daemon_ctl_(dc.clone())
+: daemon_ctl_((borrowed_dc == NULL) ? dc.clone() : NULL)
+, borrowed_daemon_ctl_(borrowed_dc)
 , pid_file_(pid_file)
 , pid_file_mode_(pid_file_mode)
+, pidfile_fd_(-1)
 , working_dir_(working_dir)
 , stdin_redirect_(stdin_redirect)
 , stdout_redirect_(stdout_redirect)
 , stderr_redirect_(stderr_redirect)
 , reset_signals_flag_(reset_signals_flag)
+, inherited_fds_(inherited_fds)
+, mode_(mode)
+, ready_stage_(ready_stage)
+, ready_timeout_(ready_timeout)
+, ready_stages_()
+, ready_wait_(false)
+, ready_fd_(-1)
+, ready_timer_fd_(-1)
+, daemon_pidfd_(pidfd::INVALID)
+, daemon_exited_(false)
+, lock_memory_flag_(lock_memory_flag)
+, transparent_huge_pages_(transparent_huge_pages)
+, oom_score_adj_(oom_score_adj)
+, prefault_size_(prefault_size)
+, notify_fd_(-1)
+, notify_socket_()
+, report_()
 , daemon_pid_()
 , rc_pipe_r_()
 , rc_pipe_w_()
-, filedescs_rlimit_()
-, signal_dispositions_()
+, original_sigmask_()
+, sigmask_saved_(false)
 {
-  std::memset(&(this->filedescs_rlimit_), 0, sizeof(this->filedescs_rlimit_));
-
-  if(!this->reset_signals_flag_) {
-    this->signal_dispositions_.reserve(NSIG);
+  this->rc_pipe_r_.fill(-1);
+  this->rc_pipe_w_.fill(-1);
+  SHERATAN_CHECK((this->oom_score_adj_ == daemonizer::OOM_SCORE_ADJ_INHERIT) || ((this->oom_score_adj_ >= -1000) && (this->oom_score_adj_ <= 1000)));
+  for(daemonizer::inherited_fds_type::value_type::const_iterator i = this->inherited_fds_.begin(); i != this->inherited_fds_.end(); ++i) {
+    SHERATAN_CHECK(*i > STDERR_FILENO);
   }
 }
 
@@ -115,11 +208,17 @@ void daemonization_resources::finalize()
   this->close_rc_pipe(daemonization_resources::pipe_id::CHILD, daemonization_resources::pipe_end::WRITE);
   this->close_rc_pipe(daemonization_resources::pipe_id::DAEMON, daemonization_resources::pipe_end::READ);
   this->close_rc_pipe(daemonization_resources::pipe_id::DAEMON, daemonization_resources::pipe_end::WRITE);
-  this->restore_signal_dispositions(false); // forbid throwing exceptions from restore_signal_dispositions method
+  this->stop_wait_ready();
+  this->close_notify_socket();
+  this->close_pid_file();
+  this->restore_signal_mask();
 }
 
 const daemon_ctl & daemonization_resources::get_daemon_ctl() const
 {
+  if(this->borrowed_daemon_ctl_ != NULL) {
+    return *this->borrowed_daemon_ctl_;
+  }
   SHERATAN_CHECK(this->daemon_ctl_.get() != NULL);
 
   return *this->daemon_ctl_;
@@ -127,56 +226,35 @@ const daemon_ctl & daemonization_resources::get_daemon_ctl() const
 
 daemon_ctl & daemonization_resources::get_daemon_ctl()
 {
+  if(this->borrowed_daemon_ctl_ != NULL) {
+    return *this->borrowed_daemon_ctl_;
+  }
   SHERATAN_CHECK(this->daemon_ctl_.get() != NULL);
 
   return *this->daemon_ctl_;
 }
 
+daemonization_mode::value_type daemonization_resources::get_mode() const
+{
+  return this->mode_;
+}
+
 void daemonization_resources::create_rc_pipe(daemonization_resources::pipe_id::value_type pipe_id)
 {
   SHERATAN_CHECK(pipe_id < daemonization_resources::pipe_id::COUNT);
-  SHERATAN_CHECK(this->rc_pipe_r_[pipe_id] == NULL);
-  SHERATAN_CHECK(this->rc_pipe_w_[pipe_id] == NULL);
-
-  int saved_errnum = 0;
-  int rc_pipe_fd[2] = {-1, -1};
-
-  // create rc-pipe
-  if(::pipe(rc_pipe_fd) != 0) {
-    saved_errnum = errno;
-    goto error;
-  }
-  this->rc_pipe_r_[pipe_id] = ::fdopen(rc_pipe_fd[0], "r");
-  if(this->rc_pipe_r_[pipe_id] == NULL) {
-    saved_errnum = errno;
-    goto error;
-  }
-  this->rc_pipe_w_[pipe_id] = ::fdopen(rc_pipe_fd[1], "w");
-  if(this->rc_pipe_w_[pipe_id] == NULL) {
-    saved_errnum = errno;
-    goto error;
-  }
-
-  // successful return
-  return;
+  SHERATAN_CHECK(this->rc_pipe_r_[pipe_id] < 0);
+  SHERATAN_CHECK(this->rc_pipe_w_[pipe_id] < 0);
 
-  // ERROR HANDLING
-  error:
-
-  // free all possibly allocated resources
-  if((this->rc_pipe_r_[pipe_id] == NULL) && (rc_pipe_fd[0] != -1)) {
-    ::close(rc_pipe_fd[0]);
-  }
-  if((this->rc_pipe_w_[pipe_id] == NULL) && (rc_pipe_fd[1] != -1)) {
-    ::close(rc_pipe_fd[1]);
+  // create rc-pipe, it must not leak into programs executed by any of the processes involved
+  file_descriptor_type rc_pipe_fd[2];
+  if(::pipe2(rc_pipe_fd, O_CLOEXEC) != 0) {
+    int saved_errnum = errno;
+    sheratan::errhdl::runtime_error ex_to_throw;
+    ex_to_throw << error_category::error_info::posix_errnum(saved_errnum);
+    SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
   }
-  this->close_rc_pipe(pipe_id, daemonization_resources::pipe_end::READ);
-  this->close_rc_pipe(pipe_id, daemonization_resources::pipe_end::WRITE);
-
-  // throw exception
-  sheratan::errhdl::runtime_error ex_to_throw;
-  ex_to_throw << error_category::error_info::posix_errnum(saved_errnum);
-  SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
+  this->rc_pipe_r_[pipe_id] = rc_pipe_fd[0];
+  this->rc_pipe_w_[pipe_id] = rc_pipe_fd[1];
 }
 
 void daemonization_resources::close_rc_pipe(daemonization_resources::pipe_id::value_type pipe_id, daemonization_resources::pipe_end::value_type pipe_end)
@@ -185,24 +263,36 @@ void daemonization_resources::close_rc_pipe(daemonization_resources::pipe_id::va
 
   switch(pipe_end) {
     case daemonization_resources::pipe_end::READ:
-      if(this->rc_pipe_r_[pipe_id] != NULL) {
-        std::fclose(this->rc_pipe_r_[pipe_id]);
-        this->rc_pipe_r_[pipe_id] = NULL;
+      if(this->rc_pipe_r_[pipe_id] >= 0) {
+        ::close(this->rc_pipe_r_[pipe_id]);
+        this->rc_pipe_r_[pipe_id] = -1;
       }
       break;
     case daemonization_resources::pipe_end::WRITE:
-      if(this->rc_pipe_w_[pipe_id] != NULL) {
-        std::fclose(this->rc_pipe_w_[pipe_id]);
-        this->rc_pipe_w_[pipe_id] = NULL;
+      if(this->rc_pipe_w_[pipe_id] >= 0) {
+        ::close(this->rc_pipe_w_[pipe_id]);
+        this->rc_pipe_w_[pipe_id] = -1;
       }
       break;
   }
 }
 
-
 namespace {
 
 
+/// \brief Name of environment variable holding number of inherited file descriptors.
+static const char listen_fds_env[] = "LISTEN_FDS";
+
+/// \brief Name of environment variable holding PID of process inheriting file descriptors.
+static const char listen_pid_env[] = "LISTEN_PID";
+
+/// \brief Name of environment variable holding names of inherited file descriptors.
+static const char listen_fdnames_env[] = "LISTEN_FDNAMES";
+
+/// \brief Name of environment variable holding notification socket.
+static const char notify_socket_env[] = "NOTIFY_SOCKET";
+
+
 /// \brief Map of file descriptor redirection (pairs <path, file descriptor>) type definition.
 typedef std::map<std::string, int> redirection_map_type;
 
@@ -242,61 +332,130 @@ static void redirect_file_descriptor(int fd, const std::string &path, redirectio
   SHERATAN_CHECK(retval == fd);
 }
 
+/// \brief Lock whole file for writing.
+/// \param fd File descriptor of the file to be locked.
+/// \param ofd_only Do not fall back to process-associated lock.
+/// \retval true File has been locked.
+/// \retval false Open file description locks are not supported by the
+/// system and \p ofd_only is set, file has not been locked.
+/// \par Abrahams exception guarantee:
+/// strong
+/// \note Open file description lock is preferred: it is shared by all the
+/// file descriptors referring to the same open file description (including
+/// those duplicated by \c fork), therefore the lock acquired before the
+/// fork is held by the daemon. Process-associated lock is not inherited
+/// by child processes.
+static bool lock_file(int fd, bool ofd_only)
+{
+  struct flock file_flock;
+  file_flock.l_type = F_WRLCK;
+  file_flock.l_start = 0;
+  file_flock.l_whence = SEEK_SET;
+  file_flock.l_len = 0;
+  file_flock.l_pid = 0;
+  int rc_lock = -1;
+#ifdef F_OFD_SETLK
+  rc_lock = ::fcntl(fd, F_OFD_SETLK, &file_flock);
+  if((rc_lock != 0) && (errno == EINVAL)) {
+    // kernel predating open file description locks (Linux < 3.15)
+    if(ofd_only) {
+      return false;
+    }
+    rc_lock = ::fcntl(fd, F_SETLK, &file_flock);
+  }
+#else
+  if(ofd_only) {
+    return false;
+  }
+  rc_lock = ::fcntl(fd, F_SETLK, &file_flock);
+#endif
+  if(rc_lock != 0) {
+    int saved_errnum = errno;
+    if((saved_errnum == EAGAIN) || (saved_errnum == EACCES)) {
+      SHERATAN_THROW_EXCEPTION(sheratan::errhdl::runtime_error(), sheratan::errhdl::error_code(errnum::PIDFILE_LOCKED, get_error_category()));
+    }
+    sheratan::errhdl::runtime_error ex_to_throw;
+    ex_to_throw << error_category::error_info::posix_errnum(saved_errnum);
+    SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
+  }
+  return true;
+}
+
 
 } // anonymous namespace
 
 
-void daemonization_resources::daemon_init_parent()
+void daemonization_resources::acquire_pid_file(bool ofd_only)
 {
-  // ignore all signals
-  struct sigaction signal_sigaction;
-  if(::sigemptyset(&signal_sigaction.sa_mask) != 0) {
+  if((this->pid_file_ == daemonizer::pid_file_type().get_value()) || (this->pidfile_fd_ >= 0)) {
+    return;
+  }
+
+  // descriptor is not to leak into programs executed by other threads while the daemonization is in progress
+  int pidfile_fd = ::open(this->pid_file_.c_str(), O_RDWR|O_CREAT|O_CLOEXEC, this->pid_file_mode_);
+  if(pidfile_fd < 0) {
     int saved_errnum = errno;
     sheratan::errhdl::runtime_error ex_to_throw;
     ex_to_throw << error_category::error_info::posix_errnum(saved_errnum);
     SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
   }
-  signal_sigaction.sa_flags = 0;
-  for(signal_number_type i = 1; i < NSIG; ++i) {
-    if((i == SIGKILL) || (i == SIGSTOP)) {
-      continue;
-    }
-    if(i == SIGCHLD) {
-      // For SIGCHLD, default action is ignore, but explicitly setting SIG_IGN
-      // will change behavior of waitpid, which is not desirable (in fact, daemonization
-      // algorithm relies on default waitpid's behavior, which must not be changed)
-      signal_sigaction.sa_handler = SIG_DFL;
-    }
-    else {
-      signal_sigaction.sa_handler = SIG_IGN;
-    }
-    daemonization_resources::signal_disposition original_disposition;
-    int retval = ::sigaction(i, &signal_sigaction, &(original_disposition.signal_sigaction));
-    // retpor invalid signal number error only for standard POSIX signals
-    if((retval != 0) && ((i < 32) || (errno != EINVAL))) {
-      int saved_errnum = errno;
-      sheratan::errhdl::runtime_error ex_to_throw;
-      ex_to_throw << error_category::error_info::posix_errnum(saved_errnum);
-      SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
+  try {
+    if(!lock_file(pidfile_fd, ofd_only)) {
+      // lock is to be acquired by the daemon itself
+      ::close(pidfile_fd);
+      return;
     }
-    original_disposition.signal_number = i;
-    this->signal_dispositions_.push_back(original_disposition);
   }
+  catch(...) {
+    ::close(pidfile_fd);
+    throw;
+  }
+  this->pidfile_fd_ = pidfile_fd;
+}
 
-  // get maximum number of file descriptors
-  if(::getrlimit(RLIMIT_NOFILE, &(this->filedescs_rlimit_)) != 0) {
+void daemonization_resources::close_pid_file()
+{
+  if(this->pidfile_fd_ >= 0) {
+    ::close(this->pidfile_fd_);
+    this->pidfile_fd_ = -1;
+  }
+}
+
+void daemonization_resources::daemon_init_parent()
+{
+  // acquire PID file lock before anything else, so that duplicate start fails fast
+  this->acquire_pid_file(true);
+
+  // block all signals in the calling thread, so that they are deferred (rather
+  // than lost) until the 1st child is reaped; SIGKILL and SIGSTOP can not be
+  // blocked; SIGCHLD is blocked too, which (unlike ignoring it) does not affect
+  // waitpid; other threads of the process are not protected by this mask
+  sigset_t mask;
+  if(::sigfillset(&mask) != 0) {
     int saved_errnum = errno;
     sheratan::errhdl::runtime_error ex_to_throw;
     ex_to_throw << error_category::error_info::posix_errnum(saved_errnum);
     SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
   }
-  if(this->filedescs_rlimit_.rlim_max == RLIM_INFINITY) {
-    this->filedescs_rlimit_.rlim_max = 1024;
+  int rc_sigmask = ::pthread_sigmask(SIG_BLOCK, &mask, &(this->original_sigmask_));
+  if(rc_sigmask != 0) {
+    sheratan::errhdl::runtime_error ex_to_throw;
+    ex_to_throw << error_category::error_info::posix_errnum(rc_sigmask);
+    SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
+  }
+  this->sigmask_saved_ = true;
+
+  // create notification socket, daemon reports its readiness into
+  if(!this->ready_stage_.empty()) {
+    this->create_notify_socket();
   }
 }
 
 void daemonization_resources::daemon_init_child()
 {
+  // notifications are received by parent process
+  this->close_notify_socket();
+
   // become a session leader to lose controlling tty
   if(::setsid() == static_cast<pid_t>(-1)) {
     int saved_errnum = errno;
@@ -308,8 +467,13 @@ void daemonization_resources::daemon_init_child()
 
 void daemonization_resources::daemon_init_daemon(const daemonization_resources::fd_list_type &excluded_fds)
 {
+  // supervised process keeps the environment set up by its supervisor
+  bool detached = (this->mode_ == daemonization_mode::DETACHED);
+
   // clear file creation mask
-  ::umask(0);
+  if(detached) {
+    ::umask(0);
+  }
 
   // set working directory
   if(this->working_dir_ != daemonizer::working_dir_type().get_value()) {
@@ -322,34 +486,61 @@ void daemonization_resources::daemon_init_daemon(const daemonization_resources::
   }
 
   // close all file descriptors
-  int filedescs_max = static_cast<int>(this->filedescs_rlimit_.rlim_max);
-  daemonization_resources::fd_list_type exclusion_list(excluded_fds);
-  exclusion_list.push_back(STDIN_FILENO);
-  exclusion_list.push_back(STDOUT_FILENO);
-  exclusion_list.push_back(STDERR_FILENO);
-  for(size_t i = 0; i < daemonization_resources::pipe_id::COUNT; ++i) {
-    if(this->rc_pipe_r_[i] != NULL) {
-      exclusion_list.push_back(::fileno(this->rc_pipe_r_[i]));
-    }
-    if(this->rc_pipe_w_[i] != NULL) {
-      exclusion_list.push_back(::fileno(this->rc_pipe_w_[i]));
-    }
-  }
-  daemonization_resources::fd_list_type::const_iterator begin = exclusion_list.begin();
-  daemonization_resources::fd_list_type::const_iterator end = exclusion_list.end();
-  for(int fd = 0; fd < filedescs_max; ++fd) {
-    // skip file descriptors from exclusion list
-    if(std::find(begin, end, fd) != end) {
-      continue;
+  if(detached) {
+    fd_sanitizer sanitizer;
+    sanitizer.exclude_std_streams();
+    for(daemonization_resources::fd_list_type::const_iterator i = excluded_fds.begin(); i != excluded_fds.end(); ++i) {
+      sanitizer.exclude(*i);
     }
-    // close file descriptor
-    if(::close(fd) != 0) {
-      int saved_errnum = errno;
-      if(saved_errnum != EBADF) {
+    for(daemonizer::inherited_fds_type::value_type::const_iterator i = this->inherited_fds_.begin(); i != this->inherited_fds_.end(); ++i) {
+      sanitizer.exclude(*i);
+    }
+    if(this->pidfile_fd_ >= 0) {
+      sanitizer.exclude(this->pidfile_fd_);
+    }
+    for(size_t i = 0; i < daemonization_resources::pipe_id::COUNT; ++i) {
+      if(this->rc_pipe_r_[i] >= 0) {
+        sanitizer.exclude(this->rc_pipe_r_[i]);
+      }
+      if(this->rc_pipe_w_[i] >= 0) {
+        sanitizer.exclude(this->rc_pipe_w_[i]);
+      }
+    }
+    sanitizer.sanitize();
+  }
+  this->mark(daemonization_report::phase::FD_SANITIZATION);
+
+  // move inherited file descriptors out of the way, above the range they are to be passed in
+  file_descriptor_type inherited_fds_end = daemonizer::LISTEN_FDS_START + static_cast<file_descriptor_type>(this->inherited_fds_.size());
+  if(!this->inherited_fds_.empty()) {
+    daemonizer::inherited_fds_type::value_type moved_fds;
+    for(daemonizer::inherited_fds_type::value_type::const_iterator i = this->inherited_fds_.begin(); i != this->inherited_fds_.end(); ++i) {
+      int moved_fd = ::fcntl(*i, F_DUPFD, inherited_fds_end);
+      if(moved_fd < 0) {
+        int saved_errnum = errno;
         sheratan::errhdl::runtime_error ex_to_throw;
         ex_to_throw << error_category::error_info::posix_errnum(saved_errnum);
         SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
       }
+      moved_fds.push_back(moved_fd);
+    }
+    for(daemonizer::inherited_fds_type::value_type::const_iterator i = this->inherited_fds_.begin(); i != this->inherited_fds_.end(); ++i) {
+      ::close(*i);
+    }
+    this->inherited_fds_.swap(moved_fds);
+
+    // file descriptors of supervised process are not closed, those occupying the range
+    // would be replaced, so they are moved out of the way too (PID file is moved later)
+    if(!detached) {
+      for(file_descriptor_type fd = daemonizer::LISTEN_FDS_START; fd < inherited_fds_end; ++fd) {
+        if((fd == this->pidfile_fd_) || (::fcntl(fd, F_GETFD) == -1)) {
+          continue;
+        }
+        if(::fcntl(fd, F_DUPFD_CLOEXEC, inherited_fds_end) < 0) {
+          throw_posix_error(errno);
+        }
+        ::close(fd);
+      }
     }
   }
 
@@ -364,12 +555,27 @@ void daemonization_resources::daemon_init_daemon(const daemonization_resources::
   if(this->stderr_redirect_ != daemonizer::stderr_redirect_type().get_value()) {
     redirect_file_descriptor(STDERR_FILENO, this->stderr_redirect_, redirection_map);
   }
-
-
-  // acquire PID file and write daemon's PID into it
-  if(this->pid_file_ != daemonizer::pid_file_type().get_value()) {
-    int pidfile_fd = ::open(this->pid_file_.c_str(), O_RDWR|O_CREAT, this->pid_file_mode_);
-    if(pidfile_fd < 0) {
+  this->mark(daemonization_report::phase::STREAM_REDIRECTION);
+
+  // acquire PID file (unless already locked by parent process) and write daemon's PID into it
+  this->acquire_pid_file(false);
+  if(this->pidfile_fd_ >= 0) {
+    // PID file must not occupy the range inherited file descriptors are to be passed in
+    if(!this->inherited_fds_.empty() && this->pidfile_fd_ < inherited_fds_end) {
+      int moved_fd = ::fcntl(this->pidfile_fd_, F_DUPFD, inherited_fds_end);
+      if(moved_fd < 0) {
+        int saved_errnum = errno;
+        sheratan::errhdl::runtime_error ex_to_throw;
+        ex_to_throw << error_category::error_info::posix_errnum(saved_errnum);
+        SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
+      }
+      // lock is kept, it belongs to the open file description shared by both the descriptors
+      this->close_pid_file();
+      this->pidfile_fd_ = moved_fd;
+    }
+    // PID file stays open (and locked) for the rest of daemon's life, including programs it might execute
+    int pidfile_fd = this->pidfile_fd_;
+    if(::fcntl(pidfile_fd, F_SETFD, 0) != 0) {
       int saved_errnum = errno;
       sheratan::errhdl::runtime_error ex_to_throw;
       ex_to_throw << error_category::error_info::posix_errnum(saved_errnum);
@@ -382,15 +588,7 @@ void daemonization_resources::daemon_init_daemon(const daemonization_resources::
       ex_to_throw << error_category::error_info::posix_errnum(saved_errnum);
       SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
     }
-    struct flock pidfile_flock;
-    pidfile_flock.l_type = F_WRLCK;
-    pidfile_flock.l_start = 0;
-    pidfile_flock.l_whence = SEEK_SET;
-    pidfile_flock.l_len = 0;
-    pidfile_flock.l_pid = 0;
-    if(::fcntl(pidfile_fd, F_SETLK, &pidfile_flock) != 0) {
-      SHERATAN_THROW_EXCEPTION(sheratan::errhdl::runtime_error(), sheratan::errhdl::error_code(errnum::PIDFILE_LOCKED, get_error_category()));
-    }
+    this->pidfile_fd_ = -1;
     if(::ftruncate(pidfile_fd, 0) != 0) {
       int saved_errnum = errno;
       sheratan::errhdl::runtime_error ex_to_throw;
@@ -411,8 +609,40 @@ void daemonization_resources::daemon_init_daemon(const daemonization_resources::
       SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
     }
   }
+  this->mark(daemonization_report::phase::PID_FILE);
+
+  // announce inherited file descriptors (socket activation protocol)
+  if(this->inherited_fds_.empty()) {
+    if(detached) {
+      ::unsetenv(listen_fds_env);
+      ::unsetenv(listen_pid_env);
+      ::unsetenv(listen_fdnames_env);
+    }
+  } else {
+    std::ostringstream listen_fds;
+    listen_fds << this->inherited_fds_.size();
+    std::ostringstream listen_pid;
+    listen_pid << ::getpid();
+    if((::setenv(listen_fds_env, listen_fds.str().c_str(), 1) != 0) || (::setenv(listen_pid_env, listen_pid.str().c_str(), 1) != 0)) {
+      int saved_errnum = errno;
+      sheratan::errhdl::runtime_error ex_to_throw;
+      ex_to_throw << error_category::error_info::posix_errnum(saved_errnum);
+      SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
+    }
+    ::unsetenv(listen_fdnames_env);
+  }
 
-  // set default signal dispositions or restore original signal dispositions
+  // announce notification socket (sd_notify protocol)
+  if(!this->notify_socket_.empty()) {
+    if(::setenv(notify_socket_env, this->notify_socket_.c_str(), 1) != 0) {
+      int saved_errnum = errno;
+      sheratan::errhdl::runtime_error ex_to_throw;
+      ex_to_throw << error_category::error_info::posix_errnum(saved_errnum);
+      SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
+    }
+  }
+
+  // set default signal dispositions (original signal dispositions are kept otherwise)
   if(this->reset_signals_flag_) {
     struct sigaction default_disposition;
     default_disposition.sa_handler = SIG_DFL;
@@ -436,23 +666,328 @@ void daemonization_resources::daemon_init_daemon(const daemonization_resources::
       }
     }
   }
-  else {
-    this->restore_signal_dispositions();
+
+  // apply memory policy, so that daemon does not take page faults on its serving path
+  this->apply_memory_policy();
+}
+
+
+namespace {
+
+
+/// \brief Path to OOM score adjustment of the calling process.
+static const char oom_score_adj_path[] = "/proc/self/oom_score_adj";
+
+
+} // anonymous namespace
+
+
+void daemonization_resources::apply_memory_policy()
+{
+  // set transparent huge pages policy before any memory is prefaulted
+  if(this->transparent_huge_pages_ != transparent_huge_pages::INHERIT) {
+    unsigned long thp_disable = (this->transparent_huge_pages_ == transparent_huge_pages::DISABLED) ? 1 : 0;
+    if(::prctl(PR_SET_THP_DISABLE, thp_disable, 0, 0, 0) != 0) {
+      int saved_errnum = errno;
+      sheratan::errhdl::runtime_error ex_to_throw;
+      ex_to_throw << error_category::error_info::posix_errnum(saved_errnum);
+      SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
+    }
+  }
+
+  // adjust OOM score
+  if(this->oom_score_adj_ != daemonizer::OOM_SCORE_ADJ_INHERIT) {
+    std::ostringstream oom_score_adj;
+    oom_score_adj << this->oom_score_adj_;
+    int oom_score_adj_fd = ::open(oom_score_adj_path, O_WRONLY|O_CLOEXEC);
+    if(oom_score_adj_fd < 0) {
+      int saved_errnum = errno;
+      sheratan::errhdl::runtime_error ex_to_throw;
+      ex_to_throw << error_category::error_info::posix_errnum(saved_errnum);
+      SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
+    }
+    ssize_t rc_write = ::write(oom_score_adj_fd, oom_score_adj.str().data(), oom_score_adj.str().size());
+    int saved_errnum = errno;
+    ::close(oom_score_adj_fd);
+    if(rc_write != static_cast<ssize_t>(oom_score_adj.str().size())) {
+      sheratan::errhdl::runtime_error ex_to_throw;
+      ex_to_throw << error_category::error_info::posix_errnum((rc_write < 0) ? saved_errnum : EIO);
+      SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
+    }
+  }
+
+  // prefaulted heap is to be kept: neither trim the heap, nor serve large allocations by separate mappings
+  if(this->prefault_size_ > 0) {
+    if((::mallopt(M_MMAP_MAX, 0) != 1) || (::mallopt(M_TRIM_THRESHOLD, -1) != 1)) {
+      sheratan::errhdl::runtime_error ex_to_throw;
+      ex_to_throw << error_category::error_info::posix_errnum(EINVAL);
+      SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
+    }
+  }
+
+  // lock all the memory, including the one to be mapped in the future (e.g. prefaulted heap)
+  if(this->lock_memory_flag_) {
+    if(::mlockall(MCL_CURRENT|MCL_FUTURE) != 0) {
+      int saved_errnum = errno;
+      sheratan::errhdl::runtime_error ex_to_throw;
+      ex_to_throw << error_category::error_info::posix_errnum(saved_errnum);
+      SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
+    }
+  }
+
+  // prefault heap: touch every page of allocated memory and return it to the allocator
+  if(this->prefault_size_ > 0) {
+    volatile char *heap = static_cast<volatile char *>(std::malloc(this->prefault_size_));
+    if(heap == NULL) {
+      sheratan::errhdl::runtime_error ex_to_throw;
+      ex_to_throw << error_category::error_info::posix_errnum(ENOMEM);
+      SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
+    }
+    std::size_t page_size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    for(std::size_t i = 0; i < this->prefault_size_; i += page_size) {
+      heap[i] = 0;
+    }
+    std::free(const_cast<char *>(heap));
+  }
+}
+
+void daemonization_resources::daemon_init_inherited_fds()
+{
+  // move inherited file descriptors to their final position
+  for(std::size_t i = 0; i < this->inherited_fds_.size(); ++i) {
+    file_descriptor_type target_fd = daemonizer::LISTEN_FDS_START + static_cast<file_descriptor_type>(i);
+    if(::dup2(this->inherited_fds_[i], target_fd) < 0) {
+      int saved_errnum = errno;
+      sheratan::errhdl::runtime_error ex_to_throw;
+      ex_to_throw << error_category::error_info::posix_errnum(saved_errnum);
+      SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
+    }
+    ::close(this->inherited_fds_[i]);
+    this->inherited_fds_[i] = target_fd;
+  }
+}
+
+
+namespace {
+
+
+/// \brief Readiness assignment.
+static const char ready_assignment[] = "READY=1";
+
+/// \brief Stage assignment key.
+static const char stage_key[] = "STAGE=";
+
+/// \brief Size of buffer notifications are received into.
+static const std::size_t notify_buffer_size = 4096;
+
+
+} // anonymous namespace
+
+
+void daemonization_resources::start_wait_ready()
+{
+  SHERATAN_CHECK(!this->ready_wait_);
+
+  this->ready_stages_.clear();
+  if(this->notify_fd_ < 0) {
+    // no readiness stage requested
+    return;
+  }
+  SHERATAN_CHECK(this->daemon_pid_ != process_id::value_type());
+
+  try {
+    // daemon is not a child of this process, its termination is watched using process file descriptor (if available)
+    this->daemon_pidfd_ = pidfd::open(this->daemon_pid_);
+    this->daemon_exited_ = ((this->daemon_pidfd_ == pidfd::INVALID) && (errno == ESRCH));
+
+    // readiness timeout expires once the timer is readable (zero would disarm the timer)
+    this->ready_timer_fd_ = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if(this->ready_timer_fd_ == -1) {
+      throw_posix_error(errno);
+    }
+    boost::int64_t timeout = this->ready_timeout_.total_microseconds();
+    struct itimerspec spec;
+    std::memset(&spec, 0, sizeof(spec));
+    if(timeout > 0) {
+      spec.it_value.tv_sec = static_cast<time_t>(timeout / 1000000);
+      spec.it_value.tv_nsec = static_cast<long>((timeout % 1000000) * 1000);
+    } else {
+      spec.it_value.tv_nsec = 1;
+    }
+    if(::timerfd_settime(this->ready_timer_fd_, 0, &spec, NULL) == -1) {
+      throw_posix_error(errno);
+    }
+
+    // readiness handle aggregates all the events the wait is resumed by
+    this->ready_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+    if(this->ready_fd_ == -1) {
+      throw_posix_error(errno);
+    }
+    file_descriptor_type fds[3] = {this->notify_fd_, this->ready_timer_fd_, this->daemon_pidfd_};
+    for(std::size_t i = 0; i < sizeof(fds) / sizeof(fds[0]); ++i) {
+      if(fds[i] < 0) {
+        continue;
+      }
+      struct epoll_event event;
+      std::memset(&event, 0, sizeof(event));
+      event.events = EPOLLIN;
+      event.data.fd = fds[i];
+      if(::epoll_ctl(this->ready_fd_, EPOLL_CTL_ADD, fds[i], &event) == -1) {
+        throw_posix_error(errno);
+      }
+    }
   }
+  catch(...) {
+    this->stop_wait_ready();
+    throw;
+  }
+  this->ready_wait_ = true;
+}
+
+bool daemonization_resources::wait_ready(bool nonblocking)
+{
+  if(!this->ready_wait_) {
+    // no readiness stage requested
+    return true;
+  }
+
+  try {
+    for(;;) {
+      // notifications sent by the daemon before it exited are still queued
+      if(this->receive_notifications()) {
+        break;
+      }
+
+      // daemon has exited, or readiness timeout has expired
+      struct pollfd fds[2];
+      fds[0].fd = this->daemon_pidfd_;
+      fds[0].events = POLLIN;
+      fds[0].revents = 0;
+      fds[1].fd = this->ready_timer_fd_;
+      fds[1].events = POLLIN;
+      fds[1].revents = 0;
+      if(::poll(fds, 2, 0) == -1) {
+        if(errno == EINTR) {
+          continue;
+        }
+        throw_posix_error(errno);
+      }
+      if(fds[0].revents != 0) {
+        this->daemon_exited_ = true;
+      }
+      if(this->daemon_exited_ || (fds[1].revents != 0)) {
+        if(!this->daemon_exited_) {
+          // nobody is going to take care of the daemon, which is not ready in time
+          if(this->daemon_pidfd_ != pidfd::INVALID) {
+            pidfd::send_signal(this->daemon_pidfd_, SIGTERM);
+          } else {
+            ::kill(this->daemon_pid_, SIGTERM);
+          }
+        }
+        SHERATAN_THROW_EXCEPTION(sheratan::errhdl::runtime_error(), sheratan::errhdl::error_code(errnum::DAEMON_NOT_READY, get_error_category()));
+      }
+
+      if(nonblocking) {
+        return false;
+      }
+
+      // wait for some notification, daemon exit, or readiness timeout
+      struct pollfd pfd;
+      pfd.fd = this->ready_fd_;
+      pfd.events = POLLIN;
+      pfd.revents = 0;
+      if((::poll(&pfd, 1, -1) == -1) && (errno != EINTR)) {
+        throw_posix_error(errno);
+      }
+    }
+  }
+  catch(...) {
+    this->stop_wait_ready();
+    throw;
+  }
+  this->stop_wait_ready();
+  return true;
+}
+
+bool daemonization_resources::waiting_ready() const
+{
+  return this->ready_wait_;
+}
+
+file_descriptor_type daemonization_resources::get_ready_handle() const
+{
+  return this->ready_fd_;
+}
+
+const daemonizer::ready_stage_list_type & daemonization_resources::get_ready_stages() const
+{
+  return this->ready_stages_;
+}
+
+void daemonization_resources::start_report()
+{
+  this->report_.start();
+}
+
+void daemonization_resources::mark(daemonization_report::phase::value_type p)
+{
+  this->report_.mark(p);
+}
+
+const daemonization_report & daemonization_resources::get_report() const
+{
+  return this->report_;
 }
 
 
 namespace {
 
 
-/// \brief Return code pipe tag type definition.
-typedef char rc_pipe_tag_type;
+/// \brief Return code pipe frame version.
+/// \note Version is to be incremented whenever layout of any frame changes.
+static const boost::uint16_t rc_pipe_version = 1;
+
+/// \brief Return code pipe frame type.
+/// \ingroup sheratan_process_posix
+/// \nosubgrouping
+struct rc_pipe_frame_type
+{
+  /// \brief Return code pipe frame type values.
+  typedef enum
+  {
+    PID = 42,       ///< Daemon's PID, followed by timestamps of daemonization phases.
+    EXCEPTION = 23  ///< Exception records, the exception itself followed by its causes.
+  } value_type;
+};
+
+/// \brief Return code pipe frame header.
+/// \ingroup sheratan_process_posix
+/// \nosubgrouping
+struct rc_pipe_header
+{
+  /// \brief Frame version.
+  boost::uint16_t version;
+
+  /// \brief Frame type.
+  boost::uint16_t type;
+
+  /// \brief Length of payload following the header (in bytes).
+  boost::uint32_t length;
+};
+
+/// \brief Maximal length of return code pipe frame payload (in bytes).
+/// \note Whole frame fits into \c PIPE_BUF bytes, therefore it is written
+/// into the pipe atomically.
+static const std::size_t rc_pipe_payload_max = PIPE_BUF - sizeof(rc_pipe_header);
+
+/// \brief Return code pipe timestamp type definition (microseconds).
+typedef boost::int64_t rc_pipe_timestamp_type;
 
-/// \brief Return code pipe PID tag.
-static const rc_pipe_tag_type rc_pipe_pid_tag = 42;
+/// \brief First daemonization phase executed outside of the calling process.
+static const daemonization_report::phase::value_type rc_pipe_first_phase = daemonization_report::phase::FIRST_FORK;
 
-/// \brief Return code pipe exception tag.
-static const rc_pipe_tag_type rc_pipe_ex_tag = 23;
+/// \brief Last daemonization phase executed outside of the calling process.
+static const daemonization_report::phase::value_type rc_pipe_last_phase = daemonization_report::phase::PID_FILE;
 
 /// \brief Return code pipe exception type.
 /// \ingroup sheratan_process_posix
@@ -482,50 +1017,306 @@ struct rc_pipe_excategory
 };
 
 
-/// \brief Write exception into the file.
-/// \param fd File descriptor to be written to.
-/// \param ex Exception to be written.
-/// \param extype Exception type.
+/// \brief Return code pipe frame payload.
+/// \ingroup sheratan_process_posix
+/// \nosubgrouping
+/// \note Payload is built in (and parsed from) fixed-size buffer. Fields
+/// are stored in native representation, both the ends of the pipe belong
+/// to processes forked from the same program image.
+class rc_pipe_payload
+{
+  public:
+
+    /// \brief Default constructor.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    rc_pipe_payload()
+    : size_(0)
+    , offset_(0)
+    {
+    }
+
+  public:
+
+    /// \brief Get payload data.
+    /// \return Pointer to the beginning of payload.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    char * data()
+    {
+      return this->data_;
+    }
+
+    /// \brief Get payload size.
+    /// \return Payload size (in bytes).
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    std::size_t size() const
+    {
+      return this->size_;
+    }
+
+    /// \brief Resize payload.
+    /// \param size New payload size (in bytes).
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \pre <code>size <= rc_pipe_payload_max</code>
+    void resize(std::size_t size)
+    {
+      this->size_ = size;
+      this->offset_ = 0;
+    }
+
+    /// \brief Determine whether whole payload has been extracted.
+    /// \retval true There is no data left to be extracted.
+    /// \retval false There is some data left to be extracted.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    bool exhausted() const
+    {
+      return (this->offset_ == this->size_);
+    }
+
+    /// \brief Append data to payload.
+    /// \param data Data to be appended.
+    /// \param size Size of data to be appended (in bytes).
+    /// \retval true Data have been appended.
+    /// \retval false Data do not fit into the payload, nothing has been appended.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    bool append(const void *data, std::size_t size)
+    {
+      if(size > rc_pipe_payload_max - this->size_) {
+        return false;
+      }
+      std::memcpy(this->data_ + this->size_, data, size);
+      this->size_ += size;
+      return true;
+    }
+
+    /// \brief Append value to payload.
+    /// \param value Value to be appended.
+    /// \retval true Value has been appended.
+    /// \retval false Value does not fit into the payload, nothing has been appended.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    template<typename T>
+    bool put(const T &value)
+    {
+      return this->append(&value, sizeof(value));
+    }
+
+    /// \brief Extract data from payload.
+    /// \param data Buffer data are to be extracted into.
+    /// \param size Size of data to be extracted (in bytes).
+    /// \retval true Data have been extracted.
+    /// \retval false Payload is truncated, nothing has been extracted.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    bool extract(void *data, std::size_t size)
+    {
+      if(size > this->size_ - this->offset_) {
+        return false;
+      }
+      std::memcpy(data, this->data_ + this->offset_, size);
+      this->offset_ += size;
+      return true;
+    }
+
+    /// \brief Extract value from payload.
+    /// \param value Value to be extracted.
+    /// \retval true Value has been extracted.
+    /// \retval false Payload is truncated, nothing has been extracted.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    template<typename T>
+    bool get(T &value)
+    {
+      return this->extract(&value, sizeof(value));
+    }
+
+  private:
+
+    /// \brief Payload data.
+    char data_[rc_pipe_payload_max];
+
+    /// \brief Payload size (in bytes).
+    std::size_t size_;
+
+    /// \brief Offset of data to be extracted next (in bytes).
+    std::size_t offset_;
+};
+
+
+/// \brief Return code pipe exception record.
+/// \ingroup sheratan_process_posix
+/// \nosubgrouping
+struct rc_pipe_exrecord
+{
+  /// \brief Exception type.
+  boost::uint8_t extype;
+
+  /// \brief Exception category.
+  boost::uint8_t excategory;
+
+  /// \brief Error number.
+  sheratan::errhdl::error_category::errnum_type errnum;
+
+  /// \brief POSIX error number (POSIX Process exception category only).
+  error_category::error_info::posix_errnum_type posix_errnum;
+
+  /// \brief Boost error number (POSIX Process exception category only).
+  error_category::error_info::boost_errnum_type boost_errnum;
+
+  /// \brief Line number.
+  sheratan::errhdl::error_info::line_type line;
+
+  /// \brief Seconds part of time of throw.
+  sheratan::errhdl::error_info::seconds_type seconds;
+
+  /// \brief Microseconds part of time of throw.
+  sheratan::errhdl::error_info::useconds_type useconds;
+};
+
+
+/// \brief Write frame into return code pipe.
+/// \param fd Return code pipe write-end.
+/// \param type Frame type.
+/// \param payload Frame payload.
+/// \return Zero on success, POSIX error number otherwise.
 /// \par Abrahams exception guarantee:
 /// no-throw
-static void write_ex(FILE *fd, const sheratan::errhdl::exception &ex, rc_pipe_extype::value_type extype)
+/// \note Header and payload are written by single system call. Frame does
+/// not exceed \c PIPE_BUF bytes, therefore it is never written partially.
+static int write_frame(file_descriptor_type fd, rc_pipe_frame_type::value_type type, rc_pipe_payload &payload)
 {
-  std::fwrite(&rc_pipe_ex_tag, sizeof(rc_pipe_ex_tag), 1, fd);
+  rc_pipe_header header;
+  header.version = rc_pipe_version;
+  header.type = static_cast<boost::uint16_t>(type);
+  header.length = static_cast<boost::uint32_t>(payload.size());
+
+  struct iovec iov[2];
+  iov[0].iov_base = &header;
+  iov[0].iov_len = sizeof(header);
+  iov[1].iov_base = payload.data();
+  iov[1].iov_len = payload.size();
+
+  ssize_t rc_write;
+  do {
+    rc_write = ::writev(fd, iov, 2);
+  } while((rc_write < 0) && (errno == EINTR));
+  if(rc_write < 0) {
+    return errno;
+  }
+  if(static_cast<std::size_t>(rc_write) != sizeof(header) + payload.size()) {
+    return EIO;
+  }
+  return 0;
+}
+
+/// \brief Read exactly specified amount of data from return code pipe.
+/// \param fd Return code pipe read-end.
+/// \param data Buffer data are to be read into.
+/// \param size Size of data to be read (in bytes).
+/// \return Zero on success, POSIX error number otherwise (\c EPIPE in case
+/// the pipe has been closed prematurely).
+/// \par Abrahams exception guarantee:
+/// no-throw
+static int read_exactly(file_descriptor_type fd, void *data, std::size_t size)
+{
+  char *buffer = static_cast<char *>(data);
+  while(size > 0) {
+    ssize_t rc_read = ::read(fd, buffer, size);
+    if(rc_read < 0) {
+      if(errno == EINTR) {
+        continue;
+      }
+      return errno;
+    }
+    if(rc_read == 0) {
+      return EPIPE;
+    }
+    buffer += rc_read;
+    size -= static_cast<std::size_t>(rc_read);
+  }
+  return 0;
+}
+
+/// \brief Read frame from return code pipe.
+/// \param fd Return code pipe read-end.
+/// \param type Expected frame type.
+/// \param payload Frame payload.
+/// \par Abrahams exception guarantee:
+/// strong
+/// \throw sheratan::errhdl::runtime_error Frame could not be read, or its
+/// version is not supported (\c EPROTO).
+/// \throw sheratan::errhdl::logic_error Frame of different type has been read.
+static void read_frame(file_descriptor_type fd, rc_pipe_frame_type::value_type type, rc_pipe_payload &payload)
+{
+  rc_pipe_header header;
+  int saved_errnum = read_exactly(fd, &header, sizeof(header));
+  if((saved_errnum == 0) && ((header.version != rc_pipe_version) || (header.length > rc_pipe_payload_max))) {
+    saved_errnum = EPROTO;
+  }
+  if(saved_errnum == 0) {
+    saved_errnum = read_exactly(fd, payload.data(), header.length);
+  }
+  if(saved_errnum != 0) {
+    sheratan::errhdl::runtime_error ex_to_throw;
+    ex_to_throw << error_category::error_info::posix_errnum(saved_errnum);
+    SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
+  }
+  SHERATAN_CHECK(header.type == type);
+  payload.resize(header.length);
+}
 
-  std::fwrite(&extype, sizeof(extype), 1, fd);
+/// \brief Append exception record to payload.
+/// \param payload Payload record is to be appended to.
+/// \param ex Exception to be recorded (its cause is not).
+/// \retval true Record has been appended.
+/// \retval false Record does not fit into the payload, nothing has been appended.
+/// \par Abrahams exception guarantee:
+/// no-throw
+static bool put_exrecord(rc_pipe_payload &payload, const sheratan::errhdl::exception &ex)
+{
+  rc_pipe_exrecord record = rc_pipe_exrecord();
+
+  record.extype = rc_pipe_extype::RUNTIME_ERROR;
+  if(dynamic_cast<const sheratan::errhdl::logic_error *>(&ex) != NULL) {
+    record.extype = rc_pipe_extype::LOGIC_ERROR;
+  }
 
   bool is_assert_ex = (get_code(ex).get_category() == sheratan::errhdl::get_assert_category());
   bool is_process_ex = (get_code(ex).get_category() == sheratan::process_impl::posix::get_error_category());
-  rc_pipe_excategory::value_type excategory = rc_pipe_excategory::UNKNOWN;
+  record.excategory = rc_pipe_excategory::UNKNOWN;
   if(is_assert_ex) {
-    excategory = rc_pipe_excategory::ASSERT;
+    record.excategory = rc_pipe_excategory::ASSERT;
   }
   else if(is_process_ex) {
-    excategory = rc_pipe_excategory::PROCESS;
+    record.excategory = rc_pipe_excategory::PROCESS;
   }
-  errno = 0;
-  std::fwrite(&excategory, sizeof(excategory), 1, fd);
-
-  sheratan::errhdl::error_category::errnum_type en = get_code(ex).get_errnum();
-  std::fwrite(&en, sizeof(en), 1, fd);
 
+  record.errnum = get_code(ex).get_errnum();
+  record.posix_errnum = 0;
+  record.boost_errnum = error_category::error_info::boost_errnum_type();
   if(is_process_ex) {
-    switch(static_cast<errnum::value_type>(en)) {
+    switch(static_cast<errnum::value_type>(record.errnum)) {
       case errnum::POSIX_SYSTEM:
       {
-        error_category::error_info::posix_errnum_type posix_en = get_posix_errnum(ex);
-        std::fwrite(&posix_en, sizeof(posix_en), 1, fd);
+        record.posix_errnum = get_posix_errnum(ex);
         break;
       }
       case errnum::BOOST_SYSTEM:
       {
-        error_category::error_info::boost_errnum_type boost_en = get_boost_errnum(ex);
-        std::fwrite(&boost_en, sizeof(boost_en), 1, fd);
+        record.boost_errnum = get_boost_errnum(ex);
         break;
       }
       case errnum::UNKNOWN:
       case errnum::DAEMON_ERROR:
       case errnum::PIDFILE_LOCKED:
+      case errnum::HANDOVER_FAILED:
+      case errnum::DAEMON_NOT_READY:
+      case errnum::ZYGOTE_FAILED:
       {
         // nothing to do
         break;
@@ -533,14 +1324,135 @@ static void write_ex(FILE *fd, const sheratan::errhdl::exception &ex, rc_pipe_ex
     }
   }
 
-  sheratan::errhdl::error_info::line_type l = get_line(ex);
-  std::fwrite(&l, sizeof(l), 1, fd);
+  record.line = get_line(ex);
+  record.seconds = get_seconds(ex);
+  record.useconds = get_useconds(ex);
 
-  sheratan::errhdl::error_info::seconds_type s = get_seconds(ex);
-  std::fwrite(&s, sizeof(s), 1, fd);
+  // file name is stored along with its length, in case it does not fit, whole record is dropped
+  sheratan::errhdl::error_info::file_type file = get_file(ex);
+  boost::uint16_t file_length = static_cast<boost::uint16_t>(std::min<std::size_t>(std::strlen(file), rc_pipe_payload_max));
+  std::size_t record_size = sizeof(record) + sizeof(file_length) + file_length;
+  if(record_size > rc_pipe_payload_max - payload.size()) {
+    return false;
+  }
+  payload.put(record);
+  payload.put(file_length);
+  payload.append(file, file_length);
+  return true;
+}
 
-  sheratan::errhdl::error_info::useconds_type u = get_useconds(ex);
-  std::fwrite(&u, sizeof(u), 1, fd);
+/// \brief Intern source file name.
+/// \param file Source file name.
+/// \return Pointer to interned source file name, valid for the rest of the program's life.
+/// \throw std::bad_alloc Allocation of interned source file name failed.
+/// \par Abrahams exception guarantee:
+/// strong
+/// \note Exceptions refer to source file names by plain pointers, so names
+/// retrieved from return code pipe are kept in a set which never shrinks
+/// (it is bounded by number of source files the names come from).
+static sheratan::errhdl::error_info::file_type intern_file_name(const std::string &file)
+{
+  static pthread_mutex_t interned_files_mutex = PTHREAD_MUTEX_INITIALIZER;
+  static std::set<std::string> interned_files;
+
+  ::pthread_mutex_lock(&interned_files_mutex);
+  try {
+    sheratan::errhdl::error_info::file_type interned_file = interned_files.insert(file).first->c_str();
+    ::pthread_mutex_unlock(&interned_files_mutex);
+    return interned_file;
+  }
+  catch(...) {
+    ::pthread_mutex_unlock(&interned_files_mutex);
+    throw;
+  }
+}
+
+/// \brief Extract exception record from payload and fill exception with its data.
+/// \param payload Payload record is to be extracted from.
+/// \param logic_error Sheratan logic error exception object.
+/// \param runtime_error Sheratan runtime error exception object.
+/// \return Pointer to one of exception objects passed via parameters
+/// (depending on recorded exception type), or \c NULL in case the payload
+/// is truncated.
+/// \par Abrahams exception guarantee:
+/// weak
+static sheratan::errhdl::exception * get_exrecord(rc_pipe_payload &payload, sheratan::errhdl::logic_error &logic_error, sheratan::errhdl::runtime_error &runtime_error)
+{
+  rc_pipe_exrecord record;
+  boost::uint16_t file_length;
+  char file[rc_pipe_payload_max];
+  if(!payload.get(record) || !payload.get(file_length) || !payload.extract(file, file_length)) {
+    return NULL;
+  }
+
+  sheratan::errhdl::exception *ex_to_return = NULL;
+  switch(record.extype) {
+    case rc_pipe_extype::LOGIC_ERROR:
+    {
+      ex_to_return = &logic_error;
+      break;
+    }
+    case rc_pipe_extype::RUNTIME_ERROR:
+    {
+      ex_to_return = &runtime_error;
+      break;
+    }
+  }
+  SHERATAN_CHECK(ex_to_return != NULL);
+
+  switch(record.excategory) {
+    case rc_pipe_excategory::UNKNOWN:
+    {
+      sheratan::errhdl::error_code code_to_report(static_cast<sheratan::errhdl::default_errnum::value_type>(record.errnum), sheratan::errhdl::get_default_category());
+      *ex_to_return << sheratan::errhdl::error_info::code(code_to_report);
+      break;
+    }
+    case rc_pipe_excategory::ASSERT:
+    {
+      sheratan::errhdl::error_code code_to_report(static_cast<sheratan::errhdl::assert_errnum::value_type>(record.errnum), sheratan::errhdl::get_assert_category());
+      *ex_to_return << sheratan::errhdl::error_info::code(code_to_report);
+      break;
+    }
+    case rc_pipe_excategory::PROCESS:
+    {
+      sheratan::errhdl::error_code code_to_report(static_cast<sheratan::process_impl::posix::errnum::value_type>(record.errnum), sheratan::process_impl::posix::get_error_category());
+      *ex_to_return << sheratan::errhdl::error_info::code(code_to_report);
+      if(record.errnum == errnum::POSIX_SYSTEM) {
+        *ex_to_return << error_category::error_info::posix_errnum(record.posix_errnum);
+      }
+      else if(record.errnum == errnum::BOOST_SYSTEM) {
+        *ex_to_return << error_category::error_info::boost_errnum(record.boost_errnum);
+      }
+      break;
+    }
+  }
+
+  *ex_to_return
+    << sheratan::errhdl::error_info::file(intern_file_name(std::string(file, file_length)))
+    << sheratan::errhdl::error_info::line(record.line)
+    << sheratan::errhdl::error_info::seconds(record.seconds)
+    << sheratan::errhdl::error_info::useconds(record.useconds)
+  ;
+
+  return ex_to_return;
+}
+
+/// \brief Write exception into return code pipe.
+/// \param fd Return code pipe write-end.
+/// \param ex Exception to be written.
+/// \par Abrahams exception guarantee:
+/// no-throw
+/// \note Exception is written along with its causes. In case the cause
+/// chain does not fit into single frame, the innermost causes are dropped.
+static void write_ex(file_descriptor_type fd, const sheratan::errhdl::exception &ex)
+{
+  rc_pipe_payload payload;
+  for(sheratan::errhdl::exception::const_iterator i = ex.begin(); i != ex.end(); ++i) {
+    if(!put_exrecord(payload, *i)) {
+      break;
+    }
+  }
+  write_frame(fd, rc_pipe_frame_type::EXCEPTION, payload);
 }
 
 
@@ -550,19 +1462,19 @@ static void write_ex(FILE *fd, const sheratan::errhdl::exception &ex, rc_pipe_ex
 void daemonization_resources::report_pid(daemonization_resources::pipe_id::value_type pipe_id, const process_id::value_type &pid)
 {
   SHERATAN_CHECK(pipe_id < daemonization_resources::pipe_id::COUNT);
-  SHERATAN_CHECK(this->rc_pipe_w_[pipe_id] != NULL);
+  SHERATAN_CHECK(this->rc_pipe_w_[pipe_id] >= 0);
 
-  errno = 0;
-  if(std::fwrite(&rc_pipe_pid_tag, sizeof(rc_pipe_pid_tag), 1, this->rc_pipe_w_[pipe_id]) != 1) {
-    int saved_errnum = errno;
-    sheratan::errhdl::runtime_error ex_to_throw;
-    ex_to_throw << error_category::error_info::posix_errnum(saved_errnum);
-    SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
+  // timestamps of phases executed by child process and by the daemon travel along
+  rc_pipe_timestamp_type timestamps[rc_pipe_last_phase - rc_pipe_first_phase + 1];
+  for(int p = rc_pipe_first_phase; p <= rc_pipe_last_phase; ++p) {
+    timestamps[p - rc_pipe_first_phase] = this->report_.timestamps_[p + 1].total_microseconds();
   }
 
-  errno = 0;
-  if(std::fwrite(&pid, sizeof(pid), 1, this->rc_pipe_w_[pipe_id]) != 1) {
-    int saved_errnum = errno;
+  rc_pipe_payload payload;
+  payload.put(pid);
+  payload.put(timestamps);
+  int saved_errnum = write_frame(this->rc_pipe_w_[pipe_id], rc_pipe_frame_type::PID, payload);
+  if(saved_errnum != 0) {
     sheratan::errhdl::runtime_error ex_to_throw;
     ex_to_throw << error_category::error_info::posix_errnum(saved_errnum);
     SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
@@ -572,28 +1484,23 @@ void daemonization_resources::report_pid(daemonization_resources::pipe_id::value
 void daemonization_resources::retrieve_daemon_pid(daemonization_resources::pipe_id::value_type pipe_id)
 {
   SHERATAN_CHECK(pipe_id < daemonization_resources::pipe_id::COUNT);
-  SHERATAN_CHECK(this->rc_pipe_r_[pipe_id] != NULL);
+  SHERATAN_CHECK(this->rc_pipe_r_[pipe_id] >= 0);
 
-  rc_pipe_tag_type pid_tag;
-  errno = 0;
-  if(std::fread(&pid_tag, sizeof(pid_tag), 1, this->rc_pipe_r_[pipe_id]) != 1) {
-    int saved_errnum = errno;
-    sheratan::errhdl::runtime_error ex_to_throw;
-    ex_to_throw << error_category::error_info::posix_errnum(saved_errnum);
-    SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
-  }
-  SHERATAN_CHECK(pid_tag == rc_pipe_pid_tag);
+  rc_pipe_payload payload;
+  read_frame(this->rc_pipe_r_[pipe_id], rc_pipe_frame_type::PID, payload);
 
   process_id::value_type pid;
-  errno = 0;
-  if(std::fread(&pid, sizeof(pid), 1, this->rc_pipe_r_[pipe_id]) != 1) {
-    int saved_errnum = errno;
+  rc_pipe_timestamp_type timestamps[rc_pipe_last_phase - rc_pipe_first_phase + 1];
+  if(!payload.get(pid) || !payload.get(timestamps) || !payload.exhausted()) {
     sheratan::errhdl::runtime_error ex_to_throw;
-    ex_to_throw << error_category::error_info::posix_errnum(saved_errnum);
+    ex_to_throw << error_category::error_info::posix_errnum(EPROTO);
     SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
   }
 
   this->daemon_pid_ = pid;
+  for(int p = rc_pipe_first_phase; p <= rc_pipe_last_phase; ++p) {
+    this->report_.timestamps_[p + 1] = boost::posix_time::microseconds(timestamps[p - rc_pipe_first_phase]);
+  }
 }
 
 process_id::value_type daemonization_resources::get_daemon_pid() const
@@ -604,23 +1511,23 @@ process_id::value_type daemonization_resources::get_daemon_pid() const
 void daemonization_resources::report_ex(daemonization_resources::pipe_id::value_type pipe_id, const sheratan::errhdl::logic_error &ex)
 {
   SHERATAN_CHECK(pipe_id < daemonization_resources::pipe_id::COUNT);
-  SHERATAN_CHECK(this->rc_pipe_w_[pipe_id] != NULL);
+  SHERATAN_CHECK(this->rc_pipe_w_[pipe_id] >= 0);
 
-  write_ex(this->rc_pipe_w_[pipe_id], ex, rc_pipe_extype::LOGIC_ERROR);
+  write_ex(this->rc_pipe_w_[pipe_id], ex);
 }
 
 void daemonization_resources::report_ex(daemonization_resources::pipe_id::value_type pipe_id, const sheratan::errhdl::runtime_error &ex)
 {
   SHERATAN_CHECK(pipe_id < daemonization_resources::pipe_id::COUNT);
-  SHERATAN_CHECK(this->rc_pipe_w_[pipe_id] != NULL);
+  SHERATAN_CHECK(this->rc_pipe_w_[pipe_id] >= 0);
 
-  write_ex(this->rc_pipe_w_[pipe_id], ex, rc_pipe_extype::RUNTIME_ERROR);
+  write_ex(this->rc_pipe_w_[pipe_id], ex);
 }
 
 void daemonization_resources::report_unknown_ex(daemonization_resources::pipe_id::value_type pipe_id)
 {
   SHERATAN_CHECK(pipe_id < daemonization_resources::pipe_id::COUNT);
-  SHERATAN_CHECK(this->rc_pipe_w_[pipe_id] != NULL);
+  SHERATAN_CHECK(this->rc_pipe_w_[pipe_id] >= 0);
 
   sheratan::errhdl::runtime_error ex_to_report;
   sheratan::errhdl::error_code code_to_report(sheratan::errhdl::default_errnum::UNKNOWN, sheratan::errhdl::get_default_category());
@@ -630,129 +1537,185 @@ void daemonization_resources::report_unknown_ex(daemonization_resources::pipe_id
     << sheratan::errhdl::error_info::line(0)
   ;
 
-  write_ex(this->rc_pipe_w_[pipe_id], ex_to_report, rc_pipe_extype::RUNTIME_ERROR);
+  write_ex(this->rc_pipe_w_[pipe_id], ex_to_report);
 }
 
 sheratan::errhdl::exception * daemonization_resources::retrieve_ex(daemonization_resources::pipe_id::value_type pipe_id, sheratan::errhdl::logic_error &logic_error, sheratan::errhdl::runtime_error &runtime_error)
 {
   SHERATAN_CHECK(pipe_id < daemonization_resources::pipe_id::COUNT);
-  SHERATAN_CHECK(this->rc_pipe_r_[pipe_id] != NULL);
+  SHERATAN_CHECK(this->rc_pipe_r_[pipe_id] >= 0);
 
-  rc_pipe_tag_type ex_tag;
-  errno = 0;
-  if(std::fread(&ex_tag, sizeof(ex_tag), 1, this->rc_pipe_r_[pipe_id]) != 1) {
-    int saved_errnum = errno;
-    sheratan::errhdl::runtime_error ex_to_throw;
-    ex_to_throw << error_category::error_info::posix_errnum(saved_errnum);
-    SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
-  }
-  SHERATAN_CHECK(ex_tag == rc_pipe_ex_tag);
+  rc_pipe_payload payload;
+  read_frame(this->rc_pipe_r_[pipe_id], rc_pipe_frame_type::EXCEPTION, payload);
 
-  rc_pipe_extype::value_type extype;
-  errno = 0;
-  if(std::fread(&extype, sizeof(extype), 1, this->rc_pipe_r_[pipe_id]) != 1) {
-    int saved_errnum = errno;
+  // exception itself comes first, its causes follow
+  sheratan::errhdl::exception *ex_to_return = get_exrecord(payload, logic_error, runtime_error);
+  if(ex_to_return == NULL) {
     sheratan::errhdl::runtime_error ex_to_throw;
-    ex_to_throw << error_category::error_info::posix_errnum(saved_errnum);
+    ex_to_throw << error_category::error_info::posix_errnum(EPROTO);
     SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
   }
-  sheratan::errhdl::exception *ex_to_return = NULL;
-  switch(extype) {
-    case rc_pipe_extype::LOGIC_ERROR:
-    {
-      ex_to_return = &logic_error;
-      break;
-    }
-    case rc_pipe_extype::RUNTIME_ERROR:
-    {
-      ex_to_return = &runtime_error;
-      break;
+  std::vector<sheratan::errhdl::error_info::cause_type> causes;
+  while(!payload.exhausted()) {
+    sheratan::errhdl::logic_error cause_logic_error;
+    sheratan::errhdl::runtime_error cause_runtime_error;
+    sheratan::errhdl::exception *cause = get_exrecord(payload, cause_logic_error, cause_runtime_error);
+    if(cause == NULL) {
+      sheratan::errhdl::runtime_error ex_to_throw;
+      ex_to_throw << error_category::error_info::posix_errnum(EPROTO);
+      SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
     }
+    causes.push_back(sheratan::errhdl::error_info::cause_type(cause->clone(), sheratan::errhdl::exception::destroy));
   }
-  SHERATAN_CHECK(ex_to_return != NULL);
 
-  rc_pipe_excategory::value_type excategory;
-  errno = 0;
-  if(std::fread(&excategory, sizeof(excategory), 1, this->rc_pipe_r_[pipe_id]) != 1) {
-    int saved_errnum = errno;
-    sheratan::errhdl::runtime_error ex_to_throw;
-    ex_to_throw << error_category::error_info::posix_errnum(saved_errnum);
-    SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
+  // link the cause chain
+  for(std::size_t i = 1; i < causes.size(); ++i) {
+    *causes[i - 1] << sheratan::errhdl::error_info::cause(causes[i]);
   }
-  sheratan::errhdl::error_category::errnum_type en;
-  errno = 0;
-  if(std::fread(&en, sizeof(en), 1, this->rc_pipe_r_[pipe_id]) != 1) {
-    int saved_errnum = errno;
-    sheratan::errhdl::runtime_error ex_to_throw;
-    ex_to_throw << error_category::error_info::posix_errnum(saved_errnum);
-    SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
-  }
-  switch(excategory) {
-    case rc_pipe_excategory::UNKNOWN:
-    {
-      sheratan::errhdl::error_code code_to_report(static_cast<sheratan::errhdl::default_errnum::value_type>(en), sheratan::errhdl::get_default_category());
-      *ex_to_return << sheratan::errhdl::error_info::code(code_to_report);
-      break;
-    }
-    case rc_pipe_excategory::ASSERT:
-    {
-      sheratan::errhdl::error_code code_to_report(static_cast<sheratan::errhdl::assert_errnum::value_type>(en), sheratan::errhdl::get_assert_category());
-      *ex_to_return << sheratan::errhdl::error_info::code(code_to_report);
-      break;
-    }
-    case rc_pipe_excategory::PROCESS:
-    {
-      sheratan::errhdl::error_code code_to_report(static_cast<sheratan::process_impl::posix::errnum::value_type>(en), sheratan::process_impl::posix::get_error_category());
-      *ex_to_return << sheratan::errhdl::error_info::code(code_to_report);
-      break;
-    }
+  if(!causes.empty()) {
+    *ex_to_return << sheratan::errhdl::error_info::cause(causes.front());
   }
 
-  *ex_to_return << sheratan::errhdl::error_info::file("");
+  return ex_to_return;
+}
 
-  sheratan::errhdl::error_info::line_type l;
-  errno = 0;
-  if(std::fread(&l, sizeof(l), 1, this->rc_pipe_r_[pipe_id]) != 1) {
-    int saved_errnum = errno;
-    sheratan::errhdl::runtime_error ex_to_throw;
-    ex_to_throw << error_category::error_info::posix_errnum(saved_errnum);
-    SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
+void daemonization_resources::stop_wait_ready()
+{
+  if(this->ready_fd_ >= 0) {
+    ::close(this->ready_fd_);
+    this->ready_fd_ = -1;
+  }
+  if(this->ready_timer_fd_ >= 0) {
+    ::close(this->ready_timer_fd_);
+    this->ready_timer_fd_ = -1;
+  }
+  pidfd::close(this->daemon_pidfd_);
+  this->daemon_pidfd_ = pidfd::INVALID;
+  this->daemon_exited_ = false;
+  this->ready_wait_ = false;
+}
+
+void daemonization_resources::restore_signal_mask()
+{
+  if(this->sigmask_saved_) {
+    // signals, which are pending, are delivered now
+    ::pthread_sigmask(SIG_SETMASK, &(this->original_sigmask_), NULL);
+    this->sigmask_saved_ = false;
   }
-  *ex_to_return << sheratan::errhdl::error_info::line(l);
+}
 
-  sheratan::errhdl::error_info::seconds_type s;
-  errno = 0;
-  if(std::fread(&s, sizeof(s), 1, this->rc_pipe_r_[pipe_id]) != 1) {
+void daemonization_resources::create_notify_socket()
+{
+  SHERATAN_CHECK(this->notify_fd_ < 0);
+
+  file_descriptor_type fd = ::socket(AF_UNIX, SOCK_DGRAM|SOCK_CLOEXEC, 0);
+  if(fd < 0) {
     int saved_errnum = errno;
     sheratan::errhdl::runtime_error ex_to_throw;
     ex_to_throw << error_category::error_info::posix_errnum(saved_errnum);
     SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
   }
-  *ex_to_return << sheratan::errhdl::error_info::seconds(s);
 
-  sheratan::errhdl::error_info::useconds_type u;
-  errno = 0;
-  if(std::fread(&u, sizeof(u), 1, this->rc_pipe_r_[pipe_id]) != 1) {
+  // credentials of the sender are attached to each notification and
+  // the socket is bound to unique abstract name chosen by the kernel
+  int enable = 1;
+  struct sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  socklen_t address_length = sizeof(address);
+  if((::setsockopt(fd, SOL_SOCKET, SO_PASSCRED, &enable, sizeof(enable)) != 0)
+    || (::bind(fd, reinterpret_cast<struct sockaddr *>(&address), sizeof(sa_family_t)) != 0)
+    || (::getsockname(fd, reinterpret_cast<struct sockaddr *>(&address), &address_length) != 0)) {
     int saved_errnum = errno;
+    ::close(fd);
     sheratan::errhdl::runtime_error ex_to_throw;
     ex_to_throw << error_category::error_info::posix_errnum(saved_errnum);
     SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
   }
-  *ex_to_return << sheratan::errhdl::error_info::useconds(u);
 
-  return ex_to_return;
+  // leading zero byte of abstract name is written as '@'
+  std::size_t name_length = static_cast<std::size_t>(address_length) - offsetof(struct sockaddr_un, sun_path);
+  this->notify_socket_ = "@" + std::string(address.sun_path + 1, name_length - 1);
+  this->notify_fd_ = fd;
 }
 
-void daemonization_resources::restore_signal_dispositions(bool allow_throw)
+void daemonization_resources::close_notify_socket()
 {
-  daemonization_resources::signal_dispositions_type::const_iterator end = this->signal_dispositions_.end();
-  for(daemonization_resources::signal_dispositions_type::const_iterator i = this->signal_dispositions_.begin(); i != end; ++i) {
-    if((::sigaction(i->signal_number, &(i->signal_sigaction), NULL) != 0) && (allow_throw)) {
+  if(this->notify_fd_ >= 0) {
+    ::close(this->notify_fd_);
+    this->notify_fd_ = -1;
+  }
+}
+
+bool daemonization_resources::receive_notifications()
+{
+  for(;;) {
+    // there is room for sender credentials only, file descriptors sent along are discarded by the kernel
+    char buffer[notify_buffer_size];
+    union
+    {
+      struct cmsghdr align;
+      char data[CMSG_SPACE(sizeof(struct ucred))];
+    } control;
+    struct iovec iov;
+    iov.iov_base = buffer;
+    iov.iov_len = sizeof(buffer);
+    struct msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.data;
+    msg.msg_controllen = sizeof(control.data);
+    ssize_t rc_recv = ::recvmsg(this->notify_fd_, &msg, MSG_DONTWAIT|MSG_CMSG_CLOEXEC);
+    if(rc_recv < 0) {
+      if(errno == EINTR) {
+        continue;
+      }
+      if((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+        return false;
+      }
       int saved_errnum = errno;
       sheratan::errhdl::runtime_error ex_to_throw;
       ex_to_throw << error_category::error_info::posix_errnum(saved_errnum);
       SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
     }
+
+    // only the daemon process itself is allowed to report its readiness
+    bool sent_by_daemon = false;
+    for(struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      if((cmsg->cmsg_level == SOL_SOCKET) && (cmsg->cmsg_type == SCM_CREDENTIALS) && (cmsg->cmsg_len == CMSG_LEN(sizeof(struct ucred)))) {
+        struct ucred credentials;
+        std::memcpy(&credentials, CMSG_DATA(cmsg), sizeof(credentials));
+        sent_by_daemon = (credentials.pid == this->daemon_pid_);
+      }
+    }
+    if(!sent_by_daemon) {
+      continue;
+    }
+
+    // process newline-separated assignments, the others than readiness and stage ones are ignored
+    std::string message(buffer, static_cast<std::size_t>(rc_recv));
+    std::string::size_type begin = 0;
+    while(begin < message.size()) {
+      std::string::size_type end = message.find('\n', begin);
+      if(end == std::string::npos) {
+        end = message.size();
+      }
+      std::string assignment(message, begin, end - begin);
+      begin = end + 1;
+      std::string stage;
+      if(assignment == ready_assignment) {
+        stage = daemonizer::READY_STAGE;
+      } else if((assignment.compare(0, sizeof(stage_key) - 1, stage_key) == 0) && (assignment.size() > sizeof(stage_key) - 1)) {
+        stage = assignment.substr(sizeof(stage_key) - 1);
+      } else {
+        continue;
+      }
+      this->ready_stages_.push_back(daemonizer::ready_stage_list_type::value_type(stage, boost::posix_time::microsec_clock::universal_time()));
+      if((stage == this->ready_stage_) || (stage == daemonizer::READY_STAGE)) {
+        return true;
+      }
+    }
   }
 }
 
@@ -8,17 +8,18 @@
 #define HGI_SHERATAN_PROCESS_POSIX_DAEMONIZATION_RESOURCES_HPP
 
 
+#include <string>
 #include <vector>
 
 #include <unistd.h>
 #include <signal.h>
-#include <sys/resource.h>
 
 #include <boost/noncopyable.hpp>
 #include <boost/array.hpp>
 
 #include "sheratan/errhdl/exception.hpp"
 #include "sheratan/process/posix/daemonizer.hpp"
+#include "sheratan/process/posix/daemonization_report.hpp"
 #include "sheratan/process/posix/daemon_ctl.hpp"
 #include "sheratan/process/posix/process_id.hpp"
 
@@ -75,7 +76,9 @@ class daemonization_resources : private boost::noncopyable
     daemonization_resources();
 
     /// \brief Constructor.
-    /// \param dc Daemon controller.
+    /// \param dc Daemon controller (cloned, unless borrowed one is passed).
+    /// \param borrowed_dc Daemon controller to be used without cloning (or
+    /// \c NULL). It must outlive the resources.
     /// \param pid_file Path to the daemon's PID file. No PID file will be
     /// used, if ommited.
     /// \param pid_file_mode Mode to be used for creation of PID file.
@@ -89,16 +92,39 @@ class daemonization_resources : private boost::noncopyable
     /// will not be redirected, if ommited.
     /// \param reset_signals_flag Reset all signal handlers to default values
     /// in the daemon process.
+    /// \param inherited_fds File descriptors to be inherited by the daemon
+    /// process.
+    /// \param ready_stage Readiness stage to wait for.
+    /// \param ready_timeout Maximal time to wait for the readiness stage.
+    /// \param mode Daemonization mode.
+    /// \param lock_memory_flag Lock all the memory of the daemon process.
+    /// \param transparent_huge_pages Transparent huge pages policy of the
+    /// daemon process.
+    /// \param oom_score_adj OOM score adjustment of the daemon process.
+    /// \param prefault_size Size of heap to be prefaulted in the daemon
+    /// process.
     /// \par Abrahams exception guarantee: /// strong
-    explicit daemonization_resources(
+    /// \pre Inherited file descriptors must be distinct from standard streams.
+    /// \pre OOM score adjustment must be \c daemonizer::OOM_SCORE_ADJ_INHERIT
+    /// or it must be in range from -1000 to 1000.
+    daemonization_resources(
       const daemon_ctl &dc,
+      daemon_ctl *borrowed_dc,
       const daemonizer::pid_file_type &pid_file = daemonizer::pid_file_type(),
       const daemonizer::pid_file_mode_type &pid_file_mode = daemonizer::pid_file_mode_type(),
       const daemonizer::working_dir_type &working_dir = daemonizer::working_dir_type(),
       const daemonizer::stdin_redirect_type &stdin_redirect = daemonizer::stdin_redirect_type(),
       const daemonizer::stdout_redirect_type &stdout_redirect = daemonizer::stdout_redirect_type(),
       const daemonizer::stderr_redirect_type &stderr_redirect = daemonizer::stderr_redirect_type(),
-      const daemonizer::reset_signals_flag_type &reset_signals_flag = daemonizer::reset_signals_flag_type()
+      const daemonizer::reset_signals_flag_type &reset_signals_flag = daemonizer::reset_signals_flag_type(),
+      const daemonizer::inherited_fds_type &inherited_fds = daemonizer::inherited_fds_type(),
+      const daemonizer::ready_stage_type &ready_stage = daemonizer::ready_stage_type(),
+      const daemonizer::ready_timeout_type &ready_timeout = daemonizer::ready_timeout_type(),
+      const daemonizer::mode_type &mode = daemonizer::mode_type(),
+      const daemonizer::lock_memory_flag_type &lock_memory_flag = daemonizer::lock_memory_flag_type(),
+      const daemonizer::transparent_huge_pages_type &transparent_huge_pages = daemonizer::transparent_huge_pages_type(),
+      const daemonizer::oom_score_adj_type &oom_score_adj = daemonizer::oom_score_adj_type(),
+      const daemonizer::prefault_size_type &prefault_size = daemonizer::prefault_size_type()
     );
 
     /// \brief Destructor
@@ -129,6 +155,12 @@ class daemonization_resources : private boost::noncopyable
     /// \pre Object must not be created by default constructor.
     daemon_ctl & get_daemon_ctl();
 
+    /// \brief Get daemonization mode.
+    /// \return Daemonization mode.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    daemonization_mode::value_type get_mode() const;
+
   public:
 
     /// \brief Create return code pipe.
@@ -149,11 +181,28 @@ class daemonization_resources : private boost::noncopyable
     /// \brief Daemon initialization: parent process.
     /// \par Abrahams exception guarantee:
     /// weak
+    /// \note All signals are blocked in the calling thread (and in the
+    /// processes forked from it) until \c restore_signal_mask (or
+    /// \c finalize) is called. Signal dispositions are not changed, so
+    /// other threads of the process are not protected.
+    /// \note PID file is opened and locked (open file description lock),
+    /// so that the lock is handed down to the daemon. Another instance
+    /// holding the lock is thus detected before any process is forked.
+    /// \note Notification socket is created, in case readiness stage is
+    /// requested.
     void daemon_init_parent();
 
+    /// \brief Restore signal mask saved by \c daemon_init_parent.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \note Signals, which are pending, are delivered now.
+    void restore_signal_mask();
+
     /// \brief Daemon initialization: child process.
     /// \par Abrahams exception guarantee:
     /// weak
+    /// \note Notification socket is closed, it is of interest to parent
+    /// process only.
     void daemon_init_child();
 
     /// \brief Daemon initialization: daemon process.
@@ -165,8 +214,94 @@ class daemonization_resources : private boost::noncopyable
     /// class, which are managed separately.
     /// \par Abrahams exception guarantee:
     /// weak
+    /// \note Inherited file descriptors are excluded as well, they are
+    /// moved above the range they are to be passed in and socket activation
+    /// environment variables are set.
+    /// \note Notification socket environment variable is set, in case
+    /// readiness stage is requested.
+    /// \note In \c daemonization_mode::FOREGROUND mode, file creation mask
+    /// is kept, file descriptors are not closed (those occupying the range
+    /// inherited file descriptors are to be passed in are moved above it)
+    /// and socket activation environment variables are not unset.
+    /// \note Memory policy is applied as the last step.
     void daemon_init_daemon(const daemonization_resources::fd_list_type &excluded_fds);
 
+    /// \brief Daemon initialization: pass inherited file descriptors.
+    /// \par Abrahams exception guarantee:
+    /// weak
+    /// \pre \c daemon_init_daemon has been called.
+    /// \pre All the file descriptors owned by daemonization have been closed.
+    /// \note Inherited file descriptors are moved to their final position,
+    /// starting at \c daemonizer::LISTEN_FDS_START.
+    void daemon_init_inherited_fds();
+
+  public:
+
+    /// \brief Start waiting for daemon to reach requested readiness stage.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \pre Daemon process ID has been retrieved.
+    /// \pre Readiness wait is not in progress.
+    /// \note Readiness timeout starts now. There is nothing to wait for, in
+    /// case no readiness stage is requested.
+    void start_wait_ready();
+
+    /// \brief Wait for daemon to reach requested readiness stage.
+    /// \param nonblocking If set, this method will not block.
+    /// \retval true Readiness stage has been reached (or there is nothing to
+    /// wait for), readiness wait is over.
+    /// \retval false Readiness stage has not been reached yet (non-blocking
+    /// call only), readiness wait is still in progress.
+    /// \par Abrahams exception guarantee:
+    /// weak
+    /// \note In case the daemon exits or the readiness timeout expires
+    /// before the readiness stage is reached, \c runtime_error with
+    /// \c errnum::DAEMON_NOT_READY code is thrown. Daemon, which is still
+    /// running, is asked to terminate (\c SIGTERM) in such case. Readiness
+    /// wait is over, whenever exception is thrown.
+    bool wait_ready(bool nonblocking = false);
+
+    /// \brief Determine whether readiness wait is in progress.
+    /// \retval true Readiness wait is in progress.
+    /// \retval false Readiness wait is not in progress.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    bool waiting_ready() const;
+
+    /// \brief Get readiness handle.
+    /// \return File descriptor, which becomes readable once the readiness
+    /// wait is to be resumed, or \c -1 in case it is not in progress.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \note It is \c epoll file descriptor watching the notification
+    /// socket, daemon's process file descriptor and readiness timer.
+    file_descriptor_type get_ready_handle() const;
+
+    /// \brief Get reached readiness stages.
+    /// \return Reached readiness stages.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    const daemonizer::ready_stage_list_type & get_ready_stages() const;
+
+  public:
+
+    /// \brief Start recording daemonization report.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    void start_report();
+
+    /// \brief Record the end of daemonization phase.
+    /// \param p Daemonization phase.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    void mark(daemonization_report::phase::value_type p);
+
+    /// \brief Get daemonization report.
+    /// \return Daemonization report.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    const daemonization_report & get_report() const;
+
   public:
 
     /// \brief Report PID.
@@ -174,12 +309,16 @@ class daemonization_resources : private boost::noncopyable
     /// \param pid Process ID to be reported.
     /// \par Abrahams exception guarantee:
     /// strong
+    /// \note Timestamps of daemonization phases executed by child process
+    /// and by the daemon are reported along.
     void report_pid(daemonization_resources::pipe_id::value_type pipe_id, const process_id::value_type &pid);
 
     /// \brief Set daemon process ID.
     /// \param pipe_id Return code pipe ID.
     /// \par Abrahams exception guarantee:
     /// no-throw
+    /// \note Timestamps of daemonization phases executed by child process
+    /// and by the daemon are retrieved along.
     void retrieve_daemon_pid(daemonization_resources::pipe_id::value_type pipe_id);
 
     /// \brief Get daemon process ID.
@@ -193,6 +332,9 @@ class daemonization_resources : private boost::noncopyable
     /// \param ex Exception to be reported.
     /// \par Abrahams exception guarantee:
     /// no-throw
+    /// \note Exception is reported along with its causes, in single frame
+    /// (the innermost causes, which do not fit into \c PIPE_BUF bytes, are
+    /// dropped).
     void report_ex(daemonization_resources::pipe_id::value_type pipe_id, const sheratan::errhdl::logic_error &ex);
 
     /// \brief Report runtime exception.
@@ -223,48 +365,83 @@ class daemonization_resources : private boost::noncopyable
     /// \note In case when unknown exception is reported to rc-pipe,
     /// Sheratan runtime error exception with default error category
     /// is returned.
+    /// \note Source file name and cause chain of reported exception
+    /// are retrieved along.
     sheratan::errhdl::exception * retrieve_ex(daemonization_resources::pipe_id::value_type pipe_id, sheratan::errhdl::logic_error &logic_error, sheratan::errhdl::runtime_error &runtime_error);
 
   private:
     
     /// \brief Return code pipe type definition.
-    typedef boost::array<FILE *, daemonization_resources::pipe_id::COUNT> rc_pipe_type;
+    typedef boost::array<file_descriptor_type, daemonization_resources::pipe_id::COUNT> rc_pipe_type;
 
-    /// \brief Signal disposition type definition.
-    /// \ingroup sheratan_process_posix
-    /// \nosubgrouping
-    struct signal_disposition
-    {
-      /// \brief Signal number.
-      signal_number_type signal_number;
+  private:
 
-      /// \brief Signal disposition.
-      struct sigaction signal_sigaction;
-    };
+    /// \brief Stop waiting for daemon readiness.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \note File descriptors of readiness wait are closed.
+    void stop_wait_ready();
 
-    /// \brief Signal dispositions type definition.
-    typedef std::vector<signal_disposition> signal_dispositions_type;
+    /// \brief Apply memory policy.
+    /// \par Abrahams exception guarantee:
+    /// weak
+    void apply_memory_policy();
 
-  private:
+    /// \brief Open and lock PID file.
+    /// \param ofd_only Acquire open file description lock only, which is
+    /// shared with forked processes.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \note Does nothing, in case no PID file is requested or it has
+    /// already been acquired. In case \p ofd_only is set and open file
+    /// description locks are not supported, PID file is left for the daemon
+    /// to be acquired.
+    /// \note In case PID file is locked by another process, \c runtime_error
+    /// with \c errnum::PIDFILE_LOCKED code is thrown.
+    void acquire_pid_file(bool ofd_only);
+
+    /// \brief Close PID file.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \note The lock is released, unless the open file description is
+    /// shared with another process (i.e. the daemon).
+    void close_pid_file();
 
-    /// \brief Restore signal dispositions.
-    /// \param allow_throw Flag determining required Abrahams exception guarantee.
+    /// \brief Create notification socket.
     /// \par Abrahams exception guarantee:
-    /// - <code>allow_throw == true</code>: strong
-    /// - <code>allow_throw == false</code>: no-throw
-    void restore_signal_dispositions(bool allow_throw = true);
+    /// strong
+    void create_notify_socket();
+
+    /// \brief Close notification socket.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    void close_notify_socket();
+
+    /// \brief Receive pending notifications.
+    /// \retval true Requested readiness stage has been reached.
+    /// \retval false Requested readiness stage has not been reached yet.
+    /// \par Abrahams exception guarantee:
+    /// weak
+    /// \note Notifications not sent by the daemon process are ignored.
+    bool receive_notifications();
 
   private:
 
-    /// \brief Daemon controller.
+    /// \brief Daemon controller (clone owned by the resources).
     std::auto_ptr<daemon_ctl> daemon_ctl_;
 
+    /// \brief Borrowed daemon controller (used instead of the clone, if set).
+    daemon_ctl *borrowed_daemon_ctl_;
+
     /// \brief PID file.
     daemonizer::pid_file_type::value_type pid_file_;
 
     /// \brief PID file mode.
     daemonizer::pid_file_mode_type::value_type pid_file_mode_;
 
+    /// \brief PID file (locked).
+    file_descriptor_type pidfile_fd_;
+
     /// \brief Working directory.
     daemonizer::working_dir_type::value_type working_dir_;
 
@@ -280,6 +457,57 @@ class daemonization_resources : private boost::noncopyable
     /// \brief Reset signal dispositions to default values flag.
     daemonizer::reset_signals_flag_type::value_type reset_signals_flag_;
 
+    /// \brief Inherited file descriptors.
+    daemonizer::inherited_fds_type::value_type inherited_fds_;
+
+    /// \brief Daemonization mode.
+    daemonizer::mode_type::value_type mode_;
+
+    /// \brief Readiness stage.
+    daemonizer::ready_stage_type::value_type ready_stage_;
+
+    /// \brief Readiness timeout.
+    daemonizer::ready_timeout_type::value_type ready_timeout_;
+
+    /// \brief Reached readiness stages.
+    daemonizer::ready_stage_list_type ready_stages_;
+
+    /// \brief Whether readiness wait is in progress.
+    bool ready_wait_;
+
+    /// \brief Readiness handle (\c epoll).
+    file_descriptor_type ready_fd_;
+
+    /// \brief Readiness timer (\c timerfd).
+    file_descriptor_type ready_timer_fd_;
+
+    /// \brief Daemon's process file descriptor.
+    file_descriptor_type daemon_pidfd_;
+
+    /// \brief Whether the daemon has exited.
+    bool daemon_exited_;
+
+    /// \brief Lock memory flag.
+    daemonizer::lock_memory_flag_type::value_type lock_memory_flag_;
+
+    /// \brief Transparent huge pages policy.
+    daemonizer::transparent_huge_pages_type::value_type transparent_huge_pages_;
+
+    /// \brief OOM score adjustment.
+    daemonizer::oom_score_adj_type::value_type oom_score_adj_;
+
+    /// \brief Heap prefault size.
+    daemonizer::prefault_size_type::value_type prefault_size_;
+
+    /// \brief Notification socket.
+    file_descriptor_type notify_fd_;
+
+    /// \brief Notification socket name (value of \c NOTIFY_SOCKET environment variable).
+    std::string notify_socket_;
+
+    /// \brief Daemonization report.
+    daemonization_report report_;
+
     /// \brief Daemon process ID.
     process_id::value_type daemon_pid_;
 
@@ -289,11 +517,11 @@ class daemonization_resources : private boost::noncopyable
     /// \brief Return code pipe write-end.
     daemonization_resources::rc_pipe_type rc_pipe_w_;
 
-    /// \brief Maximum number of file descriptors limit.
-    struct rlimit filedescs_rlimit_;
+    /// \brief Original signal mask.
+    sigset_t original_sigmask_;
 
-    /// \brief Original signal dispositions.
-    daemonization_resources::signal_dispositions_type signal_dispositions_;
+    /// \brief Whether the original signal mask has been saved (and it is to be restored).
+    bool sigmask_saved_;
 };
 
 
@@ -4,10 +4,15 @@
 /// \author Marek Balint \c (mareq[A]balint[D]eu)
 
 
+#include <climits>
+#include <cstdlib>
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
 #include "sheratan/errhdl/assert.hpp"
 #include "sheratan/process/posix/daemonizer.hpp"
 #include "sheratan/process/posix/daemon.hpp"
-#include "sheratan/process/posix/process_template.hpp"
+#include "sheratan/process/posix/static_process_template.hpp"
 #include "daemonization_resources.hpp"
 #include "daemonization_ctl_1st.hpp"
 
@@ -20,7 +25,7 @@ namespace posix {
 
 
 /// \brief First child process type definition.
-typedef process_template<struct first_child_tag> first_child_process;
+typedef static_process_template<daemonization_ctl_1st> first_child_process;
 
 
 daemonizer::pid_file_value_traits::value_type daemonizer::pid_file_value_traits::default_value()
@@ -48,9 +53,57 @@ daemonizer::reset_signals_flag_value_traits::value_type daemonizer::reset_signal
   return true;
 }
 
+daemonizer::inherited_fds_value_traits::value_type daemonizer::inherited_fds_value_traits::default_value()
+{
+  return daemonizer::inherited_fds_value_traits::value_type();
+}
+
+daemonizer::ready_stage_value_traits::value_type daemonizer::ready_stage_value_traits::default_value()
+{
+  return "";
+}
+
+daemonizer::ready_timeout_value_traits::value_type daemonizer::ready_timeout_value_traits::default_value()
+{
+  return boost::posix_time::seconds(30);
+}
+
+daemonizer::mode_value_traits::value_type daemonizer::mode_value_traits::default_value()
+{
+  return daemonization_mode::DETACHED;
+}
+
+daemonizer::lock_memory_flag_value_traits::value_type daemonizer::lock_memory_flag_value_traits::default_value()
+{
+  return false;
+}
+
+daemonizer::transparent_huge_pages_value_traits::value_type daemonizer::transparent_huge_pages_value_traits::default_value()
+{
+  return transparent_huge_pages::INHERIT;
+}
+
+daemonizer::oom_score_adj_value_traits::value_type daemonizer::oom_score_adj_value_traits::default_value()
+{
+  return daemonizer::OOM_SCORE_ADJ_INHERIT;
+}
+
+daemonizer::prefault_size_value_traits::value_type daemonizer::prefault_size_value_traits::default_value()
+{
+  return 0;
+}
+
+
+const file_descriptor_type daemonizer::LISTEN_FDS_START = 3;
+
+const char daemonizer::READY_STAGE[] = "READY";
+
+const int daemonizer::OOM_SCORE_ADJ_INHERIT = INT_MIN;
+
 
 daemonizer::daemonizer()
 : resources_()
+, first_child_()
 {
 }
 
@@ -62,10 +115,56 @@ daemonizer::daemonizer(
   const daemonizer::stdin_redirect_type &stdin_redirect,
   const daemonizer::stdout_redirect_type &stdout_redirect,
   const daemonizer::stderr_redirect_type &stderr_redirect,
-  const daemonizer::reset_signals_flag_type &reset_signals_flag
+  const daemonizer::reset_signals_flag_type &reset_signals_flag,
+  const daemonizer::inherited_fds_type &inherited_fds,
+  const daemonizer::ready_stage_type &ready_stage,
+  const daemonizer::ready_timeout_type &ready_timeout,
+  const daemonizer::mode_type &mode,
+  const daemonizer::lock_memory_flag_type &lock_memory_flag,
+  const daemonizer::transparent_huge_pages_type &transparent_huge_pages,
+  const daemonizer::oom_score_adj_type &oom_score_adj,
+  const daemonizer::prefault_size_type &prefault_size
+)
+: resources_(new daemonization_resources(dc, NULL, pid_file, pid_file_mode, working_dir, stdin_redirect, stdout_redirect, stderr_redirect, reset_signals_flag, inherited_fds, ready_stage, ready_timeout, mode, lock_memory_flag, transparent_huge_pages, oom_score_adj, prefault_size))
+, first_child_()
+{
+}
+
+daemonizer::daemonizer(
+  daemonizer::borrowed_daemon_ctl_tag,
+  daemon_ctl &dc,
+  const daemonizer::pid_file_type &pid_file,
+  const daemonizer::pid_file_mode_type &pid_file_mode,
+  const daemonizer::working_dir_type &working_dir,
+  const daemonizer::stdin_redirect_type &stdin_redirect,
+  const daemonizer::stdout_redirect_type &stdout_redirect,
+  const daemonizer::stderr_redirect_type &stderr_redirect,
+  const daemonizer::reset_signals_flag_type &reset_signals_flag,
+  const daemonizer::inherited_fds_type &inherited_fds,
+  const daemonizer::ready_stage_type &ready_stage,
+  const daemonizer::ready_timeout_type &ready_timeout,
+  const daemonizer::mode_type &mode,
+  const daemonizer::lock_memory_flag_type &lock_memory_flag,
+  const daemonizer::transparent_huge_pages_type &transparent_huge_pages,
+  const daemonizer::oom_score_adj_type &oom_score_adj,
+  const daemonizer::prefault_size_type &prefault_size
 )
-: resources_(new daemonization_resources(dc, pid_file, pid_file_mode, working_dir, stdin_redirect, stdout_redirect, stderr_redirect, reset_signals_flag))
+: resources_(new daemonization_resources(dc, &dc, pid_file, pid_file_mode, working_dir, stdin_redirect, stdout_redirect, stderr_redirect, reset_signals_flag, inherited_fds, ready_stage, ready_timeout, mode, lock_memory_flag, transparent_huge_pages, oom_score_adj, prefault_size))
+, first_child_()
+{
+}
+
+daemonizer::~daemonizer()
 {
+  // do not leave zombie behind, in case daemonization was not ended
+  if((this->first_child_.get() != NULL) && (this->first_child_->valid())) {
+    try {
+      this->first_child_->join();
+    }
+    catch(...) {
+      // nothing to do here
+    }
+  }
 }
 
 const daemon_ctl & daemonizer::get_daemon_ctl() const
@@ -82,30 +181,111 @@ daemon_ctl & daemonizer::get_daemon_ctl()
   return this->resources_->get_daemon_ctl();
 }
 
+const daemonizer::ready_stage_list_type & daemonizer::get_ready_stages() const
+{
+  SHERATAN_CHECK(this->resources_.get() != NULL);
+
+  return this->resources_->get_ready_stages();
+}
+
 void daemonizer::daemonize(daemon &daemon_process)
 {
   SHERATAN_CHECK(this->resources_.get() != NULL);
 
+  // calling process is the daemon process itself, it is taken care of by its supervisor
+  if(this->resources_->get_mode() == daemonization_mode::FOREGROUND) {
+    this->resources_->start_report();
+    this->resources_->get_daemon_ctl().predaemonize();
+    this->resources_->mark(daemonization_report::phase::PREDAEMONIZE);
+    this->resources_->daemon_init_daemon(daemonization_resources::fd_list_type());
+    this->resources_->daemon_init_inherited_fds();
+    std::exit(this->resources_->get_daemon_ctl().daemonized_child());
+  }
+
+  // start child process (a.k.a. 1st child), its exit status contains information about both child and daemon
+  process &first_child = this->begin_daemonize();
+  exit_status status = first_child.join();
+  this->end_daemonize(daemon_process, status);
+}
+
+process & daemonizer::begin_daemonize()
+{
+  SHERATAN_CHECK(this->resources_.get() != NULL);
+  SHERATAN_CHECK(this->first_child_.get() == NULL);
+  SHERATAN_CHECK(!this->resources_->waiting_ready());
+  SHERATAN_CHECK(this->resources_->get_mode() == daemonization_mode::DETACHED);
+
   // let user's daemon controller know that daemonization is about to be executed
+  this->resources_->start_report();
   this->resources_->get_daemon_ctl().predaemonize();
+  this->resources_->mark(daemonization_report::phase::PREDAEMONIZE);
 
   // execute common daemon initialization procedure
   this->resources_->daemon_init_parent();
+  this->resources_->mark(daemonization_report::phase::INIT_PARENT);
+
+  // start child process (a.k.a. 1st child), it will be joined by the caller
+  this->first_child_.reset(new first_child_process(daemonization_ctl_1st(*this->resources_)));
 
-  // start child process (a.k.a. 1st child)
-  first_child_process first_child(daemonization_ctl_1st(*this->resources_));
+  return *this->first_child_;
+}
+
+bool daemonizer::end_daemonize(daemon &daemon_process, const exit_status &first_child_status, bool nonblocking)
+{
+  SHERATAN_CHECK(this->first_child_.get() != NULL);
+  SHERATAN_CHECK(first_child_status.valid());
 
-  // no need to join process, it was already taken care of in daemonization_ctl_1st's postfork routine
-  //exit_status status = first_child.join();
+  // 1st child is over, whatever the outcome of daemonization is
+  std::auto_ptr<process> first_child(this->first_child_);
+
+  // 1st child has been reaped, so signals need not be deferred while waiting for the daemon
+  this->resources_->restore_signal_mask();
+
+  // handle errors and retrieve daemon's process ID
+  daemonization_ctl_1st::complete(*this->resources_, first_child_status);
+
+  // start waiting for daemon to reach requested readiness stage
+  this->resources_->start_wait_ready();
+  return this->finish_daemonize(daemon_process, nonblocking);
+}
+
+bool daemonizer::continue_daemonize(daemon &daemon_process, bool nonblocking)
+{
+  SHERATAN_CHECK(this->resources_.get() != NULL);
+  SHERATAN_CHECK(this->resources_->waiting_ready());
+
+  return this->finish_daemonize(daemon_process, nonblocking);
+}
+
+file_descriptor_type daemonizer::native_handle() const
+{
+  SHERATAN_CHECK(this->resources_.get() != NULL);
+
+  return this->resources_->get_ready_handle();
+}
+
+bool daemonizer::finish_daemonize(daemon &daemon_process, bool nonblocking)
+{
+  // wait for daemon to reach requested readiness stage
+  if(!this->resources_->wait_ready(nonblocking)) {
+    return false;
+  }
+  this->resources_->mark(daemonization_report::phase::READINESS);
 
   // set daemon's process ID
   daemon_process.set_pid(process_id(this->resources_->get_daemon_pid()));
 
   // let user's daemon controller know that daemonization is done and this is a parent process
   this->resources_->get_daemon_ctl().postdaemonize(daemon_process);
+  this->resources_->mark(daemonization_report::phase::POSTDAEMONIZE);
+
+  // hand daemonization report over to the daemon object
+  daemon_process.set_report(this->resources_->get_report());
 
   // finalize daemonization resources
   this->resources_->finalize();
+
+  return true;
 }
 
 
@@ -0,0 +1,185 @@
+/// \file process/sub/posix/src/epoll_reactor_engine.cpp
+/// \brief POSIX epoll reactor engine implementation.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+// epoll_create1(2): http://man7.org/linux/man-pages/man2/epoll_create1.2.html
+// epoll_ctl(2): http://man7.org/linux/man-pages/man2/epoll_ctl.2.html
+// epoll_wait(2): http://man7.org/linux/man-pages/man2/epoll_wait.2.html
+// close(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/close.html
+
+
+#include <cerrno>
+
+#include <unistd.h>
+#include <stdint.h>
+#include <sys/epoll.h>
+
+#include "sheratan/errhdl/throw.hpp"
+#include "sheratan/process/posix/error_category.hpp"
+#include "epoll_reactor_engine.hpp"
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+namespace {
+
+
+/// \brief Maximal number of events reported by single wait.
+static const int max_events = 256;
+
+
+/// \brief Convert I/O event mask into \c epoll events.
+/// \param events Mask of I/O events.
+/// \return Mask of \c epoll events.
+/// \par Abrahams exception guarantee:
+/// no-throw
+static uint32_t to_epoll_events(io_event_mask_type events)
+{
+  uint32_t ret = 0;
+  if(events & io_events::READABLE) {
+    ret |= EPOLLIN | EPOLLRDHUP;
+  }
+  if(events & io_events::WRITABLE) {
+    ret |= EPOLLOUT;
+  }
+  return ret;
+}
+
+/// \brief Convert \c epoll events into I/O event mask.
+/// \param events Mask of \c epoll events.
+/// \return Mask of I/O events.
+/// \par Abrahams exception guarantee:
+/// no-throw
+static io_event_mask_type from_epoll_events(uint32_t events)
+{
+  io_event_mask_type ret = io_events::NONE;
+  if(events & (EPOLLIN | EPOLLPRI)) {
+    ret |= io_events::READABLE;
+  }
+  if(events & EPOLLOUT) {
+    ret |= io_events::WRITABLE;
+  }
+  if(events & (EPOLLHUP | EPOLLRDHUP)) {
+    ret |= io_events::HANGUP;
+  }
+  if(events & EPOLLERR) {
+    ret |= io_events::FAILURE;
+  }
+  return ret;
+}
+
+/// \brief Update \c epoll set.
+/// \param epoll_fd File descriptor of \c epoll set.
+/// \param op Operation.
+/// \param fd File descriptor.
+/// \param events Mask of I/O events.
+/// \par Abrahams exception guarantee:
+/// strong
+static void control(file_descriptor_type epoll_fd, int op, file_descriptor_type fd, io_event_mask_type events)
+{
+  struct epoll_event ev;
+  ev.events = to_epoll_events(events);
+  ev.data.fd = fd;
+  if(::epoll_ctl(epoll_fd, op, fd, &ev) != 0) {
+    int saved_errnum = errno;
+    sheratan::errhdl::runtime_error ex_to_throw;
+    ex_to_throw << error_category::error_info::posix_errnum(saved_errnum);
+    SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
+  }
+}
+
+
+} // anonymous namespace
+
+
+epoll_reactor_engine::epoll_reactor_engine()
+: reactor_engine()
+, epoll_fd_(-1)
+{
+  this->epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+  if(this->epoll_fd_ == -1) {
+    int saved_errnum = errno;
+    sheratan::errhdl::runtime_error ex_to_throw;
+    ex_to_throw << error_category::error_info::posix_errnum(saved_errnum);
+    SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
+  }
+}
+
+epoll_reactor_engine::~epoll_reactor_engine()
+{
+  ::close(this->epoll_fd_);
+}
+
+reactor_backend::value_type epoll_reactor_engine::get_backend() const
+{
+  return reactor_backend::EPOLL;
+}
+
+void epoll_reactor_engine::add(file_descriptor_type fd, io_event_mask_type events)
+{
+  control(this->epoll_fd_, EPOLL_CTL_ADD, fd, events);
+}
+
+void epoll_reactor_engine::add_process(file_descriptor_type fd)
+{
+  // process file descriptor becomes readable once the process terminates
+  control(this->epoll_fd_, EPOLL_CTL_ADD, fd, io_events::READABLE);
+}
+
+void epoll_reactor_engine::modify(file_descriptor_type fd, io_event_mask_type events)
+{
+  control(this->epoll_fd_, EPOLL_CTL_MOD, fd, events);
+}
+
+bool epoll_reactor_engine::remove(file_descriptor_type fd, int &)
+{
+  // file descriptor must be removed from epoll set before it is closed (it might
+  // have been inherited by child process and epoll watches open files, not descriptors)
+  ::epoll_ctl(this->epoll_fd_, EPOLL_CTL_DEL, fd, NULL);
+  return false;
+}
+
+void epoll_reactor_engine::wait(bool nonblocking, reactor_engine::event_list_type &events)
+{
+  struct epoll_event ready[max_events];
+  int rc_wait;
+  // blocking wait might be interrupted without any signal delivered (e.g. by task work), it goes on
+  do {
+    rc_wait = ::epoll_wait(this->epoll_fd_, ready, max_events, nonblocking ? 0 : -1);
+  } while((rc_wait == -1) && (errno == EINTR) && !nonblocking);
+  if(rc_wait == -1) {
+    if(errno == EINTR) {
+      return;
+    }
+    int saved_errnum = errno;
+    sheratan::errhdl::runtime_error ex_to_throw;
+    ex_to_throw << error_category::error_info::posix_errnum(saved_errnum);
+    SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
+  }
+
+  for(int i = 0; i < rc_wait; ++i) {
+    reactor_engine::event ev;
+    ev.fd = ready[i].data.fd;
+    ev.events = from_epoll_events(ready[i].events);
+    ev.reaped = false;
+    ev.status = 0;
+    events.push_back(ev);
+  }
+}
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+// vim: set ts=2 sw=2 et:
@@ -0,0 +1,69 @@
+/// \file process/sub/posix/src/epoll_reactor_engine.hpp
+/// \brief POSIX epoll reactor engine interface.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#ifndef HGI_SHERATAN_PROCESS_POSIX_EPOLL_REACTOR_ENGINE_HPP
+#define HGI_SHERATAN_PROCESS_POSIX_EPOLL_REACTOR_ENGINE_HPP
+
+
+#include "reactor_engine.hpp"
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+/// \brief POSIX \c epoll reactor engine.
+/// \ingroup sheratan_process_posix
+/// \nosubgrouping
+class epoll_reactor_engine : public reactor_engine
+{
+  public:
+
+    /// \brief Default constructor.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    epoll_reactor_engine();
+
+    /// \brief Destructor.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    virtual ~epoll_reactor_engine();
+
+  public:
+
+    virtual reactor_backend::value_type get_backend() const;
+
+    virtual void add(file_descriptor_type fd, io_event_mask_type events);
+
+    virtual void add_process(file_descriptor_type fd);
+
+    virtual void modify(file_descriptor_type fd, io_event_mask_type events);
+
+    virtual bool remove(file_descriptor_type fd, int &status);
+
+    virtual void wait(bool nonblocking, event_list_type &events);
+
+  private:
+
+    /// \brief File descriptor of \c epoll set.
+    file_descriptor_type epoll_fd_;
+};
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+#endif // HGI_SHERATAN_PROCESS_POSIX_EPOLL_REACTOR_ENGINE_HPP
+
+
+// vim: set ts=2 sw=2 et:
@@ -0,0 +1,161 @@
+/// \file process/sub/posix/src/exec_ctl.cpp
+/// \brief POSIX exec controller implementation.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+// execve(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/exec.html
+
+
+#include <unistd.h>
+
+#include "sheratan/errhdl/assert.hpp"
+#include "sheratan/process/posix/exec_ctl.hpp"
+
+
+extern char **environ;
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+namespace {
+
+
+/// \brief Build \c NULL terminated vector of C-strings.
+/// \param strings List of strings.
+/// \param vector Vector to be built.
+/// \par Abrahams exception guarantee:
+/// strong
+/// \note Built vector points into strings of \c strings list, so it
+/// is valid only until the list is modified or destroyed.
+static void build_cstring_vector(const exec_ctl::string_list_type &strings, std::vector<char *> &vector)
+{
+  std::vector<char *> result;
+  result.reserve(strings.size() + 1);
+  exec_ctl::string_list_type::const_iterator end = strings.end();
+  for(exec_ctl::string_list_type::const_iterator i = strings.begin(); i != end; ++i) {
+    result.push_back(const_cast<char *>(i->c_str()));
+  }
+  result.push_back(NULL);
+  vector.swap(result);
+}
+
+
+} // anonymous namespace
+
+
+const exit_status::value_type exec_ctl::EXEC_FAILURE = 127;
+
+
+exec_ctl::exec_ctl(const std::string &path, const exec_ctl::string_list_type &args)
+: path_(path)
+, args_(args)
+, env_()
+, inherit_env_(true)
+, argv_()
+, envp_()
+{
+}
+
+exec_ctl::exec_ctl(const std::string &path, const exec_ctl::string_list_type &args, const exec_ctl::string_list_type &env)
+: path_(path)
+, args_(args)
+, env_(env)
+, inherit_env_(false)
+, argv_()
+, envp_()
+{
+}
+
+exec_ctl::exec_ctl(const exec_ctl &that)
+: fork_ctl()
+, path_(that.path_)
+, args_(that.args_)
+, env_(that.env_)
+, inherit_env_(that.inherit_env_)
+, argv_()  // vectors point into strings of each particular copy
+, envp_()  // vectors point into strings of each particular copy
+{
+}
+
+fork_ctl * exec_ctl::clone() const
+{
+  return new exec_ctl(*this);
+}
+
+void exec_ctl::prefork()
+{
+  // prepare vectors in parent, so that nothing needs to be allocated in child
+  build_cstring_vector(this->args_, this->argv_);
+  if(!this->inherit_env_) {
+    build_cstring_vector(this->env_, this->envp_);
+  }
+}
+
+void exec_ctl::postfork(process &)
+{
+  // nothing to do here
+}
+
+exit_status::value_type exec_ctl::child()
+{
+  // replace program image (returns only in case of an error)
+  ::execve(this->path_.c_str(), this->get_argv(), this->get_envp());
+
+  return exec_ctl::EXEC_FAILURE;
+}
+
+const std::string & exec_ctl::get_path() const
+{
+  return this->path_;
+}
+
+const exec_ctl::string_list_type & exec_ctl::get_args() const
+{
+  return this->args_;
+}
+
+const exec_ctl::string_list_type & exec_ctl::get_env() const
+{
+  SHERATAN_CHECK(!this->inherit_env_);
+
+  return this->env_;
+}
+
+bool exec_ctl::inherits_env() const
+{
+  return this->inherit_env_;
+}
+
+char * const * exec_ctl::get_argv() const
+{
+  SHERATAN_CHECK(!this->argv_.empty());
+
+  return &(this->argv_[0]);
+}
+
+char * const * exec_ctl::get_envp() const
+{
+  if(this->inherit_env_) {
+    return ::environ;
+  }
+
+  SHERATAN_CHECK(!this->envp_.empty());
+
+  return &(this->envp_[0]);
+}
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+// vim: set ts=2 sw=2 et:
@@ -0,0 +1,266 @@
+/// \file process/sub/posix/src/fd_sanitizer.cpp
+/// \brief POSIX file descriptor sanitizer implementation.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+// close_range(2): http://man7.org/linux/man-pages/man2/close_range.2.html
+// proc(5): http://man7.org/linux/man-pages/man5/proc.5.html
+// opendir(3): http://pubs.opengroup.org/onlinepubs/009695399/functions/opendir.html
+// readdir(3): http://pubs.opengroup.org/onlinepubs/009695399/functions/readdir.html
+// closedir(3): http://pubs.opengroup.org/onlinepubs/009695399/functions/closedir.html
+// getrlimit(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/getrlimit.html
+// close(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/close.html
+// fcntl(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/fcntl.html
+
+
+#include <cerrno>
+#include <cstdlib>
+#include <vector>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+#include "sheratan/errhdl/assert.hpp"
+#include "sheratan/process/posix/error_category.hpp"
+#include "sheratan/process/posix/fd_sanitizer.hpp"
+#include "posix_error.hpp"
+
+
+/// \def SYS_close_range
+/// \brief System call number of \c close_range (same on all architectures).
+# ifndef SYS_close_range
+#   define SYS_close_range 436
+# endif
+
+/// \def CLOSE_RANGE_CLOEXEC
+/// \brief Set close-on-exec flag instead of closing file descriptors.
+# ifndef CLOSE_RANGE_CLOEXEC
+#   define CLOSE_RANGE_CLOEXEC (1U << 2)
+# endif
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+namespace {
+
+
+/// \brief Directory listing open file descriptors of the calling process.
+static const char proc_self_fd[] = "/proc/self/fd";
+
+/// \brief Maximal number of file descriptors, in case there is no limit.
+static const rlim_t unlimited_filedescs_max = 1024;
+
+
+/// \brief Invoke \c close_range(2).
+/// \param first First file descriptor of the range.
+/// \param last Last file descriptor of the range (inclusive).
+/// \param flags Flags.
+/// \retval 0 Success.
+/// \retval -1 Failure, \c errno is set appropriately.
+/// \par Abrahams exception guarantee:
+/// no-throw
+static int close_range(unsigned int first, unsigned int last, unsigned int flags)
+{
+  return (::syscall(SYS_close_range, first, last, flags) == 0) ? 0 : -1;
+}
+
+
+} // anonymous namespace
+
+
+fd_sanitizer::fd_sanitizer()
+: excluded_()
+{
+}
+
+void fd_sanitizer::exclude(file_descriptor_type fd)
+{
+  SHERATAN_CHECK(fd >= 0);
+
+  std::vector<bool>::size_type index = static_cast<std::vector<bool>::size_type>(fd);
+  if(index >= this->excluded_.size()) {
+    this->excluded_.resize(index + 1, false);
+  }
+  this->excluded_[index] = true;
+}
+
+void fd_sanitizer::exclude_std_streams()
+{
+  this->exclude(STDIN_FILENO);
+  this->exclude(STDOUT_FILENO);
+  this->exclude(STDERR_FILENO);
+}
+
+bool fd_sanitizer::excluded(file_descriptor_type fd) const
+{
+  if(fd < 0) {
+    return false;
+  }
+  std::vector<bool>::size_type index = static_cast<std::vector<bool>::size_type>(fd);
+  return (index < this->excluded_.size()) && this->excluded_[index];
+}
+
+fd_sanitizer::method::value_type fd_sanitizer::sanitize(fd_sanitizer::mode::value_type sanitization_mode) const
+{
+  if(this->sanitize_close_range(sanitization_mode)) {
+    return fd_sanitizer::method::CLOSE_RANGE;
+  }
+  if(this->sanitize_proc_fd(sanitization_mode)) {
+    return fd_sanitizer::method::PROC_FD;
+  }
+  this->sanitize_brute_force(sanitization_mode);
+  return fd_sanitizer::method::BRUTE_FORCE;
+}
+
+bool fd_sanitizer::sanitize(fd_sanitizer::method::value_type sanitization_method, fd_sanitizer::mode::value_type sanitization_mode) const
+{
+  switch(sanitization_method) {
+    case fd_sanitizer::method::CLOSE_RANGE:
+      return this->sanitize_close_range(sanitization_mode);
+    case fd_sanitizer::method::PROC_FD:
+      return this->sanitize_proc_fd(sanitization_mode);
+    case fd_sanitizer::method::BRUTE_FORCE:
+      this->sanitize_brute_force(sanitization_mode);
+      return true;
+  }
+  SHERATAN_CHECK(false);
+  return false;
+}
+
+bool fd_sanitizer::sanitize_close_range(fd_sanitizer::mode::value_type sanitization_mode) const
+{
+  unsigned int flags = (sanitization_mode == fd_sanitizer::mode::CLOSE_ON_EXEC) ? CLOSE_RANGE_CLOEXEC : 0;
+  bool probed = false;
+
+  // sanitize gaps between excluded file descriptors, then everything above the last one
+  unsigned int first = 0;
+  std::vector<bool>::size_type count = this->excluded_.size();
+  for(std::vector<bool>::size_type index = 0; index <= count; ++index) {
+    if(index < count && !this->excluded_[index]) {
+      continue;
+    }
+    unsigned int last = (index < count) ? static_cast<unsigned int>(index) - 1 : ~0U;
+    if(index == count || static_cast<unsigned int>(index) > first) {
+      if(close_range(first, last, flags) != 0) {
+        int saved_errnum = errno;
+        // system call (or requested flag) is not supported, nothing has been touched yet
+        if(!probed && (saved_errnum == ENOSYS || saved_errnum == EINVAL || saved_errnum == EPERM)) {
+          return false;
+        }
+        throw_posix_error(saved_errnum);
+      }
+      probed = true;
+    }
+    first = static_cast<unsigned int>(index) + 1;
+  }
+
+  return true;
+}
+
+bool fd_sanitizer::sanitize_proc_fd(fd_sanitizer::mode::value_type sanitization_mode) const
+{
+  DIR *dir = ::opendir(proc_self_fd);
+  if(dir == NULL) {
+    return false;
+  }
+
+  // collect open file descriptors first, directory must not change while it is being read
+  std::vector<file_descriptor_type> fds;
+  file_descriptor_type dir_fd = ::dirfd(dir);
+  int saved_errnum = 0;
+  try {
+    for(;;) {
+      errno = 0;
+      struct dirent *entry = ::readdir(dir);
+      if(entry == NULL) {
+        saved_errnum = errno;
+        break;
+      }
+      char *end = NULL;
+      long fd = std::strtol(entry->d_name, &end, 10);
+      if(end == entry->d_name || *end != '\0' || fd < 0) {
+        // "." and ".."
+        continue;
+      }
+      if(fd == dir_fd || this->excluded(static_cast<file_descriptor_type>(fd))) {
+        continue;
+      }
+      fds.push_back(static_cast<file_descriptor_type>(fd));
+    }
+  } catch(...) {
+    ::closedir(dir);
+    throw;
+  }
+  ::closedir(dir);
+  if(saved_errnum != 0) {
+    throw_posix_error(saved_errnum);
+  }
+
+  // sanitize collected file descriptors
+  for(std::vector<file_descriptor_type>::const_iterator i = fds.begin(); i != fds.end(); ++i) {
+    fd_sanitizer::sanitize_fd(*i, sanitization_mode);
+  }
+
+  return true;
+}
+
+void fd_sanitizer::sanitize_brute_force(fd_sanitizer::mode::value_type sanitization_mode) const
+{
+  // get maximum number of file descriptors
+  struct rlimit filedescs_rlimit;
+  if(::getrlimit(RLIMIT_NOFILE, &filedescs_rlimit) != 0) {
+    throw_posix_error(errno);
+  }
+  if(filedescs_rlimit.rlim_max == RLIM_INFINITY) {
+    filedescs_rlimit.rlim_max = unlimited_filedescs_max;
+  }
+
+  // sanitize every single file descriptor, which is not excluded
+  file_descriptor_type filedescs_max = static_cast<file_descriptor_type>(filedescs_rlimit.rlim_max);
+  for(file_descriptor_type fd = 0; fd < filedescs_max; ++fd) {
+    if(this->excluded(fd)) {
+      continue;
+    }
+    fd_sanitizer::sanitize_fd(fd, sanitization_mode);
+  }
+}
+
+void fd_sanitizer::sanitize_fd(file_descriptor_type fd, fd_sanitizer::mode::value_type sanitization_mode)
+{
+  // file descriptor, which is not open, is fine
+  if(sanitization_mode == fd_sanitizer::mode::CLOSE_ON_EXEC) {
+    int flags = ::fcntl(fd, F_GETFD);
+    if(flags < 0 || ::fcntl(fd, F_SETFD, flags | FD_CLOEXEC) != 0) {
+      int saved_errnum = errno;
+      if(saved_errnum != EBADF) {
+        throw_posix_error(saved_errnum);
+      }
+    }
+  } else {
+    if(::close(fd) != 0) {
+      int saved_errnum = errno;
+      if(saved_errnum != EBADF) {
+        throw_posix_error(saved_errnum);
+      }
+    }
+  }
+}
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+// vim: set ts=2 sw=2 et:
@@ -5,6 +5,9 @@
 
 
 // fork(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/fork.html
+// vfork(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/vfork.html
+// clone(2): http://man7.org/linux/man-pages/man2/clone.2.html
+// posix_spawn(3): http://pubs.opengroup.org/onlinepubs/009695399/functions/posix_spawn.html
 
 
 #include <cerrno>
@@ -15,7 +18,9 @@
 #include "sheratan/errhdl/throw.hpp"
 #include "sheratan/process/posix/error_category.hpp"
 #include "sheratan/process/posix/forker.hpp"
+#include "sheratan/process/posix/exec_ctl.hpp"
 #include "sheratan/process/posix/process.hpp"
+#include "spawn_engine.hpp"
 
 
 namespace sheratan {
@@ -27,12 +32,19 @@ namespace posix {
 
 forker::forker()
 : fork_ctl_()
+, spawn_method_(spawn_method::FORK)
 {
 }
 
-forker::forker(const fork_ctl &fc)
-: fork_ctl_(fc.clone())
+forker::forker(const fork_ctl &fc, spawn_method::value_type method)
+: fork_ctl_()
+, spawn_method_(method)
 {
+  // child routine is not executed for spawn methods sharing address space
+  // with the parent, only new program image can be executed by them
+  SHERATAN_CHECK((method == spawn_method::FORK) || (dynamic_cast<const exec_ctl *>(&fc) != NULL));
+
+  this->fork_ctl_.reset(fc.clone());
 }
 
 const fork_ctl & forker::get_fork_ctl() const
@@ -49,12 +61,34 @@ fork_ctl & forker::get_fork_ctl()
   return *this->fork_ctl_;
 }
 
+spawn_method::value_type forker::get_spawn_method() const
+{
+  return this->spawn_method_;
+}
+
 void forker::fork(process &child_process)
 {
   SHERATAN_CHECK(this->fork_ctl_.get() != NULL);
 
   this->fork_ctl_->prefork();
 
+  // spawn methods sharing address space with the parent
+  if(this->spawn_method_ != spawn_method::FORK) {
+    const exec_ctl &ec = dynamic_cast<const exec_ctl &>(*this->fork_ctl_);
+    process_id::value_type pid = spawn_engine::spawn(this->spawn_method_, ec);
+    child_process.set_pid(process_id(pid));
+    this->fork_ctl_->postfork(child_process);
+    return;
+  }
+
+  if(forker::fork_process(child_process)) {
+    exit(this->fork_ctl_->child());
+  }
+  this->fork_ctl_->postfork(child_process);
+}
+
+bool forker::fork_process(process &child_process)
+{
   pid_t rc_fork = ::fork();
   if(rc_fork == -1) {  // error
     int saved_errno = errno;
@@ -62,17 +96,13 @@ void forker::fork(process &child_process)
     ex_to_throw << error_category::error_info::posix_errnum(saved_errno);
     SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
   }
-  else if(rc_fork == 0) { // child
-    exit(this->fork_ctl_->child());
-  }
-  else if(rc_fork > 0) { // parent
-    child_process.set_pid(process_id(static_cast<process_id::value_type>(rc_fork)));
-    this->fork_ctl_->postfork(child_process);
-    return;
+  if(rc_fork == 0) { // child
+    return true;
   }
 
-  // this point should never be reached
-  SHERATAN_REQUIRE(false);
+  // parent
+  child_process.set_pid(process_id(static_cast<process_id::value_type>(rc_fork)));
+  return false;
 }
 
 
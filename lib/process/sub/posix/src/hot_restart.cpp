@@ -0,0 +1,333 @@
+/// \file process/sub/posix/src/hot_restart.cpp
+/// \brief POSIX hot restart implementation.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+// socketpair(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/socketpair.html
+// sendmsg(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/sendmsg.html
+// recvmsg(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/recvmsg.html
+// unix(7): http://man7.org/linux/man-pages/man7/unix.7.html
+// poll(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/poll.html
+// close(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/close.html
+
+
+#include <cerrno>
+#include <cstring>
+
+#include <stdint.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+#include "sheratan/errhdl/assert.hpp"
+#include "sheratan/errhdl/throw.hpp"
+#include "sheratan/process/posix/error_category.hpp"
+#include "sheratan/process/posix/hot_restart.hpp"
+#include "posix_error.hpp"
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+namespace {
+
+
+/// \brief Hot restart protocol version.
+static const uint32_t protocol_version = 1;
+
+/// \brief Data reported by successor, once it is ready.
+static const char ready_data = 'R';
+
+/// \brief Handover message header.
+/// \ingroup sheratan_process_posix
+/// \nosubgrouping
+struct handover_header
+{
+  /// \brief Protocol version.
+  uint32_t version;
+
+  /// \brief Number of file descriptors carried by the message.
+  uint32_t fd_count;
+
+  /// \brief Size of opaque state following the header.
+  uint64_t state_size;
+};
+
+
+/// \brief Throw exception reporting failed handover.
+/// \par Abrahams exception guarantee:
+/// strong
+static void throw_handover_failed()
+{
+  SHERATAN_THROW_EXCEPTION(sheratan::errhdl::runtime_error(), sheratan::errhdl::error_code(errnum::HANDOVER_FAILED, get_error_category()));
+}
+
+/// \brief Send whole buffer.
+/// \param fd Socket.
+/// \param data Data.
+/// \param size Size of data.
+/// \par Abrahams exception guarantee:
+/// weak
+static void send_all(file_descriptor_type fd, const char *data, std::size_t size)
+{
+  while(size > 0) {
+    ssize_t rc_send = ::send(fd, data, size, MSG_NOSIGNAL);
+    if(rc_send < 0) {
+      if(errno == EINTR) {
+        continue;
+      }
+      throw_posix_error(errno);
+    }
+    data += rc_send;
+    size -= static_cast<std::size_t>(rc_send);
+  }
+}
+
+/// \brief Receive whole buffer.
+/// \param fd Socket.
+/// \param data Buffer.
+/// \param size Size of buffer.
+/// \par Abrahams exception guarantee:
+/// weak
+/// \note Premature end of stream is reported as failed handover.
+static void recv_all(file_descriptor_type fd, char *data, std::size_t size)
+{
+  while(size > 0) {
+    ssize_t rc_recv = ::recv(fd, data, size, 0);
+    if(rc_recv < 0) {
+      if(errno == EINTR) {
+        continue;
+      }
+      throw_posix_error(errno);
+    }
+    if(rc_recv == 0) {
+      throw_handover_failed();
+    }
+    data += rc_recv;
+    size -= static_cast<std::size_t>(rc_recv);
+  }
+}
+
+
+} // anonymous namespace
+
+
+const std::size_t hot_restart::MAX_FDS = 253;
+
+
+hot_restart::hot_restart()
+: fd_(-1)
+, successor_fd_(-1)
+, predecessor_(true)
+{
+  int sv[2];
+  if(::socketpair(AF_UNIX, SOCK_STREAM|SOCK_CLOEXEC, 0, sv) != 0) {
+    throw_posix_error(errno);
+  }
+  this->fd_ = sv[0];
+  this->successor_fd_ = sv[1];
+}
+
+hot_restart::hot_restart(file_descriptor_type fd)
+: fd_(fd)
+, successor_fd_(-1)
+, predecessor_(false)
+{
+  SHERATAN_CHECK(fd >= 0);
+}
+
+hot_restart::~hot_restart()
+{
+  if(this->successor_fd_ >= 0) {
+    ::close(this->successor_fd_);
+  }
+  if(this->fd_ >= 0) {
+    ::close(this->fd_);
+  }
+}
+
+file_descriptor_type hot_restart::native_handle() const
+{
+  return this->fd_;
+}
+
+file_descriptor_type hot_restart::get_successor_fd() const
+{
+  return this->successor_fd_;
+}
+
+void hot_restart::handover(const hot_restart::fd_list_type &fds, const hot_restart::state_type &state)
+{
+  SHERATAN_CHECK(this->predecessor_);
+  SHERATAN_CHECK(fds.size() <= hot_restart::MAX_FDS);
+
+  // successor has inherited its end already, closing it here lets us notice the successor is gone
+  if(this->successor_fd_ >= 0) {
+    ::close(this->successor_fd_);
+    this->successor_fd_ = -1;
+  }
+
+  // header carries the file descriptors
+  handover_header header;
+  std::memset(&header, 0, sizeof(header));
+  header.version = protocol_version;
+  header.fd_count = static_cast<uint32_t>(fds.size());
+  header.state_size = static_cast<uint64_t>(state.size());
+  struct iovec iov;
+  iov.iov_base = &header;
+  iov.iov_len = sizeof(header);
+  std::vector<char> control(CMSG_SPACE(sizeof(file_descriptor_type) * hot_restart::MAX_FDS), 0);
+  struct msghdr msg;
+  std::memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  if(!fds.empty()) {
+    msg.msg_control = &control[0];
+    msg.msg_controllen = CMSG_SPACE(sizeof(file_descriptor_type) * fds.size());
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(file_descriptor_type) * fds.size());
+    std::memcpy(CMSG_DATA(cmsg), &fds[0], sizeof(file_descriptor_type) * fds.size());
+  }
+  ssize_t rc_sendmsg;
+  do {
+    rc_sendmsg = ::sendmsg(this->fd_, &msg, MSG_NOSIGNAL);
+  } while(rc_sendmsg < 0 && errno == EINTR);
+  if(rc_sendmsg < 0) {
+    throw_posix_error(errno);
+  }
+
+  // rest of the header (stream socket may have sent it partially) and the state follow
+  send_all(this->fd_, reinterpret_cast<const char *>(&header) + rc_sendmsg, sizeof(header) - static_cast<std::size_t>(rc_sendmsg));
+  send_all(this->fd_, state.data(), state.size());
+}
+
+bool hot_restart::wait_ready(const system_time_type &time)
+{
+  SHERATAN_CHECK(this->predecessor_);
+  SHERATAN_CHECK(this->successor_fd_ < 0);
+
+  for(;;) {
+    // compute remaining time, rounded up to milliseconds
+    system_duration_type remaining = time - boost::posix_time::microsec_clock::universal_time();
+    int timeout = 0;
+    if(!remaining.is_negative()) {
+      timeout = static_cast<int>((remaining.total_microseconds() + 999) / 1000);
+    }
+
+    struct pollfd pfd;
+    pfd.fd = this->fd_;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    int rc_poll = ::poll(&pfd, 1, timeout);
+    if(rc_poll < 0) {
+      if(errno == EINTR) {
+        continue;
+      }
+      throw_posix_error(errno);
+    }
+    if(rc_poll == 0) {
+      return false;
+    }
+
+    char data = 0;
+    ssize_t rc_recv = ::recv(this->fd_, &data, 1, 0);
+    if(rc_recv < 0) {
+      if(errno == EINTR) {
+        continue;
+      }
+      throw_posix_error(errno);
+    }
+    if(rc_recv == 0 || data != ready_data) {
+      throw_handover_failed();
+    }
+    return true;
+  }
+}
+
+void hot_restart::take_over(hot_restart::fd_list_type &fds, hot_restart::state_type &state)
+{
+  SHERATAN_CHECK(!this->predecessor_);
+
+  // receive header along with the file descriptors
+  handover_header header;
+  std::memset(&header, 0, sizeof(header));
+  struct iovec iov;
+  iov.iov_base = &header;
+  iov.iov_len = sizeof(header);
+  std::vector<char> control(CMSG_SPACE(sizeof(file_descriptor_type) * hot_restart::MAX_FDS), 0);
+  struct msghdr msg;
+  std::memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = &control[0];
+  msg.msg_controllen = control.size();
+  ssize_t rc_recvmsg;
+  do {
+    rc_recvmsg = ::recvmsg(this->fd_, &msg, MSG_CMSG_CLOEXEC);
+  } while(rc_recvmsg < 0 && errno == EINTR);
+  if(rc_recvmsg < 0) {
+    throw_posix_error(errno);
+  }
+  if(rc_recvmsg == 0) {
+    throw_handover_failed();
+  }
+
+  // collect received file descriptors (closed again, if handover fails)
+  fd_list_type received_fds;
+  for(struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+    if(cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+      continue;
+    }
+    std::size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(file_descriptor_type);
+    for(std::size_t i = 0; i < count; ++i) {
+      file_descriptor_type fd;
+      std::memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(file_descriptor_type), sizeof(fd));
+      received_fds.push_back(fd);
+    }
+  }
+  try {
+    recv_all(this->fd_, reinterpret_cast<char *>(&header) + rc_recvmsg, sizeof(header) - static_cast<std::size_t>(rc_recvmsg));
+    if((msg.msg_flags & MSG_CTRUNC) != 0 || header.version != protocol_version || header.fd_count != received_fds.size()) {
+      throw_handover_failed();
+    }
+    state_type received_state(static_cast<std::size_t>(header.state_size), '\0');
+    if(!received_state.empty()) {
+      recv_all(this->fd_, &received_state[0], received_state.size());
+    }
+    state.swap(received_state);
+  }
+  catch(...) {
+    for(fd_list_type::const_iterator i = received_fds.begin(); i != received_fds.end(); ++i) {
+      ::close(*i);
+    }
+    throw;
+  }
+  fds.swap(received_fds);
+}
+
+void hot_restart::report_ready()
+{
+  SHERATAN_CHECK(!this->predecessor_);
+
+  send_all(this->fd_, &ready_data, 1);
+}
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+// vim: set ts=2 sw=2 et:
@@ -5,18 +5,29 @@
 
 
 // pipe(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/pipe.html
+// setvbuf(3): http://pubs.opengroup.org/onlinepubs/009695399/functions/setvbuf.html
+// eventfd(2): http://man7.org/linux/man-pages/man2/eventfd.2.html
+// futex(2): http://man7.org/linux/man-pages/man2/futex.2.html
+// mmap(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/mmap.html
+// munmap(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/munmap.html
 
 
 #include <cerrno>
 #include <cstdlib>
 #include <cstdio>
 
+#include <stdint.h>
 #include <unistd.h>
+#include <linux/futex.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
 
 #include "sheratan/errhdl/assert.hpp"
 #include "sheratan/errhdl/throw.hpp"
 #include "sheratan/process/posix/error_category.hpp"
 #include "sheratan/process/posix/parent_child_sync.hpp"
+#include "posix_error.hpp"
 
 
 namespace sheratan {
@@ -26,16 +37,106 @@ namespace process_impl {
 namespace posix {
 
 
-parent_child_sync::parent_child_sync()
-: sync_pipe_r_(NULL)
+/// \brief Futex semaphore in shared memory page.
+/// \note Unblocking side increments the counter and wakes the other side
+/// only in case it is already waiting (or just about to wait) on the futex.
+struct parent_child_sync::futex_semaphore
+{
+  /// \brief Number of unblocks not yet consumed by waits (futex word).
+  int count;
+
+  /// \brief Number of processes waiting on the futex.
+  int waiters;
+};
+
+
+namespace {
+
+
+/// \brief Invoke futex operation.
+/// \param word Futex word (shared between processes, hence non-private futex).
+/// \param op Futex operation (\c FUTEX_WAIT or \c FUTEX_WAKE).
+/// \param val Expected value of the futex word (\c FUTEX_WAIT), or number of waiters to be woken up (\c FUTEX_WAKE).
+/// \return Return value of the system call.
+/// \par Abrahams exception guarantee:
+/// no-throw
+static long futex(int *word, int op, int val)
+{
+  return ::syscall(SYS_futex, word, op, val, NULL, NULL, 0);
+}
+
+
+} // anonymous namespace
+
+
+parent_child_sync::parent_child_sync(parent_child_sync_backend::value_type backend)
+: backend_(backend)
+, sync_pipe_r_(NULL)
 , sync_pipe_w_(NULL)
+, sync_eventfd_(-1)
+, sync_futex_(NULL)
+{
+}
+
+parent_child_sync::~parent_child_sync()
 {
+  this->close_sync_pipe();
+  this->close_sync_eventfd();
+  this->close_sync_futex();
+}
+
+bool parent_child_sync::supports(parent_child_sync_backend::value_type backend)
+{
+  switch(backend) {
+    case parent_child_sync_backend::EVENTFD: {
+      file_descriptor_type fd = ::eventfd(0, EFD_CLOEXEC);
+      if(fd == -1) {
+        return false;
+      }
+      ::close(fd);
+      return true;
+    }
+    case parent_child_sync_backend::FUTEX: {
+      int word = 0;
+      return (futex(&word, FUTEX_WAKE, 1) >= 0);
+    }
+    default:
+      return true;
+  }
+}
+
+parent_child_sync_backend::value_type parent_child_sync::get_backend() const
+{
+  return this->backend_;
 }
 
 void parent_child_sync::prefork()
 {
-  // create parent-child synchronization pipe
-  this->create_sync_pipe();
+  // create parent-child synchronization resources
+  switch(this->backend_) {
+    case parent_child_sync_backend::AUTO:
+      try {
+        this->create_sync_eventfd();
+        this->backend_ = parent_child_sync_backend::EVENTFD;
+      }
+      catch(const sheratan::errhdl::runtime_error &) {
+        // eventfd not available, fall back to pipe
+        this->create_sync_pipe();
+        this->backend_ = parent_child_sync_backend::PIPE;
+      }
+      break;
+    case parent_child_sync_backend::PIPE:
+      this->create_sync_pipe();
+      break;
+    case parent_child_sync_backend::EVENTFD:
+      this->create_sync_eventfd();
+      break;
+    case parent_child_sync_backend::FUTEX:
+      this->create_sync_futex();
+      break;
+    default:
+      SHERATAN_CHECK(false && "unknown parent-child synchronizer backend");
+  }
 }
 
 void parent_child_sync::postfork(process &)
@@ -53,26 +154,67 @@ exit_status::value_type parent_child_sync::child()
 void parent_child_sync::finalize()
 {
   this->close_sync_pipe();
+  this->close_sync_eventfd();
+  this->close_sync_futex();
 }
 
 void parent_child_sync::wait_for_parent()
 {
-  this->wait_sync_pipe();
+  this->wait_sync();
 }
 
 void parent_child_sync::unblock_child()
 {
-  this->unblock_sync_pipe();
+  this->unblock_sync();
 }
 
 void parent_child_sync::wait_for_child()
 {
-  this->wait_sync_pipe();
+  this->wait_sync();
 }
 
 void parent_child_sync::unblock_parent()
 {
-  this->unblock_sync_pipe();
+  this->unblock_sync();
+}
+
+file_descriptor_type parent_child_sync::native_handle() const
+{
+  if(this->sync_eventfd_ != -1) {
+    return this->sync_eventfd_;
+  }
+  if(this->sync_pipe_r_ == NULL) {
+    return -1;
+  }
+  return ::fileno(this->sync_pipe_r_);
+}
+
+void parent_child_sync::wait_sync()
+{
+  switch(this->backend_) {
+    case parent_child_sync_backend::EVENTFD:
+      this->wait_sync_eventfd();
+      break;
+    case parent_child_sync_backend::FUTEX:
+      this->wait_sync_futex();
+      break;
+    default:
+      this->wait_sync_pipe();
+  }
+}
+
+void parent_child_sync::unblock_sync()
+{
+  switch(this->backend_) {
+    case parent_child_sync_backend::EVENTFD:
+      this->unblock_sync_eventfd();
+      break;
+    case parent_child_sync_backend::FUTEX:
+      this->unblock_sync_futex();
+      break;
+    default:
+      this->unblock_sync_pipe();
+  }
 }
 
 void parent_child_sync::create_sync_pipe()
@@ -99,6 +241,11 @@ void parent_child_sync::create_sync_pipe()
     goto error;
   }
 
+  // synchronization data must neither linger in write buffer, nor be read ahead into read buffer
+  // (readiness of the read end would not reflect data available to the reader otherwise)
+  std::setvbuf(this->sync_pipe_r_, NULL, _IONBF, 0);
+  std::setvbuf(this->sync_pipe_w_, NULL, _IONBF, 0);
+
   // successful return
   return;
 
@@ -168,6 +315,112 @@ void parent_child_sync::unblock_sync_pipe()
   }
 }
 
+void parent_child_sync::create_sync_eventfd()
+{
+  SHERATAN_CHECK(this->sync_eventfd_ == -1);
+
+  // semaphore mode: each read consumes exactly one unblock
+  this->sync_eventfd_ = ::eventfd(0, EFD_CLOEXEC|EFD_SEMAPHORE);
+  if(this->sync_eventfd_ == -1) {
+    throw_posix_error(errno);
+  }
+}
+
+void parent_child_sync::close_sync_eventfd()
+{
+  if(this->sync_eventfd_ != -1) {
+    ::close(this->sync_eventfd_);
+    this->sync_eventfd_ = -1;
+  }
+}
+
+void parent_child_sync::wait_sync_eventfd()
+{
+  SHERATAN_CHECK(this->sync_eventfd_ != -1);
+
+  uint64_t value;
+  ssize_t rc_read;
+  do {
+    rc_read = ::read(this->sync_eventfd_, &value, sizeof(value));
+  } while((rc_read < 0) && (errno == EINTR));
+  if(rc_read != static_cast<ssize_t>(sizeof(value))) {
+    throw_posix_error((rc_read < 0) ? errno : EIO);
+  }
+}
+
+void parent_child_sync::unblock_sync_eventfd()
+{
+  SHERATAN_CHECK(this->sync_eventfd_ != -1);
+
+  uint64_t value = 1;
+  ssize_t rc_write;
+  do {
+    rc_write = ::write(this->sync_eventfd_, &value, sizeof(value));
+  } while((rc_write < 0) && (errno == EINTR));
+  if(rc_write != static_cast<ssize_t>(sizeof(value))) {
+    throw_posix_error((rc_write < 0) ? errno : EIO);
+  }
+}
+
+void parent_child_sync::create_sync_futex()
+{
+  SHERATAN_CHECK(this->sync_futex_ == NULL);
+
+  // shared anonymous mapping is inherited by the child (and zero-filled)
+  void *page = ::mmap(NULL, sizeof(futex_semaphore), PROT_READ|PROT_WRITE, MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+  if(page == MAP_FAILED) {
+    throw_posix_error(errno);
+  }
+  this->sync_futex_ = static_cast<futex_semaphore *>(page);
+}
+
+void parent_child_sync::close_sync_futex()
+{
+  if(this->sync_futex_ != NULL) {
+    ::munmap(this->sync_futex_, sizeof(futex_semaphore));
+    this->sync_futex_ = NULL;
+  }
+}
+
+void parent_child_sync::wait_sync_futex()
+{
+  SHERATAN_CHECK(this->sync_futex_ != NULL);
+
+  int *count = &this->sync_futex_->count;
+  int *waiters = &this->sync_futex_->waiters;
+  for(;;) {
+    // consume pending unblock, if there is any
+    int value = __atomic_load_n(count, __ATOMIC_ACQUIRE);
+    while(value > 0) {
+      if(__atomic_compare_exchange_n(count, &value, value - 1, false, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+        return;
+      }
+    }
+
+    // announce waiter before sleeping, kernel rechecks the counter is still zero
+    __atomic_fetch_add(waiters, 1, __ATOMIC_SEQ_CST);
+    long rc_futex = futex(count, FUTEX_WAIT, 0);
+    int saved_errnum = errno;
+    __atomic_fetch_sub(waiters, 1, __ATOMIC_SEQ_CST);
+    if((rc_futex != 0) && (saved_errnum != EAGAIN) && (saved_errnum != EINTR)) {
+      throw_posix_error(saved_errnum);
+    }
+  }
+}
+
+void parent_child_sync::unblock_sync_futex()
+{
+  SHERATAN_CHECK(this->sync_futex_ != NULL);
+
+  __atomic_fetch_add(&this->sync_futex_->count, 1, __ATOMIC_SEQ_CST);
+  // no system call at all, unless the other side waits
+  if(__atomic_load_n(&this->sync_futex_->waiters, __ATOMIC_SEQ_CST) != 0) {
+    if(futex(&this->sync_futex_->count, FUTEX_WAKE, 1) < 0) {
+      throw_posix_error(errno);
+    }
+  }
+}
+
 
 } // namespace posix
 
@@ -0,0 +1,141 @@
+/// \file process/sub/posix/src/pidfd.cpp
+/// \brief POSIX process file descriptor implementation.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+// pidfd_open(2): http://man7.org/linux/man-pages/man2/pidfd_open.2.html
+// pidfd_send_signal(2): http://man7.org/linux/man-pages/man2/pidfd_send_signal.2.html
+// waitid(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/waitid.html
+// waitid(2) (Linux): http://man7.org/linux/man-pages/man2/waitid.2.html
+// close(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/close.html
+
+
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+#include <signal.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "pidfd.hpp"
+
+
+/// \def SYS_pidfd_open
+/// \brief System call number of \c pidfd_open (same on all architectures).
+# ifndef SYS_pidfd_open
+#   define SYS_pidfd_open 434
+# endif
+
+/// \def SYS_pidfd_send_signal
+/// \brief System call number of \c pidfd_send_signal (same on all architectures).
+# ifndef SYS_pidfd_send_signal
+#   define SYS_pidfd_send_signal 424
+# endif
+
+/// \def P_PIDFD
+/// \brief Wait for child referred to by process file descriptor.
+# ifndef P_PIDFD
+#   define P_PIDFD 3
+# endif
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+const file_descriptor_type pidfd::INVALID = -1;
+
+
+file_descriptor_type pidfd::open(process_id::value_type pid)
+{
+  long rc_pidfd_open = ::syscall(SYS_pidfd_open, pid, 0);
+  if(rc_pidfd_open < 0) {
+    return pidfd::INVALID;
+  }
+  return static_cast<file_descriptor_type>(rc_pidfd_open);
+}
+
+void pidfd::close(file_descriptor_type fd)
+{
+  if(fd == pidfd::INVALID) {
+    return;
+  }
+
+  // close(2) must not be retried on EINTR on Linux, descriptor is released anyway
+  int saved_errnum = errno;
+  ::close(fd);
+  errno = saved_errnum;
+}
+
+int pidfd::send_signal(file_descriptor_type fd, signal_number_type signal)
+{
+  long rc_send_signal = ::syscall(SYS_pidfd_send_signal, fd, signal, NULL, 0);
+  return (rc_send_signal == 0) ? 0 : -1;
+}
+
+process_id::value_type pidfd::wait(file_descriptor_type fd, int options, int &status, struct rusage *usage)
+{
+  // waitid reports only selected state changes, there is no implicit WEXITED as in waitpid
+  siginfo_t info;
+  std::memset(&info, 0, sizeof(info));
+  int rc_waitid;
+  do {
+    rc_waitid = pidfd::waitid(P_PIDFD, static_cast<id_t>(fd), info, WEXITED | options, usage);
+  } while((rc_waitid == -1) && (errno == EINTR));
+  if(rc_waitid != 0) {
+    return -1;
+  }
+
+  // non-blocking call without state change leaves si_pid zeroed
+  if(info.si_pid == 0) {
+    return 0;
+  }
+
+  status = pidfd::wait_status(info);
+  return info.si_pid;
+}
+
+int pidfd::waitid(int idtype, id_t id, siginfo_t &info, int options, struct rusage *usage)
+{
+  if(usage == NULL) {
+    return ::waitid(static_cast<idtype_t>(idtype), id, &info, options);
+  }
+
+  // glibc wrapper does not expose resource usage reported by the system call
+  return static_cast<int>(::syscall(SYS_waitid, idtype, id, &info, options, usage));
+}
+
+int pidfd::wait_status(const siginfo_t &info)
+{
+  // encoding used by waitpid (and decoded by W* macros)
+  switch(info.si_code) {
+    case CLD_EXITED:
+      return (info.si_status & 0xff) << 8;
+    case CLD_KILLED:
+      return info.si_status & 0x7f;
+    case CLD_DUMPED:
+      return (info.si_status & 0x7f) | 0x80;
+    case CLD_STOPPED:
+    case CLD_TRAPPED:
+      return ((info.si_status & 0xff) << 8) | 0x7f;
+    case CLD_CONTINUED:
+      return 0xffff;
+  }
+  return 0;
+}
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+// vim: set ts=2 sw=2 et:
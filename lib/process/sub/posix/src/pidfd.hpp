@@ -0,0 +1,126 @@
+/// \file process/sub/posix/src/pidfd.hpp
+/// \brief POSIX process file descriptor interface.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#ifndef HGI_SHERATAN_PROCESS_POSIX_PIDFD_HPP
+#define HGI_SHERATAN_PROCESS_POSIX_PIDFD_HPP
+
+
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/resource.h>
+
+#include <boost/noncopyable.hpp>
+
+#include "sheratan/process/posix/types.hpp"
+#include "sheratan/process/posix/process_id.hpp"
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+/// \brief Process file descriptor operations.
+/// \ingroup sheratan_process_posix
+/// \nosubgrouping
+/// \note Process file descriptor refers to particular process rather
+/// than to its PID, therefore operations on it are not prone to PID reuse
+/// races. In addition, it becomes readable when the process terminates,
+/// so it can be multiplexed by \c poll, \c select or \c epoll.
+/// \note Process file descriptors are available since Linux 5.3. On
+/// older kernels, all methods fail with \c errno set to \c ENOSYS.
+class pidfd : private boost::noncopyable
+{
+  private:
+
+    /// \brief Restricted default constructor.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    pidfd();
+
+  public:
+
+    /// \brief Invalid process file descriptor.
+    static const file_descriptor_type INVALID;
+
+  public:
+
+    /// \brief Open process file descriptor.
+    /// \param pid Process ID.
+    /// \return Process file descriptor (with close-on-exec flag set),
+    /// or \c pidfd::INVALID in case of an error (\c errno is set).
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \note Process file descriptor of a child process, which was
+    /// not yet waited for, is guaranteed to refer to that child.
+    static file_descriptor_type open(process_id::value_type pid);
+
+    /// \brief Close process file descriptor.
+    /// \param fd Process file descriptor.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \note Closing \c pidfd::INVALID has no effect.
+    static void close(file_descriptor_type fd);
+
+    /// \brief Send signal to process.
+    /// \param fd Process file descriptor.
+    /// \param signal Signal number.
+    /// \retval 0 Success.
+    /// \retval -1 Failure (\c errno is set).
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    static int send_signal(file_descriptor_type fd, signal_number_type signal);
+
+    /// \brief Wait for state change of child process.
+    /// \param fd Process file descriptor.
+    /// \param options Combination of \c waitpid options (\c WNOHANG, \c WUNTRACED,
+    /// \c WCONTINUED and \c WNOWAIT).
+    /// \param status Status of the process in \c waitpid format.
+    /// \param usage Resource usage of the child (filled in only if not \c NULL).
+    /// \return Process ID of the child, \c 0 in case of non-blocking call and
+    /// no state change, or \c -1 in case of an error (\c errno is set).
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \note Semantics of this method follows \c waitpid (or \c wait4, in case
+    /// resource usage is requested).
+    static process_id::value_type wait(file_descriptor_type fd, int options, int &status, struct rusage *usage = NULL);
+
+    /// \brief Wait for state change of child process, report its resource usage.
+    /// \param idtype Type of \p id (\c P_PID, \c P_PGID, \c P_ALL or \c P_PIDFD).
+    /// \param id Identifier of child process(es) to wait for.
+    /// \param info Signal information.
+    /// \param options Combination of \c waitid options.
+    /// \param usage Resource usage of the child (filled in only if not \c NULL).
+    /// \retval 0 Success.
+    /// \retval -1 Failure (\c errno is set).
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    /// \note Semantics of this method follows \c waitid, Linux system call
+    /// is invoked directly in case resource usage is requested.
+    static int waitid(int idtype, id_t id, siginfo_t &info, int options, struct rusage *usage);
+
+    /// \brief Convert status reported by \c waitid into \c waitpid format.
+    /// \param info Signal information filled in by \c waitid.
+    /// \return Status in \c waitpid format.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    static int wait_status(const siginfo_t &info);
+};
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+#endif // HGI_SHERATAN_PROCESS_POSIX_PIDFD_HPP
+
+
+// vim: set ts=2 sw=2 et:
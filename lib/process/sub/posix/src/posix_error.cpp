@@ -0,0 +1,48 @@
+/// \file process/sub/posix/src/posix_error.cpp
+/// \brief POSIX system call error handling implementation.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+// close(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/close.html
+
+
+#include <cerrno>
+
+#include <unistd.h>
+
+#include "sheratan/errhdl/throw.hpp"
+#include "sheratan/process/posix/error_category.hpp"
+#include "posix_error.hpp"
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+void throw_posix_error(int errnum)
+{
+  sheratan::errhdl::runtime_error ex_to_throw;
+  ex_to_throw << error_category::error_info::posix_errnum(errnum);
+  SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
+}
+
+void close_fd(file_descriptor_type fd)
+{
+  int saved_errnum = errno;
+  ::close(fd);
+  errno = saved_errnum;
+}
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+// vim: set ts=2 sw=2 et:
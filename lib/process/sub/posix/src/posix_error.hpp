@@ -0,0 +1,49 @@
+/// \file process/sub/posix/src/posix_error.hpp
+/// \brief POSIX system call error handling interface.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#ifndef HGI_SHERATAN_PROCESS_POSIX_POSIX_ERROR_HPP
+#define HGI_SHERATAN_PROCESS_POSIX_POSIX_ERROR_HPP
+
+
+#include "sheratan/process/posix/types.hpp"
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+/// \brief Throw exception carrying \c errno.
+/// \param errnum Error number.
+/// \par Abrahams exception guarantee:
+/// strong
+/// \note Exception is \c sheratan::errhdl::runtime_error with
+/// \c errnum::POSIX_SYSTEM error code, carrying \p errnum as
+/// \c error_category::error_info::posix_errnum.
+void throw_posix_error(int errnum);
+
+/// \brief Close file descriptor preserving \c errno.
+/// \param fd File descriptor.
+/// \par Abrahams exception guarantee:
+/// no-throw
+/// \note Intended for cleanup on error paths, before \c errno of the
+/// failed call is reported.
+void close_fd(file_descriptor_type fd);
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+#endif // HGI_SHERATAN_PROCESS_POSIX_POSIX_ERROR_HPP
+
+
+// vim: set ts=2 sw=2 et:
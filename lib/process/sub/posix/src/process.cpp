@@ -5,18 +5,30 @@
 
 
 // waitpid(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/wait.html
+// wait4(2): http://man7.org/linux/man-pages/man2/wait4.2.html
 // kill(2): http://pubs.opengroup.org/onlinepubs/009604599/functions/kill.html
+// pidfd_open(2): http://man7.org/linux/man-pages/man2/pidfd_open.2.html
+// pidfd_send_signal(2): http://man7.org/linux/man-pages/man2/pidfd_send_signal.2.html
+// ppoll(2): http://man7.org/linux/man-pages/man2/ppoll.2.html
+// nanosleep(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/nanosleep.html
 
 
 #include <cerrno>
+#include <algorithm>
 
 #include <sys/wait.h>
+#include <sys/resource.h>
 #include <signal.h>
+#include <poll.h>
+#include <time.h>
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
 
 #include "sheratan/errhdl/assert.hpp"
 #include "sheratan/errhdl/throw.hpp"
 #include "sheratan/process/posix/error_category.hpp"
 #include "sheratan/process/posix/process.hpp"
+#include "pidfd.hpp"
 
 
 namespace sheratan {
@@ -26,6 +38,39 @@ namespace process_impl {
 namespace posix {
 
 
+namespace {
+
+
+/// \brief Initial interval of process status polling (used without process file descriptor).
+static const long timed_join_poll_min_us = 1000;
+
+/// \brief Maximal interval of process status polling (used without process file descriptor).
+static const long timed_join_poll_max_us = 50000;
+
+
+/// \brief Convert time duration into \c timespec structure.
+/// \param duration Non-negative time duration.
+/// \return Time duration as \c timespec structure.
+/// \par Abrahams exception guarantee:
+/// no-throw
+static struct timespec to_timespec(const boost::posix_time::time_duration &duration)
+{
+  struct timespec ts;
+  ts.tv_sec = static_cast<time_t>(duration.total_seconds());
+  ts.tv_nsec = static_cast<long>(duration.total_microseconds() % 1000000) * 1000;
+  return ts;
+}
+
+
+} // anonymous namespace
+
+
+process::process()
+: pid_()
+, pidfd_(pidfd::INVALID)
+{
+}
+
 process::~process()
 {
   // this may throw an exception, which means undefined behavior,
@@ -38,7 +83,21 @@ process::~process()
 
 void process::set_pid(process_id pid)
 {
+  this->reset();
   this->pid_ = process_id(pid);
+
+  // child process was not waited for yet, so its PID cannot be reused in the meantime
+  // and opened descriptor is guaranteed to refer to it (if it fails, fall back to PID)
+  this->pidfd_ = pidfd::open(this->pid_.get_value());
+}
+
+exit_status process::set_status(int status)
+{
+  exit_status ret(status);
+  if((!ret.stopped()) && (!ret.continued())) {
+    this->reset();
+  }
+  return ret;
 }
 
 process_id process::get_pid() const
@@ -46,6 +105,11 @@ process_id process::get_pid() const
   return this->pid_;
 }
 
+file_descriptor_type process::native_handle() const
+{
+  return this->pidfd_;
+}
+
 bool process::valid() const
 {
   if(this->pid_ == process_id()) {
@@ -56,15 +120,40 @@ bool process::valid() const
 
 void process::detach()
 {
-  this->pid_ = process_id();
+  this->reset();
 }
 
 exit_status process::join(bool nonblocking, bool stopped, bool continued)
+{
+  return this->wait(nonblocking, stopped, continued, NULL);
+}
+
+exit_status process::join(resource_usage &usage, bool nonblocking, bool stopped, bool continued)
+{
+  struct rusage ru;
+  exit_status ret = this->wait(nonblocking, stopped, continued, &ru);
+  if(ret.valid()) {
+    usage = resource_usage(ru);
+  }
+  return ret;
+}
+
+exit_status process::wait(bool nonblocking, bool stopped, bool continued, struct rusage *usage)
 {
   SHERATAN_CHECK(this->valid());
 
   int status;
-  pid_t rc_waitpid = ::waitpid(this->pid_.get_value(), &status, 0 | (nonblocking ? WNOHANG : 0) | (stopped ? WUNTRACED : 0) | (continued ? WCONTINUED : 0));
+  int options = 0 | (nonblocking ? WNOHANG : 0) | (stopped ? WUNTRACED : 0) | (continued ? WCONTINUED : 0);
+  pid_t rc_waitpid;
+  if(this->pidfd_ != pidfd::INVALID) {
+    rc_waitpid = pidfd::wait(this->pidfd_, options, status, usage);
+  }
+  else if(usage != NULL) {
+    rc_waitpid = ::wait4(this->pid_.get_value(), &status, options, usage);
+  }
+  else {
+    rc_waitpid = ::waitpid(this->pid_.get_value(), &status, options);
+  }
   if(nonblocking && (rc_waitpid == 0)) {
     // return invalid (defalut constructed exit status is invalid by definition) exit status
     // in case it was non-blocking call to waitpid and child has not changed its status
@@ -83,28 +172,71 @@ exit_status process::join(bool nonblocking, bool stopped, bool continued)
   // for already finished (i.e. zombie) process - it is not the case,
   // if the process just stopped or continued after job control stop
   if((!ret.stopped()) && (!ret.continued())) {
-    this->pid_ = process_id();
+    this->reset();
   }
 
   return exit_status(status);
 }
 
-#if 0 // NOT IMPLEMENTED
 exit_status process::timed_join(const system_time_type &time)
 {
   SHERATAN_CHECK(this->valid());
+  SHERATAN_CHECK(!time.is_not_a_date_time());
+
+  if(time.is_pos_infinity()) {
+    return this->join();
+  }
 
-  /// \todo Implement this method.
-  return exit_status();
+  long poll_interval_us = timed_join_poll_min_us;
+  for(;;) {
+    // check whether the process has already completed
+    exit_status ret = this->join(true);
+    if(ret.valid()) {
+      return ret;
+    }
+
+    // check whether the deadline has already expired
+    boost::posix_time::time_duration remaining = time - boost::posix_time::microsec_clock::universal_time();
+    if(remaining.is_negative() || (remaining.ticks() == 0)) {
+      return exit_status();
+    }
+
+    if(this->pidfd_ != pidfd::INVALID) {
+      // process file descriptor becomes readable when the process terminates
+      struct pollfd pfd;
+      pfd.fd = this->pidfd_;
+      pfd.events = POLLIN;
+      pfd.revents = 0;
+      struct timespec timeout = to_timespec(remaining);
+      int rc_ppoll = ::ppoll(&pfd, 1, &timeout, NULL);
+      if((rc_ppoll == -1) && (errno != EINTR)) {
+        int saved_errnum = errno;
+        sheratan::errhdl::runtime_error ex_to_throw;
+        ex_to_throw << error_category::error_info::posix_errnum(saved_errnum);
+        SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
+      }
+    }
+    else {
+      // no way how to block on process termination with a deadline, poll its status
+      struct timespec timeout = to_timespec(std::min<boost::posix_time::time_duration>(remaining, boost::posix_time::microseconds(poll_interval_us)));
+      ::nanosleep(&timeout, NULL);
+      poll_interval_us = std::min(poll_interval_us * 2, timed_join_poll_max_us);
+    }
+  }
 }
-#endif // NOT IMPLEMENTED
 
 void process::kill(signal_number_type signal)
 {
   SHERATAN_CHECK(this->valid());
 
-  // this is *NOT* recursive call - syscall kill(2) is called
-  int rc_kill = ::kill(this->pid_.get_value(), signal);
+  int rc_kill;
+  if(this->pidfd_ != pidfd::INVALID) {
+    rc_kill = pidfd::send_signal(this->pidfd_, signal);
+  }
+  else {
+    // this is *NOT* recursive call - syscall kill(2) is called
+    rc_kill = ::kill(this->pid_.get_value(), signal);
+  }
   if(rc_kill != 0) {
     int saved_errnum = errno;
     sheratan::errhdl::runtime_error ex_to_throw;
@@ -113,6 +245,13 @@ void process::kill(signal_number_type signal)
   }
 }
 
+void process::reset()
+{
+  pidfd::close(this->pidfd_);
+  this->pidfd_ = pidfd::INVALID;
+  this->pid_ = process_id();
+}
+
 
 } // namespace posix
 
@@ -0,0 +1,292 @@
+/// \file process/sub/posix/src/process_barrier.cpp
+/// \brief POSIX process barrier implementation.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+// futex(2): http://man7.org/linux/man-pages/man2/futex.2.html
+// mmap(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/mmap.html
+// munmap(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/munmap.html
+// poll(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/poll.html
+// kill(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/kill.html
+
+
+#include <cerrno>
+#include <climits>
+#include <vector>
+
+#include <unistd.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "sheratan/errhdl/assert.hpp"
+#include "sheratan/process/posix/error_category.hpp"
+#include "sheratan/process/posix/process.hpp"
+#include "sheratan/process/posix/process_barrier.hpp"
+#include "pidfd.hpp"
+#include "posix_error.hpp"
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+/// \brief Shared state of the barrier.
+struct process_barrier::shared_state
+{
+  /// \brief Generation, i.e. number of completed phases (futex word).
+  int generation;
+
+  /// \brief Number of parties arrived in current generation.
+  int arrived;
+
+  /// \brief Generation, in which the barrier has been broken, plus one (\c 0 if not broken).
+  int broken;
+};
+
+/// \brief Slot of the party.
+struct process_barrier::party_slot
+{
+  /// \brief Process ID of the party (\c 0 if the slot is vacant).
+  process_id::value_type pid;
+
+  /// \brief Generation, in which the party has arrived last time, plus one (\c 0 if never).
+  int arrived;
+};
+
+
+namespace {
+
+
+/// \brief Invoke futex operation.
+/// \param word Futex word (shared between processes, hence non-private futex).
+/// \param op Futex operation (\c FUTEX_WAIT or \c FUTEX_WAKE).
+/// \param val Expected value of the futex word (\c FUTEX_WAIT), or number of waiters to be woken up (\c FUTEX_WAKE).
+/// \param timeout Relative timeout (\c FUTEX_WAIT only, \c NULL for no timeout).
+/// \return Return value of the system call.
+/// \par Abrahams exception guarantee:
+/// no-throw
+static long futex(int *word, int op, int val, const struct timespec *timeout = NULL)
+{
+  return ::syscall(SYS_futex, word, op, val, timeout, NULL, 0);
+}
+
+/// \brief Determine whether process has terminated.
+/// \param fd Process file descriptor.
+/// \retval true Process has terminated (it may be reaped already).
+/// \retval false Process is running.
+/// \par Abrahams exception guarantee:
+/// no-throw
+static bool terminated(file_descriptor_type fd)
+{
+  struct pollfd pfd;
+  pfd.fd = fd;
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+  int rc_poll = ::poll(&pfd, 1, 0);
+  return ((rc_poll > 0) && ((pfd.revents & POLLIN) != 0));
+}
+
+
+} // anonymous namespace
+
+
+process_barrier::process_barrier(std::size_t parties, const system_duration_type &check_interval)
+: parties_(parties)
+, check_interval_(check_interval)
+, size_(sizeof(shared_state) + parties * sizeof(party_slot))
+, state_(NULL)
+, slots_(NULL)
+, slot_pid_(0)
+, slot_(0)
+, pidfds_(parties, pidfd::INVALID)
+{
+  SHERATAN_CHECK(parties > 0);
+  SHERATAN_CHECK(parties <= static_cast<std::size_t>(INT_MAX));
+  SHERATAN_CHECK(check_interval > boost::posix_time::time_duration(0, 0, 0));
+
+  // shared anonymous mapping is inherited by forked children (and zero-filled)
+  void *mapping = ::mmap(NULL, this->size_, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+  if(mapping == MAP_FAILED) {
+    throw_posix_error(errno);
+  }
+  this->state_ = static_cast<shared_state *>(mapping);
+  this->slots_ = reinterpret_cast<party_slot *>(static_cast<char *>(mapping) + sizeof(shared_state));
+
+  this->slot_pid_ = ::getpid();
+  this->slot_ = this->attach(this->slot_pid_);
+}
+
+process_barrier::~process_barrier()
+{
+  for(std::size_t i = 0; i < this->pidfds_.size(); ++i) {
+    pidfd::close(this->pidfds_[i]);
+  }
+  ::munmap(this->state_, this->size_);
+}
+
+void process_barrier::prefork()
+{
+  std::size_t vacant = 0;
+  for(std::size_t i = 0; i < this->parties_; ++i) {
+    if(__atomic_load_n(&this->slots_[i].pid, __ATOMIC_ACQUIRE) == 0) {
+      ++vacant;
+    }
+  }
+  SHERATAN_CHECK(vacant > 0);
+}
+
+void process_barrier::postfork(process &child_process)
+{
+  std::size_t slot = this->attach(child_process.get_pid().get_value());
+
+  // child is not reaped yet, so its process file descriptor refers to it even once its PID is reused
+  if(this->pidfds_[slot] == pidfd::INVALID) {
+    this->pidfds_[slot] = pidfd::open(child_process.get_pid().get_value());
+  }
+}
+
+exit_status::value_type process_barrier::child()
+{
+  this->slot_pid_ = ::getpid();
+  this->slot_ = this->attach(this->slot_pid_);
+
+  // parent is alive (or not reaped yet) as long as it is the parent, so it is held the same way
+  process_id::value_type parent_pid = ::getppid();
+  for(std::size_t i = 0; i < this->parties_; ++i) {
+    if((__atomic_load_n(&this->slots_[i].pid, __ATOMIC_ACQUIRE) == parent_pid) && (this->pidfds_[i] == pidfd::INVALID)) {
+      this->pidfds_[i] = pidfd::open(parent_pid);
+    }
+  }
+
+  return exit_status::SUCCESS;
+}
+
+bool process_barrier::wait()
+{
+  process_id::value_type pid = ::getpid();
+  if(this->slot_pid_ != pid) {
+    this->slot_ = this->attach(pid);
+    this->slot_pid_ = pid;
+  }
+
+  int generation = __atomic_load_n(&this->state_->generation, __ATOMIC_ACQUIRE);
+  if(__atomic_load_n(&this->state_->broken, __ATOMIC_ACQUIRE) != 0) {
+    return false;
+  }
+
+  // arrive, last party to arrive starts the next generation
+  __atomic_store_n(&this->slots_[this->slot_].arrived, generation + 1, __ATOMIC_RELEASE);
+  if(__atomic_add_fetch(&this->state_->arrived, 1, __ATOMIC_ACQ_REL) == static_cast<int>(this->parties_)) {
+    __atomic_store_n(&this->state_->arrived, 0, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&this->state_->generation, 1, __ATOMIC_RELEASE);
+    if(futex(&this->state_->generation, FUTEX_WAKE, INT_MAX) < 0) {
+      throw_posix_error(errno);
+    }
+    return true;
+  }
+
+  struct timespec timeout;
+  timeout.tv_sec = static_cast<time_t>(this->check_interval_.total_seconds());
+  timeout.tv_nsec = static_cast<long>((this->check_interval_.total_microseconds() % 1000000) * 1000);
+  for(;;) {
+    if(__atomic_load_n(&this->state_->generation, __ATOMIC_ACQUIRE) != generation) {
+      // generation moves on also once the barrier is broken
+      return (__atomic_load_n(&this->state_->broken, __ATOMIC_ACQUIRE) != generation + 1);
+    }
+    if(futex(&this->state_->generation, FUTEX_WAIT, generation, &timeout) == 0) {
+      continue;
+    }
+    if(errno == ETIMEDOUT) {
+      if(this->party_terminated(generation)) {
+        // break the barrier (unless someone else did) and wake up all the waiters
+        int expected = 0;
+        if(__atomic_compare_exchange_n(&this->state_->broken, &expected, generation + 1, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+          __atomic_add_fetch(&this->state_->generation, 1, __ATOMIC_RELEASE);
+          futex(&this->state_->generation, FUTEX_WAKE, INT_MAX);
+        }
+      }
+      continue;
+    }
+    if((errno != EAGAIN) && (errno != EINTR)) {
+      throw_posix_error(errno);
+    }
+  }
+}
+
+std::size_t process_barrier::get_parties() const
+{
+  return this->parties_;
+}
+
+std::size_t process_barrier::get_generation() const
+{
+  return static_cast<std::size_t>(static_cast<unsigned int>(__atomic_load_n(&this->state_->generation, __ATOMIC_ACQUIRE)));
+}
+
+bool process_barrier::broken() const
+{
+  return (__atomic_load_n(&this->state_->broken, __ATOMIC_ACQUIRE) != 0);
+}
+
+std::size_t process_barrier::attach(process_id::value_type pid)
+{
+  // parent and child may register the child concurrently, first one wins
+  for(std::size_t i = 0; i < this->parties_; ++i) {
+    process_id::value_type expected = 0;
+    if(__atomic_compare_exchange_n(&this->slots_[i].pid, &expected, pid, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) || (expected == pid)) {
+      return i;
+    }
+  }
+  SHERATAN_CHECK(false && "no vacant slot in process barrier");
+  return this->parties_;
+}
+
+bool process_barrier::party_terminated(int generation)
+{
+  for(std::size_t i = 0; i < this->parties_; ++i) {
+    process_id::value_type pid = __atomic_load_n(&this->slots_[i].pid, __ATOMIC_ACQUIRE);
+    if((pid == 0) || (i == this->slot_) || (__atomic_load_n(&this->slots_[i].arrived, __ATOMIC_ACQUIRE) == generation + 1)) {
+      continue;
+    }
+
+    // party registered by some other process is held since it is noticed (see class notes)
+    if(this->pidfds_[i] == pidfd::INVALID) {
+      this->pidfds_[i] = pidfd::open(pid);
+      if(this->pidfds_[i] == pidfd::INVALID) {
+        if(errno == ENOSYS) {
+          // no process file descriptors, only reaped processes are recognized
+          if((::kill(pid, 0) != 0) && (errno == ESRCH)) {
+            return true;
+          }
+          continue;
+        }
+        if(errno == ESRCH) {
+          return true;
+        }
+        continue;
+      }
+    }
+    if(terminated(this->pidfds_[i])) {
+      return true;
+    }
+  }
+  return false;
+}
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+// vim: set ts=2 sw=2 et:
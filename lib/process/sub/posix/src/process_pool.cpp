@@ -0,0 +1,188 @@
+/// \file process/sub/posix/src/process_pool.cpp
+/// \brief POSIX process pool implementation.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+// waitid(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/waitid.html
+
+
+#include <cerrno>
+#include <cstring>
+
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#include "sheratan/errhdl/assert.hpp"
+#include "sheratan/errhdl/throw.hpp"
+#include "sheratan/process/posix/error_category.hpp"
+#include "sheratan/process/posix/process.hpp"
+#include "sheratan/process/posix/process_pool.hpp"
+#include "pidfd.hpp"
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+process_pool::process_pool()
+: pgid_()
+, processes_()
+, usage_()
+, reaped_count_(0)
+{
+}
+
+process_pool::process_pool(const process_id &pgid)
+: pgid_(pgid)
+, processes_()
+, usage_()
+, reaped_count_(0)
+{
+  SHERATAN_CHECK(pgid != process_id());
+}
+
+process_pool::~process_pool()
+{
+}
+
+void process_pool::add(process &proc)
+{
+  SHERATAN_CHECK(proc.valid());
+
+  bool inserted = this->processes_.insert(process_map_type::value_type(proc.get_pid().get_value(), &proc)).second;
+  SHERATAN_CHECK(inserted);
+}
+
+void process_pool::remove(process &proc)
+{
+  process_map_type::iterator it = this->processes_.find(proc.get_pid().get_value());
+  if((it != this->processes_.end()) && (it->second == &proc)) {
+    this->processes_.erase(it);
+  }
+}
+
+bool process_pool::contains(const process &proc) const
+{
+  process_map_type::const_iterator it = this->processes_.find(proc.get_pid().get_value());
+  return (it != this->processes_.end()) && (it->second == &proc);
+}
+
+std::size_t process_pool::size() const
+{
+  return this->processes_.size();
+}
+
+bool process_pool::empty() const
+{
+  return this->processes_.empty();
+}
+
+process_id process_pool::get_pgid() const
+{
+  return this->pgid_;
+}
+
+process_pool::reaped_type process_pool::join_any(bool nonblocking)
+{
+  SHERATAN_CHECK(!this->empty());
+
+  reaped_type reaped(static_cast<process *>(NULL), exit_status());
+  if(!this->reap_one(nonblocking, reaped) && !nonblocking) {
+    // blocking call returned without child process, although the pool is not empty
+    sheratan::errhdl::runtime_error ex_to_throw;
+    ex_to_throw << error_category::error_info::posix_errnum(ECHILD);
+    SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
+  }
+
+  return reaped;
+}
+
+std::size_t process_pool::reap_ready(process_pool::reaped_list_type &reaped)
+{
+  std::size_t count = 0;
+  reaped_type one(static_cast<process *>(NULL), exit_status());
+  while(this->reap_one(true, one)) {
+    reaped.push_back(one);
+    ++count;
+  }
+  return count;
+}
+
+const resource_usage & process_pool::get_resource_usage() const
+{
+  return this->usage_;
+}
+
+std::size_t process_pool::get_reaped_count() const
+{
+  return this->reaped_count_;
+}
+
+void process_pool::reset_resource_usage()
+{
+  this->usage_ = resource_usage();
+  this->reaped_count_ = 0;
+}
+
+bool process_pool::reap_one(bool nonblocking, process_pool::reaped_type &reaped)
+{
+  idtype_t idtype = (this->pgid_ == process_id()) ? P_ALL : P_PGID;
+  id_t id = (this->pgid_ == process_id()) ? 0 : static_cast<id_t>(this->pgid_.get_value());
+
+  // si_pid is left zeroed in case of non-blocking call without completed child
+  siginfo_t info;
+  std::memset(&info, 0, sizeof(info));
+  struct rusage usage;
+  int rc_waitid;
+  do {
+    rc_waitid = pidfd::waitid(idtype, id, info, WEXITED | (nonblocking ? WNOHANG : 0), &usage);
+  } while((rc_waitid == -1) && (errno == EINTR));
+  if(rc_waitid != 0) {
+    if(errno == ECHILD) {
+      // no (more) child processes
+      return false;
+    }
+    int saved_errnum = errno;
+    sheratan::errhdl::runtime_error ex_to_throw;
+    ex_to_throw << error_category::error_info::posix_errnum(saved_errnum);
+    SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
+  }
+  if(info.si_pid == 0) {
+    return false;
+  }
+
+  // resource usage is reported along with the exit status
+  this->usage_ += resource_usage(usage);
+  ++(this->reaped_count_);
+
+  // map reaped child process back to process object
+  int status = pidfd::wait_status(info);
+  process_map_type::iterator it = this->processes_.find(info.si_pid);
+  if(it == this->processes_.end()) {
+    // child process is not part of the pool
+    reaped.first = NULL;
+    reaped.second = exit_status(status);
+    return true;
+  }
+  process *proc = it->second;
+  this->processes_.erase(it);
+  reaped.first = proc;
+  reaped.second = proc->set_status(status);
+  return true;
+}
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+// vim: set ts=2 sw=2 et:
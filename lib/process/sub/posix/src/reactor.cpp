@@ -0,0 +1,493 @@
+/// \file process/sub/posix/src/reactor.cpp
+/// \brief POSIX reactor implementation.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+// timerfd_create(2): http://man7.org/linux/man-pages/man2/timerfd_create.2.html
+// fcntl(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/fcntl.html
+// read(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/read.html
+// close(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/close.html
+
+
+#include <cerrno>
+#include <vector>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <sys/timerfd.h>
+
+#include <boost/bind/bind.hpp>
+
+#include "sheratan/errhdl/assert.hpp"
+#include "sheratan/errhdl/exception.hpp"
+#include "sheratan/process/posix/error_category.hpp"
+#include "sheratan/process/posix/process.hpp"
+#include "sheratan/process/posix/reactor.hpp"
+#include "reactor_engine.hpp"
+#include "posix_error.hpp"
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+reactor::reactor(reactor_backend::value_type backend)
+: engine_(reactor_engine::create(backend))
+, signal_dispatcher_()
+, watches_()
+, signals_()
+, processes_()
+, job_control_watches_()
+, sigchld_subscription_(0)
+, timers_()
+, next_timer_id_(1)
+, stopped_(false)
+{
+}
+
+reactor::~reactor()
+{
+  // remove process watches one by one, since the engine may have requests in flight
+  // referring to them; other watches are removed at once when the engine is destroyed
+  while(!this->processes_.empty()) {
+    this->remove_watch(this->processes_.begin()->second);
+  }
+  this->engine_.reset();
+
+  // close owned file descriptors (signal file descriptor is closed by the signal dispatcher)
+  watch_map_type::const_iterator end = this->watches_.end();
+  for(watch_map_type::const_iterator i = this->watches_.begin(); i != end; ++i) {
+    if((i->second.kind != watch_kind::IO) && (i->second.kind != watch_kind::SIGNAL)) {
+      close_fd(i->first);
+    }
+  }
+}
+
+bool reactor::supports(reactor_backend::value_type backend)
+{
+  return reactor_engine::available(backend);
+}
+
+reactor_backend::value_type reactor::get_backend() const
+{
+  return this->engine_->get_backend();
+}
+
+void reactor::watch_process(
+  process &proc,
+  const reactor::process_handler_type &on_exit,
+  const reactor::process_handler_type &on_stop,
+  const reactor::process_handler_type &on_continue
+)
+{
+  SHERATAN_CHECK(proc.valid());
+  SHERATAN_CHECK(proc.native_handle() != -1);
+  SHERATAN_CHECK(this->processes_.find(&proc) == this->processes_.end());
+
+  // duplicate process file descriptor, since the original is closed when the process is joined
+  file_descriptor_type fd = ::fcntl(proc.native_handle(), F_DUPFD_CLOEXEC, 0);
+  if(fd == -1) {
+    throw_posix_error(errno);
+  }
+
+  watch w;
+  w.kind = watch_kind::PROCESS;
+  w.proc = &proc;
+  w.on_exit = on_exit;
+  w.on_stop = on_stop;
+  w.on_continue = on_continue;
+  w.periodic = false;
+  try {
+    this->add_watch(fd, io_events::READABLE, w);
+  }
+  catch(...) {
+    close_fd(fd);
+    throw;
+  }
+  this->processes_[&proc] = fd;
+
+  // stop and continue notifications are driven by SIGCHLD
+  if(on_stop || on_continue) {
+    this->job_control_watches_.insert(fd);
+    try {
+      this->update_job_control();
+    }
+    catch(...) {
+      this->remove_watch(fd);
+      throw;
+    }
+  }
+}
+
+exit_status reactor::unwatch_process(process &proc)
+{
+  process_map_type::iterator it = this->processes_.find(&proc);
+  if(it == this->processes_.end()) {
+    return exit_status();
+  }
+  return this->remove_watch(it->second);
+}
+
+void reactor::watch_io(file_descriptor_type fd, io_event_mask_type events, const reactor::io_handler_type &on_ready)
+{
+  watch w;
+  w.kind = watch_kind::IO;
+  w.proc = NULL;
+  w.on_ready = on_ready;
+  w.periodic = false;
+  this->add_watch(fd, events, w);
+}
+
+void reactor::modify_io(file_descriptor_type fd, io_event_mask_type events)
+{
+  watch_map_type::const_iterator it = this->watches_.find(fd);
+  SHERATAN_CHECK((it != this->watches_.end()) && (it->second.kind == watch_kind::IO));
+
+  this->engine_->modify(fd, events);
+}
+
+void reactor::unwatch_io(file_descriptor_type fd)
+{
+  watch_map_type::const_iterator it = this->watches_.find(fd);
+  if((it == this->watches_.end()) || (it->second.kind != watch_kind::IO)) {
+    return;
+  }
+  this->remove_watch(fd);
+}
+
+void reactor::watch_signal(signal_number_type signal, const reactor::signal_handler_type &on_signal)
+{
+  SHERATAN_CHECK(this->signals_.find(signal) == this->signals_.end());
+
+  signal_dispatcher &dispatcher = this->get_signal_dispatcher();
+  signal_dispatcher::subscription_id_type subscription_id = dispatcher.subscribe(signal, on_signal);
+  try {
+    this->signals_[signal] = subscription_id;
+  }
+  catch(...) {
+    dispatcher.unsubscribe(subscription_id);
+    throw;
+  }
+}
+
+void reactor::unwatch_signal(signal_number_type signal)
+{
+  signal_map_type::iterator it = this->signals_.find(signal);
+  if(it == this->signals_.end()) {
+    return;
+  }
+  this->signal_dispatcher_->unsubscribe(it->second);
+  this->signals_.erase(it);
+}
+
+reactor::timer_id_type reactor::add_timer(const system_duration_type &interval, const reactor::timer_handler_type &on_expiry, bool periodic)
+{
+  SHERATAN_CHECK(!interval.is_special());
+  SHERATAN_CHECK(interval.ticks() > 0);
+
+  file_descriptor_type fd = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if(fd == -1) {
+    throw_posix_error(errno);
+  }
+
+  struct itimerspec spec;
+  spec.it_value.tv_sec = static_cast<time_t>(interval.total_seconds());
+  spec.it_value.tv_nsec = static_cast<long>(interval.total_microseconds() % 1000000) * 1000;
+  if(periodic) {
+    spec.it_interval = spec.it_value;
+  }
+  else {
+    spec.it_interval.tv_sec = 0;
+    spec.it_interval.tv_nsec = 0;
+  }
+  if(::timerfd_settime(fd, 0, &spec, NULL) != 0) {
+    int saved_errnum = errno;
+    close_fd(fd);
+    throw_posix_error(saved_errnum);
+  }
+
+  watch w;
+  w.kind = watch_kind::TIMER;
+  w.proc = NULL;
+  w.on_expiry = on_expiry;
+  w.periodic = periodic;
+  // timer ID is not the file descriptor, which is reused once the timer expires
+  w.timer_id = this->next_timer_id_;
+  try {
+    this->timers_.insert(timer_map_type::value_type(w.timer_id, fd));
+    try {
+      this->add_watch(fd, io_events::READABLE, w);
+    }
+    catch(...) {
+      this->timers_.erase(w.timer_id);
+      throw;
+    }
+  }
+  catch(...) {
+    close_fd(fd);
+    throw;
+  }
+  ++(this->next_timer_id_);
+
+  return w.timer_id;
+}
+
+void reactor::cancel_timer(reactor::timer_id_type timer_id)
+{
+  timer_map_type::const_iterator it = this->timers_.find(timer_id);
+  if(it == this->timers_.end()) {
+    return;
+  }
+  this->remove_watch(it->second);
+}
+
+void reactor::run()
+{
+  this->stopped_ = false;
+  while((!this->stopped_) && (!this->empty())) {
+    this->run_one();
+  }
+}
+
+std::size_t reactor::run_one(bool nonblocking)
+{
+  reactor_engine::event_list_type events;
+  this->engine_->wait(nonblocking, events);
+
+  // watches may be removed by handlers, so each event is looked up again before dispatch
+  for(std::size_t i = 0; i < events.size(); ++i) {
+    this->dispatch(events[i].fd, events[i].events, events[i].reaped, events[i].status);
+  }
+
+  return events.size();
+}
+
+void reactor::stop()
+{
+  this->stopped_ = true;
+}
+
+bool reactor::stopped() const
+{
+  return this->stopped_;
+}
+
+std::size_t reactor::size() const
+{
+  // signal file descriptor is internal, watched signals are counted instead
+  return this->watches_.size() - ((this->signal_dispatcher_.get() == NULL) ? 0 : 1) + this->signals_.size();
+}
+
+bool reactor::empty() const
+{
+  return this->size() == 0;
+}
+
+void reactor::add_watch(file_descriptor_type fd, io_event_mask_type events, const reactor::watch &w)
+{
+  SHERATAN_CHECK(this->watches_.find(fd) == this->watches_.end());
+
+  this->watches_[fd] = w;
+  try {
+    // processes watched for job control are reaped by the reactor itself (see dispatch_sigchld)
+    if((w.kind == watch_kind::PROCESS) && (!w.on_stop) && (!w.on_continue)) {
+      this->engine_->add_process(fd);
+    }
+    else {
+      this->engine_->add(fd, events);
+    }
+  }
+  catch(...) {
+    this->watches_.erase(fd);
+    throw;
+  }
+}
+
+exit_status reactor::remove_watch(file_descriptor_type fd)
+{
+  exit_status ret;
+  watch_map_type::iterator it = this->watches_.find(fd);
+  if(it == this->watches_.end()) {
+    return ret;
+  }
+
+  // file descriptor must be removed from the engine before it is closed
+  int status = 0;
+  bool reaped = false;
+  try {
+    reaped = this->engine_->remove(fd, status);
+  }
+  catch(const sheratan::errhdl::runtime_error &) {
+    // engine failed, file descriptor is closed anyway
+  }
+
+  if(it->second.kind == watch_kind::PROCESS) {
+    if(reaped) {
+      // process was reaped in the meantime, so it can not be joined anymore
+      ret = it->second.proc->set_status(status);
+    }
+    this->processes_.erase(it->second.proc);
+    if((this->job_control_watches_.erase(fd) != 0) && this->job_control_watches_.empty()) {
+      // cancelling subscription does not throw
+      this->update_job_control();
+    }
+  }
+  if(it->second.kind == watch_kind::TIMER) {
+    this->timers_.erase(it->second.timer_id);
+  }
+  if((it->second.kind != watch_kind::IO) && (it->second.kind != watch_kind::SIGNAL)) {
+    close_fd(fd);
+  }
+  this->watches_.erase(it);
+  return ret;
+}
+
+signal_dispatcher & reactor::get_signal_dispatcher()
+{
+  if(this->signal_dispatcher_.get() != NULL) {
+    return *(this->signal_dispatcher_);
+  }
+
+  std::auto_ptr<signal_dispatcher> dispatcher(new signal_dispatcher());
+  watch w;
+  w.kind = watch_kind::SIGNAL;
+  w.proc = NULL;
+  w.periodic = false;
+  this->add_watch(dispatcher->native_handle(), io_events::READABLE, w);
+  this->signal_dispatcher_ = dispatcher;
+  return *(this->signal_dispatcher_);
+}
+
+void reactor::update_job_control()
+{
+  if(this->job_control_watches_.empty()) {
+    if(this->sigchld_subscription_ != 0) {
+      this->signal_dispatcher_->unsubscribe(this->sigchld_subscription_);
+      this->sigchld_subscription_ = 0;
+    }
+    return;
+  }
+
+  if(this->sigchld_subscription_ == 0) {
+    this->sigchld_subscription_ = this->get_signal_dispatcher().subscribe(SIGCHLD, boost::bind(&reactor::dispatch_sigchld, this));
+  }
+}
+
+void reactor::dispatch(file_descriptor_type fd, io_event_mask_type events, bool reaped, int status)
+{
+  watch_map_type::const_iterator it = this->watches_.find(fd);
+  if(it == this->watches_.end()) {
+    // watch was removed by previously dispatched handler
+    return;
+  }
+
+  switch(it->second.kind) {
+    case watch_kind::PROCESS:
+      this->dispatch_process(fd, reaped, status);
+      break;
+    case watch_kind::IO:
+      {
+        // copy handler, since it may remove its own watch
+        io_handler_type on_ready = it->second.on_ready;
+        on_ready(fd, events);
+      }
+      break;
+    case watch_kind::SIGNAL:
+      this->signal_dispatcher_->dispatch(true);
+      break;
+    case watch_kind::TIMER:
+      this->dispatch_timer(fd);
+      break;
+  }
+}
+
+void reactor::dispatch_process(file_descriptor_type fd, bool reaped, int status)
+{
+  watch w = this->watches_[fd];
+
+  // process is either reaped by the engine already, or its file descriptor is readable once it terminates
+  exit_status ret;
+  if(reaped) {
+    ret = w.proc->set_status(status);
+  }
+  else {
+    ret = w.proc->join(true);
+    if(!ret.valid()) {
+      return;
+    }
+  }
+
+  this->remove_watch(fd);
+  if(w.on_exit) {
+    w.on_exit(*w.proc, ret);
+  }
+}
+
+void reactor::dispatch_sigchld()
+{
+  // SIGCHLD does not tell which child has changed its state and multiple
+  // instances coalesce, so check all children watched for job control
+  std::vector<file_descriptor_type> fds(this->job_control_watches_.begin(), this->job_control_watches_.end());
+  for(std::size_t i = 0; i < fds.size(); ++i) {
+    watch_map_type::const_iterator it = this->watches_.find(fds[i]);
+    if((it == this->watches_.end()) || (it->second.kind != watch_kind::PROCESS)) {
+      continue;
+    }
+    watch w = it->second;
+
+    exit_status status = w.proc->join(true, true, true);
+    if(!status.valid()) {
+      continue;
+    }
+    if(status.stopped()) {
+      if(w.on_stop) {
+        w.on_stop(*w.proc, status);
+      }
+    }
+    else if(status.continued()) {
+      if(w.on_continue) {
+        w.on_continue(*w.proc, status);
+      }
+    }
+    else {
+      this->remove_watch(fds[i]);
+      if(w.on_exit) {
+        w.on_exit(*w.proc, status);
+      }
+    }
+  }
+}
+
+void reactor::dispatch_timer(file_descriptor_type fd)
+{
+  uint64_t expirations = 0;
+  ssize_t rc_read = ::read(fd, &expirations, sizeof(expirations));
+  if(rc_read != static_cast<ssize_t>(sizeof(expirations))) {
+    // spurious wakeup
+    return;
+  }
+
+  timer_handler_type on_expiry = this->watches_[fd].on_expiry;
+  if(!this->watches_[fd].periodic) {
+    this->remove_watch(fd);
+  }
+  if(on_expiry) {
+    on_expiry();
+  }
+}
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+// vim: set ts=2 sw=2 et:
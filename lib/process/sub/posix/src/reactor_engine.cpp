@@ -0,0 +1,71 @@
+/// \file process/sub/posix/src/reactor_engine.cpp
+/// \brief POSIX reactor engine implementation.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#include "sheratan/errhdl/assert.hpp"
+#include "sheratan/errhdl/exception.hpp"
+#include "reactor_engine.hpp"
+#include "epoll_reactor_engine.hpp"
+#include "uring_reactor_engine.hpp"
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+reactor_engine::reactor_engine()
+{
+}
+
+reactor_engine::~reactor_engine()
+{
+}
+
+reactor_engine * reactor_engine::create(reactor_backend::value_type backend)
+{
+  switch(backend) {
+    case reactor_backend::AUTO:
+      try {
+        return new uring_reactor_engine();
+      }
+      catch(const sheratan::errhdl::runtime_error &) {
+        // io_uring not available, fall back to epoll
+      }
+      return new epoll_reactor_engine();
+    case reactor_backend::EPOLL:
+      return new epoll_reactor_engine();
+    case reactor_backend::IO_URING:
+      return new uring_reactor_engine();
+  }
+  SHERATAN_CHECK(false && "unknown reactor backend");
+  return NULL;
+}
+
+bool reactor_engine::available(reactor_backend::value_type backend)
+{
+  if(backend != reactor_backend::IO_URING) {
+    return true;
+  }
+  try {
+    uring_reactor_engine probe;
+  }
+  catch(const sheratan::errhdl::runtime_error &) {
+    return false;
+  }
+  return true;
+}
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+// vim: set ts=2 sw=2 et:
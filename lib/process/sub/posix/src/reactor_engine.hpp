@@ -0,0 +1,155 @@
+/// \file process/sub/posix/src/reactor_engine.hpp
+/// \brief POSIX reactor engine interface.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#ifndef HGI_SHERATAN_PROCESS_POSIX_REACTOR_ENGINE_HPP
+#define HGI_SHERATAN_PROCESS_POSIX_REACTOR_ENGINE_HPP
+
+
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include "sheratan/process/posix/types.hpp"
+#include "sheratan/process/posix/reactor.hpp"
+#include "sheratan/process/posix/reactor_backend.hpp"
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+/// \brief POSIX reactor engine.
+/// \ingroup sheratan_process_posix
+/// \nosubgrouping
+/// \note Reactor engine is the part of the reactor, which waits for events
+/// on watched file descriptors. Dispatching of the events is left up to the
+/// reactor itself. All watches behave as level-triggered.
+class reactor_engine : private boost::noncopyable
+{
+  public:
+
+    /// \brief Event reported by reactor engine.
+    /// \ingroup sheratan_process_posix
+    /// \nosubgrouping
+    struct event
+    {
+      /// \brief File descriptor.
+      file_descriptor_type fd;
+
+      /// \brief Mask of I/O events (see \c io_events).
+      io_event_mask_type events;
+
+      /// \brief Whether the process was reaped by the engine (process watch only).
+      bool reaped;
+
+      /// \brief Status of reaped process in \c waitpid format (process watch only).
+      int status;
+    };
+
+    /// \brief Event list type definition.
+    typedef std::vector<event> event_list_type;
+
+  protected:
+
+    /// \brief Default constructor.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    reactor_engine();
+
+  public:
+
+    /// \brief Virtual destructor.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    virtual ~reactor_engine() = 0;
+
+  public:
+
+    /// \brief Create reactor engine.
+    /// \param backend Reactor backend.
+    /// \return Reactor engine (caller takes ownership).
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \note \c AUTO backend falls back to \c EPOLL, in case \c IO_URING
+    /// is not available. Explicitly requested backend, which is not available,
+    /// results in an exception.
+    static reactor_engine * create(reactor_backend::value_type backend);
+
+    /// \brief Determine whether reactor backend is available.
+    /// \param backend Reactor backend.
+    /// \retval true Backend is available.
+    /// \retval false Backend is not available.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    static bool available(reactor_backend::value_type backend);
+
+  public:
+
+    /// \brief Get reactor backend.
+    /// \return Reactor backend implemented by the engine.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    virtual reactor_backend::value_type get_backend() const = 0;
+
+    /// \brief Watch file descriptor.
+    /// \param fd File descriptor.
+    /// \param events Mask of I/O events (see \c io_events).
+    /// \par Abrahams exception guarantee:
+    /// strong
+    virtual void add(file_descriptor_type fd, io_event_mask_type events) = 0;
+
+    /// \brief Watch process file descriptor for process termination.
+    /// \param fd Process file descriptor.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \note Engine either reports the descriptor as readable, or it reaps
+    /// the process itself and reports its status.
+    virtual void add_process(file_descriptor_type fd) = 0;
+
+    /// \brief Change I/O events watched for file descriptor.
+    /// \param fd Watched file descriptor.
+    /// \param events Mask of I/O events (see \c io_events).
+    /// \par Abrahams exception guarantee:
+    /// strong
+    virtual void modify(file_descriptor_type fd, io_event_mask_type events) = 0;
+
+    /// \brief Stop watching file descriptor.
+    /// \param fd Watched file descriptor.
+    /// \param status Status of the process in \c waitpid format, in case
+    /// it was reaped by the engine in the meantime (process watch only).
+    /// \retval true Process was reaped in the meantime (process watch only).
+    /// \retval false Process was not reaped.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \post File descriptor may be closed once this method returns.
+    virtual bool remove(file_descriptor_type fd, int &status) = 0;
+
+    /// \brief Wait for events.
+    /// \param nonblocking If set, this method will not block.
+    /// \param events List, where events are appended.
+    /// \par Abrahams exception guarantee:
+    /// weak
+    /// \note Blocking wait returns only once there are some events (it goes on
+    /// when interrupted, or woken up by internal completions), non-blocking
+    /// wait returns without events when interrupted.
+    virtual void wait(bool nonblocking, event_list_type &events) = 0;
+};
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+#endif // HGI_SHERATAN_PROCESS_POSIX_REACTOR_ENGINE_HPP
+
+
+// vim: set ts=2 sw=2 et:
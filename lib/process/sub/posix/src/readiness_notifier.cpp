@@ -0,0 +1,131 @@
+/// \file process/sub/posix/src/readiness_notifier.cpp
+/// \brief POSIX readiness notifier implementation.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+// socket(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/socket.html
+// sendto(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/sendto.html
+// unix(7): http://man7.org/linux/man-pages/man7/unix.7.html
+// sd_notify(3): http://man7.org/linux/man-pages/man3/sd_notify.3.html
+// close(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/close.html
+
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "sheratan/errhdl/assert.hpp"
+#include "sheratan/process/posix/error_category.hpp"
+#include "sheratan/process/posix/readiness_notifier.hpp"
+#include "posix_error.hpp"
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+namespace {
+
+
+/// \brief Name of environment variable holding notification socket.
+static const char notify_socket_env[] = "NOTIFY_SOCKET";
+
+/// \brief Readiness assignment.
+static const char ready_assignment[] = "READY=1";
+
+/// \brief Stage assignment key.
+static const char stage_key[] = "STAGE=";
+
+
+
+} // anonymous namespace
+
+
+readiness_notifier::readiness_notifier()
+: fd_(-1)
+, address_()
+{
+  const char *notify_socket = std::getenv(notify_socket_env);
+  if((notify_socket == NULL) || ((notify_socket[0] != '/') && (notify_socket[0] != '@'))) {
+    return;
+  }
+
+  // build socket address, leading '@' denotes abstract socket name
+  struct sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  std::size_t length = std::strlen(notify_socket);
+  if(length >= sizeof(address.sun_path)) {
+    throw_posix_error(ENAMETOOLONG);
+  }
+  std::memcpy(address.sun_path, notify_socket, length);
+  if(address.sun_path[0] == '@') {
+    address.sun_path[0] = '\0';
+  }
+  std::size_t address_length = offsetof(struct sockaddr_un, sun_path) + length;
+
+  this->fd_ = ::socket(AF_UNIX, SOCK_DGRAM|SOCK_CLOEXEC, 0);
+  if(this->fd_ < 0) {
+    throw_posix_error(errno);
+  }
+  this->address_.assign(reinterpret_cast<const char *>(&address), address_length);
+}
+
+readiness_notifier::~readiness_notifier()
+{
+  if(this->fd_ >= 0) {
+    ::close(this->fd_);
+  }
+}
+
+bool readiness_notifier::enabled() const
+{
+  return (this->fd_ >= 0);
+}
+
+void readiness_notifier::notify(const std::string &state)
+{
+  if(this->fd_ < 0) {
+    return;
+  }
+
+  ssize_t rc_send;
+  do {
+    rc_send = ::sendto(this->fd_, state.data(), state.size(), MSG_NOSIGNAL, reinterpret_cast<const struct sockaddr *>(this->address_.data()), static_cast<socklen_t>(this->address_.size()));
+  } while(rc_send < 0 && errno == EINTR);
+  if(rc_send < 0) {
+    throw_posix_error(errno);
+  }
+}
+
+void readiness_notifier::stage(const std::string &name)
+{
+  SHERATAN_CHECK(!name.empty());
+  SHERATAN_CHECK(name.find('\n') == std::string::npos);
+
+  this->notify(stage_key + name);
+}
+
+void readiness_notifier::ready()
+{
+  this->notify(ready_assignment);
+}
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+// vim: set ts=2 sw=2 et:
@@ -0,0 +1,106 @@
+/// \file process/sub/posix/src/resource_usage.cpp
+/// \brief POSIX process resource usage implementation.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+// getrusage(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/getrusage.html
+
+
+#include <algorithm>
+
+#include "sheratan/process/posix/resource_usage.hpp"
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+resource_usage::resource_usage()
+: user_time_us_(0)
+, system_time_us_(0)
+, max_rss_(0)
+, minor_faults_(0)
+, major_faults_(0)
+, voluntary_context_switches_(0)
+, involuntary_context_switches_(0)
+{
+}
+
+resource_usage::resource_usage(const struct rusage &usage)
+: user_time_us_(static_cast<counter_type>(usage.ru_utime.tv_sec) * 1000000 + usage.ru_utime.tv_usec)
+, system_time_us_(static_cast<counter_type>(usage.ru_stime.tv_sec) * 1000000 + usage.ru_stime.tv_usec)
+, max_rss_(usage.ru_maxrss)
+, minor_faults_(usage.ru_minflt)
+, major_faults_(usage.ru_majflt)
+, voluntary_context_switches_(usage.ru_nvcsw)
+, involuntary_context_switches_(usage.ru_nivcsw)
+{
+}
+
+resource_usage & resource_usage::operator+=(const resource_usage &other)
+{
+  this->user_time_us_ += other.user_time_us_;
+  this->system_time_us_ += other.system_time_us_;
+  this->max_rss_ = std::max(this->max_rss_, other.max_rss_);
+  this->minor_faults_ += other.minor_faults_;
+  this->major_faults_ += other.major_faults_;
+  this->voluntary_context_switches_ += other.voluntary_context_switches_;
+  this->involuntary_context_switches_ += other.involuntary_context_switches_;
+  return *this;
+}
+
+system_duration_type resource_usage::get_user_time() const
+{
+  return boost::posix_time::microseconds(this->user_time_us_);
+}
+
+system_duration_type resource_usage::get_system_time() const
+{
+  return boost::posix_time::microseconds(this->system_time_us_);
+}
+
+resource_usage::counter_type resource_usage::get_max_rss() const
+{
+  return this->max_rss_;
+}
+
+resource_usage::counter_type resource_usage::get_minor_faults() const
+{
+  return this->minor_faults_;
+}
+
+resource_usage::counter_type resource_usage::get_major_faults() const
+{
+  return this->major_faults_;
+}
+
+resource_usage::counter_type resource_usage::get_voluntary_context_switches() const
+{
+  return this->voluntary_context_switches_;
+}
+
+resource_usage::counter_type resource_usage::get_involuntary_context_switches() const
+{
+  return this->involuntary_context_switches_;
+}
+
+resource_usage operator+(const resource_usage &ru1, const resource_usage &ru2)
+{
+  resource_usage ret(ru1);
+  ret += ru2;
+  return ret;
+}
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+// vim: set ts=2 sw=2 et:
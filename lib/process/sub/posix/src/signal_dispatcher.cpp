@@ -0,0 +1,283 @@
+/// \file process/sub/posix/src/signal_dispatcher.cpp
+/// \brief POSIX signal dispatcher implementation.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+// signalfd(2): http://man7.org/linux/man-pages/man2/signalfd.2.html
+// pthread_sigmask(3): http://pubs.opengroup.org/onlinepubs/009695399/functions/pthread_sigmask.html
+// sigtimedwait(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/sigtimedwait.html
+// poll(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/poll.html
+// read(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/read.html
+// close(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/close.html
+
+
+#include <cerrno>
+#include <vector>
+
+#include <unistd.h>
+#include <poll.h>
+#include <signal.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/signalfd.h>
+
+#include "sheratan/errhdl/assert.hpp"
+#include "sheratan/errhdl/exception.hpp"
+#include "sheratan/process/posix/error_category.hpp"
+#include "sheratan/process/posix/signal_dispatcher.hpp"
+#include "posix_error.hpp"
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+namespace {
+
+
+/// \brief Maximal number of signals read by single read.
+static const int max_signals = 16;
+
+
+/// \brief Unblock signals in the calling thread.
+/// \param signals Signals to be unblocked.
+/// \par Abrahams exception guarantee:
+/// no-throw
+/// \note Pending instances of the signals are discarded at first, they
+/// have no subscriber to be dispatched to and their default action (if
+/// they were delivered once unblocked) would terminate the process.
+static void release_signals(const std::set<signal_number_type> &signals)
+{
+  if(signals.empty()) {
+    return;
+  }
+  sigset_t mask;
+  ::sigemptyset(&mask);
+  std::set<signal_number_type>::const_iterator end = signals.end();
+  for(std::set<signal_number_type>::const_iterator i = signals.begin(); i != end; ++i) {
+    ::sigaddset(&mask, *i);
+  }
+
+  // discard pending instances
+  struct timespec no_wait;
+  no_wait.tv_sec = 0;
+  no_wait.tv_nsec = 0;
+  while((::sigtimedwait(&mask, NULL, &no_wait) != -1) || (errno == EINTR)) {
+  }
+
+  ::pthread_sigmask(SIG_UNBLOCK, &mask, NULL);
+}
+
+
+} // anonymous namespace
+
+
+signal_dispatcher::signal_dispatcher()
+: signal_fd_(-1)
+, subscriptions_()
+, blocked_signals_()
+, next_subscription_id_(1)
+{
+  sigset_t mask;
+  ::sigemptyset(&mask);
+  this->signal_fd_ = ::signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+  if(this->signal_fd_ == -1) {
+    throw_posix_error(errno);
+  }
+}
+
+signal_dispatcher::~signal_dispatcher()
+{
+  ::close(this->signal_fd_);
+
+  // unblock signals blocked by the dispatcher
+  release_signals(this->blocked_signals_);
+}
+
+signal_dispatcher::subscription_id_type signal_dispatcher::subscribe(signal_number_type signal, const signal_dispatcher::handler_type &handler)
+{
+  sigset_t probe;
+  ::sigemptyset(&probe);
+  if(::sigaddset(&probe, signal) != 0) {
+    throw_posix_error(errno);
+  }
+
+  subscription_id_type subscription_id = this->next_subscription_id_;
+  subscription s;
+  s.signal = signal;
+  s.handler = handler;
+  this->subscriptions_[subscription_id] = s;
+  try {
+    this->update_mask();
+  }
+  catch(...) {
+    this->subscriptions_.erase(subscription_id);
+    throw;
+  }
+  ++(this->next_subscription_id_);
+
+  return subscription_id;
+}
+
+void signal_dispatcher::unsubscribe(signal_dispatcher::subscription_id_type subscription_id)
+{
+  if(this->subscriptions_.erase(subscription_id) == 0) {
+    return;
+  }
+  try {
+    this->update_mask();
+  }
+  catch(const sheratan::errhdl::runtime_error &) {
+    // signal stays blocked, its instances are discarded by dispatch
+  }
+}
+
+bool signal_dispatcher::subscribed(signal_number_type signal) const
+{
+  subscription_map_type::const_iterator end = this->subscriptions_.end();
+  for(subscription_map_type::const_iterator i = this->subscriptions_.begin(); i != end; ++i) {
+    if(i->second.signal == signal) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::size_t signal_dispatcher::dispatch(bool nonblocking)
+{
+  // drain signalfd first, subscribers may change the subscriptions
+  std::vector<signal_number_type> delivered;
+  for(;;) {
+    struct signalfd_siginfo info[max_signals];
+    ssize_t rc_read = ::read(this->signal_fd_, info, sizeof(info));
+    if(rc_read == -1) {
+      if(errno == EINTR) {
+        continue;
+      }
+      if(errno != EAGAIN) {
+        throw_posix_error(errno);
+      }
+      if(nonblocking || (!delivered.empty())) {
+        break;
+      }
+
+      // wait for some signal
+      struct pollfd pfd;
+      pfd.fd = this->signal_fd_;
+      pfd.events = POLLIN;
+      if(::poll(&pfd, 1, -1) == -1) {
+        if(errno == EINTR) {
+          break;
+        }
+        throw_posix_error(errno);
+      }
+      continue;
+    }
+    std::size_t count = static_cast<std::size_t>(rc_read) / sizeof(struct signalfd_siginfo);
+    for(std::size_t i = 0; i < count; ++i) {
+      delivered.push_back(static_cast<signal_number_type>(info[i].ssi_signo));
+    }
+    if(count < static_cast<std::size_t>(max_signals)) {
+      if(nonblocking || (count > 0)) {
+        break;
+      }
+    }
+  }
+
+  for(std::size_t i = 0; i < delivered.size(); ++i) {
+    // collect subscribers first, each of them is looked up again before it is invoked
+    std::vector<subscription_id_type> subscribers;
+    subscription_map_type::const_iterator end = this->subscriptions_.end();
+    for(subscription_map_type::const_iterator j = this->subscriptions_.begin(); j != end; ++j) {
+      if(j->second.signal == delivered[i]) {
+        subscribers.push_back(j->first);
+      }
+    }
+    for(std::size_t j = 0; j < subscribers.size(); ++j) {
+      subscription_map_type::const_iterator it = this->subscriptions_.find(subscribers[j]);
+      if(it == this->subscriptions_.end()) {
+        continue;
+      }
+      // copy handler, since it may cancel its own subscription
+      handler_type handler = it->second.handler;
+      handler(delivered[i]);
+    }
+  }
+
+  return delivered.size();
+}
+
+file_descriptor_type signal_dispatcher::native_handle() const
+{
+  return this->signal_fd_;
+}
+
+std::size_t signal_dispatcher::size() const
+{
+  return this->subscriptions_.size();
+}
+
+bool signal_dispatcher::empty() const
+{
+  return this->subscriptions_.empty();
+}
+
+void signal_dispatcher::update_mask()
+{
+  // collect subscribed signals
+  sigset_t mask;
+  ::sigemptyset(&mask);
+  std::set<signal_number_type> signals;
+  subscription_map_type::const_iterator end = this->subscriptions_.end();
+  for(subscription_map_type::const_iterator i = this->subscriptions_.begin(); i != end; ++i) {
+    signals.insert(i->second.signal);
+    if(::sigaddset(&mask, i->second.signal) != 0) {
+      throw_posix_error(errno);
+    }
+  }
+
+  // block signals, which are not blocked yet (otherwise they would not be delivered via signalfd)
+  sigset_t orig_mask;
+  int rc_sigmask = ::pthread_sigmask(SIG_BLOCK, &mask, &orig_mask);
+  if(rc_sigmask != 0) {
+    throw_posix_error(rc_sigmask);
+  }
+  std::set<signal_number_type>::const_iterator signals_end = signals.end();
+  for(std::set<signal_number_type>::const_iterator i = signals.begin(); i != signals_end; ++i) {
+    if(!::sigismember(&orig_mask, *i)) {
+      this->blocked_signals_.insert(*i);
+    }
+  }
+
+  // update signalfd
+  if(::signalfd(this->signal_fd_, &mask, 0) == -1) {
+    throw_posix_error(errno);
+  }
+
+  // unblock signals blocked by the dispatcher, which have no subscriber anymore
+  std::set<signal_number_type> unsubscribed;
+  std::set<signal_number_type>::const_iterator blocked_end = this->blocked_signals_.end();
+  for(std::set<signal_number_type>::const_iterator i = this->blocked_signals_.begin(); i != blocked_end; ++i) {
+    if(signals.find(*i) == signals_end) {
+      unsubscribed.insert(*i);
+    }
+  }
+  release_signals(unsubscribed);
+  for(std::set<signal_number_type>::const_iterator i = unsubscribed.begin(); i != unsubscribed.end(); ++i) {
+    this->blocked_signals_.erase(*i);
+  }
+}
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+// vim: set ts=2 sw=2 et:
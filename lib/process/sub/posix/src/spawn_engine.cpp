@@ -0,0 +1,260 @@
+/// \file process/sub/posix/src/spawn_engine.cpp
+/// \brief POSIX spawn engine implementation.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+// vfork(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/vfork.html
+// clone(2): http://man7.org/linux/man-pages/man2/clone.2.html
+// posix_spawn(3): http://pubs.opengroup.org/onlinepubs/009695399/functions/posix_spawn.html
+// execve(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/exec.html
+// pthread_sigmask(3): http://pubs.opengroup.org/onlinepubs/009695399/functions/pthread_sigmask.html
+// waitpid(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/wait.html
+
+
+#include <cerrno>
+#include <cstddef>
+#include <vector>
+
+#include <unistd.h>
+#include <signal.h>
+#include <sched.h>
+#include <spawn.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "sheratan/errhdl/assert.hpp"
+#include "sheratan/errhdl/throw.hpp"
+#include "sheratan/process/posix/error_category.hpp"
+#include "sheratan/process/posix/exec_ctl.hpp"
+#include "spawn_engine.hpp"
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+/// \def NSIG
+/// \brief Number of signals defined by the system.
+# ifndef NSIG
+#   ifdef _NSIG
+#     define NSIG _NSIG
+#   else
+#     define NSIG 32
+#   endif
+# endif
+
+
+namespace {
+
+
+/// \brief Stack size of the child process created by \c clone.
+/// \note Child process only resets signal dispositions and calls
+/// \c execve on this stack.
+static const std::size_t clone_stack_size = 64 * 1024;
+
+
+/// \brief Context of the child process sharing address space with its parent.
+/// \ingroup sheratan_process_posix
+/// \nosubgrouping
+struct shared_child_context
+{
+  /// \brief Path to the program image.
+  const char *path;
+
+  /// \brief Argument vector.
+  char * const *argv;
+
+  /// \brief Environment vector.
+  char * const *envp;
+
+  /// \brief Original signal mask of the parent.
+  const sigset_t *orig_mask;
+
+  /// \brief Error number reported by failed \c execve.
+  volatile int *exec_errnum;
+};
+
+
+/// \brief Routine of the child process sharing address space with its parent.
+/// \param arg Pointer to \c shared_child_context structure.
+/// \return Exit status of the child process (it returns only in case of an error).
+/// \par Abrahams exception guarantee:
+/// no-throw
+/// \note Only async-signal-safe functions may be called from this routine.
+static int shared_child(void *arg)
+{
+  shared_child_context *context = static_cast<shared_child_context *>(arg);
+
+  // signal handlers of the parent must never run in child sharing its address space,
+  // so reset all caught signals to their default dispositions (ignored ones are kept)
+  for(signal_number_type i = 1; i < NSIG; ++i) {
+    struct sigaction signal_sigaction;
+    if(::sigaction(i, NULL, &signal_sigaction) != 0) {
+      continue;
+    }
+    if((signal_sigaction.sa_handler == SIG_DFL) || (signal_sigaction.sa_handler == SIG_IGN)) {
+      continue;
+    }
+    signal_sigaction.sa_handler = SIG_DFL;
+    signal_sigaction.sa_flags = 0;
+    ::sigemptyset(&signal_sigaction.sa_mask);
+    ::sigaction(i, &signal_sigaction, NULL);
+  }
+
+  // restore original signal mask
+  ::sigprocmask(SIG_SETMASK, context->orig_mask, NULL);
+
+  // replace program image (returns only in case of an error)
+  ::execve(context->path, context->argv, context->envp);
+
+  // report failure to the parent through the shared address space
+  *context->exec_errnum = errno;
+  return exec_ctl::EXEC_FAILURE;
+}
+
+/// \brief Block all signals.
+/// \param orig_mask Original signal mask.
+/// \par Abrahams exception guarantee:
+/// strong
+static void block_all_signals(sigset_t &orig_mask)
+{
+  sigset_t all_signals;
+  ::sigfillset(&all_signals);
+  int rc_sigmask = ::pthread_sigmask(SIG_SETMASK, &all_signals, &orig_mask);
+  if(rc_sigmask != 0) {
+    sheratan::errhdl::runtime_error ex_to_throw;
+    ex_to_throw << error_category::error_info::posix_errnum(rc_sigmask);
+    SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
+  }
+}
+
+
+} // anonymous namespace
+
+
+process_id::value_type spawn_engine::spawn(spawn_method::value_type method, const exec_ctl &ec)
+{
+  SHERATAN_CHECK(method != spawn_method::FORK);
+
+  volatile int exec_errnum = 0;
+  process_id::value_type pid = -1;
+  switch(method) {
+    case spawn_method::VFORK:
+      pid = spawn_engine::spawn_vfork(ec, exec_errnum);
+      break;
+    case spawn_method::CLONE_VM_VFORK:
+      pid = spawn_engine::spawn_clone_vfork(ec, exec_errnum);
+      break;
+    case spawn_method::POSIX_SPAWN:
+      pid = spawn_engine::spawn_posix_spawn(ec, exec_errnum);
+      break;
+    case spawn_method::FORK:
+      break;
+  }
+
+  // spawn failed
+  if(pid == -1) {
+    int saved_errnum = errno;
+    sheratan::errhdl::runtime_error ex_to_throw;
+    ex_to_throw << error_category::error_info::posix_errnum(saved_errnum);
+    SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
+  }
+
+  // child failed to execute program image: reap it and report the error
+  if(exec_errnum != 0) {
+    int saved_errnum = exec_errnum;
+    int status;
+    while((::waitpid(pid, &status, 0) == -1) && (errno == EINTR)) {
+      // retry
+    }
+    sheratan::errhdl::runtime_error ex_to_throw;
+    ex_to_throw << error_category::error_info::posix_errnum(saved_errnum);
+    SHERATAN_THROW_EXCEPTION(ex_to_throw, sheratan::errhdl::error_code(errnum::POSIX_SYSTEM, get_error_category()));
+  }
+
+  return pid;
+}
+
+process_id::value_type spawn_engine::spawn_vfork(const exec_ctl &ec, volatile int &exec_errnum)
+{
+  sigset_t orig_mask;
+  block_all_signals(orig_mask);
+
+  shared_child_context context;
+  context.path = ec.get_path().c_str();
+  context.argv = ec.get_argv();
+  context.envp = ec.get_envp();
+  context.orig_mask = &orig_mask;
+  context.exec_errnum = &exec_errnum;
+
+  // parent is suspended until the child either executes new program image or exits
+  pid_t rc_vfork = ::vfork();
+  if(rc_vfork == 0) { // child
+    ::_exit(shared_child(&context));
+  }
+  int saved_errnum = errno;
+
+  ::pthread_sigmask(SIG_SETMASK, &orig_mask, NULL);
+
+  errno = saved_errnum;
+  return rc_vfork;
+}
+
+process_id::value_type spawn_engine::spawn_clone_vfork(const exec_ctl &ec, volatile int &exec_errnum)
+{
+  // allocate stack for the child (stack grows down on all supported architectures)
+  std::vector<char> stack(clone_stack_size);
+  void *stack_top = &(stack[0]) + clone_stack_size;
+  stack_top = reinterpret_cast<void *>(reinterpret_cast<std::size_t>(stack_top) & ~static_cast<std::size_t>(15));
+
+  sigset_t orig_mask;
+  block_all_signals(orig_mask);
+
+  shared_child_context context;
+  context.path = ec.get_path().c_str();
+  context.argv = ec.get_argv();
+  context.envp = ec.get_envp();
+  context.orig_mask = &orig_mask;
+  context.exec_errnum = &exec_errnum;
+
+  // parent is suspended until the child either executes new program image or exits
+  int rc_clone = ::clone(shared_child, stack_top, CLONE_VM | CLONE_VFORK | SIGCHLD, &context);
+  int saved_errnum = errno;
+
+  ::pthread_sigmask(SIG_SETMASK, &orig_mask, NULL);
+
+  errno = saved_errnum;
+  return rc_clone;
+}
+
+process_id::value_type spawn_engine::spawn_posix_spawn(const exec_ctl &ec, volatile int &exec_errnum)
+{
+  pid_t pid = -1;
+  int rc_spawn = ::posix_spawn(&pid, ec.get_path().c_str(), NULL, NULL, ec.get_argv(), ec.get_envp());
+  if(rc_spawn != 0) {
+    // posix_spawn reaps child, which failed to execute program image, by itself
+    errno = rc_spawn;
+    return -1;
+  }
+
+  // make compiler shut up about unused parameter exec_errnum (execve
+  // failure is reported via return value of posix_spawn)
+  exec_errnum = 0;
+
+  return pid;
+}
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+// vim: set ts=2 sw=2 et:
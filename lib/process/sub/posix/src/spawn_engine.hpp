@@ -0,0 +1,93 @@
+/// \file process/sub/posix/src/spawn_engine.hpp
+/// \brief POSIX spawn engine interface.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#ifndef HGI_SHERATAN_PROCESS_POSIX_SPAWN_ENGINE_HPP
+#define HGI_SHERATAN_PROCESS_POSIX_SPAWN_ENGINE_HPP
+
+
+#include <boost/noncopyable.hpp>
+
+#include "sheratan/process/posix/fwd.hpp"
+#include "sheratan/process/posix/process_id.hpp"
+#include "sheratan/process/posix/spawn_method.hpp"
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+/// \brief POSIX spawn engine.
+/// \ingroup sheratan_process_posix
+/// \nosubgrouping
+/// \note Spawn engine implements all spawn methods executing new
+/// program image described by exec controller, which do not copy
+/// address space of the parent process.
+class spawn_engine : private boost::noncopyable
+{
+  private:
+
+    /// \brief Restricted default constructor.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    spawn_engine();
+
+  public:
+
+    /// \brief Spawn child process executing program image.
+    /// \param method Spawn method.
+    /// \param ec Exec controller describing program image to be executed.
+    /// \return Process ID of the child process.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \pre <code>method != spawn_method::FORK</code>
+    /// \pre Prefork routine of exec controller must have been called.
+    /// \note In case when the child process fails to execute program
+    /// image, it is reaped and an exception carrying \c errno reported
+    /// by \c execve is thrown.
+    static process_id::value_type spawn(spawn_method::value_type method, const exec_ctl &ec);
+
+  private:
+
+    /// \brief Spawn child process using \c vfork.
+    /// \param ec Exec controller.
+    /// \param exec_errnum Error number reported by failed \c execve.
+    /// \return Process ID of the child process, or \c -1 in case of an error.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    static process_id::value_type spawn_vfork(const exec_ctl &ec, volatile int &exec_errnum);
+
+    /// \brief Spawn child process using \c clone with <code>CLONE_VM | CLONE_VFORK</code>.
+    /// \param ec Exec controller.
+    /// \param exec_errnum Error number reported by failed \c execve.
+    /// \return Process ID of the child process, or \c -1 in case of an error.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    static process_id::value_type spawn_clone_vfork(const exec_ctl &ec, volatile int &exec_errnum);
+
+    /// \brief Spawn child process using \c posix_spawn.
+    /// \param ec Exec controller.
+    /// \param exec_errnum Error number reported by failed \c execve.
+    /// \return Process ID of the child process, or \c -1 in case of an error.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    static process_id::value_type spawn_posix_spawn(const exec_ctl &ec, volatile int &exec_errnum);
+};
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+#endif // HGI_SHERATAN_PROCESS_POSIX_SPAWN_ENGINE_HPP
+
+
+// vim: set ts=2 sw=2 et:
@@ -0,0 +1,54 @@
+/// \file process/sub/posix/src/terminate.cpp
+/// \brief POSIX process termination implementation.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#include <signal.h>
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+#include "sheratan/errhdl/assert.hpp"
+#include "sheratan/process/posix/process.hpp"
+#include "sheratan/process/posix/terminate.hpp"
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+exit_status terminate(process &proc, const system_duration_type &grace_period, signal_number_type signal)
+{
+  SHERATAN_CHECK(proc.valid());
+  SHERATAN_CHECK(!grace_period.is_special());
+
+  // process, which has already terminated, needs no signal
+  exit_status status = proc.join(true);
+  if(status.valid()) {
+    return status;
+  }
+
+  // at first, ask politely and give it the grace period to exit
+  proc.kill(signal);
+  status = proc.timed_join(boost::posix_time::microsec_clock::universal_time() + grace_period);
+  if(status.valid()) {
+    return status;
+  }
+
+  // stop being polite and just plain kill it
+  proc.kill(SIGKILL);
+  return proc.join();
+}
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+// vim: set ts=2 sw=2 et:
@@ -0,0 +1,536 @@
+/// \file process/sub/posix/src/uring_reactor_engine.cpp
+/// \brief POSIX io_uring reactor engine implementation.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+// io_uring_setup(2): http://man7.org/linux/man-pages/man2/io_uring_setup.2.html
+// io_uring_enter(2): http://man7.org/linux/man-pages/man2/io_uring_enter.2.html
+// io_uring_register(2): http://man7.org/linux/man-pages/man2/io_uring_register.2.html
+// mmap(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/mmap.html
+// munmap(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/munmap.html
+// close(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/close.html
+
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+#include "sheratan/errhdl/assert.hpp"
+#include "sheratan/process/posix/error_category.hpp"
+#include "pidfd.hpp"
+#include "uring_reactor_engine.hpp"
+#include "posix_error.hpp"
+
+
+/// \def P_PIDFD
+/// \brief Wait for child referred to by process file descriptor.
+# ifndef P_PIDFD
+#   define P_PIDFD 3
+# endif
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+namespace {
+
+
+/// \brief Number of submission queue entries.
+static const unsigned int sq_entries = 256;
+
+/// \brief Number of completion queue entries.
+static const unsigned int cq_entries = 4096;
+
+/// \brief Opcode of \c IORING_OP_WAITID (not yet defined by all kernel headers).
+static const uint8_t uring_op_waitid = 50;
+
+/// \brief Token of internal requests, whose completions are ignored.
+static const uint64_t internal_token = 0;
+
+
+/// \brief Convert I/O event mask into \c poll events.
+/// \param events Mask of I/O events.
+/// \return Mask of \c poll events.
+/// \par Abrahams exception guarantee:
+/// no-throw
+static uint32_t to_poll_events(io_event_mask_type events)
+{
+  uint32_t ret = 0;
+  if(events & io_events::READABLE) {
+    ret |= POLLIN | POLLRDHUP;
+  }
+  if(events & io_events::WRITABLE) {
+    ret |= POLLOUT;
+  }
+  return ret;
+}
+
+/// \brief Convert \c poll events into I/O event mask.
+/// \param events Mask of \c poll events.
+/// \return Mask of I/O events.
+/// \par Abrahams exception guarantee:
+/// no-throw
+static io_event_mask_type from_poll_events(uint32_t events)
+{
+  io_event_mask_type ret = io_events::NONE;
+  if(events & (POLLIN | POLLPRI)) {
+    ret |= io_events::READABLE;
+  }
+  if(events & POLLOUT) {
+    ret |= io_events::WRITABLE;
+  }
+  if(events & (POLLHUP | POLLRDHUP)) {
+    ret |= io_events::HANGUP;
+  }
+  if(events & (POLLERR | POLLNVAL)) {
+    ret |= io_events::FAILURE;
+  }
+  return ret;
+}
+
+/// \brief Determine whether the ring supports \c IORING_OP_WAITID.
+/// \param ring_fd File descriptor of the ring.
+/// \retval true Operation is supported.
+/// \retval false Operation is not supported.
+/// \par Abrahams exception guarantee:
+/// strong
+static bool probe_waitid(file_descriptor_type ring_fd)
+{
+  static const unsigned int probe_ops = 256;
+  std::vector<char> buffer(sizeof(struct io_uring_probe) + probe_ops * sizeof(struct io_uring_probe_op), 0);
+  struct io_uring_probe *probe = reinterpret_cast<struct io_uring_probe *>(&(buffer[0]));
+  if(::syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_PROBE, probe, probe_ops) != 0) {
+    return false;
+  }
+  if(probe->last_op < uring_op_waitid) {
+    return false;
+  }
+  return (probe->ops[uring_op_waitid].flags & IO_URING_OP_SUPPORTED) != 0;
+}
+
+
+} // anonymous namespace
+
+
+uring_reactor_engine::uring_reactor_engine()
+: reactor_engine()
+, ring_fd_(-1)
+, sq_ring_(MAP_FAILED)
+, sq_ring_size_(0)
+, cq_ring_(MAP_FAILED)
+, cq_ring_size_(0)
+, sqes_(static_cast<struct io_uring_sqe *>(MAP_FAILED))
+, sqes_size_(0)
+, sq_head_(NULL)
+, sq_tail_(NULL)
+, sq_mask_(0)
+, sq_entries_(0)
+, sq_array_(NULL)
+, cq_head_(NULL)
+, cq_tail_(NULL)
+, cq_mask_(0)
+, cqes_(NULL)
+, waitid_supported_(false)
+, next_token_(internal_token + 1)
+, registrations_()
+, tokens_()
+, rearm_()
+, backlog_()
+{
+  // create ring (large completion queue, since all watches may complete at once)
+  struct io_uring_params params;
+  std::memset(&params, 0, sizeof(params));
+  params.flags = IORING_SETUP_CQSIZE;
+  params.cq_entries = cq_entries;
+  long rc_setup = ::syscall(__NR_io_uring_setup, sq_entries, &params);
+  if((rc_setup < 0) && (errno == EINVAL)) {
+    std::memset(&params, 0, sizeof(params));
+    rc_setup = ::syscall(__NR_io_uring_setup, sq_entries, &params);
+  }
+  if(rc_setup < 0) {
+    throw_posix_error(errno);
+  }
+  this->ring_fd_ = static_cast<file_descriptor_type>(rc_setup);
+
+  try {
+    // map rings (single mapping is shared by both rings on Linux 5.4 and newer)
+    this->sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    this->cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if(params.features & IORING_FEAT_SINGLE_MMAP) {
+      this->sq_ring_size_ = std::max(this->sq_ring_size_, this->cq_ring_size_);
+      this->cq_ring_size_ = this->sq_ring_size_;
+    }
+    this->sq_ring_ = ::mmap(NULL, this->sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->ring_fd_, IORING_OFF_SQ_RING);
+    if(this->sq_ring_ == MAP_FAILED) {
+      throw_posix_error(errno);
+    }
+    if(params.features & IORING_FEAT_SINGLE_MMAP) {
+      this->cq_ring_ = this->sq_ring_;
+    }
+    else {
+      this->cq_ring_ = ::mmap(NULL, this->cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->ring_fd_, IORING_OFF_CQ_RING);
+      if(this->cq_ring_ == MAP_FAILED) {
+        throw_posix_error(errno);
+      }
+    }
+    this->sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+    void *sqes = ::mmap(NULL, this->sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->ring_fd_, IORING_OFF_SQES);
+    if(sqes == MAP_FAILED) {
+      throw_posix_error(errno);
+    }
+    this->sqes_ = static_cast<struct io_uring_sqe *>(sqes);
+  }
+  catch(...) {
+    this->release();
+    throw;
+  }
+
+  char *sq = static_cast<char *>(this->sq_ring_);
+  this->sq_head_ = reinterpret_cast<unsigned int *>(sq + params.sq_off.head);
+  this->sq_tail_ = reinterpret_cast<unsigned int *>(sq + params.sq_off.tail);
+  this->sq_mask_ = *reinterpret_cast<unsigned int *>(sq + params.sq_off.ring_mask);
+  this->sq_entries_ = *reinterpret_cast<unsigned int *>(sq + params.sq_off.ring_entries);
+  this->sq_array_ = reinterpret_cast<unsigned int *>(sq + params.sq_off.array);
+  char *cq = static_cast<char *>(this->cq_ring_);
+  this->cq_head_ = reinterpret_cast<unsigned int *>(cq + params.cq_off.head);
+  this->cq_tail_ = reinterpret_cast<unsigned int *>(cq + params.cq_off.tail);
+  this->cq_mask_ = *reinterpret_cast<unsigned int *>(cq + params.cq_off.ring_mask);
+  this->cqes_ = reinterpret_cast<struct io_uring_cqe *>(cq + params.cq_off.cqes);
+
+  this->waitid_supported_ = probe_waitid(this->ring_fd_);
+}
+
+uring_reactor_engine::~uring_reactor_engine()
+{
+  this->release();
+}
+
+void uring_reactor_engine::release()
+{
+  // closing the ring cancels all requests in flight
+  if(this->sqes_ != MAP_FAILED) {
+    ::munmap(this->sqes_, this->sqes_size_);
+  }
+  if((this->cq_ring_ != MAP_FAILED) && (this->cq_ring_ != this->sq_ring_)) {
+    ::munmap(this->cq_ring_, this->cq_ring_size_);
+  }
+  if(this->sq_ring_ != MAP_FAILED) {
+    ::munmap(this->sq_ring_, this->sq_ring_size_);
+  }
+  if(this->ring_fd_ != -1) {
+    ::close(this->ring_fd_);
+  }
+  this->sqes_ = static_cast<struct io_uring_sqe *>(MAP_FAILED);
+  this->cq_ring_ = MAP_FAILED;
+  this->sq_ring_ = MAP_FAILED;
+  this->ring_fd_ = -1;
+}
+
+reactor_backend::value_type uring_reactor_engine::get_backend() const
+{
+  return reactor_backend::IO_URING;
+}
+
+void uring_reactor_engine::add(file_descriptor_type fd, io_event_mask_type events)
+{
+  registration r;
+  std::memset(&r, 0, sizeof(r));
+  r.events = events;
+  r.waitid = false;
+  r.token = 0;
+  this->add_registration(fd, r);
+}
+
+void uring_reactor_engine::add_process(file_descriptor_type fd)
+{
+  registration r;
+  std::memset(&r, 0, sizeof(r));
+  r.events = io_events::READABLE;
+  r.waitid = this->waitid_supported_;
+  r.token = 0;
+  this->add_registration(fd, r);
+}
+
+void uring_reactor_engine::modify(file_descriptor_type fd, io_event_mask_type events)
+{
+  registration_map_type::iterator it = this->registrations_.find(fd);
+  SHERATAN_CHECK((it != this->registrations_.end()) && (!it->second.waitid));
+
+  // replace request in flight by new one
+  if(it->second.token != 0) {
+    this->cancel(IORING_OP_POLL_REMOVE, it->second.token);
+    this->tokens_.erase(it->second.token);
+    it->second.token = 0;
+  }
+  it->second.events = events;
+  this->arm(fd);
+}
+
+bool uring_reactor_engine::remove(file_descriptor_type fd, int &status)
+{
+  registration_map_type::iterator it = this->registrations_.find(fd);
+  if(it == this->registrations_.end()) {
+    return false;
+  }
+  uint64_t token = it->second.token;
+  if(token == 0) {
+    this->registrations_.erase(it);
+    return false;
+  }
+  this->tokens_.erase(token);
+
+  if(!it->second.waitid) {
+    // submit cancellation right away, so that request releases file descriptor as soon as possible
+    this->registrations_.erase(it);
+    this->cancel(IORING_OP_POLL_REMOVE, token);
+    this->enter(0);
+    return false;
+  }
+
+  // wait request may complete (and reap the process) before it is cancelled, so its
+  // completion must be awaited (kernel also writes into signal information until then)
+  this->cancel(IORING_OP_ASYNC_CANCEL, token);
+  bool reaped = false;
+  for(bool found = false; !found; ) {
+    completion_list_type completions;
+    this->harvest(completions);
+    for(std::size_t i = 0; i < completions.size(); ++i) {
+      if((!found) && (completions[i].token == token)) {
+        found = true;
+        reaped = (completions[i].res == 0);
+        continue;
+      }
+      this->backlog_.push_back(completions[i]);
+    }
+    if(!found) {
+      this->enter(1);
+    }
+  }
+  if(reaped) {
+    status = pidfd::wait_status(it->second.info);
+  }
+  this->registrations_.erase(it);
+  return reaped;
+}
+
+void uring_reactor_engine::wait(bool nonblocking, reactor_engine::event_list_type &events)
+{
+  for(;;) {
+    // re-arm watches reported by previous wait, unless they were removed in the meantime
+    std::vector<file_descriptor_type> rearm;
+    rearm.swap(this->rearm_);
+    for(std::size_t i = 0; i < rearm.size(); ++i) {
+      registration_map_type::const_iterator it = this->registrations_.find(rearm[i]);
+      if((it != this->registrations_.end()) && (it->second.token == 0)) {
+        this->arm(rearm[i]);
+      }
+    }
+
+    // submit re-armed requests and wait for completions in single system call
+    completion_list_type completions;
+    completions.swap(this->backlog_);
+    this->enter((nonblocking || !completions.empty()) ? 0 : 1);
+    this->harvest(completions);
+
+    for(std::size_t i = 0; i < completions.size(); ++i) {
+      this->complete(completions[i], events);
+    }
+
+    // completions of internal requests (e.g. cancellations) carry no events and blocking wait
+    // might be interrupted without any signal delivered (e.g. by task work), blocking wait goes on
+    if(nonblocking || !events.empty()) {
+      return;
+    }
+  }
+}
+
+void uring_reactor_engine::add_registration(file_descriptor_type fd, const registration &r)
+{
+  SHERATAN_CHECK(this->registrations_.find(fd) == this->registrations_.end());
+
+  this->registrations_[fd] = r;
+  try {
+    this->arm(fd);
+  }
+  catch(...) {
+    this->registrations_.erase(fd);
+    throw;
+  }
+}
+
+void uring_reactor_engine::arm(file_descriptor_type fd)
+{
+  registration &r = this->registrations_[fd];
+  SHERATAN_CHECK(r.token == 0);
+
+  struct io_uring_sqe *sqe = this->get_sqe();
+  uint64_t token = this->next_token_;
+  this->tokens_[token] = fd;
+  ++(this->next_token_);
+  r.token = token;
+
+  sqe->user_data = token;
+  if(r.waitid) {
+    std::memset(&(r.info), 0, sizeof(r.info));
+    sqe->opcode = uring_op_waitid;
+    sqe->fd = fd;
+    sqe->len = P_PIDFD;
+    sqe->file_index = WEXITED;
+    sqe->addr2 = reinterpret_cast<uint64_t>(&(r.info));
+  }
+  else {
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = to_poll_events(r.events);
+  }
+  this->commit_sqe();
+}
+
+void uring_reactor_engine::cancel(uint8_t opcode, uint64_t token)
+{
+  struct io_uring_sqe *sqe = this->get_sqe();
+  sqe->opcode = opcode;
+  sqe->fd = -1;
+  sqe->addr = token;
+  sqe->user_data = internal_token;
+  this->commit_sqe();
+}
+
+struct io_uring_sqe * uring_reactor_engine::get_sqe()
+{
+  unsigned int tail = *(this->sq_tail_);
+  if(tail - __atomic_load_n(this->sq_head_, __ATOMIC_ACQUIRE) >= this->sq_entries_) {
+    // submission queue is full, submit queued requests
+    while(!this->enter(0)) {
+      // retry
+    }
+  }
+
+  struct io_uring_sqe *sqe = &(this->sqes_[tail & this->sq_mask_]);
+  std::memset(sqe, 0, sizeof(*sqe));
+  return sqe;
+}
+
+void uring_reactor_engine::commit_sqe()
+{
+  unsigned int tail = *(this->sq_tail_);
+  this->sq_array_[tail & this->sq_mask_] = tail & this->sq_mask_;
+  __atomic_store_n(this->sq_tail_, tail + 1, __ATOMIC_RELEASE);
+}
+
+bool uring_reactor_engine::enter(unsigned int min_complete)
+{
+  unsigned int flags = (min_complete > 0) ? IORING_ENTER_GETEVENTS : 0;
+  for(;;) {
+    unsigned int to_submit = *(this->sq_tail_) - __atomic_load_n(this->sq_head_, __ATOMIC_ACQUIRE);
+    if((to_submit == 0) && (min_complete == 0)) {
+      return true;
+    }
+    long rc_enter = ::syscall(__NR_io_uring_enter, this->ring_fd_, to_submit, min_complete, flags, NULL, 0);
+    if(rc_enter >= 0) {
+      if(static_cast<unsigned int>(rc_enter) < to_submit) {
+        // not all requests were consumed, do not wait until they are
+        min_complete = 0;
+        flags = 0;
+        continue;
+      }
+      return true;
+    }
+    if(errno == EINTR) {
+      return false;
+    }
+    if((errno == EAGAIN) || (errno == EBUSY)) {
+      // completion queue overflown, make room by moving completions into the backlog
+      this->harvest(this->backlog_);
+      min_complete = 0;
+      flags = 0;
+      continue;
+    }
+    throw_posix_error(errno);
+  }
+}
+
+void uring_reactor_engine::harvest(uring_reactor_engine::completion_list_type &completions)
+{
+  unsigned int head = *(this->cq_head_);
+  unsigned int tail = __atomic_load_n(this->cq_tail_, __ATOMIC_ACQUIRE);
+  completions.reserve(completions.size() + (tail - head));
+  for(; head != tail; ++head) {
+    const struct io_uring_cqe &cqe = this->cqes_[head & this->cq_mask_];
+    completion c;
+    c.token = cqe.user_data;
+    c.res = cqe.res;
+    completions.push_back(c);
+  }
+  __atomic_store_n(this->cq_head_, head, __ATOMIC_RELEASE);
+}
+
+void uring_reactor_engine::complete(const uring_reactor_engine::completion &c, reactor_engine::event_list_type &events)
+{
+  // completions of internal requests and of removed watches are ignored
+  token_map_type::iterator token_it = this->tokens_.find(c.token);
+  if(token_it == this->tokens_.end()) {
+    return;
+  }
+  file_descriptor_type fd = token_it->second;
+  this->tokens_.erase(token_it);
+  registration &r = this->registrations_[fd];
+  r.token = 0;
+
+  reactor_engine::event ev;
+  ev.fd = fd;
+  ev.events = io_events::NONE;
+  ev.reaped = false;
+  ev.status = 0;
+
+  if(r.waitid) {
+    if(c.res == 0) {
+      // process has been reaped
+      ev.events = io_events::READABLE;
+      ev.reaped = true;
+      ev.status = pidfd::wait_status(r.info);
+      events.push_back(ev);
+    }
+    else if(c.res != -ECHILD) {
+      // wait request refused, fall back to polling process file descriptor
+      r.waitid = false;
+      this->rearm_.push_back(fd);
+    }
+    // ECHILD: process has been reaped by other means
+    return;
+  }
+
+  if(c.res < 0) {
+    if(c.res != -ECANCELED) {
+      // failed poll request is not re-armed, failure is reported instead
+      ev.events = io_events::FAILURE;
+      events.push_back(ev);
+    }
+    return;
+  }
+
+  ev.events = from_poll_events(static_cast<uint32_t>(c.res));
+  events.push_back(ev);
+  this->rearm_.push_back(fd);
+}
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+// vim: set ts=2 sw=2 et:
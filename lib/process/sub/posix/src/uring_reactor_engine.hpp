@@ -0,0 +1,254 @@
+/// \file process/sub/posix/src/uring_reactor_engine.hpp
+/// \brief POSIX io_uring reactor engine interface.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#ifndef HGI_SHERATAN_PROCESS_POSIX_URING_REACTOR_ENGINE_HPP
+#define HGI_SHERATAN_PROCESS_POSIX_URING_REACTOR_ENGINE_HPP
+
+
+#include <cstddef>
+#include <vector>
+
+#include <signal.h>
+#include <stdint.h>
+#include <linux/io_uring.h>
+
+#include <boost/unordered_map.hpp>
+
+#include "reactor_engine.hpp"
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+/// \brief POSIX \c io_uring reactor engine.
+/// \ingroup sheratan_process_posix
+/// \nosubgrouping
+/// \note Every watch has at most single request in flight. Readiness
+/// watches are implemented by one-shot \c IORING_OP_POLL_ADD requests,
+/// which are re-armed (after the reactor has dispatched reported events)
+/// together with waiting for next events in single \c io_uring_enter
+/// call, so that they behave as level-triggered. Process watches are
+/// implemented by \c IORING_OP_WAITID requests, which reap terminated
+/// process directly, in case the kernel supports them (Linux 6.7 and
+/// newer), or by polling process file descriptor otherwise.
+class uring_reactor_engine : public reactor_engine
+{
+  public:
+
+    /// \brief Default constructor.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \note Exception is thrown in case \c io_uring is not available
+    /// (e.g. it is not supported or it is disabled by the kernel).
+    uring_reactor_engine();
+
+    /// \brief Destructor.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    virtual ~uring_reactor_engine();
+
+  public:
+
+    virtual reactor_backend::value_type get_backend() const;
+
+    virtual void add(file_descriptor_type fd, io_event_mask_type events);
+
+    virtual void add_process(file_descriptor_type fd);
+
+    virtual void modify(file_descriptor_type fd, io_event_mask_type events);
+
+    virtual bool remove(file_descriptor_type fd, int &status);
+
+    virtual void wait(bool nonblocking, event_list_type &events);
+
+  private:
+
+    /// \brief Watch registration.
+    /// \ingroup sheratan_process_posix
+    /// \nosubgrouping
+    struct registration
+    {
+      /// \brief Mask of I/O events (see \c io_events).
+      io_event_mask_type events;
+
+      /// \brief Whether the process is reaped by \c IORING_OP_WAITID request.
+      bool waitid;
+
+      /// \brief Token of request in flight (\c 0 if there is none).
+      uint64_t token;
+
+      /// \brief Signal information filled in by \c IORING_OP_WAITID request.
+      siginfo_t info;
+    };
+
+    /// \brief Completion of a request.
+    /// \ingroup sheratan_process_posix
+    /// \nosubgrouping
+    struct completion
+    {
+      /// \brief Token of the request.
+      uint64_t token;
+
+      /// \brief Result of the request.
+      int32_t res;
+    };
+
+    /// \brief Registration map type definition.
+    /// \note Elements of unordered map are never relocated, so that kernel
+    /// may write into signal information of a registration.
+    typedef boost::unordered_map<file_descriptor_type, registration> registration_map_type;
+
+    /// \brief Token map type definition.
+    typedef boost::unordered_map<uint64_t, file_descriptor_type> token_map_type;
+
+    /// \brief Completion list type definition.
+    typedef std::vector<completion> completion_list_type;
+
+  private:
+
+    /// \brief Unmap rings and close the ring.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    void release();
+
+    /// \brief Register watch and submit its request.
+    /// \param fd File descriptor.
+    /// \param r Registration.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    void add_registration(file_descriptor_type fd, const registration &r);
+
+    /// \brief Queue request of the watch.
+    /// \param fd File descriptor.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    void arm(file_descriptor_type fd);
+
+    /// \brief Queue request cancelling request in flight.
+    /// \param opcode Cancelling operation (\c IORING_OP_POLL_REMOVE or \c IORING_OP_ASYNC_CANCEL).
+    /// \param token Token of request to be cancelled.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    void cancel(uint8_t opcode, uint64_t token);
+
+    /// \brief Get free submission queue entry.
+    /// \return Zeroed submission queue entry.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    /// \note Queued requests are submitted, in case the submission queue is full.
+    struct io_uring_sqe * get_sqe();
+
+    /// \brief Make submission queue entry obtained by \c get_sqe visible to the kernel.
+    /// \par Abrahams exception guarantee:
+    /// no-throw
+    void commit_sqe();
+
+    /// \brief Submit queued requests and optionally wait for completions.
+    /// \param min_complete Number of completions to wait for.
+    /// \retval true Success.
+    /// \retval false Wait was interrupted by a signal.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    bool enter(unsigned int min_complete);
+
+    /// \brief Move completions from the completion queue into the list.
+    /// \param completions Completion list.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    void harvest(completion_list_type &completions);
+
+    /// \brief Process completion.
+    /// \param c Completion.
+    /// \param events List, where events are appended.
+    /// \par Abrahams exception guarantee:
+    /// strong
+    void complete(const completion &c, event_list_type &events);
+
+  private:
+
+    /// \brief File descriptor of the ring.
+    file_descriptor_type ring_fd_;
+
+    /// \brief Mapped submission queue ring.
+    void *sq_ring_;
+
+    /// \brief Size of mapped submission queue ring.
+    std::size_t sq_ring_size_;
+
+    /// \brief Mapped completion queue ring.
+    void *cq_ring_;
+
+    /// \brief Size of mapped completion queue ring.
+    std::size_t cq_ring_size_;
+
+    /// \brief Mapped submission queue entries.
+    struct io_uring_sqe *sqes_;
+
+    /// \brief Size of mapped submission queue entries.
+    std::size_t sqes_size_;
+
+    /// \brief Submission queue head (written by the kernel).
+    unsigned int *sq_head_;
+
+    /// \brief Submission queue tail.
+    unsigned int *sq_tail_;
+
+    /// \brief Submission queue ring mask.
+    unsigned int sq_mask_;
+
+    /// \brief Number of submission queue entries.
+    unsigned int sq_entries_;
+
+    /// \brief Submission queue index array.
+    unsigned int *sq_array_;
+
+    /// \brief Completion queue head.
+    unsigned int *cq_head_;
+
+    /// \brief Completion queue tail (written by the kernel).
+    unsigned int *cq_tail_;
+
+    /// \brief Completion queue ring mask.
+    unsigned int cq_mask_;
+
+    /// \brief Completion queue entries.
+    struct io_uring_cqe *cqes_;
+
+    /// \brief Whether \c IORING_OP_WAITID is supported.
+    bool waitid_supported_;
+
+    /// \brief Token of next request.
+    uint64_t next_token_;
+
+    /// \brief Registrations indexed by file descriptor.
+    registration_map_type registrations_;
+
+    /// \brief File descriptors indexed by tokens of requests in flight.
+    token_map_type tokens_;
+
+    /// \brief File descriptors of watches to be re-armed before next wait.
+    std::vector<file_descriptor_type> rearm_;
+
+    /// \brief Completions harvested, but not yet processed.
+    completion_list_type backlog_;
+};
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+#endif // HGI_SHERATAN_PROCESS_POSIX_URING_REACTOR_ENGINE_HPP
+
+
+// vim: set ts=2 sw=2 et:
@@ -0,0 +1,289 @@
+/// \file process/sub/posix/src/worker_pool.cpp
+/// \brief POSIX worker pool implementation.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#include <cerrno>
+
+#include <signal.h>
+
+#include <boost/bind/bind.hpp>
+
+#include "sheratan/errhdl/assert.hpp"
+#include "sheratan/errhdl/exception.hpp"
+#include "sheratan/process/posix/error_category.hpp"
+#include "sheratan/process/posix/process_template.hpp"
+#include "sheratan/process/posix/worker_pool.hpp"
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+namespace {
+
+
+/// \brief Worker process type definition.
+typedef process_template<struct worker_pool_process_tag> worker_process;
+
+
+/// \brief Get current time.
+/// \return Current system time (UTC).
+/// \par Abrahams exception guarantee:
+/// no-throw
+static system_time_type now()
+{
+  return boost::posix_time::microsec_clock::universal_time();
+}
+
+
+} // anonymous namespace
+
+
+worker_pool::slot::slot()
+: proc(new worker_process())
+, started(boost::posix_time::not_a_date_time)
+, crashes(0)
+, respawn_pending(false)
+, respawn_timer(0)
+{
+}
+
+worker_pool::worker_pool(
+  reactor &r,
+  const fork_ctl &fc,
+  std::size_t size,
+  const system_duration_type &min_uptime,
+  const system_duration_type &backoff_min,
+  const system_duration_type &backoff_max,
+  const worker_pool::exit_handler_type &on_exit
+)
+: reactor_(r)
+, fork_ctl_(fc.clone())
+, min_uptime_(min_uptime)
+, backoff_min_(backoff_min)
+, backoff_max_(backoff_max)
+, on_exit_(on_exit)
+, slots_()
+, running_(0)
+, respawn_count_(0)
+, started_(false)
+, shutting_down_(false)
+, grace_pending_(false)
+, grace_timer_(0)
+{
+  SHERATAN_CHECK(size > 0);
+  SHERATAN_CHECK(backoff_min > boost::posix_time::time_duration(0, 0, 0));
+  SHERATAN_CHECK(backoff_max >= backoff_min);
+
+  for(std::size_t i = 0; i < size; ++i) {
+    this->slots_.push_back(new slot());
+  }
+}
+
+worker_pool::~worker_pool()
+{
+  if(this->grace_pending_) {
+    this->reactor_.cancel_timer(this->grace_timer_);
+  }
+  for(slot_list_type::iterator i = this->slots_.begin(); i != this->slots_.end(); ++i) {
+    if(i->respawn_pending) {
+      this->reactor_.cancel_timer(i->respawn_timer);
+    }
+    if(!i->proc->valid()) {
+      continue;
+    }
+    this->reactor_.unwatch_process(*i->proc);
+    if(!i->proc->valid()) {
+      // reaped in the meantime
+      continue;
+    }
+    try {
+      i->proc->kill(SIGKILL);
+      i->proc->join();
+    }
+    catch(...) {
+      i->proc->detach();
+    }
+  }
+}
+
+void worker_pool::start()
+{
+  SHERATAN_CHECK(!this->started_);
+
+  this->started_ = true;
+  for(std::size_t i = 0; i < this->slots_.size(); ++i) {
+    this->spawn(i);
+  }
+}
+
+void worker_pool::broadcast(signal_number_type signal)
+{
+  for(slot_list_type::iterator i = this->slots_.begin(); i != this->slots_.end(); ++i) {
+    if(!i->proc->valid()) {
+      continue;
+    }
+    try {
+      i->proc->kill(signal);
+    }
+    catch(sheratan::errhdl::runtime_error &ex) {
+      // worker has terminated, it is going to be reaped by the reactor
+      if(get_posix_errnum(ex) != ESRCH) {
+        throw;
+      }
+    }
+  }
+}
+
+void worker_pool::shutdown(signal_number_type signal, const system_duration_type &grace)
+{
+  SHERATAN_CHECK(grace > boost::posix_time::time_duration(0, 0, 0));
+
+  this->shutting_down_ = true;
+  for(slot_list_type::iterator i = this->slots_.begin(); i != this->slots_.end(); ++i) {
+    if(i->respawn_pending) {
+      this->reactor_.cancel_timer(i->respawn_timer);
+      i->respawn_pending = false;
+    }
+  }
+  if(this->running_ == 0) {
+    return;
+  }
+
+  // all the workers are signaled at once, so they terminate in parallel
+  this->broadcast(signal);
+  if(!this->grace_pending_) {
+    this->grace_timer_ = this->reactor_.add_timer(grace, boost::bind(&worker_pool::on_grace_expired, this));
+    this->grace_pending_ = true;
+  }
+  while(this->running_ > 0) {
+    this->reactor_.run_one();
+  }
+  if(this->grace_pending_) {
+    this->reactor_.cancel_timer(this->grace_timer_);
+    this->grace_pending_ = false;
+  }
+}
+
+std::size_t worker_pool::size() const
+{
+  return this->slots_.size();
+}
+
+std::size_t worker_pool::running() const
+{
+  return this->running_;
+}
+
+const process & worker_pool::get_worker(std::size_t index) const
+{
+  SHERATAN_CHECK(index < this->slots_.size());
+
+  return *this->slots_[index].proc;
+}
+
+std::size_t worker_pool::get_respawn_count() const
+{
+  return this->respawn_count_;
+}
+
+void worker_pool::spawn(std::size_t index)
+{
+  slot &s = this->slots_[index];
+  std::auto_ptr<process> proc(new worker_process(*this->fork_ctl_));
+  try {
+    this->reactor_.watch_process(*proc, boost::bind(&worker_pool::on_worker_exit, this, index, boost::placeholders::_1, boost::placeholders::_2));
+  }
+  catch(...) {
+    try {
+      proc->kill(SIGKILL);
+      proc->join();
+    }
+    catch(...) {
+      proc->detach();
+    }
+    throw;
+  }
+  s.proc = proc;
+  s.started = now();
+  ++this->running_;
+}
+
+void worker_pool::respawn(std::size_t index)
+{
+  slot &s = this->slots_[index];
+  s.respawn_pending = false;
+  try {
+    this->spawn(index);
+  }
+  catch(sheratan::errhdl::runtime_error &) {
+    // failure to fork (e.g. process limit reached) counts as a crash
+    ++s.crashes;
+    this->schedule_respawn(index);
+    return;
+  }
+  ++this->respawn_count_;
+}
+
+void worker_pool::schedule_respawn(std::size_t index)
+{
+  slot &s = this->slots_[index];
+  if(s.crashes == 0) {
+    this->respawn(index);
+    return;
+  }
+
+  // delay doubles with each consecutive crash
+  system_duration_type delay = this->backoff_min_;
+  for(unsigned int i = 1; (i < s.crashes) && (delay < this->backoff_max_); ++i) {
+    delay = delay * 2;
+  }
+  if(delay > this->backoff_max_) {
+    delay = this->backoff_max_;
+  }
+  s.respawn_timer = this->reactor_.add_timer(delay, boost::bind(&worker_pool::respawn, this, index));
+  s.respawn_pending = true;
+}
+
+void worker_pool::on_worker_exit(std::size_t index, process &, const exit_status &status)
+{
+  slot &s = this->slots_[index];
+  --this->running_;
+  system_duration_type uptime = now() - s.started;
+
+  if(this->on_exit_) {
+    this->on_exit_(index, status);
+  }
+  if(this->shutting_down_) {
+    return;
+  }
+
+  if(uptime < this->min_uptime_) {
+    ++s.crashes;
+  }
+  else {
+    s.crashes = 0;
+  }
+  this->schedule_respawn(index);
+}
+
+void worker_pool::on_grace_expired()
+{
+  this->grace_pending_ = false;
+  this->broadcast(SIGKILL);
+}
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+// vim: set ts=2 sw=2 et:
@@ -0,0 +1,317 @@
+/// \file process/sub/posix/src/zygote.cpp
+/// \brief POSIX zygote implementation.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+// socketpair(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/socketpair.html
+// send(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/send.html
+// recv(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/recv.html
+// shutdown(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/shutdown.html
+// clone(2): http://man7.org/linux/man-pages/man2/clone.2.html
+// close(2): http://pubs.opengroup.org/onlinepubs/009695399/functions/close.html
+
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+
+#include "sheratan/errhdl/assert.hpp"
+#include "sheratan/errhdl/throw.hpp"
+#include "sheratan/process/posix/error_category.hpp"
+#include "sheratan/process/posix/forker.hpp"
+#include "sheratan/process/posix/zygote.hpp"
+#include "posix_error.hpp"
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+namespace {
+
+
+/// \brief Zygote protocol version.
+static const uint32_t protocol_version = 1;
+
+/// \brief Spawn request header (request data follow).
+/// \ingroup sheratan_process_posix
+/// \nosubgrouping
+struct zygote_request_header
+{
+  /// \brief Protocol version.
+  uint32_t version;
+};
+
+/// \brief Reply of the zygote (to its initialization or to spawn request).
+/// \ingroup sheratan_process_posix
+/// \nosubgrouping
+struct zygote_reply
+{
+  /// \brief Protocol version.
+  uint32_t version;
+
+  /// \brief Process ID of the zygote (initialization) or of the worker (spawn request), \c -1 on failure.
+  int32_t pid;
+
+  /// \brief Error number (\c errno) in case of failure.
+  int32_t errnum;
+};
+
+
+/// \brief Throw exception reporting failed zygote.
+/// \par Abrahams exception guarantee:
+/// strong
+static void throw_zygote_failed()
+{
+  SHERATAN_THROW_EXCEPTION(sheratan::errhdl::runtime_error(), sheratan::errhdl::error_code(errnum::ZYGOTE_FAILED, get_error_category()));
+}
+
+/// \brief Send reply.
+/// \param fd Control socket.
+/// \param pid Process ID.
+/// \param errnum Error number.
+/// \retval true Reply has been sent.
+/// \retval false Reply could not be sent.
+/// \par Abrahams exception guarantee:
+/// no-throw
+static bool send_reply(file_descriptor_type fd, pid_t pid, int errnum)
+{
+  zygote_reply reply;
+  std::memset(&reply, 0, sizeof(reply));
+  reply.version = protocol_version;
+  reply.pid = static_cast<int32_t>(pid);
+  reply.errnum = static_cast<int32_t>(errnum);
+  ssize_t rc_send;
+  do {
+    rc_send = ::send(fd, &reply, sizeof(reply), MSG_NOSIGNAL);
+  } while((rc_send < 0) && (errno == EINTR));
+  return (rc_send == static_cast<ssize_t>(sizeof(reply)));
+}
+
+/// \brief Receive reply.
+/// \param fd Control socket.
+/// \return Process ID carried by the reply.
+/// \par Abrahams exception guarantee:
+/// strong
+/// \note Closed control socket is reported as failed zygote, failure
+/// reported by the zygote is thrown as POSIX system error.
+static pid_t recv_reply(file_descriptor_type fd)
+{
+  zygote_reply reply;
+  std::memset(&reply, 0, sizeof(reply));
+  ssize_t rc_recv;
+  do {
+    rc_recv = ::recv(fd, &reply, sizeof(reply), 0);
+  } while((rc_recv < 0) && (errno == EINTR));
+  if(rc_recv < 0) {
+    if(errno == ECONNRESET) {
+      throw_zygote_failed();
+    }
+    throw_posix_error(errno);
+  }
+  if(rc_recv == 0) {
+    throw_zygote_failed();
+  }
+  if((rc_recv != static_cast<ssize_t>(sizeof(reply))) || (reply.version != protocol_version)) {
+    throw_posix_error(EPROTO);
+  }
+  if(reply.pid <= 0) {
+    throw_posix_error(reply.errnum);
+  }
+  return static_cast<pid_t>(reply.pid);
+}
+
+/// \brief Fork a sibling of the calling process.
+/// \return Process ID of the child (in the calling process), \c 0 (in the
+/// child process), or \c -1 in case of an error (\c errno is set).
+/// \par Abrahams exception guarantee:
+/// no-throw
+/// \note Parent of the child is the parent of the calling process. Without
+/// stack given, the child continues on the copy of the stack of the calling
+/// process, just like after \c fork.
+static pid_t fork_sibling()
+{
+#if defined(__s390__) || defined(__CRIS__)
+  return static_cast<pid_t>(::syscall(SYS_clone, 0, CLONE_PARENT|SIGCHLD, NULL, NULL, 0));
+#else
+  return static_cast<pid_t>(::syscall(SYS_clone, CLONE_PARENT|SIGCHLD, 0, NULL, NULL, 0));
+#endif
+}
+
+/// \brief Zygote process routine.
+/// \param zc Zygote controller.
+/// \param fd Zygote's end of control socket.
+/// \return Return value of zygote process.
+/// \par Abrahams exception guarantee:
+/// no-throw
+static exit_status::value_type serve(const zygote_ctl &zc, file_descriptor_type fd)
+{
+  // controller is owned by the zygote, workers inherit it initialized
+  std::auto_ptr<zygote_ctl> ctl;
+  std::vector<char> buffer;
+  try {
+    ctl.reset(zc.clone());
+    buffer.resize(sizeof(zygote_request_header) + zygote::MAX_REQUEST);
+    ctl->init();
+  }
+  catch(...) {
+    return EXIT_FAILURE;
+  }
+  if(!send_reply(fd, ::getpid(), 0)) {
+    return EXIT_FAILURE;
+  }
+
+  for(;;) {
+    ssize_t rc_recv = ::recv(fd, &buffer[0], buffer.size(), 0);
+    if(rc_recv < 0) {
+      if(errno == EINTR) {
+        continue;
+      }
+      return EXIT_FAILURE;
+    }
+    if(rc_recv == 0) {
+      // control socket has been shut down
+      return EXIT_SUCCESS;
+    }
+
+    zygote_request_header header;
+    std::memset(&header, 0, sizeof(header));
+    if(static_cast<std::size_t>(rc_recv) >= sizeof(header)) {
+      std::memcpy(&header, &buffer[0], sizeof(header));
+    }
+    if(header.version != protocol_version) {
+      if(!send_reply(fd, -1, EPROTO)) {
+        return EXIT_FAILURE;
+      }
+      continue;
+    }
+
+    pid_t pid = fork_sibling();
+    if(pid == 0) {
+      // worker
+      ::close(fd);
+      std::string request(&buffer[sizeof(header)], static_cast<std::size_t>(rc_recv) - sizeof(header));
+      std::exit(ctl->worker(request));
+    }
+    if(!send_reply(fd, pid, (pid < 0) ? errno : 0)) {
+      return EXIT_FAILURE;
+    }
+  }
+}
+
+
+} // anonymous namespace
+
+
+const std::size_t zygote::MAX_REQUEST = 4096;
+
+
+zygote::zygote(const zygote_ctl &zc)
+: fd_(-1)
+, process_()
+{
+  int sv[2];
+  if(::socketpair(AF_UNIX, SOCK_SEQPACKET|SOCK_CLOEXEC, 0, sv) != 0) {
+    throw_posix_error(errno);
+  }
+  try {
+    if(forker::fork_process(this->process_)) {
+      // zygote
+      ::close(sv[0]);
+      std::exit(serve(zc, sv[1]));
+    }
+  }
+  catch(...) {
+    ::close(sv[0]);
+    ::close(sv[1]);
+    throw;
+  }
+  ::close(sv[1]);
+  this->fd_ = sv[0];
+
+  // wait for the zygote to be initialized
+  try {
+    recv_reply(this->fd_);
+  }
+  catch(...) {
+    ::close(this->fd_);
+    this->fd_ = -1;
+    try {
+      this->process_.join();
+    }
+    catch(...) {
+      this->process_.detach();
+    }
+    throw;
+  }
+}
+
+zygote::~zygote()
+{
+  // shutdown is seen by the zygote, even if some other process holds a copy of the socket
+  ::shutdown(this->fd_, SHUT_RDWR);
+  ::close(this->fd_);
+  try {
+    this->process_.join();
+  }
+  catch(...) {
+    this->process_.detach();
+  }
+}
+
+const process & zygote::get_process() const
+{
+  return this->process_;
+}
+
+void zygote::spawn(process &worker, const zygote::request_type &request)
+{
+  SHERATAN_CHECK(!worker.valid());
+  SHERATAN_CHECK(request.size() <= zygote::MAX_REQUEST);
+
+  zygote_request_header header;
+  std::memset(&header, 0, sizeof(header));
+  header.version = protocol_version;
+  std::vector<char> buffer(sizeof(header) + request.size());
+  std::memcpy(&buffer[0], &header, sizeof(header));
+  std::copy(request.begin(), request.end(), buffer.begin() + sizeof(header));
+  ssize_t rc_send;
+  do {
+    rc_send = ::send(this->fd_, &buffer[0], buffer.size(), MSG_NOSIGNAL);
+  } while((rc_send < 0) && (errno == EINTR));
+  if(rc_send < 0) {
+    if((errno == EPIPE) || (errno == ECONNRESET)) {
+      throw_zygote_failed();
+    }
+    throw_posix_error(errno);
+  }
+
+  // worker is child of this process, not yet waited for, so its process file descriptor refers to it
+  pid_t pid = recv_reply(this->fd_);
+  worker.set_pid(process_id(static_cast<process_id::value_type>(pid)));
+}
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+// vim: set ts=2 sw=2 et:
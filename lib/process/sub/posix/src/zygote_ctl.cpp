@@ -0,0 +1,32 @@
+/// \file process/sub/posix/src/zygote_ctl.cpp
+/// \brief POSIX zygote controller implementation.
+/// \ingroup sheratan_process_posix
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#include "sheratan/process/posix/zygote_ctl.hpp"
+
+
+namespace sheratan {
+
+namespace process_impl {
+
+namespace posix {
+
+
+zygote_ctl::~zygote_ctl()
+{
+  // nothing to do
+}
+
+
+} // namespace posix
+
+} // namespace process_impl
+
+} // namespace sheratan
+
+
+// vim: set ts=2 sw=2 et:
+
+
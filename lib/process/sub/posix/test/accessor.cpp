@@ -26,6 +26,11 @@ accessor::exit_status_ptr accessor::exit_status__exit_status(sheratan::process_i
   return accessor::exit_status_ptr(new sheratan::process_impl::posix::exit_status(value));
 }
 
+accessor::resource_usage_ptr accessor::resource_usage__resource_usage(const struct rusage &usage)
+{
+  return accessor::resource_usage_ptr(new sheratan::process_impl::posix::resource_usage(usage));
+}
+
 
 } // namespace test
 
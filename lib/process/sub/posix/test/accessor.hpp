@@ -12,6 +12,7 @@
 
 #include "sheratan/process/posix/process_id.hpp"
 #include "sheratan/process/posix/exit_status.hpp"
+#include "sheratan/process/posix/resource_usage.hpp"
 
 
 namespace sheratan {
@@ -35,6 +36,9 @@ class accessor
     /// \brief Managed pointer to exit_status type definition.
     typedef boost::shared_ptr<sheratan::process_impl::posix::exit_status> exit_status_ptr;
 
+    /// \brief Managed pointer to resource_usage type definition.
+    typedef boost::shared_ptr<sheratan::process_impl::posix::resource_usage> resource_usage_ptr;
+
   public:
 
     /// \brief Call private constructor of process_id.
@@ -48,6 +52,12 @@ class accessor
     /// \return Instance of exit_status.
     /// \note See process_id class for more information.
     static accessor::exit_status_ptr exit_status__exit_status(sheratan::process_impl::posix::exit_status::value_type value);
+
+    /// \brief Call private constructor of resource_usage.
+    /// \param usage Resource usage reported by the kernel.
+    /// \return Instance of resource_usage.
+    /// \note See resource_usage class for more information.
+    static accessor::resource_usage_ptr resource_usage__resource_usage(const struct rusage &usage);
 };
 
 
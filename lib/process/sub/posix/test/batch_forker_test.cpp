@@ -0,0 +1,313 @@
+/// \file process/sub/posix/test/batch_forker_test.cpp
+/// \brief Batch forker POSIX implementation unit-test file.
+/// \ingroup sheratan_process_posix_test
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#include <cstddef>
+
+#include <unistd.h>
+#include <signal.h>
+
+#include <boost/cstdint.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include "boost_test_sigchld_suppressor.hpp"
+
+#include "sheratan/errhdl/exception.hpp"
+#include "sheratan/process/posix/fork_ctl.hpp"
+#include "sheratan/process/posix/process_template.hpp"
+#include "sheratan/process/posix/parent_child_sync.hpp"
+#include "sheratan/process/posix/batch_forker.hpp"
+
+
+namespace {
+
+
+/// \brief Test process type definition.
+typedef sheratan::process_impl::posix::process_template<struct test_batch_process_tag> test_batch_process;
+
+/// \brief Number of children in test batch.
+static const std::size_t test_batch_size = 8;
+
+/// \brief Index of child, which fails in test batch.
+static const std::size_t test_failing_index = 5;
+
+
+/// \brief Delay of child of synchronized test batch before it unblocks its parent.
+static const useconds_t test_sync_delay = 200000;
+
+
+/// \brief Numbers of executed fork controller routines (shared by all the copies of controller).
+struct test_batch_counters
+{
+  /// \brief Constructor.
+  test_batch_counters()
+  : preforked(0)
+  , postforked(0)
+  {
+  }
+
+  /// \brief Number of executed prefork routines.
+  std::size_t preforked;
+
+  /// \brief Number of executed postfork routines.
+  std::size_t postforked;
+};
+
+
+/// \brief Fork controller of test batch.
+/// \note Child reports ready and exits with status derived from its index,
+/// except for the failing one (if any), which exits without reporting ready,
+/// and for the hanging one (if any), which never reports ready.
+class test_batch_fork_ctl : public sheratan::process_impl::posix::fork_ctl
+{
+  public:
+
+    test_batch_fork_ctl(bool fail, bool hang, test_batch_counters *counters = NULL)
+    : fail_(fail)
+    , hang_(hang)
+    , counters_(counters)
+    {
+    }
+
+    virtual sheratan::process_impl::posix::fork_ctl * clone() const
+    {
+      return new test_batch_fork_ctl(*this);
+    }
+
+    virtual void prefork()
+    {
+      if(this->counters_ != NULL) {
+        ++this->counters_->preforked;
+      }
+    }
+
+    virtual void postfork(sheratan::process_impl::posix::process &)
+    {
+      if(this->counters_ != NULL) {
+        ++this->counters_->postforked;
+      }
+    }
+
+    virtual sheratan::process_impl::posix::exit_status::value_type child()
+    {
+      std::size_t index = sheratan::process_impl::posix::batch_forker::get_index();
+      if(index == test_failing_index) {
+        if(this->fail_) {
+          return 1;
+        }
+        if(this->hang_) {
+          ::pause();
+        }
+      }
+      // later children are slower to initialize
+      ::usleep(static_cast<useconds_t>(index * 1000));
+      sheratan::process_impl::posix::batch_forker::report_ready();
+      return static_cast<sheratan::process_impl::posix::exit_status::value_type>(10 + index);
+    }
+
+  public:
+
+    /// \brief Whether one of the children fails.
+    bool fail_;
+
+    /// \brief Whether one of the children never reports ready.
+    bool hang_;
+
+    /// \brief Numbers of executed routines (if any).
+    test_batch_counters *counters_;
+};
+
+/// \brief Fork controller of synchronized test batch.
+/// \note Parent waits for each child in postfork routine, child unblocks
+/// its parent after a delay, then it reports ready and exits with status
+/// derived from its index.
+class test_sync_batch_fork_ctl : public sheratan::process_impl::posix::fork_ctl
+{
+  public:
+
+    explicit test_sync_batch_fork_ctl(test_batch_counters *counters)
+    : sync_()
+    , counters_(counters)
+    {
+    }
+
+    test_sync_batch_fork_ctl(const test_sync_batch_fork_ctl &that)
+    : fork_ctl()
+    , sync_()
+    , counters_(that.counters_)
+    {
+    }
+
+    virtual sheratan::process_impl::posix::fork_ctl * clone() const
+    {
+      return new test_sync_batch_fork_ctl(*this);
+    }
+
+    virtual void prefork()
+    {
+      this->sync_.prefork();
+      ++this->counters_->preforked;
+    }
+
+    virtual void postfork(sheratan::process_impl::posix::process &child_process)
+    {
+      this->sync_.postfork(child_process);
+      this->sync_.wait_for_child();
+      this->sync_.finalize();
+      ++this->counters_->postforked;
+    }
+
+    virtual sheratan::process_impl::posix::exit_status::value_type child()
+    {
+      std::size_t index = sheratan::process_impl::posix::batch_forker::get_index();
+      ::usleep(test_sync_delay);
+      this->sync_.unblock_parent();
+      sheratan::process_impl::posix::batch_forker::report_ready();
+      return static_cast<sheratan::process_impl::posix::exit_status::value_type>(10 + index);
+    }
+
+  private:
+
+    /// \brief Parent-child synchronizer.
+    sheratan::process_impl::posix::parent_child_sync sync_;
+
+    /// \brief Numbers of executed routines.
+    test_batch_counters *counters_;
+};
+
+
+/// \brief Create batch of default constructed processes.
+/// \param processes Process objects.
+/// \return List of child processes.
+static sheratan::process_impl::posix::batch_forker::process_list_type make_batch(boost::ptr_vector<test_batch_process> &processes)
+{
+  sheratan::process_impl::posix::batch_forker::process_list_type ret;
+  for(std::size_t i = 0; i < test_batch_size; ++i) {
+    processes.push_back(new test_batch_process());
+    ret.push_back(&processes.back());
+  }
+  return ret;
+}
+
+
+BOOST_AUTO_TEST_SUITE(batch_forker)
+
+  /// \brief Unit-test case: All the children are ready.
+  BOOST_AUTO_TEST_CASE(ready)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    boost::ptr_vector<test_batch_process> processes;
+    sheratan::process_impl::posix::batch_forker::process_list_type children = make_batch(processes);
+    test_batch_counters counters;
+    sheratan::process_impl::posix::batch_forker batch(test_batch_fork_ctl(false, false, &counters));
+    BOOST_CHECK_EQUAL(batch.fork(children), true);
+
+    // controller routines are executed for each child
+    BOOST_CHECK_EQUAL(counters.preforked, test_batch_size);
+    BOOST_CHECK_EQUAL(counters.postforked, test_batch_size);
+
+    for(std::size_t i = 0; i < test_batch_size; ++i) {
+      BOOST_REQUIRE_EQUAL(children[i]->valid(), true);
+      sheratan::process_impl::posix::exit_status exit_status = children[i]->join();
+      BOOST_CHECK_EQUAL(exit_status.exited(), true);
+      BOOST_CHECK_EQUAL(exit_status.get_status(), static_cast<int>(10 + i));
+    }
+
+    // batch can not be forked into valid processes, child API is not available in parent
+    children[0] = NULL;
+    BOOST_CHECK_THROW(batch.fork(children), sheratan::errhdl::logic_error);
+    BOOST_CHECK_THROW(sheratan::process_impl::posix::batch_forker::get_index(), sheratan::errhdl::logic_error);
+    BOOST_CHECK_THROW(sheratan::process_impl::posix::batch_forker::report_ready(), sheratan::errhdl::logic_error);
+  }
+
+  /// \brief Unit-test case: Child fails.
+  BOOST_AUTO_TEST_CASE(failure)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    boost::ptr_vector<test_batch_process> processes;
+    sheratan::process_impl::posix::batch_forker::process_list_type children = make_batch(processes);
+    sheratan::process_impl::posix::batch_forker batch(test_batch_fork_ctl(true, false));
+    BOOST_CHECK_EQUAL(batch.fork(children), false);
+    for(std::size_t i = 0; i < test_batch_size; ++i) {
+      BOOST_REQUIRE_EQUAL(children[i]->valid(), true);
+      sheratan::process_impl::posix::exit_status exit_status = children[i]->join();
+      BOOST_CHECK_EQUAL(exit_status.get_status(), ((i == test_failing_index) ? 1 : static_cast<int>(10 + i)));
+    }
+  }
+
+  /// \brief Unit-test case: Deadline expires.
+  BOOST_AUTO_TEST_CASE(deadline)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    boost::ptr_vector<test_batch_process> processes;
+    sheratan::process_impl::posix::batch_forker::process_list_type children = make_batch(processes);
+    sheratan::process_impl::posix::batch_forker batch(test_batch_fork_ctl(false, true));
+    boost::posix_time::ptime deadline = boost::posix_time::microsec_clock::universal_time() + boost::posix_time::milliseconds(100);
+    BOOST_CHECK_EQUAL(batch.fork(children, deadline), false);
+    BOOST_CHECK(boost::posix_time::microsec_clock::universal_time() >= deadline);
+    children[test_failing_index]->kill(SIGKILL);
+    for(std::size_t i = 0; i < test_batch_size; ++i) {
+      sheratan::process_impl::posix::exit_status exit_status = children[i]->join();
+      if(i == test_failing_index) {
+        BOOST_CHECK_EQUAL(exit_status.get_term_signal(), SIGKILL);
+      }
+      else {
+        BOOST_CHECK_EQUAL(exit_status.get_status(), static_cast<int>(10 + i));
+      }
+    }
+  }
+
+  /// \brief Unit-test case: Fork controller synchronizing with each child.
+  BOOST_AUTO_TEST_CASE(sync)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    // each child has its own synchronizer and parent waits for all of them at once
+    boost::ptr_vector<test_batch_process> processes;
+    sheratan::process_impl::posix::batch_forker::process_list_type children = make_batch(processes);
+    test_batch_counters counters;
+    test_sync_batch_fork_ctl fc(&counters);
+    sheratan::process_impl::posix::batch_forker batch(fc);
+    boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+    BOOST_CHECK_EQUAL(batch.fork(children), true);
+    boost::posix_time::time_duration elapsed = boost::posix_time::microsec_clock::universal_time() - start;
+    BOOST_CHECK_EQUAL(counters.preforked, test_batch_size);
+    BOOST_CHECK_EQUAL(counters.postforked, test_batch_size);
+    BOOST_CHECK(elapsed < boost::posix_time::microseconds(static_cast<boost::int64_t>(test_sync_delay) * static_cast<boost::int64_t>(test_batch_size) / 2));
+
+    for(std::size_t i = 0; i < test_batch_size; ++i) {
+      BOOST_REQUIRE_EQUAL(children[i]->valid(), true);
+      sheratan::process_impl::posix::exit_status exit_status = children[i]->join();
+      BOOST_CHECK_EQUAL(exit_status.get_status(), static_cast<int>(10 + i));
+    }
+  }
+
+BOOST_AUTO_TEST_SUITE_END() // batch_forker
+
+
+} // anonymous namespace
+
+
+// vim: set ts=2 sw=2 et:
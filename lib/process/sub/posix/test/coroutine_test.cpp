@@ -0,0 +1,381 @@
+/// \file process/sub/posix/test/coroutine_test.cpp
+/// \brief Coroutine awaitables POSIX implementation unit-test file.
+/// \ingroup sheratan_process_posix_test
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#include "sheratan/process/posix/coroutine.hpp"
+
+
+#ifdef SHERATAN_PROCESS_POSIX_COROUTINES
+
+
+#include <exception>
+
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/bind/bind.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include "boost_test_sigchld_suppressor.hpp"
+
+#include "sheratan/errhdl/exception.hpp"
+#include "sheratan/process/posix/fork_ctl.hpp"
+#include "sheratan/process/posix/process_template.hpp"
+#include "sheratan/process/posix/daemon_template.hpp"
+#include "sheratan/process/posix/daemonizer.hpp"
+#include "sheratan/process/posix/parent_child_sync.hpp"
+#include "sheratan/process/posix/reactor.hpp"
+#include "sheratan/process/posix/readiness_notifier.hpp"
+#include "test_sync_fork_ctl.hpp"
+#include "test_daemon_ctl.hpp"
+
+
+using namespace sheratan::process_impl::posix::test;
+
+
+namespace {
+
+
+/// \brief Test process type definition.
+typedef sheratan::process_impl::posix::process_template<struct test_coroutine_process_tag> test_coroutine_process;
+
+/// \brief Test daemon type definition.
+typedef sheratan::process_impl::posix::daemon_template<struct test_coroutine_daemon_tag> test_coroutine_daemon;
+
+
+/// \brief Fire-and-forget coroutine.
+struct test_task
+{
+  /// \brief Promise.
+  struct promise_type
+  {
+    test_task get_return_object() { return test_task(); }
+    std::suspend_never initial_suspend() noexcept { return std::suspend_never(); }
+    std::suspend_never final_suspend() noexcept { return std::suspend_never(); }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+};
+
+/// \brief Outcome of test coroutine.
+struct test_outcome
+{
+  /// \brief Constructor.
+  test_outcome()
+  : done(false)
+  , status()
+  , error()
+  {
+  }
+
+  /// \brief Whether the coroutine has finished.
+  bool done;
+
+  /// \brief Exit status.
+  sheratan::process_impl::posix::exit_status status;
+
+  /// \brief Exception caught by the coroutine.
+  std::exception_ptr error;
+};
+
+/// \brief Fork controller of child process, which unblocks its parent.
+class test_unblocking_fork_ctl : public sheratan::process_impl::posix::fork_ctl
+{
+  public:
+
+    test_unblocking_fork_ctl()
+    : sync_()
+    {
+    }
+
+    test_unblocking_fork_ctl(const test_unblocking_fork_ctl &)
+    : fork_ctl()
+    , sync_()
+    {
+    }
+
+    virtual sheratan::process_impl::posix::fork_ctl * clone() const
+    {
+      return new test_unblocking_fork_ctl(*this);
+    }
+
+    virtual void prefork()
+    {
+      this->sync_.prefork();
+    }
+
+    virtual void postfork(sheratan::process_impl::posix::process &child_process)
+    {
+      this->sync_.postfork(child_process);
+    }
+
+    virtual sheratan::process_impl::posix::exit_status::value_type child()
+    {
+      this->sync_.unblock_parent();
+      return 7;
+    }
+
+    /// \brief Get parent-child synchronizer.
+    sheratan::process_impl::posix::parent_child_sync & get_sync()
+    {
+      return this->sync_;
+    }
+
+  private:
+
+    /// \brief Parent-child synchronizer.
+    sheratan::process_impl::posix::parent_child_sync sync_;
+};
+
+/// \brief Daemon controller of daemon, which reports its readiness once it is released.
+/// \note Daemon is released by a byte written into its inherited socket.
+class test_released_daemon_ctl : public sheratan::process_impl::posix::daemon_ctl
+{
+  public:
+
+    virtual sheratan::process_impl::posix::daemon_ctl * clone() const
+    {
+      return new test_released_daemon_ctl(*this);
+    }
+
+    virtual void predaemonize()
+    {
+    }
+
+    virtual void postdaemonize(sheratan::process_impl::posix::daemon &)
+    {
+    }
+
+    virtual sheratan::process_impl::posix::exit_status::value_type daemonized_child()
+    {
+      try {
+        sheratan::process_impl::posix::readiness_notifier notifier;
+        char data = 0;
+        if(::read(sheratan::process_impl::posix::daemonizer::LISTEN_FDS_START, &data, 1) != 1) {
+          return 1;
+        }
+        notifier.ready();
+      } catch(...) {
+        return 2;
+      }
+      return 0;
+    }
+};
+
+/// \brief Release daemon.
+/// \param fd Socket connected to the daemon.
+/// \param released Set once the daemon is released.
+static void release_daemon(int fd, bool *released)
+{
+  char data = 'r';
+  BOOST_CHECK_EQUAL(::write(fd, &data, 1), 1);
+  *released = true;
+}
+
+
+/// \brief Join process.
+test_task join(sheratan::process_impl::posix::reactor &r, sheratan::process_impl::posix::process &proc, test_outcome &outcome)
+{
+  try {
+    outcome.status = co_await sheratan::process_impl::posix::async_join(r, proc);
+  }
+  catch(...) {
+    outcome.error = std::current_exception();
+  }
+  outcome.done = true;
+}
+
+/// \brief Wait for child and join it.
+test_task wait_and_join(sheratan::process_impl::posix::reactor &r, sheratan::process_impl::posix::process &proc, sheratan::process_impl::posix::parent_child_sync &sync, test_outcome &outcome)
+{
+  try {
+    co_await sheratan::process_impl::posix::async_wait_for_child(r, sync);
+    outcome.status = co_await sheratan::process_impl::posix::async_join(r, proc);
+  }
+  catch(...) {
+    outcome.error = std::current_exception();
+  }
+  outcome.done = true;
+}
+
+/// \brief Daemonize.
+test_task daemonize(sheratan::process_impl::posix::reactor &r, sheratan::process_impl::posix::daemonizer &dz, sheratan::process_impl::posix::daemon &daemon_process, test_outcome &outcome)
+{
+  try {
+    co_await sheratan::process_impl::posix::async_daemonize(r, dz, daemon_process);
+  }
+  catch(...) {
+    outcome.error = std::current_exception();
+  }
+  outcome.done = true;
+}
+
+
+BOOST_AUTO_TEST_SUITE(coroutine)
+
+  /// \brief Unit-test case: Join.
+  BOOST_AUTO_TEST_CASE(join)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    sheratan::process_impl::posix::reactor r;
+    test_coroutine_process child(test_sync_fork_ctl(5, false));
+    test_outcome outcome;
+    ::join(r, child, outcome);
+
+    // coroutine is suspended until the child terminates
+    BOOST_CHECK_EQUAL(outcome.done, false);
+    BOOST_CHECK_EQUAL(r.size(), 1U);
+    test_sync_fork_ctl &fc = dynamic_cast<test_sync_fork_ctl &>(child.get_fork_ctl());
+    fc.unblock_child();
+    fc.finalize();
+    r.run();
+
+    BOOST_CHECK_EQUAL(outcome.done, true);
+    BOOST_CHECK(!outcome.error);
+    BOOST_CHECK_EQUAL(outcome.status.exited(), true);
+    BOOST_CHECK_EQUAL(outcome.status.get_status(), 5);
+    BOOST_CHECK_EQUAL(child.valid(), false);
+
+    // process, which is not valid, can not be joined
+    test_outcome invalid_outcome;
+    ::join(r, child, invalid_outcome);
+    BOOST_CHECK_EQUAL(invalid_outcome.done, true);
+    BOOST_REQUIRE(invalid_outcome.error);
+    BOOST_CHECK_THROW(std::rethrow_exception(invalid_outcome.error), sheratan::errhdl::logic_error);
+  }
+
+  /// \brief Unit-test case: Wait for child.
+  BOOST_AUTO_TEST_CASE(wait_for_child)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    sheratan::process_impl::posix::reactor r;
+    test_unblocking_fork_ctl unblocking_fc;
+    test_coroutine_process child(unblocking_fc);
+    test_unblocking_fork_ctl &fc = dynamic_cast<test_unblocking_fork_ctl &>(child.get_fork_ctl());
+    test_outcome outcome;
+    ::wait_and_join(r, child, fc.get_sync(), outcome);
+    r.run();
+
+    BOOST_CHECK_EQUAL(outcome.done, true);
+    BOOST_CHECK(!outcome.error);
+    BOOST_CHECK_EQUAL(outcome.status.get_status(), 7);
+    fc.get_sync().finalize();
+  }
+
+  /// \brief Unit-test case: Daemonize.
+  BOOST_AUTO_TEST_CASE(daemonize)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    sheratan::process_impl::posix::reactor r;
+    test_daemon_ctl dc;
+
+    // successful daemonization
+    {
+      sheratan::process_impl::posix::daemonizer dz(
+        dc,
+        sheratan::process_impl::posix::daemonizer::pid_file_type(),
+        sheratan::process_impl::posix::daemonizer::pid_file_mode_type(),
+        sheratan::process_impl::posix::daemonizer::working_dir_type("./")
+      );
+      test_coroutine_daemon daemon_process;
+      test_outcome outcome;
+      ::daemonize(r, dz, daemon_process, outcome);
+      r.run();
+      BOOST_CHECK_EQUAL(outcome.done, true);
+      BOOST_CHECK(!outcome.error);
+      BOOST_CHECK_EQUAL(daemon_process.valid(), true);
+    }
+
+    // failed daemonization (daemon can not change its working directory)
+    {
+      sheratan::process_impl::posix::daemonizer dz(
+        dc,
+        sheratan::process_impl::posix::daemonizer::pid_file_type(),
+        sheratan::process_impl::posix::daemonizer::pid_file_mode_type(),
+        sheratan::process_impl::posix::daemonizer::working_dir_type("/nonexistent/sheratan_process_posix_coroutine")
+      );
+      test_coroutine_daemon daemon_process;
+      test_outcome outcome;
+      ::daemonize(r, dz, daemon_process, outcome);
+      r.run();
+      BOOST_CHECK_EQUAL(outcome.done, true);
+      BOOST_REQUIRE(outcome.error);
+      BOOST_CHECK_THROW(std::rethrow_exception(outcome.error), sheratan::errhdl::runtime_error);
+      BOOST_CHECK_EQUAL(daemon_process.valid(), false);
+    }
+  }
+
+  /// \brief Unit-test case: Daemonize with readiness stage.
+  BOOST_AUTO_TEST_CASE(daemonize_ready)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    sheratan::process_impl::posix::reactor r;
+    int sv[2];
+    BOOST_REQUIRE_EQUAL(::socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+    sheratan::process_impl::posix::daemonizer::inherited_fds_type::value_type inherited_fds;
+    inherited_fds.push_back(sv[1]);
+    sheratan::process_impl::posix::daemonizer dz(
+      test_released_daemon_ctl(),
+      sheratan::process_impl::posix::daemonizer::pid_file_type(),
+      sheratan::process_impl::posix::daemonizer::pid_file_mode_type(),
+      sheratan::process_impl::posix::daemonizer::working_dir_type("./"),
+      sheratan::process_impl::posix::daemonizer::stdin_redirect_type(),
+      sheratan::process_impl::posix::daemonizer::stdout_redirect_type(),
+      sheratan::process_impl::posix::daemonizer::stderr_redirect_type(),
+      sheratan::process_impl::posix::daemonizer::reset_signals_flag_type(),
+      sheratan::process_impl::posix::daemonizer::inherited_fds_type(inherited_fds),
+      sheratan::process_impl::posix::daemonizer::ready_stage_type(sheratan::process_impl::posix::daemonizer::READY_STAGE),
+      sheratan::process_impl::posix::daemonizer::ready_timeout_type(boost::posix_time::seconds(5))
+    );
+
+    // daemon is released by the event loop, which would never happen if the readiness wait blocked it
+    bool released = false;
+    r.add_timer(boost::posix_time::milliseconds(100), boost::bind(&release_daemon, sv[0], &released));
+    test_coroutine_daemon daemon_process;
+    test_outcome outcome;
+    ::daemonize(r, dz, daemon_process, outcome);
+    BOOST_CHECK_EQUAL(outcome.done, false);
+    r.run();
+    BOOST_CHECK_EQUAL(released, true);
+    BOOST_CHECK_EQUAL(outcome.done, true);
+    BOOST_CHECK(!outcome.error);
+    BOOST_CHECK_EQUAL(daemon_process.valid(), true);
+    BOOST_CHECK_EQUAL(dz.native_handle(), -1);
+    BOOST_REQUIRE_EQUAL(dz.get_ready_stages().size(), 1U);
+    BOOST_CHECK_EQUAL(dz.get_ready_stages()[0].first, sheratan::process_impl::posix::daemonizer::READY_STAGE);
+    ::close(sv[0]);
+    ::close(sv[1]);
+  }
+
+BOOST_AUTO_TEST_SUITE_END() // coroutine
+
+
+} // anonymous namespace
+
+
+#endif // SHERATAN_PROCESS_POSIX_COROUTINES
+
+
+// vim: set ts=2 sw=2 et:
@@ -4,11 +4,34 @@
 /// \author Marek Balint \c (mareq[A]balint[D]eu)
 
 
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
 #include <boost/test/unit_test.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
 #include "boost_test_sigchld_suppressor.hpp"
 
 #include "sheratan/errhdl/exception.hpp"
+#include "sheratan/process/posix/error_category.hpp"
 #include "sheratan/process/posix/daemon_template.hpp"
+#include "sheratan/process/posix/fork_ctl.hpp"
+#include "sheratan/process/posix/process_template.hpp"
+#include "sheratan/process/posix/readiness_notifier.hpp"
+#include "sheratan/process/posix/static_daemon_template.hpp"
 #include "test_daemon_ctl.hpp"
 
 
@@ -20,6 +43,527 @@ namespace {
 /// \brief Test daemon type definition.
 typedef sheratan::process_impl::posix::daemon_template<struct test_daemon_tag> test_daemon;
 
+/// \brief Test supervised process type definition.
+typedef sheratan::process_impl::posix::process_template<struct test_supervised_process_tag> test_supervised_process;
+
+/// \brief Daemon controller of daemon, which reports inherited sockets it has received.
+/// \note Daemon writes its index into each of the inherited sockets, provided
+/// that socket activation environment is set properly.
+class test_inheriting_daemon_ctl : public sheratan::process_impl::posix::daemon_ctl
+{
+  public:
+
+    explicit test_inheriting_daemon_ctl(std::size_t count)
+    : count_(count)
+    {
+    }
+
+    virtual sheratan::process_impl::posix::daemon_ctl * clone() const
+    {
+      return new test_inheriting_daemon_ctl(*this);
+    }
+
+    virtual void predaemonize()
+    {
+    }
+
+    virtual void postdaemonize(sheratan::process_impl::posix::daemon &)
+    {
+    }
+
+    virtual sheratan::process_impl::posix::exit_status::value_type daemonized_child()
+    {
+      // check socket activation environment
+      std::ostringstream listen_fds;
+      listen_fds << this->count_;
+      std::ostringstream listen_pid;
+      listen_pid << ::getpid();
+      const char *listen_fds_env = std::getenv("LISTEN_FDS");
+      const char *listen_pid_env = std::getenv("LISTEN_PID");
+      if(listen_fds_env == NULL || listen_pid_env == NULL || listen_fds.str() != listen_fds_env || listen_pid.str() != listen_pid_env) {
+        return 1;
+      }
+
+      // report index of each inherited socket
+      for(std::size_t i = 0; i < this->count_; ++i) {
+        char data = static_cast<char>('0' + i);
+        if(::write(sheratan::process_impl::posix::daemonizer::LISTEN_FDS_START + static_cast<int>(i), &data, 1) != 1) {
+          return 2;
+        }
+      }
+      return 0;
+    }
+
+  private:
+
+    /// \brief Number of inherited sockets.
+    std::size_t count_;
+};
+
+/// \brief Daemon controller of daemon, which reports its readiness.
+/// \note Daemon reports stages \c init and \c listen and then it either
+/// reports it is ready, exits, or hangs (until it is terminated).
+class test_ready_daemon_ctl : public sheratan::process_impl::posix::daemon_ctl
+{
+  public:
+
+    /// \brief Daemon behaviour after the stages are reported.
+    typedef enum
+    {
+      READY, ///< Report it is ready.
+      EXIT,  ///< Exit.
+      HANG   ///< Hang.
+    } behaviour_type;
+
+  public:
+
+    explicit test_ready_daemon_ctl(behaviour_type behaviour)
+    : behaviour_(behaviour)
+    {
+    }
+
+    virtual sheratan::process_impl::posix::daemon_ctl * clone() const
+    {
+      return new test_ready_daemon_ctl(*this);
+    }
+
+    virtual void predaemonize()
+    {
+    }
+
+    virtual void postdaemonize(sheratan::process_impl::posix::daemon &)
+    {
+    }
+
+    virtual sheratan::process_impl::posix::exit_status::value_type daemonized_child()
+    {
+      try {
+        sheratan::process_impl::posix::readiness_notifier notifier;
+        if(!notifier.enabled()) {
+          return 1;
+        }
+        notifier.stage("init");
+        notifier.stage("listen");
+        switch(this->behaviour_) {
+          case READY:
+            notifier.ready();
+            break;
+          case EXIT:
+            return 2;
+          case HANG:
+            ::pause();
+            break;
+        }
+      } catch(...) {
+        return 3;
+      }
+      return 0;
+    }
+
+  private:
+
+    /// \brief Daemon behaviour.
+    behaviour_type behaviour_;
+};
+
+/// \brief OOM score adjustment of memory policy daemon.
+static const int memory_oom_score_adj = 1000;
+
+/// \brief Heap prefault size of memory policy daemon.
+static const std::size_t memory_prefault_size = 4 * 1024 * 1024;
+
+/// \brief Daemon controller of daemon, which checks its memory policy.
+/// \note Daemon checks that transparent huge pages are disabled, OOM score
+/// is adjusted and (optionally) its memory is locked. Then it writes \c 'm'
+/// into the inherited file descriptor.
+class test_memory_daemon_ctl : public sheratan::process_impl::posix::daemon_ctl
+{
+  public:
+
+    explicit test_memory_daemon_ctl(bool locked)
+    : locked_(locked)
+    {
+    }
+
+    virtual sheratan::process_impl::posix::daemon_ctl * clone() const
+    {
+      return new test_memory_daemon_ctl(*this);
+    }
+
+    virtual void predaemonize()
+    {
+    }
+
+    virtual void postdaemonize(sheratan::process_impl::posix::daemon &)
+    {
+    }
+
+    virtual sheratan::process_impl::posix::exit_status::value_type daemonized_child()
+    {
+      if(::prctl(PR_GET_THP_DISABLE, 0, 0, 0, 0) != 1) {
+        return 1;
+      }
+      std::ifstream oom_score_adj_file("/proc/self/oom_score_adj");
+      int oom_score_adj = 0;
+      if(!(oom_score_adj_file >> oom_score_adj) || oom_score_adj != memory_oom_score_adj) {
+        return 2;
+      }
+      if(this->locked_) {
+        // locked memory includes prefaulted heap
+        std::ifstream status_file("/proc/self/status");
+        std::string key;
+        std::size_t locked_kb = 0;
+        while(status_file >> key) {
+          if(key == "VmLck:") {
+            status_file >> locked_kb;
+            break;
+          }
+        }
+        if(locked_kb * 1024 < memory_prefault_size) {
+          return 3;
+        }
+      }
+      char data = 'm';
+      if(::write(sheratan::process_impl::posix::daemonizer::LISTEN_FDS_START, &data, 1) != 1) {
+        return 4;
+      }
+      return 0;
+    }
+
+  private:
+
+    /// \brief Whether memory is to be locked.
+    bool locked_;
+};
+
+/// \brief Daemon controller, which counts its parent routines.
+/// \note It is not supposed to be cloned, clone does not keep the counters.
+class test_counting_daemon_ctl : public sheratan::process_impl::posix::daemon_ctl
+{
+  public:
+
+    test_counting_daemon_ctl()
+    : predaemonized_(0)
+    , postdaemonized_(0)
+    , postdaemonize_mask_()
+    {
+      ::sigemptyset(&this->postdaemonize_mask_);
+    }
+
+    virtual sheratan::process_impl::posix::daemon_ctl * clone() const
+    {
+      return new test_counting_daemon_ctl();
+    }
+
+    virtual void predaemonize()
+    {
+      ++this->predaemonized_;
+    }
+
+    virtual void postdaemonize(sheratan::process_impl::posix::daemon &)
+    {
+      ++this->postdaemonized_;
+      ::pthread_sigmask(SIG_BLOCK, NULL, &this->postdaemonize_mask_);
+    }
+
+    virtual sheratan::process_impl::posix::exit_status::value_type daemonized_child()
+    {
+      return 0;
+    }
+
+  public:
+
+    /// \brief Number of predaemonize routine calls.
+    int predaemonized_;
+
+    /// \brief Number of postdaemonize routine calls.
+    int postdaemonized_;
+
+    /// \brief Signal mask of postdaemonize routine.
+    sigset_t postdaemonize_mask_;
+};
+
+
+/// \brief Exit status of successful foreground daemon.
+static const sheratan::process_impl::posix::exit_status::value_type foreground_status = 7;
+
+/// \brief PID file of foreground daemon.
+static const char foreground_pid_file[] = "/tmp/sheratan_process_posix_daemon_foreground.pid";
+
+/// \brief PID file locked by running daemon.
+static const char locked_pid_file[] = "/tmp/sheratan_process_posix_daemon_locked.pid";
+
+/// \brief Daemon controller of foreground daemon.
+/// \note Daemon checks that it runs in the process it was started in, that
+/// its PID file is written, that unrelated file descriptor is kept open and
+/// writes into inherited pipe.
+class test_foreground_daemon_ctl : public sheratan::process_impl::posix::daemon_ctl
+{
+  public:
+
+    test_foreground_daemon_ctl(pid_t pid, int open_fd)
+    : pid_(pid)
+    , open_fd_(open_fd)
+    {
+    }
+
+    virtual sheratan::process_impl::posix::daemon_ctl * clone() const
+    {
+      return new test_foreground_daemon_ctl(*this);
+    }
+
+    virtual void predaemonize()
+    {
+    }
+
+    virtual void postdaemonize(sheratan::process_impl::posix::daemon &)
+    {
+    }
+
+    virtual sheratan::process_impl::posix::exit_status::value_type daemonized_child()
+    {
+      if(::getpid() != this->pid_) {
+        return 1;
+      }
+      std::ifstream pid_file(foreground_pid_file);
+      pid_t pid = 0;
+      if(!(pid_file >> pid) || pid != this->pid_) {
+        return 2;
+      }
+      if(::fcntl(this->open_fd_, F_GETFD) < 0) {
+        return 3;
+      }
+      char data = 'f';
+      if(::write(sheratan::process_impl::posix::daemonizer::LISTEN_FDS_START, &data, 1) != 1) {
+        return 4;
+      }
+      return foreground_status;
+    }
+
+  private:
+
+    /// \brief Expected PID of the daemon.
+    pid_t pid_;
+
+    /// \brief File descriptor expected to be kept open.
+    int open_fd_;
+};
+
+/// \brief Fork controller of supervised process, which becomes foreground daemon.
+class test_supervised_fork_ctl : public sheratan::process_impl::posix::fork_ctl
+{
+  public:
+
+    explicit test_supervised_fork_ctl(int pipe_fd)
+    : pipe_fd_(pipe_fd)
+    {
+    }
+
+    virtual sheratan::process_impl::posix::fork_ctl * clone() const
+    {
+      return new test_supervised_fork_ctl(*this);
+    }
+
+    virtual void prefork()
+    {
+    }
+
+    virtual void postfork(sheratan::process_impl::posix::process &)
+    {
+    }
+
+    virtual sheratan::process_impl::posix::exit_status::value_type child()
+    {
+      try {
+        int open_fd = ::open("/dev/null", O_RDONLY);
+        sheratan::process_impl::posix::daemonizer::inherited_fds_type::value_type inherited_fds;
+        inherited_fds.push_back(this->pipe_fd_);
+        test_daemon daemon_process(
+          test_foreground_daemon_ctl(::getpid(), open_fd),
+          sheratan::process_impl::posix::daemonizer::pid_file_type(foreground_pid_file),
+          sheratan::process_impl::posix::daemonizer::pid_file_mode_type(),
+          sheratan::process_impl::posix::daemonizer::working_dir_type("./"),
+          sheratan::process_impl::posix::daemonizer::stdin_redirect_type(),
+          sheratan::process_impl::posix::daemonizer::stdout_redirect_type(),
+          sheratan::process_impl::posix::daemonizer::stderr_redirect_type(),
+          sheratan::process_impl::posix::daemonizer::reset_signals_flag_type(),
+          sheratan::process_impl::posix::daemonizer::inherited_fds_type(inherited_fds),
+          sheratan::process_impl::posix::daemonizer::ready_stage_type(),
+          sheratan::process_impl::posix::daemonizer::ready_timeout_type(),
+          sheratan::process_impl::posix::daemonizer::mode_type(sheratan::process_impl::posix::daemonization_mode::FOREGROUND)
+        );
+      } catch(...) {
+        return 100;
+      }
+      // daemonization never returns in foreground mode
+      return 101;
+    }
+
+  private:
+
+    /// \brief Write end of pipe to be inherited by the daemon.
+    int pipe_fd_;
+};
+
+/// \brief Daemon controller of foreground daemon, which had its own file
+/// descriptor in the range inherited file descriptors are passed in.
+/// \note Daemon checks that the inherited pipe (rather than its own socket)
+/// is passed in the range and that its own socket is kept open above the
+/// range with close-on-exec flag set.
+class test_occupied_daemon_ctl : public sheratan::process_impl::posix::daemon_ctl
+{
+  public:
+
+    test_occupied_daemon_ctl(dev_t dev, ino_t ino)
+    : dev_(dev)
+    , ino_(ino)
+    {
+    }
+
+    virtual sheratan::process_impl::posix::daemon_ctl * clone() const
+    {
+      return new test_occupied_daemon_ctl(*this);
+    }
+
+    virtual void predaemonize()
+    {
+    }
+
+    virtual void postdaemonize(sheratan::process_impl::posix::daemon &)
+    {
+    }
+
+    virtual sheratan::process_impl::posix::exit_status::value_type daemonized_child()
+    {
+      int moved_fd = -1;
+      for(int fd = sheratan::process_impl::posix::daemonizer::LISTEN_FDS_START + 1; (fd < 1024) && (moved_fd < 0); ++fd) {
+        struct stat st;
+        if((::fstat(fd, &st) == 0) && (st.st_dev == this->dev_) && (st.st_ino == this->ino_)) {
+          moved_fd = fd;
+        }
+      }
+      if(moved_fd < 0) {
+        return 1;
+      }
+      if((::fcntl(moved_fd, F_GETFD) & FD_CLOEXEC) == 0) {
+        return 2;
+      }
+      char data = 'o';
+      if(::write(sheratan::process_impl::posix::daemonizer::LISTEN_FDS_START, &data, 1) != 1) {
+        return 3;
+      }
+      return foreground_status;
+    }
+
+  private:
+
+    /// \brief Device of the file descriptor expected to be moved.
+    dev_t dev_;
+
+    /// \brief Inode of the file descriptor expected to be moved.
+    ino_t ino_;
+};
+
+/// \brief Fork controller of supervised process, which becomes foreground
+/// daemon, while its own file descriptor occupies the range inherited file
+/// descriptors are to be passed in.
+class test_occupied_fork_ctl : public sheratan::process_impl::posix::fork_ctl
+{
+  public:
+
+    explicit test_occupied_fork_ctl(int pipe_fd)
+    : pipe_fd_(pipe_fd)
+    {
+    }
+
+    virtual sheratan::process_impl::posix::fork_ctl * clone() const
+    {
+      return new test_occupied_fork_ctl(*this);
+    }
+
+    virtual void prefork()
+    {
+    }
+
+    virtual void postfork(sheratan::process_impl::posix::process &)
+    {
+    }
+
+    virtual sheratan::process_impl::posix::exit_status::value_type child()
+    {
+      try {
+        // inherited pipe is kept out of the range, own socket (having inode of its own,
+        // unlike pipe ends) is put in its first slot
+        sheratan::process_impl::posix::daemonizer::inherited_fds_type::value_type inherited_fds;
+        inherited_fds.push_back(::fcntl(this->pipe_fd_, F_DUPFD, 16));
+        int own_socket[2];
+        if(::socketpair(AF_UNIX, SOCK_STREAM, 0, own_socket) != 0) {
+          return 102;
+        }
+        if(::dup2(own_socket[0], sheratan::process_impl::posix::daemonizer::LISTEN_FDS_START) < 0) {
+          return 103;
+        }
+        if(own_socket[0] != sheratan::process_impl::posix::daemonizer::LISTEN_FDS_START) {
+          ::close(own_socket[0]);
+        }
+        struct stat st;
+        if(::fstat(sheratan::process_impl::posix::daemonizer::LISTEN_FDS_START, &st) != 0) {
+          return 104;
+        }
+        test_daemon daemon_process(
+          test_occupied_daemon_ctl(st.st_dev, st.st_ino),
+          sheratan::process_impl::posix::daemonizer::pid_file_type(),
+          sheratan::process_impl::posix::daemonizer::pid_file_mode_type(),
+          sheratan::process_impl::posix::daemonizer::working_dir_type(),
+          sheratan::process_impl::posix::daemonizer::stdin_redirect_type(),
+          sheratan::process_impl::posix::daemonizer::stdout_redirect_type(),
+          sheratan::process_impl::posix::daemonizer::stderr_redirect_type(),
+          sheratan::process_impl::posix::daemonizer::reset_signals_flag_type(),
+          sheratan::process_impl::posix::daemonizer::inherited_fds_type(inherited_fds),
+          sheratan::process_impl::posix::daemonizer::ready_stage_type(),
+          sheratan::process_impl::posix::daemonizer::ready_timeout_type(),
+          sheratan::process_impl::posix::daemonizer::mode_type(sheratan::process_impl::posix::daemonization_mode::FOREGROUND)
+        );
+      } catch(...) {
+        return 100;
+      }
+      // daemonization never returns in foreground mode
+      return 101;
+    }
+
+  private:
+
+    /// \brief Write end of pipe to be inherited by the daemon.
+    int pipe_fd_;
+};
+
+/// \brief Create daemon, which reports its readiness.
+/// \param daemon_process Daemon process object.
+/// \param behaviour Daemon behaviour.
+/// \param ready_stage Readiness stage to wait for.
+/// \param ready_timeout Readiness timeout.
+/// \param pid_file PID file path.
+/// \return Readiness stages reached by the daemon.
+static sheratan::process_impl::posix::daemonizer::ready_stage_list_type create_ready_daemon(sheratan::process_impl::posix::daemon &daemon_process, test_ready_daemon_ctl::behaviour_type behaviour, const std::string &ready_stage, const sheratan::process_impl::posix::system_duration_type &ready_timeout, const std::string &pid_file = sheratan::process_impl::posix::daemonizer::pid_file_type().get_value())
+{
+  sheratan::process_impl::posix::daemonizer d(
+    test_ready_daemon_ctl(behaviour),
+    sheratan::process_impl::posix::daemonizer::pid_file_type(pid_file),
+    sheratan::process_impl::posix::daemonizer::pid_file_mode_type(),
+    sheratan::process_impl::posix::daemonizer::working_dir_type("./"),
+    sheratan::process_impl::posix::daemonizer::stdin_redirect_type(),
+    sheratan::process_impl::posix::daemonizer::stdout_redirect_type(),
+    sheratan::process_impl::posix::daemonizer::stderr_redirect_type(),
+    sheratan::process_impl::posix::daemonizer::reset_signals_flag_type(),
+    sheratan::process_impl::posix::daemonizer::inherited_fds_type(),
+    sheratan::process_impl::posix::daemonizer::ready_stage_type(ready_stage),
+    sheratan::process_impl::posix::daemonizer::ready_timeout_type(ready_timeout)
+  );
+  d.daemonize(daemon_process);
+  return d.get_ready_stages();
+}
+
+
 BOOST_AUTO_TEST_SUITE(daemon)
 
   /// \brief Unit-test case: Default construction.
@@ -67,6 +611,463 @@ BOOST_AUTO_TEST_SUITE(daemon)
     BOOST_CHECK_NE(daemon_process.get_pid(), sheratan::process_impl::posix::process_id());
   }
 
+  /// \brief Unit-test case: Static daemon.
+  BOOST_AUTO_TEST_CASE(static_daemon)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    // default construction
+    sheratan::process_impl::posix::static_daemon_template<test_daemon_ctl> default_constructed;
+    BOOST_CHECK_EQUAL(default_constructed.valid(), false);
+
+    // daemon controller is held by value and used by the daemonizer as it is
+    sheratan::process_impl::posix::static_daemon_template<test_counting_daemon_ctl> daemon_process(
+      test_counting_daemon_ctl(),
+      sheratan::process_impl::posix::daemonizer::pid_file_type(),
+      sheratan::process_impl::posix::daemonizer::pid_file_mode_type(),
+      sheratan::process_impl::posix::daemonizer::working_dir_type("./")
+    );
+    BOOST_CHECK_EQUAL(daemon_process.valid(), true);
+    BOOST_CHECK_NE(daemon_process.get_pid(), sheratan::process_impl::posix::process_id());
+    BOOST_CHECK_EQUAL(daemon_process.get_report().complete(), true);
+    BOOST_CHECK_EQUAL(daemon_process.get_daemon_ctl().predaemonized_, 1);
+    BOOST_CHECK_EQUAL(daemon_process.get_daemon_ctl().postdaemonized_, 1);
+
+    // daemonization failure is reported the same way
+    test_daemon_ctl dc;
+    BOOST_CHECK_THROW(
+      sheratan::process_impl::posix::static_daemon_template<test_daemon_ctl>(
+        dc,
+        sheratan::process_impl::posix::daemonizer::pid_file_type(),
+        sheratan::process_impl::posix::daemonizer::pid_file_mode_type(),
+        sheratan::process_impl::posix::daemonizer::working_dir_type("/nonexistent/sheratan_process_posix_daemon")
+      ),
+      sheratan::errhdl::runtime_error
+    );
+  }
+
+  /// \brief Unit-test case: Daemonization report.
+  BOOST_AUTO_TEST_CASE(report)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    // no report without daemonization
+    test_daemon default_constructed;
+    BOOST_CHECK_EQUAL(default_constructed.get_report().complete(), false);
+
+    // all the phases are recorded, the ones executed by child process and by the daemon included
+    test_daemon_ctl dc;
+    test_daemon daemon_process(
+      dc,
+      sheratan::process_impl::posix::daemonizer::pid_file_type(),
+      sheratan::process_impl::posix::daemonizer::pid_file_mode_type(),
+      sheratan::process_impl::posix::daemonizer::working_dir_type("./")
+    );
+    const sheratan::process_impl::posix::daemonization_report &report = daemon_process.get_report();
+    BOOST_REQUIRE_EQUAL(report.complete(), true);
+    sheratan::process_impl::posix::system_duration_type total;
+    for(int p = 0; p < sheratan::process_impl::posix::daemonization_report::phase::COUNT; ++p) {
+      sheratan::process_impl::posix::system_duration_type duration = report.get_duration(static_cast<sheratan::process_impl::posix::daemonization_report::phase::value_type>(p));
+      BOOST_CHECK(!duration.is_negative());
+      total += duration;
+    }
+    BOOST_CHECK(total == report.get_total());
+    BOOST_CHECK(report.get_total() < boost::posix_time::seconds(5));
+    BOOST_CHECK_THROW(report.get_duration(sheratan::process_impl::posix::daemonization_report::phase::COUNT), sheratan::errhdl::logic_error);
+  }
+
+  /// \brief Unit-test case: Failure reported by the daemon.
+  BOOST_AUTO_TEST_CASE(failure)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    // daemon fails to change its working directory, its exception is the cause of child's one
+    test_daemon_ctl dc;
+    try {
+      test_daemon daemon_process(
+        dc,
+        sheratan::process_impl::posix::daemonizer::pid_file_type(),
+        sheratan::process_impl::posix::daemonizer::pid_file_mode_type(),
+        sheratan::process_impl::posix::daemonizer::working_dir_type("/nonexistent/sheratan_process_posix_daemon")
+      );
+      BOOST_ERROR("exception expected");
+    }
+    catch(sheratan::errhdl::runtime_error &ex) {
+      BOOST_CHECK_EQUAL(get_code(ex).get_errnum(), sheratan::process_impl::posix::errnum::DAEMON_ERROR);
+      BOOST_CHECK_NE(std::string(get_file(ex)), "");
+      sheratan::errhdl::exception::const_iterator cause = ++static_cast<const sheratan::errhdl::exception &>(ex).begin();
+      BOOST_REQUIRE(cause != static_cast<const sheratan::errhdl::exception &>(ex).end());
+      BOOST_CHECK(dynamic_cast<const sheratan::errhdl::runtime_error *>(&*cause) != NULL);
+      BOOST_CHECK(get_code(*cause).get_category() == sheratan::process_impl::posix::get_error_category());
+      BOOST_CHECK_EQUAL(get_code(*cause).get_errnum(), sheratan::process_impl::posix::errnum::POSIX_SYSTEM);
+      BOOST_CHECK_EQUAL(sheratan::process_impl::posix::get_posix_errnum(*cause), ENOENT);
+      BOOST_CHECK_NE(std::string(get_file(*cause)).find("daemonization_resources.cpp"), std::string::npos);
+      BOOST_CHECK_GT(get_line(*cause), 0u);
+    }
+  }
+
+  /// \brief Unit-test case: Signal mask.
+  BOOST_AUTO_TEST_CASE(signal_mask)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    sigset_t orig_mask;
+    BOOST_REQUIRE_EQUAL(::pthread_sigmask(SIG_BLOCK, NULL, &orig_mask), 0);
+
+    // signals are blocked during daemonization only, both on success and on failure
+    test_daemon_ctl dc;
+    {
+      test_daemon daemon_process(
+        dc,
+        sheratan::process_impl::posix::daemonizer::pid_file_type(),
+        sheratan::process_impl::posix::daemonizer::pid_file_mode_type(),
+        sheratan::process_impl::posix::daemonizer::working_dir_type("./")
+      );
+      BOOST_CHECK_EQUAL(daemon_process.valid(), true);
+    }
+    BOOST_CHECK_THROW(
+      test_daemon(
+        dc,
+        sheratan::process_impl::posix::daemonizer::pid_file_type(),
+        sheratan::process_impl::posix::daemonizer::pid_file_mode_type(),
+        sheratan::process_impl::posix::daemonizer::working_dir_type("/nonexistent/sheratan_process_posix_daemon")
+      ),
+      sheratan::errhdl::runtime_error
+    );
+
+    // signals are not blocked anymore once the 1st child is reaped (daemon is waited for and postdaemonized afterwards)
+    {
+      sheratan::process_impl::posix::static_daemon_template<test_counting_daemon_ctl> daemon_process(
+        test_counting_daemon_ctl(),
+        sheratan::process_impl::posix::daemonizer::pid_file_type(),
+        sheratan::process_impl::posix::daemonizer::pid_file_mode_type(),
+        sheratan::process_impl::posix::daemonizer::working_dir_type("./")
+      );
+      BOOST_CHECK_EQUAL(daemon_process.get_daemon_ctl().postdaemonized_, 1);
+      BOOST_CHECK_EQUAL(::sigismember(&daemon_process.get_daemon_ctl().postdaemonize_mask_, SIGTERM), ::sigismember(&orig_mask, SIGTERM));
+      BOOST_CHECK_EQUAL(::sigismember(&daemon_process.get_daemon_ctl().postdaemonize_mask_, SIGHUP), ::sigismember(&orig_mask, SIGHUP));
+    }
+
+    sigset_t mask;
+    BOOST_REQUIRE_EQUAL(::pthread_sigmask(SIG_BLOCK, NULL, &mask), 0);
+    BOOST_CHECK_EQUAL(::sigismember(&mask, SIGTERM), ::sigismember(&orig_mask, SIGTERM));
+    BOOST_CHECK_EQUAL(::sigismember(&mask, SIGHUP), ::sigismember(&orig_mask, SIGHUP));
+    BOOST_CHECK_EQUAL(::sigismember(&mask, SIGCHLD), ::sigismember(&orig_mask, SIGCHLD));
+  }
+
+  /// \brief Unit-test case: Inherited file descriptors.
+  BOOST_AUTO_TEST_CASE(inherited_fds)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    // create socket pairs, daemon inherits one end of each
+    int sv_1[2];
+    int sv_2[2];
+    BOOST_REQUIRE_EQUAL(::socketpair(AF_UNIX, SOCK_STREAM, 0, sv_1), 0);
+    BOOST_REQUIRE_EQUAL(::socketpair(AF_UNIX, SOCK_STREAM, 0, sv_2), 0);
+    sheratan::process_impl::posix::daemonizer::inherited_fds_type::value_type inherited_fds;
+    inherited_fds.push_back(sv_2[1]);
+    inherited_fds.push_back(sv_1[1]);
+
+    // create daemon
+    test_inheriting_daemon_ctl dc(inherited_fds.size());
+    test_daemon daemon_process(
+      dc,
+      sheratan::process_impl::posix::daemonizer::pid_file_type(),
+      sheratan::process_impl::posix::daemonizer::pid_file_mode_type(),
+      sheratan::process_impl::posix::daemonizer::working_dir_type("./"),
+      sheratan::process_impl::posix::daemonizer::stdin_redirect_type(),
+      sheratan::process_impl::posix::daemonizer::stdout_redirect_type(),
+      sheratan::process_impl::posix::daemonizer::stderr_redirect_type(),
+      sheratan::process_impl::posix::daemonizer::reset_signals_flag_type(),
+      sheratan::process_impl::posix::daemonizer::inherited_fds_type(inherited_fds)
+    );
+    BOOST_CHECK_EQUAL(daemon_process.valid(), true);
+    ::close(sv_1[1]);
+    ::close(sv_2[1]);
+
+    // inherited sockets are passed in the order they are listed
+    struct pollfd pfd[2];
+    pfd[0].fd = sv_2[0];
+    pfd[0].events = POLLIN;
+    pfd[1].fd = sv_1[0];
+    pfd[1].events = POLLIN;
+    for(int i = 0; i < 2; ++i) {
+      BOOST_REQUIRE_EQUAL(::poll(&pfd[i], 1, 5000), 1);
+      char data = 0;
+      BOOST_CHECK_EQUAL(::read(pfd[i].fd, &data, 1), 1);
+      BOOST_CHECK_EQUAL(data, static_cast<char>('0' + i));
+    }
+    ::close(sv_1[0]);
+    ::close(sv_2[0]);
+
+    // standard streams can not be inherited
+    inherited_fds.push_back(STDOUT_FILENO);
+    BOOST_CHECK_THROW(
+      sheratan::process_impl::posix::daemonizer(
+        dc,
+        sheratan::process_impl::posix::daemonizer::pid_file_type(),
+        sheratan::process_impl::posix::daemonizer::pid_file_mode_type(),
+        sheratan::process_impl::posix::daemonizer::working_dir_type(),
+        sheratan::process_impl::posix::daemonizer::stdin_redirect_type(),
+        sheratan::process_impl::posix::daemonizer::stdout_redirect_type(),
+        sheratan::process_impl::posix::daemonizer::stderr_redirect_type(),
+        sheratan::process_impl::posix::daemonizer::reset_signals_flag_type(),
+        sheratan::process_impl::posix::daemonizer::inherited_fds_type(inherited_fds)
+      ),
+      sheratan::errhdl::logic_error
+    );
+  }
+
+  /// \brief Unit-test case: Readiness notification.
+  BOOST_AUTO_TEST_CASE(readiness)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    // wait for the daemon to be ready, all the stages are reported in order
+    {
+      test_daemon daemon_process;
+      sheratan::process_impl::posix::daemonizer::ready_stage_list_type stages = create_ready_daemon(daemon_process, test_ready_daemon_ctl::READY, sheratan::process_impl::posix::daemonizer::READY_STAGE, boost::posix_time::seconds(5));
+      BOOST_CHECK_EQUAL(daemon_process.valid(), true);
+      BOOST_REQUIRE_EQUAL(stages.size(), 3U);
+      BOOST_CHECK_EQUAL(stages[0].first, "init");
+      BOOST_CHECK_EQUAL(stages[1].first, "listen");
+      BOOST_CHECK_EQUAL(stages[2].first, sheratan::process_impl::posix::daemonizer::READY_STAGE);
+      BOOST_CHECK(stages[0].second <= stages[1].second);
+      BOOST_CHECK(stages[1].second <= stages[2].second);
+    }
+
+    // wait for named stage only
+    {
+      test_daemon daemon_process;
+      sheratan::process_impl::posix::daemonizer::ready_stage_list_type stages = create_ready_daemon(daemon_process, test_ready_daemon_ctl::HANG, "init", boost::posix_time::seconds(5));
+      BOOST_CHECK_EQUAL(daemon_process.valid(), true);
+      BOOST_REQUIRE_EQUAL(stages.size(), 1U);
+      BOOST_CHECK_EQUAL(stages[0].first, "init");
+      BOOST_CHECK_EQUAL(::kill(daemon_process.get_pid().get_value(), SIGTERM), 0);
+    }
+
+    // daemon exits before it is ready
+    try {
+      test_daemon daemon_process;
+      create_ready_daemon(daemon_process, test_ready_daemon_ctl::EXIT, sheratan::process_impl::posix::daemonizer::READY_STAGE, boost::posix_time::seconds(5));
+      BOOST_ERROR("exception expected");
+    }
+    catch(sheratan::errhdl::runtime_error &ex) {
+      BOOST_CHECK_EQUAL(get_code(ex).get_errnum(), sheratan::process_impl::posix::errnum::DAEMON_NOT_READY);
+    }
+
+    // daemon is not ready in time
+    try {
+      test_daemon daemon_process;
+      create_ready_daemon(daemon_process, test_ready_daemon_ctl::HANG, sheratan::process_impl::posix::daemonizer::READY_STAGE, boost::posix_time::milliseconds(200));
+      BOOST_ERROR("exception expected");
+    }
+    catch(sheratan::errhdl::runtime_error &ex) {
+      BOOST_CHECK_EQUAL(get_code(ex).get_errnum(), sheratan::process_impl::posix::errnum::DAEMON_NOT_READY);
+    }
+  }
+
+  /// \brief Unit-test case: PID file lock.
+  BOOST_AUTO_TEST_CASE(pid_file_lock)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    ::unlink(locked_pid_file);
+
+    // running daemon holds the lock acquired by its parent process
+    test_daemon daemon_process;
+    create_ready_daemon(daemon_process, test_ready_daemon_ctl::HANG, "init", boost::posix_time::seconds(5), locked_pid_file);
+    BOOST_REQUIRE_EQUAL(daemon_process.valid(), true);
+    std::ifstream pid_file(locked_pid_file);
+    sheratan::process_impl::posix::process_id::value_type pid = 0;
+    BOOST_CHECK(pid_file >> pid);
+    BOOST_CHECK_EQUAL(pid, daemon_process.get_pid().get_value());
+
+    // second instance is refused by its parent process
+    test_daemon_ctl dc;
+    try {
+      test_daemon second_daemon_process(
+        dc,
+        sheratan::process_impl::posix::daemonizer::pid_file_type(locked_pid_file)
+      );
+      BOOST_ERROR("exception expected");
+    }
+    catch(sheratan::errhdl::runtime_error &ex) {
+      BOOST_CHECK_EQUAL(get_code(ex).get_errnum(), sheratan::process_impl::posix::errnum::PIDFILE_LOCKED);
+    }
+
+    BOOST_CHECK_EQUAL(::kill(daemon_process.get_pid().get_value(), SIGTERM), 0);
+    ::unlink(locked_pid_file);
+  }
+
+  /// \brief Unit-test case: Memory policy.
+  BOOST_AUTO_TEST_CASE(memory_policy)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    // memory can be locked only if the limit allows it
+    struct rlimit memlock_limit;
+    BOOST_REQUIRE_EQUAL(::getrlimit(RLIMIT_MEMLOCK, &memlock_limit), 0);
+    bool locked = ((::geteuid() == 0) || (memlock_limit.rlim_cur == RLIM_INFINITY));
+
+    // daemon checks its memory policy and reports it back
+    int pipe_fd[2];
+    BOOST_REQUIRE_EQUAL(::pipe(pipe_fd), 0);
+    sheratan::process_impl::posix::daemonizer::inherited_fds_type::value_type inherited_fds;
+    inherited_fds.push_back(pipe_fd[1]);
+    test_daemon daemon_process(
+      test_memory_daemon_ctl(locked),
+      sheratan::process_impl::posix::daemonizer::pid_file_type(),
+      sheratan::process_impl::posix::daemonizer::pid_file_mode_type(),
+      sheratan::process_impl::posix::daemonizer::working_dir_type("./"),
+      sheratan::process_impl::posix::daemonizer::stdin_redirect_type(),
+      sheratan::process_impl::posix::daemonizer::stdout_redirect_type(),
+      sheratan::process_impl::posix::daemonizer::stderr_redirect_type(),
+      sheratan::process_impl::posix::daemonizer::reset_signals_flag_type(),
+      sheratan::process_impl::posix::daemonizer::inherited_fds_type(inherited_fds),
+      sheratan::process_impl::posix::daemonizer::ready_stage_type(),
+      sheratan::process_impl::posix::daemonizer::ready_timeout_type(),
+      sheratan::process_impl::posix::daemonizer::mode_type(),
+      sheratan::process_impl::posix::daemonizer::lock_memory_flag_type(locked),
+      sheratan::process_impl::posix::daemonizer::transparent_huge_pages_type(sheratan::process_impl::posix::transparent_huge_pages::DISABLED),
+      sheratan::process_impl::posix::daemonizer::oom_score_adj_type(memory_oom_score_adj),
+      sheratan::process_impl::posix::daemonizer::prefault_size_type(memory_prefault_size)
+    );
+    BOOST_CHECK_EQUAL(daemon_process.valid(), true);
+    ::close(pipe_fd[1]);
+    char data = 0;
+    BOOST_CHECK_EQUAL(::read(pipe_fd[0], &data, 1), 1);
+    BOOST_CHECK_EQUAL(data, 'm');
+    ::close(pipe_fd[0]);
+
+    // OOM score adjustment out of range
+    BOOST_CHECK_THROW(
+      sheratan::process_impl::posix::daemonizer(
+        test_daemon_ctl(),
+        sheratan::process_impl::posix::daemonizer::pid_file_type(),
+        sheratan::process_impl::posix::daemonizer::pid_file_mode_type(),
+        sheratan::process_impl::posix::daemonizer::working_dir_type(),
+        sheratan::process_impl::posix::daemonizer::stdin_redirect_type(),
+        sheratan::process_impl::posix::daemonizer::stdout_redirect_type(),
+        sheratan::process_impl::posix::daemonizer::stderr_redirect_type(),
+        sheratan::process_impl::posix::daemonizer::reset_signals_flag_type(),
+        sheratan::process_impl::posix::daemonizer::inherited_fds_type(),
+        sheratan::process_impl::posix::daemonizer::ready_stage_type(),
+        sheratan::process_impl::posix::daemonizer::ready_timeout_type(),
+        sheratan::process_impl::posix::daemonizer::mode_type(),
+        sheratan::process_impl::posix::daemonizer::lock_memory_flag_type(),
+        sheratan::process_impl::posix::daemonizer::transparent_huge_pages_type(),
+        sheratan::process_impl::posix::daemonizer::oom_score_adj_type(1001)
+      ),
+      sheratan::errhdl::logic_error
+    );
+  }
+
+  /// \brief Unit-test case: Foreground (supervised) daemon.
+  BOOST_AUTO_TEST_CASE(foreground)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    // supervised process exits regularly, buffered output would be written twice otherwise
+    std::cout.flush();
+
+    // supervised process becomes the daemon, exit status of daemon routine is its exit status
+    int pipe_fd[2];
+    BOOST_REQUIRE_EQUAL(::pipe(pipe_fd), 0);
+    test_supervised_fork_ctl fc(pipe_fd[1]);
+    test_supervised_process supervised(fc);
+    ::close(pipe_fd[1]);
+    sheratan::process_impl::posix::exit_status status = supervised.join();
+    BOOST_REQUIRE_EQUAL(status.exited(), true);
+    BOOST_CHECK_EQUAL(status.get_status(), foreground_status);
+    char data = 0;
+    BOOST_CHECK_EQUAL(::read(pipe_fd[0], &data, 1), 1);
+    BOOST_CHECK_EQUAL(data, 'f');
+    ::close(pipe_fd[0]);
+    ::unlink(foreground_pid_file);
+
+    // asynchronous daemonization is not available in foreground mode
+    sheratan::process_impl::posix::daemonizer d(
+      test_daemon_ctl(),
+      sheratan::process_impl::posix::daemonizer::pid_file_type(),
+      sheratan::process_impl::posix::daemonizer::pid_file_mode_type(),
+      sheratan::process_impl::posix::daemonizer::working_dir_type(),
+      sheratan::process_impl::posix::daemonizer::stdin_redirect_type(),
+      sheratan::process_impl::posix::daemonizer::stdout_redirect_type(),
+      sheratan::process_impl::posix::daemonizer::stderr_redirect_type(),
+      sheratan::process_impl::posix::daemonizer::reset_signals_flag_type(),
+      sheratan::process_impl::posix::daemonizer::inherited_fds_type(),
+      sheratan::process_impl::posix::daemonizer::ready_stage_type(),
+      sheratan::process_impl::posix::daemonizer::ready_timeout_type(),
+      sheratan::process_impl::posix::daemonizer::mode_type(sheratan::process_impl::posix::daemonization_mode::FOREGROUND)
+    );
+    BOOST_CHECK_THROW(d.begin_daemonize(), sheratan::errhdl::logic_error);
+  }
+
+  /// \brief Unit-test case: Foreground daemon with its own file descriptor in the inherited range.
+  BOOST_AUTO_TEST_CASE(foreground_occupied)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    // supervised process exits regularly, buffered output would be written twice otherwise
+    std::cout.flush();
+
+    // own file descriptor of supervised process is moved, rather than replaced by inherited one
+    int pipe_fd[2];
+    BOOST_REQUIRE_EQUAL(::pipe(pipe_fd), 0);
+    test_occupied_fork_ctl fc(pipe_fd[1]);
+    test_supervised_process supervised(fc);
+    ::close(pipe_fd[1]);
+    sheratan::process_impl::posix::exit_status status = supervised.join();
+    BOOST_REQUIRE_EQUAL(status.exited(), true);
+    BOOST_CHECK_EQUAL(status.get_status(), foreground_status);
+    char data = 0;
+    BOOST_CHECK_EQUAL(::read(pipe_fd[0], &data, 1), 1);
+    BOOST_CHECK_EQUAL(data, 'o');
+    ::close(pipe_fd[0]);
+  }
+
 BOOST_AUTO_TEST_SUITE_END() // process
 
 
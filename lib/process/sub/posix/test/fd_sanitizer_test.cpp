@@ -0,0 +1,193 @@
+/// \file process/sub/posix/test/fd_sanitizer_test.cpp
+/// \brief File descriptor sanitizer POSIX implementation unit-test file.
+/// \ingroup sheratan_process_posix_test
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#include <cerrno>
+
+#include <unistd.h>
+#include <fcntl.h>
+
+#include <boost/test/unit_test.hpp>
+#include "boost_test_sigchld_suppressor.hpp"
+
+#include "sheratan/errhdl/exception.hpp"
+#include "sheratan/process/posix/fd_sanitizer.hpp"
+#include "sheratan/process/posix/fork_ctl.hpp"
+#include "sheratan/process/posix/process_template.hpp"
+
+
+namespace {
+
+
+/// \brief Test process type definition.
+typedef sheratan::process_impl::posix::process_template<struct test_fd_sanitizer_process_tag> test_fd_sanitizer_process;
+
+/// \brief Exit status of child process, in case sanitization method is not available.
+static const sheratan::process_impl::posix::exit_status::value_type method_not_available = 100;
+
+/// \brief Excluded file descriptor with high number.
+static const int excluded_high_fd = 100;
+
+/// \brief Sanitized file descriptor with high number.
+static const int sanitized_high_fd = 200;
+
+
+/// \brief Check state of file descriptor.
+/// \param fd File descriptor.
+/// \param open Whether file descriptor is expected to be open.
+/// \param cloexec Whether file descriptor is expected to have close-on-exec flag set.
+/// \retval true File descriptor is in expected state.
+/// \retval false File descriptor is not in expected state.
+static bool check_fd(int fd, bool open, bool cloexec)
+{
+  int flags = ::fcntl(fd, F_GETFD);
+  if(!open) {
+    return (flags < 0 && errno == EBADF);
+  }
+  return (flags >= 0 && ((flags & FD_CLOEXEC) != 0) == cloexec);
+}
+
+/// \brief Fork controller of child process, which sanitizes its file descriptors.
+class test_sanitizing_fork_ctl : public sheratan::process_impl::posix::fork_ctl
+{
+  public:
+
+    test_sanitizing_fork_ctl(sheratan::process_impl::posix::fd_sanitizer::method::value_type method, sheratan::process_impl::posix::fd_sanitizer::mode::value_type mode)
+    : method_(method)
+    , mode_(mode)
+    {
+    }
+
+    virtual sheratan::process_impl::posix::fork_ctl * clone() const
+    {
+      return new test_sanitizing_fork_ctl(*this);
+    }
+
+    virtual void prefork()
+    {
+    }
+
+    virtual void postfork(sheratan::process_impl::posix::process &)
+    {
+    }
+
+    virtual sheratan::process_impl::posix::exit_status::value_type child()
+    {
+      try {
+        // open file descriptors, half of them excluded
+        int excluded_fd = ::open("/dev/null", O_RDONLY);
+        int sanitized_fd = ::open("/dev/null", O_RDONLY);
+        if(excluded_fd < 0 || sanitized_fd < 0) {
+          return 1;
+        }
+        if(::dup2(excluded_fd, excluded_high_fd) < 0 || ::dup2(sanitized_fd, sanitized_high_fd) < 0) {
+          return 2;
+        }
+        sheratan::process_impl::posix::fd_sanitizer sanitizer;
+        sanitizer.exclude_std_streams();
+        sanitizer.exclude(excluded_fd);
+        sanitizer.exclude(excluded_high_fd);
+
+        // sanitize
+        if(!sanitizer.sanitize(this->method_, this->mode_)) {
+          return method_not_available;
+        }
+
+        // check that excluded file descriptors are intact
+        if(!check_fd(STDERR_FILENO, true, false) || !check_fd(excluded_fd, true, false) || !check_fd(excluded_high_fd, true, false)) {
+          return 3;
+        }
+
+        // check that other file descriptors are sanitized
+        bool close_on_exec = (this->mode_ == sheratan::process_impl::posix::fd_sanitizer::mode::CLOSE_ON_EXEC);
+        if(!check_fd(sanitized_fd, close_on_exec, true) || !check_fd(sanitized_high_fd, close_on_exec, true)) {
+          return 4;
+        }
+      } catch(...) {
+        return 5;
+      }
+      return 0;
+    }
+
+  private:
+
+    /// \brief Sanitization method.
+    sheratan::process_impl::posix::fd_sanitizer::method::value_type method_;
+
+    /// \brief Sanitization mode.
+    sheratan::process_impl::posix::fd_sanitizer::mode::value_type mode_;
+};
+
+
+/// \brief All sanitization methods.
+static const sheratan::process_impl::posix::fd_sanitizer::method::value_type all_methods[] = {
+  sheratan::process_impl::posix::fd_sanitizer::method::CLOSE_RANGE,
+  sheratan::process_impl::posix::fd_sanitizer::method::PROC_FD,
+  sheratan::process_impl::posix::fd_sanitizer::method::BRUTE_FORCE
+};
+
+/// \brief All sanitization modes.
+static const sheratan::process_impl::posix::fd_sanitizer::mode::value_type all_modes[] = {
+  sheratan::process_impl::posix::fd_sanitizer::mode::CLOSE,
+  sheratan::process_impl::posix::fd_sanitizer::mode::CLOSE_ON_EXEC
+};
+
+
+BOOST_AUTO_TEST_SUITE(fd_sanitizer)
+
+  /// \brief Unit-test case: Exclusion.
+  BOOST_AUTO_TEST_CASE(exclusion)
+  {
+    sheratan::process_impl::posix::fd_sanitizer sanitizer;
+    BOOST_CHECK_EQUAL(sanitizer.excluded(STDIN_FILENO), false);
+    BOOST_CHECK_EQUAL(sanitizer.excluded(-1), false);
+
+    sanitizer.exclude(1000);
+    BOOST_CHECK_EQUAL(sanitizer.excluded(1000), true);
+    BOOST_CHECK_EQUAL(sanitizer.excluded(999), false);
+    BOOST_CHECK_EQUAL(sanitizer.excluded(1001), false);
+
+    sanitizer.exclude_std_streams();
+    BOOST_CHECK_EQUAL(sanitizer.excluded(STDIN_FILENO), true);
+    BOOST_CHECK_EQUAL(sanitizer.excluded(STDOUT_FILENO), true);
+    BOOST_CHECK_EQUAL(sanitizer.excluded(STDERR_FILENO), true);
+    BOOST_CHECK_EQUAL(sanitizer.excluded(3), false);
+
+    BOOST_CHECK_THROW(sanitizer.exclude(-1), sheratan::errhdl::logic_error);
+  }
+
+  /// \brief Unit-test case: Sanitization with all methods and modes.
+  BOOST_AUTO_TEST_CASE(sanitization)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    for(std::size_t i = 0; i < sizeof(all_methods) / sizeof(all_methods[0]); ++i) {
+      for(std::size_t j = 0; j < sizeof(all_modes) / sizeof(all_modes[0]); ++j) {
+        BOOST_TEST_MESSAGE("sanitization method: " << all_methods[i] << ", mode: " << all_modes[j]);
+
+        test_fd_sanitizer_process child(test_sanitizing_fork_ctl(all_methods[i], all_modes[j]));
+        sheratan::process_impl::posix::exit_status exit_status = child.join();
+        BOOST_REQUIRE_EQUAL(exit_status.exited(), true);
+        if(exit_status.get_status() == method_not_available) {
+          BOOST_TEST_MESSAGE("sanitization method not available");
+          BOOST_CHECK_NE(all_methods[i], sheratan::process_impl::posix::fd_sanitizer::method::BRUTE_FORCE);
+          continue;
+        }
+        BOOST_CHECK_EQUAL(exit_status.get_status(), 0);
+      }
+    }
+  }
+
+BOOST_AUTO_TEST_SUITE_END() // fd_sanitizer
+
+
+} // anonymous namespace
+
+
+// vim: set ts=2 sw=2 et:
@@ -0,0 +1,186 @@
+/// \file process/sub/posix/test/hot_restart_test.cpp
+/// \brief Hot restart POSIX implementation unit-test file.
+/// \ingroup sheratan_process_posix_test
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#include <string>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include "boost_test_sigchld_suppressor.hpp"
+
+#include "sheratan/errhdl/exception.hpp"
+#include "sheratan/process/posix/error_category.hpp"
+#include "sheratan/process/posix/daemon_template.hpp"
+#include "sheratan/process/posix/hot_restart.hpp"
+
+
+namespace {
+
+
+/// \brief Test daemon type definition.
+typedef sheratan::process_impl::posix::daemon_template<struct test_hot_restart_daemon_tag> test_hot_restart_daemon;
+
+/// \brief Opaque state handed over to successor.
+static const char test_state[] = "connections=42";
+
+
+/// \brief Daemon controller of successor daemon.
+/// \note Successor takes sockets and state over, waits for a byte on the
+/// first socket, replies with the state and reports it is ready. In case
+/// it is asked to fail, it exits without reporting it is ready.
+class test_successor_daemon_ctl : public sheratan::process_impl::posix::daemon_ctl
+{
+  public:
+
+    explicit test_successor_daemon_ctl(bool fail)
+    : fail_(fail)
+    {
+    }
+
+    virtual sheratan::process_impl::posix::daemon_ctl * clone() const
+    {
+      return new test_successor_daemon_ctl(*this);
+    }
+
+    virtual void predaemonize()
+    {
+    }
+
+    virtual void postdaemonize(sheratan::process_impl::posix::daemon &)
+    {
+    }
+
+    virtual sheratan::process_impl::posix::exit_status::value_type daemonized_child()
+    {
+      try {
+        sheratan::process_impl::posix::hot_restart hr(sheratan::process_impl::posix::daemonizer::LISTEN_FDS_START);
+        sheratan::process_impl::posix::hot_restart::fd_list_type fds;
+        sheratan::process_impl::posix::hot_restart::state_type state;
+        hr.take_over(fds, state);
+        if(this->fail_) {
+          return 1;
+        }
+        if(fds.size() != 1) {
+          return 2;
+        }
+        char data = 0;
+        if(::read(fds[0], &data, 1) != 1) {
+          return 3;
+        }
+        if(::write(fds[0], state.data(), state.size()) != static_cast<ssize_t>(state.size())) {
+          return 4;
+        }
+        hr.report_ready();
+      } catch(...) {
+        return 5;
+      }
+      return 0;
+    }
+
+  private:
+
+    /// \brief Whether the successor is to fail.
+    bool fail_;
+};
+
+/// \brief Spawn successor daemon.
+/// \param hr Hot restart channel.
+/// \param fail Whether the successor is to fail.
+static void spawn_successor(sheratan::process_impl::posix::hot_restart &hr, bool fail)
+{
+  sheratan::process_impl::posix::daemonizer::inherited_fds_type::value_type inherited_fds;
+  inherited_fds.push_back(hr.get_successor_fd());
+  test_successor_daemon_ctl dc(fail);
+  test_hot_restart_daemon successor(
+    dc,
+    sheratan::process_impl::posix::daemonizer::pid_file_type(),
+    sheratan::process_impl::posix::daemonizer::pid_file_mode_type(),
+    sheratan::process_impl::posix::daemonizer::working_dir_type("./"),
+    sheratan::process_impl::posix::daemonizer::stdin_redirect_type(),
+    sheratan::process_impl::posix::daemonizer::stdout_redirect_type(),
+    sheratan::process_impl::posix::daemonizer::stderr_redirect_type(),
+    sheratan::process_impl::posix::daemonizer::reset_signals_flag_type(),
+    sheratan::process_impl::posix::daemonizer::inherited_fds_type(inherited_fds)
+  );
+  BOOST_CHECK_EQUAL(successor.valid(), true);
+}
+
+
+BOOST_AUTO_TEST_SUITE(hot_restart)
+
+  /// \brief Unit-test case: Handover.
+  BOOST_AUTO_TEST_CASE(handover)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    // socket to be handed over
+    int sv[2];
+    BOOST_REQUIRE_EQUAL(::socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+
+    // spawn successor and hand the socket and state over
+    sheratan::process_impl::posix::hot_restart hr;
+    BOOST_CHECK_GE(hr.native_handle(), 0);
+    BOOST_CHECK_GE(hr.get_successor_fd(), 0);
+    spawn_successor(hr, false);
+    sheratan::process_impl::posix::hot_restart::fd_list_type fds;
+    fds.push_back(sv[1]);
+    hr.handover(fds, test_state);
+    BOOST_CHECK_EQUAL(hr.get_successor_fd(), -1);
+
+    // handed over socket remains open in predecessor, successor is not ready yet
+    BOOST_CHECK_EQUAL(hr.wait_ready(boost::posix_time::microsec_clock::universal_time() + boost::posix_time::milliseconds(50)), false);
+    BOOST_CHECK_GE(::fcntl(sv[1], F_GETFD), 0);
+
+    // let the successor run, it replies with the state handed over
+    char data = 'x';
+    BOOST_REQUIRE_EQUAL(::write(sv[0], &data, 1), 1);
+    BOOST_CHECK_EQUAL(hr.wait_ready(boost::posix_time::microsec_clock::universal_time() + boost::posix_time::seconds(5)), true);
+    char reply[sizeof(test_state)] = {0};
+    BOOST_CHECK_EQUAL(::read(sv[0], reply, sizeof(reply) - 1), static_cast<ssize_t>(sizeof(test_state) - 1));
+    BOOST_CHECK_EQUAL(std::string(reply), std::string(test_state));
+
+    // predecessor side only
+    BOOST_CHECK_THROW(hr.report_ready(), sheratan::errhdl::logic_error);
+
+    ::close(sv[0]);
+    ::close(sv[1]);
+  }
+
+  /// \brief Unit-test case: Successor fails.
+  BOOST_AUTO_TEST_CASE(successor_failure)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    sheratan::process_impl::posix::hot_restart hr;
+    spawn_successor(hr, true);
+    hr.handover(sheratan::process_impl::posix::hot_restart::fd_list_type(), test_state);
+    try {
+      hr.wait_ready(boost::posix_time::microsec_clock::universal_time() + boost::posix_time::seconds(5));
+      BOOST_ERROR("exception expected");
+    }
+    catch(sheratan::errhdl::runtime_error &ex) {
+      BOOST_CHECK_EQUAL(get_code(ex).get_errnum(), sheratan::process_impl::posix::errnum::HANDOVER_FAILED);
+    }
+  }
+
+BOOST_AUTO_TEST_SUITE_END() // hot_restart
+
+
+} // anonymous namespace
+
+
+// vim: set ts=2 sw=2 et:
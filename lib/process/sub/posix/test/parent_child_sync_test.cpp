@@ -0,0 +1,167 @@
+/// \file process/sub/posix/test/parent_child_sync_test.cpp
+/// \brief Parent-child synchronizer POSIX implementation unit-test file.
+/// \ingroup sheratan_process_posix_test
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#include <poll.h>
+
+#include <boost/test/unit_test.hpp>
+#include "boost_test_sigchld_suppressor.hpp"
+
+#include "sheratan/process/posix/fork_ctl.hpp"
+#include "sheratan/process/posix/parent_child_sync.hpp"
+#include "sheratan/process/posix/process_template.hpp"
+
+
+namespace {
+
+
+/// \brief Test process type definition.
+typedef sheratan::process_impl::posix::process_template<struct test_ping_pong_process_tag> test_ping_pong_process;
+
+/// \brief Number of ping-pong rounds.
+static const int test_rounds = 100;
+
+
+/// \brief Fork controller of ping-pong child.
+/// \note Child waits for each ping and answers it with pong, it exits with
+/// number of rounds played.
+class test_ping_pong_fork_ctl : public sheratan::process_impl::posix::fork_ctl
+{
+  public:
+
+    explicit test_ping_pong_fork_ctl(sheratan::process_impl::posix::parent_child_sync_backend::value_type backend)
+    : backend_(backend)
+    , ping_(backend)
+    , pong_(backend)
+    {
+    }
+
+    test_ping_pong_fork_ctl(const test_ping_pong_fork_ctl &that)
+    : sheratan::process_impl::posix::fork_ctl()
+    , backend_(that.backend_)
+    , ping_(that.backend_)  // each copy must contain its own distinct synchronizers
+    , pong_(that.backend_)
+    {
+    }
+
+    virtual sheratan::process_impl::posix::fork_ctl * clone() const
+    {
+      return new test_ping_pong_fork_ctl(*this);
+    }
+
+    virtual void prefork()
+    {
+      this->ping_.prefork();
+      this->pong_.prefork();
+    }
+
+    virtual void postfork(sheratan::process_impl::posix::process &)
+    {
+    }
+
+    virtual sheratan::process_impl::posix::exit_status::value_type child()
+    {
+      int rounds = 0;
+      for(; rounds < test_rounds; ++rounds) {
+        this->ping_.wait_for_parent();
+        this->pong_.unblock_parent();
+      }
+      return rounds;
+    }
+
+  public:
+
+    /// \brief Synchronizer backend.
+    sheratan::process_impl::posix::parent_child_sync_backend::value_type backend_;
+
+    /// \brief Parent-to-child synchronizer.
+    sheratan::process_impl::posix::parent_child_sync ping_;
+
+    /// \brief Child-to-parent synchronizer.
+    sheratan::process_impl::posix::parent_child_sync pong_;
+};
+
+
+/// \brief Play ping-pong with child process.
+/// \param backend Synchronizer backend.
+static void play_ping_pong(sheratan::process_impl::posix::parent_child_sync_backend::value_type backend)
+{
+  test_ping_pong_process child((test_ping_pong_fork_ctl(backend)));
+  test_ping_pong_fork_ctl &fc = dynamic_cast<test_ping_pong_fork_ctl &>(child.get_fork_ctl());
+  for(int i = 0; i < test_rounds; ++i) {
+    fc.ping_.unblock_child();
+    fc.pong_.wait_for_child();
+  }
+  sheratan::process_impl::posix::exit_status exit_status = child.join();
+  BOOST_CHECK_EQUAL(exit_status.exited(), true);
+  BOOST_CHECK_EQUAL(exit_status.get_status(), test_rounds);
+  fc.ping_.finalize();
+  fc.pong_.finalize();
+}
+
+
+BOOST_AUTO_TEST_SUITE(parent_child_sync)
+
+  /// \brief Unit-test case: Backends.
+  BOOST_AUTO_TEST_CASE(backends)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    BOOST_CHECK_EQUAL(sheratan::process_impl::posix::parent_child_sync::supports(sheratan::process_impl::posix::parent_child_sync_backend::PIPE), true);
+    play_ping_pong(sheratan::process_impl::posix::parent_child_sync_backend::PIPE);
+    if(sheratan::process_impl::posix::parent_child_sync::supports(sheratan::process_impl::posix::parent_child_sync_backend::EVENTFD)) {
+      play_ping_pong(sheratan::process_impl::posix::parent_child_sync_backend::EVENTFD);
+    }
+    if(sheratan::process_impl::posix::parent_child_sync::supports(sheratan::process_impl::posix::parent_child_sync_backend::FUTEX)) {
+      play_ping_pong(sheratan::process_impl::posix::parent_child_sync_backend::FUTEX);
+    }
+  }
+
+  /// \brief Unit-test case: Native handle.
+  BOOST_AUTO_TEST_CASE(native_handle)
+  {
+    // backend is resolved once the synchronizer is created
+    sheratan::process_impl::posix::parent_child_sync sync;
+    BOOST_CHECK_EQUAL(sync.get_backend(), sheratan::process_impl::posix::parent_child_sync_backend::AUTO);
+    BOOST_CHECK_EQUAL(sync.native_handle(), -1);
+    sync.prefork();
+    BOOST_CHECK_NE(sync.get_backend(), sheratan::process_impl::posix::parent_child_sync_backend::AUTO);
+    BOOST_REQUIRE_NE(sync.native_handle(), -1);
+
+    // handle becomes readable once unblocked, and stays so until the unblock is consumed
+    struct pollfd pfd;
+    pfd.fd = sync.native_handle();
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    BOOST_CHECK_EQUAL(::poll(&pfd, 1, 0), 0);
+    sync.unblock_child();
+    sync.unblock_child();
+    BOOST_CHECK_EQUAL(::poll(&pfd, 1, 0), 1);
+    sync.wait_for_child();
+    BOOST_CHECK_EQUAL(::poll(&pfd, 1, 0), 1);
+    sync.wait_for_child();
+    BOOST_CHECK_EQUAL(::poll(&pfd, 1, 0), 0);
+    sync.finalize();
+    BOOST_CHECK_EQUAL(sync.native_handle(), -1);
+
+    // futex has no file descriptor
+    sheratan::process_impl::posix::parent_child_sync futex_sync(sheratan::process_impl::posix::parent_child_sync_backend::FUTEX);
+    futex_sync.prefork();
+    BOOST_CHECK_EQUAL(futex_sync.native_handle(), -1);
+    futex_sync.unblock_parent();
+    futex_sync.wait_for_parent();
+  }
+
+BOOST_AUTO_TEST_SUITE_END() // parent_child_sync
+
+
+} // anonymous namespace
+
+
+// vim: set ts=2 sw=2 et:
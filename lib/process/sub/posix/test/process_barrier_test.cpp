@@ -0,0 +1,213 @@
+/// \file process/sub/posix/test/process_barrier_test.cpp
+/// \brief Process barrier POSIX implementation unit-test file.
+/// \ingroup sheratan_process_posix_test
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#include <cstddef>
+#include <fstream>
+
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include "boost_test_sigchld_suppressor.hpp"
+
+#include "sheratan/errhdl/exception.hpp"
+#include "sheratan/process/posix/fork_ctl.hpp"
+#include "sheratan/process/posix/process_barrier.hpp"
+#include "sheratan/process/posix/process_template.hpp"
+
+
+namespace {
+
+
+/// \brief Test process type definition.
+typedef sheratan::process_impl::posix::process_template<struct test_barrier_process_tag> test_barrier_process;
+
+/// \brief Number of phases (init, warm, serve).
+static const int test_phases = 3;
+
+/// \brief Exit status of child, which has seen the barrier broken.
+static const int test_broken_status = 100;
+
+
+/// \brief Fork controller of test barrier party.
+/// \note Child initializes itself for a time derived from its index, then
+/// it passes all the phases and exits with number of phases passed. Child,
+/// which deserts, exits without arriving at the barrier.
+class test_barrier_fork_ctl : public sheratan::process_impl::posix::fork_ctl
+{
+  public:
+
+    test_barrier_fork_ctl(sheratan::process_impl::posix::process_barrier &barrier, std::size_t index, bool desert)
+    : barrier_(barrier)
+    , index_(index)
+    , desert_(desert)
+    {
+    }
+
+    virtual sheratan::process_impl::posix::fork_ctl * clone() const
+    {
+      return new test_barrier_fork_ctl(*this);
+    }
+
+    virtual void prefork()
+    {
+      this->barrier_.prefork();
+    }
+
+    virtual void postfork(sheratan::process_impl::posix::process &child_process)
+    {
+      this->barrier_.postfork(child_process);
+    }
+
+    virtual sheratan::process_impl::posix::exit_status::value_type child()
+    {
+      sheratan::process_impl::posix::exit_status::value_type rc = this->barrier_.child();
+      if(rc != sheratan::process_impl::posix::exit_status::SUCCESS) {
+        return rc;
+      }
+      if(this->desert_) {
+        return 7;
+      }
+      ::usleep(static_cast<useconds_t>((this->index_ + 1) * 10000));
+      int phase = 0;
+      for(; phase < test_phases; ++phase) {
+        if(!this->barrier_.wait()) {
+          return test_broken_status;
+        }
+      }
+      return phase;
+    }
+
+  private:
+
+    /// \brief Process barrier.
+    sheratan::process_impl::posix::process_barrier &barrier_;
+
+    /// \brief Index of the child.
+    std::size_t index_;
+
+    /// \brief Whether the child exits without arriving at the barrier.
+    bool desert_;
+};
+
+
+BOOST_AUTO_TEST_SUITE(process_barrier)
+
+  /// \brief Unit-test case: Phases.
+  BOOST_AUTO_TEST_CASE(phases)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    BOOST_CHECK_THROW(sheratan::process_impl::posix::process_barrier(0), sheratan::errhdl::logic_error);
+
+    const std::size_t children = 3;
+    sheratan::process_impl::posix::process_barrier barrier(children + 1);
+    BOOST_CHECK_EQUAL(barrier.get_parties(), children + 1);
+    BOOST_CHECK_EQUAL(barrier.get_generation(), 0U);
+    boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+    boost::ptr_vector<test_barrier_process> processes;
+    for(std::size_t i = 0; i < children; ++i) {
+      processes.push_back(new test_barrier_process(test_barrier_fork_ctl(barrier, i, false)));
+    }
+
+    // there is no vacant slot for another party
+    BOOST_CHECK_THROW(barrier.prefork(), sheratan::errhdl::logic_error);
+
+    // first phase completes once the slowest child has initialized
+    BOOST_CHECK_EQUAL(barrier.wait(), true);
+    BOOST_CHECK(boost::posix_time::microsec_clock::universal_time() - start >= boost::posix_time::milliseconds(10 * children));
+    for(int phase = 1; phase < test_phases; ++phase) {
+      BOOST_CHECK_EQUAL(barrier.wait(), true);
+    }
+    BOOST_CHECK_EQUAL(barrier.get_generation(), static_cast<std::size_t>(test_phases));
+    BOOST_CHECK_EQUAL(barrier.broken(), false);
+
+    for(std::size_t i = 0; i < children; ++i) {
+      sheratan::process_impl::posix::exit_status exit_status = processes[i].join();
+      BOOST_CHECK_EQUAL(exit_status.exited(), true);
+      BOOST_CHECK_EQUAL(exit_status.get_status(), test_phases);
+    }
+  }
+
+  /// \brief Unit-test case: Party terminated.
+  BOOST_AUTO_TEST_CASE(terminated)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    sheratan::process_impl::posix::process_barrier barrier(3, boost::posix_time::milliseconds(5));
+    test_barrier_process waiting(test_barrier_fork_ctl(barrier, 0, false));
+    test_barrier_process deserting(test_barrier_fork_ctl(barrier, 1, true));
+
+    // deserting child never arrives, waiting parties notice it has terminated
+    BOOST_CHECK_EQUAL(barrier.wait(), false);
+    BOOST_CHECK_EQUAL(barrier.broken(), true);
+    BOOST_CHECK_EQUAL(barrier.wait(), false);
+
+    sheratan::process_impl::posix::exit_status exit_status = waiting.join();
+    BOOST_CHECK_EQUAL(exit_status.get_status(), test_broken_status);
+    exit_status = deserting.join();
+    BOOST_CHECK_EQUAL(exit_status.get_status(), 7);
+  }
+
+  /// \brief Unit-test case: Party terminated and reaped.
+  BOOST_AUTO_TEST_CASE(reaped)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    sheratan::process_impl::posix::process_barrier barrier(2, boost::posix_time::milliseconds(5));
+    test_barrier_process deserting(test_barrier_fork_ctl(barrier, 0, true));
+    pid_t deserting_pid = deserting.get_pid().get_value();
+    sheratan::process_impl::posix::exit_status exit_status = deserting.join();
+    BOOST_CHECK_EQUAL(exit_status.get_status(), 7);
+
+    // PID of reaped party is reused by unrelated process, if possible (it requires privileges)
+    pid_t reusing_pid = -1;
+    std::ofstream last_pid("/proc/sys/kernel/ns_last_pid");
+    if(last_pid << (deserting_pid - 1) << std::flush) {
+      last_pid.close();
+      reusing_pid = ::fork();
+      BOOST_REQUIRE(reusing_pid != -1);
+      if(reusing_pid == 0) {
+        ::pause();
+        ::_exit(0);
+      }
+    }
+    if(reusing_pid != deserting_pid) {
+      BOOST_TEST_MESSAGE("PID of reaped party is not reused");
+    }
+
+    // reaped party is recognized by its process file descriptor held since postfork
+    BOOST_CHECK_EQUAL(barrier.wait(), false);
+    BOOST_CHECK_EQUAL(barrier.broken(), true);
+
+    if(reusing_pid > 0) {
+      ::kill(reusing_pid, SIGKILL);
+      ::waitpid(reusing_pid, NULL, 0);
+    }
+  }
+
+BOOST_AUTO_TEST_SUITE_END() // process_barrier
+
+
+} // anonymous namespace
+
+
+// vim: set ts=2 sw=2 et:
@@ -0,0 +1,204 @@
+/// \file process/sub/posix/test/process_pool_test.cpp
+/// \brief Process pool POSIX implementation unit-test file.
+/// \ingroup sheratan_process_posix_test
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#include <set>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include "boost_test_sigchld_suppressor.hpp"
+
+#include "sheratan/errhdl/exception.hpp"
+#include "sheratan/process/posix/process.hpp"
+#include "sheratan/process/posix/process_pool.hpp"
+#include "sheratan/process/posix/process_template.hpp"
+#include "test_sync_fork_ctl.hpp"
+
+
+using namespace sheratan::process_impl::posix::test;
+
+
+namespace {
+
+
+/// \brief Test process type definition.
+typedef sheratan::process_impl::posix::process_template<struct test_process_pool_process_tag> test_pool_process;
+
+
+BOOST_AUTO_TEST_SUITE(process_pool)
+
+  /// \brief Unit-test case: Default construction.
+  BOOST_AUTO_TEST_CASE(default_construction)
+  {
+    sheratan::process_impl::posix::process_pool pool;
+    BOOST_CHECK_EQUAL(pool.empty(), true);
+    BOOST_CHECK_EQUAL(pool.size(), 0U);
+    BOOST_CHECK_EQUAL(pool.get_pgid(), sheratan::process_impl::posix::process_id());
+    BOOST_CHECK_THROW(pool.join_any(), sheratan::errhdl::logic_error);
+  }
+
+  /// \brief Unit-test case: Add and remove processes.
+  BOOST_AUTO_TEST_CASE(add_remove)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    test_pool_process child(test_sync_fork_ctl(0, false));
+    test_sync_fork_ctl &fc = dynamic_cast<test_sync_fork_ctl &>(child.get_fork_ctl());
+
+    sheratan::process_impl::posix::process_pool pool;
+    pool.add(child);
+    BOOST_CHECK_EQUAL(pool.contains(child), true);
+    BOOST_CHECK_EQUAL(pool.size(), 1U);
+    BOOST_CHECK_THROW(pool.add(child), sheratan::errhdl::logic_error);
+    pool.remove(child);
+    BOOST_CHECK_EQUAL(pool.contains(child), false);
+    BOOST_CHECK_EQUAL(pool.empty(), true);
+
+    fc.unblock_child();
+    fc.finalize();
+    child.join();
+  }
+
+  /// \brief Unit-test case: Join any process.
+  BOOST_AUTO_TEST_CASE(join_any)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    // create child processes (they are blocked until unblocked)
+    boost::ptr_vector<test_pool_process> children;
+    sheratan::process_impl::posix::process_pool pool;
+    for(int i = 0; i < 4; ++i) {
+      children.push_back(new test_pool_process(test_sync_fork_ctl(10 + i, false)));
+      pool.add(children.back());
+    }
+
+    // no child process has completed yet
+    sheratan::process_impl::posix::process_pool::reaped_type none = pool.join_any(true);
+    BOOST_CHECK(none.first == NULL);
+    BOOST_CHECK_EQUAL(none.second.valid(), false);
+
+    // let the third child process complete
+    test_sync_fork_ctl &fc = dynamic_cast<test_sync_fork_ctl &>(children[2].get_fork_ctl());
+    fc.unblock_child();
+    fc.finalize();
+    sheratan::process_impl::posix::process_pool::reaped_type reaped = pool.join_any();
+    BOOST_CHECK(reaped.first == &children[2]);
+    BOOST_CHECK_EQUAL(reaped.second.exited(), true);
+    BOOST_CHECK_EQUAL(reaped.second.get_status(), 12);
+    BOOST_CHECK_EQUAL(children[2].valid(), false);
+    BOOST_CHECK_EQUAL(pool.contains(children[2]), false);
+    BOOST_CHECK_EQUAL(pool.size(), 3U);
+
+    // let the remaining child processes complete
+    for(std::size_t i = 0; i < children.size(); ++i) {
+      if(i == 2) {
+        continue;
+      }
+      test_sync_fork_ctl &remaining_fc = dynamic_cast<test_sync_fork_ctl &>(children[i].get_fork_ctl());
+      remaining_fc.unblock_child();
+      remaining_fc.finalize();
+    }
+    while(!pool.empty()) {
+      reaped = pool.join_any();
+      BOOST_REQUIRE(reaped.first != NULL);
+      BOOST_CHECK_EQUAL(reaped.first->valid(), false);
+      for(std::size_t i = 0; i < children.size(); ++i) {
+        if(reaped.first == &children[i]) {
+          BOOST_CHECK_EQUAL(reaped.second.get_status(), static_cast<int>(10 + i));
+        }
+      }
+    }
+  }
+
+  /// \brief Unit-test case: Reap ready processes.
+  BOOST_AUTO_TEST_CASE(reap_ready)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    // create child processes and let them complete
+    boost::ptr_vector<test_pool_process> children;
+    sheratan::process_impl::posix::process_pool pool;
+    for(int i = 0; i < 16; ++i) {
+      children.push_back(new test_pool_process(test_sync_fork_ctl(i, false)));
+      pool.add(children.back());
+      test_sync_fork_ctl &fc = dynamic_cast<test_sync_fork_ctl &>(children.back().get_fork_ctl());
+      fc.unblock_child();
+      fc.finalize();
+    }
+
+    // reap them in batches
+    std::set<int> statuses;
+    while(!pool.empty()) {
+      sheratan::process_impl::posix::process_pool::reaped_list_type reaped;
+      if(pool.reap_ready(reaped) == 0) {
+        // wait until at least one child process completes
+        sheratan::process_impl::posix::process_pool::reaped_type one = pool.join_any();
+        reaped.push_back(one);
+      }
+      for(std::size_t i = 0; i < reaped.size(); ++i) {
+        BOOST_REQUIRE(reaped[i].first != NULL);
+        BOOST_CHECK_EQUAL(reaped[i].first->valid(), false);
+        BOOST_CHECK_EQUAL(reaped[i].second.exited(), true);
+        statuses.insert(reaped[i].second.get_status());
+      }
+    }
+    BOOST_CHECK_EQUAL(statuses.size(), 16U);
+  }
+
+  /// \brief Unit-test case: Accumulated resource usage.
+  BOOST_AUTO_TEST_CASE(resource_usage)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    sheratan::process_impl::posix::process_pool pool;
+    BOOST_CHECK_EQUAL(pool.get_reaped_count(), 0U);
+    BOOST_CHECK_EQUAL(pool.get_resource_usage().get_minor_faults(), 0);
+
+    // create child processes, let them complete and reap them
+    boost::ptr_vector<test_pool_process> children;
+    for(int i = 0; i < 4; ++i) {
+      children.push_back(new test_pool_process(test_sync_fork_ctl(i, false)));
+      pool.add(children.back());
+      test_sync_fork_ctl &fc = dynamic_cast<test_sync_fork_ctl &>(children.back().get_fork_ctl());
+      fc.unblock_child();
+      fc.finalize();
+    }
+    while(!pool.empty()) {
+      pool.join_any();
+    }
+
+    // usage of all of them is accumulated
+    BOOST_CHECK_EQUAL(pool.get_reaped_count(), 4U);
+    BOOST_CHECK_GT(pool.get_resource_usage().get_max_rss(), 0);
+    BOOST_CHECK_GE(pool.get_resource_usage().get_minor_faults(), 4);
+
+    pool.reset_resource_usage();
+    BOOST_CHECK_EQUAL(pool.get_reaped_count(), 0U);
+    BOOST_CHECK_EQUAL(pool.get_resource_usage().get_max_rss(), 0);
+  }
+
+BOOST_AUTO_TEST_SUITE_END() // process_pool
+
+
+} // anonymous namespace
+
+
+// vim: set ts=2 sw=2 et:
@@ -9,11 +9,15 @@
 /// by other means.
 
 
+#include <poll.h>
+
 #include <boost/test/unit_test.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
 #include "boost_test_sigchld_suppressor.hpp"
 
 #include "sheratan/process/posix/process.hpp"
 #include "sheratan/process/posix/process_template.hpp"
+#include "sheratan/process/posix/static_process_template.hpp"
 #include "test_sync_fork_ctl.hpp"
 
 
@@ -26,6 +30,46 @@ namespace {
 /// \brief Test process type definition.
 typedef sheratan::process_impl::posix::process_template<struct test_parent_child_sync_process_tag> test_parent_child_sync_process;
 
+/// \brief Test static process type definition.
+typedef sheratan::process_impl::posix::static_process_template<test_sync_fork_ctl> test_static_parent_child_sync_process;
+
+
+/// \brief Fork controller, which is not derived from fork controller interface.
+class test_static_fork_ctl
+{
+  public:
+
+    test_static_fork_ctl()
+    : preforked_(false)
+    , postforked_pid_()
+    {
+    }
+
+    void prefork()
+    {
+      this->preforked_ = true;
+    }
+
+    void postfork(sheratan::process_impl::posix::process &child_process)
+    {
+      this->postforked_pid_ = child_process.get_pid();
+    }
+
+    sheratan::process_impl::posix::exit_status::value_type child()
+    {
+      // prefork routine was executed on the very same object before fork
+      return this->preforked_ ? 7 : 1;
+    }
+
+  public:
+
+    /// \brief Whether prefork routine has been executed.
+    bool preforked_;
+
+    /// \brief PID of child process passed to postfork routine.
+    sheratan::process_impl::posix::process_id postforked_pid_;
+};
+
 
 BOOST_AUTO_TEST_SUITE(process)
 
@@ -73,6 +117,40 @@ BOOST_AUTO_TEST_SUITE(process)
     BOOST_CHECK_EQUAL(exit_status.get_status(), 42);
   }
 
+  /// \brief Unit-test case: Join with resource usage.
+  BOOST_AUTO_TEST_CASE(join_usage)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    // create child process
+    test_parent_child_sync_process child(test_sync_fork_ctl(42, false));
+    test_sync_fork_ctl &fc = dynamic_cast<test_sync_fork_ctl &>(child.get_fork_ctl());
+
+    // resource usage is not reported until the child process completes
+    sheratan::process_impl::posix::resource_usage usage;
+    BOOST_CHECK_EQUAL(child.join(usage, true).valid(), false);
+    BOOST_CHECK_EQUAL(usage.get_max_rss(), 0);
+    fc.unblock_child();
+    fc.finalize();
+
+    sheratan::process_impl::posix::exit_status exit_status = child.join(usage);
+    BOOST_CHECK_EQUAL(child.valid(), false);
+    BOOST_CHECK_EQUAL(exit_status.exited(), true);
+    BOOST_CHECK_EQUAL(exit_status.get_status(), 42);
+
+    // forked child process touches (at least) its stack, so it has resident pages and page faults
+    BOOST_CHECK_GT(usage.get_max_rss(), 0);
+    BOOST_CHECK_GT(usage.get_minor_faults(), 0);
+    BOOST_CHECK_GE(usage.get_major_faults(), 0);
+    BOOST_CHECK(!usage.get_user_time().is_negative());
+    BOOST_CHECK(!usage.get_system_time().is_negative());
+    BOOST_CHECK_GE(usage.get_voluntary_context_switches() + usage.get_involuntary_context_switches(), 0);
+  }
+
   /// \brief Unit-test case: Child process with exit by signal.
   BOOST_AUTO_TEST_CASE(child_signal_exit)
   {
@@ -110,6 +188,115 @@ BOOST_AUTO_TEST_SUITE(process)
     BOOST_CHECK_EQUAL(term_status.get_term_signal(), SIGTERM);
   }
 
+  /// \brief Unit-test case: Native handle.
+  BOOST_AUTO_TEST_CASE(native_handle)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    // invalid process has no native handle
+    test_parent_child_sync_process default_constructed;
+    BOOST_CHECK_EQUAL(default_constructed.native_handle(), -1);
+
+    // create child process (it is blocked until unblocked)
+    test_parent_child_sync_process child(test_sync_fork_ctl(42, false));
+    test_sync_fork_ctl &fc = dynamic_cast<test_sync_fork_ctl &>(child.get_fork_ctl());
+    BOOST_REQUIRE_GE(child.native_handle(), 0);
+
+    // native handle is not readable while the child is running
+    struct pollfd pfd;
+    pfd.fd = child.native_handle();
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    BOOST_CHECK_EQUAL(::poll(&pfd, 1, 0), 0);
+
+    // native handle becomes readable once the child terminates
+    fc.unblock_child();
+    fc.finalize();
+    pfd.revents = 0;
+    BOOST_CHECK_EQUAL(::poll(&pfd, 1, -1), 1);
+    BOOST_CHECK((pfd.revents & POLLIN) != 0);
+
+    // join via native handle
+    sheratan::process_impl::posix::exit_status exit_status = child.join();
+    BOOST_CHECK_EQUAL(exit_status.exited(), true);
+    BOOST_CHECK_EQUAL(exit_status.get_status(), 42);
+    BOOST_CHECK_EQUAL(child.native_handle(), -1);
+  }
+
+  /// \brief Unit-test case: Timed join.
+  BOOST_AUTO_TEST_CASE(timed_join)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    // create child process (it is blocked until unblocked)
+    test_parent_child_sync_process child(test_sync_fork_ctl(42, false));
+    test_sync_fork_ctl &fc = dynamic_cast<test_sync_fork_ctl &>(child.get_fork_ctl());
+
+    // deadline expires while the child is still running
+    boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+    sheratan::process_impl::posix::exit_status timeout_status = child.timed_join(boost::posix_time::milliseconds(100));
+    boost::posix_time::time_duration elapsed = boost::posix_time::microsec_clock::universal_time() - start;
+    BOOST_CHECK_EQUAL(timeout_status.valid(), false);
+    BOOST_CHECK_EQUAL(child.valid(), true);
+    BOOST_CHECK(elapsed >= boost::posix_time::milliseconds(100));
+
+    // deadline in the past means non-blocking check
+    timeout_status = child.timed_join(start);
+    BOOST_CHECK_EQUAL(timeout_status.valid(), false);
+    BOOST_CHECK_EQUAL(child.valid(), true);
+
+    // child completes long before the deadline
+    fc.unblock_child();
+    fc.finalize();
+    start = boost::posix_time::microsec_clock::universal_time();
+    sheratan::process_impl::posix::exit_status exit_status = child.timed_join(boost::posix_time::seconds(60));
+    elapsed = boost::posix_time::microsec_clock::universal_time() - start;
+    BOOST_CHECK_EQUAL(child.valid(), false);
+    BOOST_CHECK_EQUAL(exit_status.exited(), true);
+    BOOST_CHECK_EQUAL(exit_status.get_status(), 42);
+    BOOST_CHECK(elapsed < boost::posix_time::seconds(10));
+  }
+
+  /// \brief Unit-test case: Static process.
+  BOOST_AUTO_TEST_CASE(static_process)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    // default construction
+    sheratan::process_impl::posix::static_process_template<test_static_fork_ctl> default_constructed;
+    BOOST_CHECK_EQUAL(default_constructed.valid(), false);
+
+    // fork controller derived from fork controller interface is held by value
+    test_static_parent_child_sync_process child(test_sync_fork_ctl(42, false));
+    test_sync_fork_ctl &fc = child.get_fork_ctl();
+    fc.unblock_child();
+    fc.finalize();
+    BOOST_CHECK_EQUAL(child.valid(), true);
+    sheratan::process_impl::posix::exit_status exit_status = child.join();
+    BOOST_CHECK_EQUAL(exit_status.exited(), true);
+    BOOST_CHECK_EQUAL(exit_status.get_status(), 42);
+
+    // any fork controller providing the routines will do
+    sheratan::process_impl::posix::static_process_template<test_static_fork_ctl> plain_child((test_static_fork_ctl()));
+    BOOST_CHECK_EQUAL(plain_child.get_fork_ctl().preforked_, true);
+    BOOST_CHECK_EQUAL(plain_child.get_fork_ctl().postforked_pid_, plain_child.get_pid());
+    exit_status = plain_child.join();
+    BOOST_CHECK_EQUAL(exit_status.exited(), true);
+    BOOST_CHECK_EQUAL(exit_status.get_status(), 7);
+  }
+
 BOOST_AUTO_TEST_SUITE_END() // process
 
 
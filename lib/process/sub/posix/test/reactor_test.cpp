@@ -0,0 +1,455 @@
+/// \file process/sub/posix/test/reactor_test.cpp
+/// \brief Reactor POSIX implementation unit-test file.
+/// \ingroup sheratan_process_posix_test
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#include <vector>
+
+#include <unistd.h>
+#include <poll.h>
+#include <signal.h>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/bind/bind.hpp>
+#include <boost/ref.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include "boost_test_sigchld_suppressor.hpp"
+
+#include "sheratan/errhdl/exception.hpp"
+#include "sheratan/process/posix/process.hpp"
+#include "sheratan/process/posix/process_template.hpp"
+#include "sheratan/process/posix/reactor.hpp"
+#include "sheratan/process/posix/reactor_backend.hpp"
+#include "test_sync_fork_ctl.hpp"
+
+
+using namespace sheratan::process_impl::posix::test;
+
+
+namespace {
+
+
+/// \brief Test process type definition.
+typedef sheratan::process_impl::posix::process_template<struct test_reactor_process_tag> test_reactor_process;
+
+/// \brief Reactor backends tested explicitly.
+static const sheratan::process_impl::posix::reactor_backend::value_type test_backends[] = {
+  sheratan::process_impl::posix::reactor_backend::EPOLL,
+  sheratan::process_impl::posix::reactor_backend::IO_URING
+};
+
+
+/// \brief Record of events dispatched by the reactor.
+struct event_log
+{
+  /// \brief Record process state change.
+  /// \param proc Process.
+  /// \param status Exit status.
+  void on_process(sheratan::process_impl::posix::process &proc, const sheratan::process_impl::posix::exit_status &status)
+  {
+    processes.push_back(&proc);
+    statuses.push_back(status);
+  }
+
+  /// \brief Record I/O readiness.
+  /// \param fd File descriptor.
+  /// \param events I/O events.
+  void on_io(sheratan::process_impl::posix::file_descriptor_type fd, sheratan::process_impl::posix::io_event_mask_type events)
+  {
+    fds.push_back(fd);
+    io_events.push_back(events);
+  }
+
+  /// \brief Record signal.
+  /// \param signal Signal number.
+  void on_signal(sheratan::process_impl::posix::signal_number_type signal)
+  {
+    signals.push_back(signal);
+  }
+
+  /// \brief Record timer expiry.
+  void on_timer()
+  {
+    ++timers;
+  }
+
+  /// \brief Processes.
+  std::vector<sheratan::process_impl::posix::process *> processes;
+
+  /// \brief Exit statuses.
+  std::vector<sheratan::process_impl::posix::exit_status> statuses;
+
+  /// \brief File descriptors.
+  std::vector<sheratan::process_impl::posix::file_descriptor_type> fds;
+
+  /// \brief I/O events.
+  std::vector<sheratan::process_impl::posix::io_event_mask_type> io_events;
+
+  /// \brief Signals.
+  std::vector<sheratan::process_impl::posix::signal_number_type> signals;
+
+  /// \brief Number of timer expiries.
+  int timers;
+};
+
+
+BOOST_AUTO_TEST_SUITE(reactor)
+
+  /// \brief Unit-test case: Default construction.
+  BOOST_AUTO_TEST_CASE(default_construction)
+  {
+    sheratan::process_impl::posix::reactor r;
+    BOOST_CHECK_EQUAL(r.empty(), true);
+    BOOST_CHECK_EQUAL(r.size(), 0U);
+    BOOST_CHECK_EQUAL(r.run_one(true), 0U);
+    r.run();
+    BOOST_CHECK_EQUAL(r.stopped(), false);
+  }
+
+  /// \brief Unit-test case: Process exit.
+  BOOST_AUTO_TEST_CASE(process_exit)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    event_log log;
+    log.timers = 0;
+    sheratan::process_impl::posix::reactor r;
+
+    // create child processes and watch them
+    test_reactor_process child_1(test_sync_fork_ctl(1, false));
+    test_reactor_process child_2(test_sync_fork_ctl(2, false));
+    r.watch_process(child_1, boost::bind(&event_log::on_process, &log, boost::placeholders::_1, boost::placeholders::_2));
+    r.watch_process(child_2, boost::bind(&event_log::on_process, &log, boost::placeholders::_1, boost::placeholders::_2));
+    BOOST_CHECK_THROW(r.watch_process(child_1, boost::bind(&event_log::on_process, &log, boost::placeholders::_1, boost::placeholders::_2)), sheratan::errhdl::logic_error);
+    BOOST_CHECK_EQUAL(r.size(), 2U);
+
+    // let them complete and dispatch their termination
+    test_sync_fork_ctl &fc_1 = dynamic_cast<test_sync_fork_ctl &>(child_1.get_fork_ctl());
+    test_sync_fork_ctl &fc_2 = dynamic_cast<test_sync_fork_ctl &>(child_2.get_fork_ctl());
+    fc_2.unblock_child();
+    fc_2.finalize();
+    fc_1.unblock_child();
+    fc_1.finalize();
+    r.run();
+
+    BOOST_CHECK_EQUAL(r.empty(), true);
+    BOOST_REQUIRE_EQUAL(log.processes.size(), 2U);
+    for(std::size_t i = 0; i < log.processes.size(); ++i) {
+      BOOST_CHECK_EQUAL(log.processes[i]->valid(), false);
+      BOOST_CHECK_EQUAL(log.statuses[i].exited(), true);
+      BOOST_CHECK_EQUAL(log.statuses[i].get_status(), (log.processes[i] == &child_1) ? 1 : 2);
+    }
+  }
+
+  /// \brief Unit-test case: Process stop and continue.
+  BOOST_AUTO_TEST_CASE(process_stop_continue)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    event_log exited;
+    event_log stopped;
+    event_log continued;
+    sheratan::process_impl::posix::reactor r;
+
+    test_reactor_process child(test_sync_fork_ctl(0, false));
+    test_sync_fork_ctl &fc = dynamic_cast<test_sync_fork_ctl &>(child.get_fork_ctl());
+    r.watch_process(
+      child,
+      boost::bind(&event_log::on_process, &exited, boost::placeholders::_1, boost::placeholders::_2),
+      boost::bind(&event_log::on_process, &stopped, boost::placeholders::_1, boost::placeholders::_2),
+      boost::bind(&event_log::on_process, &continued, boost::placeholders::_1, boost::placeholders::_2)
+    );
+
+    child.kill(SIGSTOP);
+    while(stopped.statuses.empty()) {
+      r.run_one();
+    }
+    BOOST_CHECK_EQUAL(stopped.statuses[0].stopped(), true);
+    BOOST_CHECK_EQUAL(stopped.statuses[0].get_stop_signal(), SIGSTOP);
+    BOOST_CHECK_EQUAL(child.valid(), true);
+
+    child.kill(SIGCONT);
+    while(continued.statuses.empty()) {
+      r.run_one();
+    }
+    BOOST_CHECK_EQUAL(continued.statuses[0].continued(), true);
+
+    fc.unblock_child();
+    fc.finalize();
+    r.run();
+    BOOST_REQUIRE_EQUAL(exited.statuses.size(), 1U);
+    BOOST_CHECK_EQUAL(exited.statuses[0].exited(), true);
+    BOOST_CHECK_EQUAL(child.valid(), false);
+  }
+
+  /// \brief Unit-test case: I/O readiness.
+  BOOST_AUTO_TEST_CASE(io)
+  {
+    event_log log;
+    log.timers = 0;
+    sheratan::process_impl::posix::reactor r;
+
+    int fds[2];
+    BOOST_REQUIRE_EQUAL(::pipe(fds), 0);
+    r.watch_io(fds[0], sheratan::process_impl::posix::io_events::READABLE, boost::bind(&event_log::on_io, &log, boost::placeholders::_1, boost::placeholders::_2));
+    BOOST_CHECK_EQUAL(r.run_one(true), 0U);
+
+    // data available
+    char c = 'x';
+    BOOST_REQUIRE_EQUAL(::write(fds[1], &c, 1), 1);
+    BOOST_CHECK_EQUAL(r.run_one(), 1U);
+    BOOST_REQUIRE_EQUAL(log.fds.size(), 1U);
+    BOOST_CHECK_EQUAL(log.fds[0], fds[0]);
+    BOOST_CHECK((log.io_events[0] & sheratan::process_impl::posix::io_events::READABLE) != 0);
+
+    // writer closed its end
+    BOOST_REQUIRE_EQUAL(::read(fds[0], &c, 1), 1);
+    ::close(fds[1]);
+    BOOST_CHECK_EQUAL(r.run_one(), 1U);
+    BOOST_REQUIRE_EQUAL(log.fds.size(), 2U);
+    BOOST_CHECK((log.io_events[1] & sheratan::process_impl::posix::io_events::HANGUP) != 0);
+
+    r.unwatch_io(fds[0]);
+    BOOST_CHECK_EQUAL(r.empty(), true);
+    ::close(fds[0]);
+  }
+
+  /// \brief Unit-test case: Signals.
+  BOOST_AUTO_TEST_CASE(signals)
+  {
+    event_log log;
+    log.timers = 0;
+    {
+      sheratan::process_impl::posix::reactor r;
+      r.watch_signal(SIGUSR1, boost::bind(&event_log::on_signal, &log, boost::placeholders::_1));
+      BOOST_CHECK_EQUAL(r.size(), 1U);
+
+      // signal is blocked, so it is delivered via signalfd
+      BOOST_REQUIRE_EQUAL(::raise(SIGUSR1), 0);
+      r.run_one();
+      BOOST_REQUIRE_EQUAL(log.signals.size(), 1U);
+      BOOST_CHECK_EQUAL(log.signals[0], SIGUSR1);
+
+      r.unwatch_signal(SIGUSR1);
+      BOOST_CHECK_EQUAL(r.empty(), true);
+    }
+
+    // signal is unblocked again once the reactor is destroyed
+    sigset_t mask;
+    BOOST_REQUIRE_EQUAL(::pthread_sigmask(SIG_BLOCK, NULL, &mask), 0);
+    BOOST_CHECK_EQUAL(::sigismember(&mask, SIGUSR1), 0);
+  }
+
+  /// \brief Unit-test case: Timers.
+  BOOST_AUTO_TEST_CASE(timers)
+  {
+    event_log log;
+    log.timers = 0;
+    sheratan::process_impl::posix::reactor r;
+
+    // one-shot timer is removed after it expires
+    r.add_timer(boost::posix_time::milliseconds(10), boost::bind(&event_log::on_timer, &log));
+    r.run();
+    BOOST_CHECK_EQUAL(log.timers, 1);
+    BOOST_CHECK_EQUAL(r.empty(), true);
+
+    // periodic timer is rearmed until cancelled
+    sheratan::process_impl::posix::reactor::timer_id_type timer_id = r.add_timer(boost::posix_time::milliseconds(5), boost::bind(&event_log::on_timer, &log), true);
+    while(log.timers < 4) {
+      r.run_one();
+    }
+    r.cancel_timer(timer_id);
+    BOOST_CHECK_EQUAL(r.empty(), true);
+  }
+
+  /// \brief Unit-test case: Cancelling expired timer.
+  BOOST_AUTO_TEST_CASE(expired_timer)
+  {
+    event_log log;
+    log.timers = 0;
+    sheratan::process_impl::posix::reactor r;
+
+    sheratan::process_impl::posix::reactor::timer_id_type expired_id = r.add_timer(boost::posix_time::milliseconds(1), boost::bind(&event_log::on_timer, &log));
+    r.run();
+    BOOST_CHECK_EQUAL(log.timers, 1);
+
+    // file descriptor of the expired timer is reused, its ID is not
+    sheratan::process_impl::posix::reactor::timer_id_type live_id = r.add_timer(boost::posix_time::milliseconds(5), boost::bind(&event_log::on_timer, &log));
+    BOOST_CHECK(live_id != expired_id);
+
+    // cancelling expired timer does not affect the live one
+    r.cancel_timer(expired_id);
+    BOOST_CHECK_EQUAL(r.empty(), false);
+    r.run();
+    BOOST_CHECK_EQUAL(log.timers, 2);
+  }
+
+  /// \brief Unit-test case: Stop.
+  BOOST_AUTO_TEST_CASE(stop)
+  {
+    sheratan::process_impl::posix::reactor r;
+    sheratan::process_impl::posix::reactor::timer_id_type timer_id = r.add_timer(
+      boost::posix_time::milliseconds(5),
+      boost::bind(&sheratan::process_impl::posix::reactor::stop, boost::ref(r)),
+      true
+    );
+    r.run();
+    BOOST_CHECK_EQUAL(r.stopped(), true);
+    BOOST_CHECK_EQUAL(r.empty(), false);
+    r.cancel_timer(timer_id);
+  }
+
+  /// \brief Unit-test case: Backend selection.
+  BOOST_AUTO_TEST_CASE(backend)
+  {
+    BOOST_CHECK_EQUAL(sheratan::process_impl::posix::reactor::supports(sheratan::process_impl::posix::reactor_backend::AUTO), true);
+    BOOST_CHECK_EQUAL(sheratan::process_impl::posix::reactor::supports(sheratan::process_impl::posix::reactor_backend::EPOLL), true);
+    bool uring = sheratan::process_impl::posix::reactor::supports(sheratan::process_impl::posix::reactor_backend::IO_URING);
+
+    // automatic selection prefers io_uring
+    sheratan::process_impl::posix::reactor r_auto;
+    BOOST_CHECK(r_auto.get_backend() == (uring ? sheratan::process_impl::posix::reactor_backend::IO_URING : sheratan::process_impl::posix::reactor_backend::EPOLL));
+
+    // explicit selection
+    sheratan::process_impl::posix::reactor r_epoll(sheratan::process_impl::posix::reactor_backend::EPOLL);
+    BOOST_CHECK(r_epoll.get_backend() == sheratan::process_impl::posix::reactor_backend::EPOLL);
+    if(uring) {
+      sheratan::process_impl::posix::reactor r_uring(sheratan::process_impl::posix::reactor_backend::IO_URING);
+      BOOST_CHECK(r_uring.get_backend() == sheratan::process_impl::posix::reactor_backend::IO_URING);
+    }
+    else {
+      BOOST_CHECK_THROW(sheratan::process_impl::posix::reactor r_uring(sheratan::process_impl::posix::reactor_backend::IO_URING), sheratan::errhdl::runtime_error);
+    }
+  }
+
+  /// \brief Unit-test case: Processes (all backends).
+  BOOST_AUTO_TEST_CASE(backend_processes)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    for(std::size_t b = 0; b < sizeof(test_backends) / sizeof(test_backends[0]); ++b) {
+      if(!sheratan::process_impl::posix::reactor::supports(test_backends[b])) {
+        continue;
+      }
+      BOOST_TEST_CHECKPOINT("backend " << test_backends[b]);
+      event_log log;
+      log.timers = 0;
+      sheratan::process_impl::posix::reactor r(test_backends[b]);
+
+      // many children terminating at once
+      boost::ptr_vector<test_reactor_process> children;
+      for(int i = 0; i < 16; ++i) {
+        children.push_back(new test_reactor_process(test_sync_fork_ctl(i, false)));
+        r.watch_process(children.back(), boost::bind(&event_log::on_process, &log, boost::placeholders::_1, boost::placeholders::_2));
+      }
+      for(std::size_t i = 0; i < children.size(); ++i) {
+        test_sync_fork_ctl &fc = dynamic_cast<test_sync_fork_ctl &>(children[i].get_fork_ctl());
+        fc.unblock_child();
+        fc.finalize();
+      }
+      r.run();
+      BOOST_CHECK_EQUAL(r.empty(), true);
+      BOOST_REQUIRE_EQUAL(log.processes.size(), children.size());
+      for(std::size_t i = 0; i < log.processes.size(); ++i) {
+        BOOST_CHECK_EQUAL(log.processes[i]->valid(), false);
+        BOOST_CHECK_EQUAL(log.statuses[i].exited(), true);
+        int index = -1;
+        for(std::size_t j = 0; j < children.size(); ++j) {
+          if(&(children[j]) == log.processes[i]) {
+            index = static_cast<int>(j);
+          }
+        }
+        BOOST_CHECK_EQUAL(log.statuses[i].get_status(), index);
+      }
+
+      // child terminated, but unwatched before its termination was dispatched
+      // (it is either reaped by the backend already, or it can still be joined)
+      test_reactor_process child(test_sync_fork_ctl(3, false));
+      r.watch_process(child, boost::bind(&event_log::on_process, &log, boost::placeholders::_1, boost::placeholders::_2));
+      r.run_one(true);
+      test_sync_fork_ctl &fc = dynamic_cast<test_sync_fork_ctl &>(child.get_fork_ctl());
+      fc.unblock_child();
+      fc.finalize();
+      struct pollfd pfd;
+      pfd.fd = child.native_handle();
+      pfd.events = POLLIN;
+      BOOST_REQUIRE_EQUAL(::poll(&pfd, 1, -1), 1);
+      sheratan::process_impl::posix::exit_status status = r.unwatch_process(child);
+      if(status.valid()) {
+        BOOST_CHECK_EQUAL(child.valid(), false);
+      }
+      else {
+        status = child.join();
+      }
+      BOOST_CHECK_EQUAL(status.exited(), true);
+      BOOST_CHECK_EQUAL(status.get_status(), 3);
+      BOOST_CHECK_EQUAL(log.processes.size(), children.size());
+      BOOST_CHECK_EQUAL(r.empty(), true);
+    }
+  }
+
+  /// \brief Unit-test case: I/O readiness (all backends).
+  BOOST_AUTO_TEST_CASE(backend_io)
+  {
+    for(std::size_t b = 0; b < sizeof(test_backends) / sizeof(test_backends[0]); ++b) {
+      if(!sheratan::process_impl::posix::reactor::supports(test_backends[b])) {
+        continue;
+      }
+      BOOST_TEST_CHECKPOINT("backend " << test_backends[b]);
+      event_log log;
+      log.timers = 0;
+      sheratan::process_impl::posix::reactor r(test_backends[b]);
+
+      int fds[2];
+      BOOST_REQUIRE_EQUAL(::pipe(fds), 0);
+      r.watch_io(fds[0], sheratan::process_impl::posix::io_events::READABLE, boost::bind(&event_log::on_io, &log, boost::placeholders::_1, boost::placeholders::_2));
+      BOOST_CHECK_EQUAL(r.run_one(true), 0U);
+
+      // watch is level-triggered, so unread data are reported repeatedly
+      char c = 'x';
+      BOOST_REQUIRE_EQUAL(::write(fds[1], &c, 1), 1);
+      BOOST_CHECK_EQUAL(r.run_one(), 1U);
+      BOOST_CHECK_EQUAL(r.run_one(), 1U);
+      BOOST_REQUIRE_EQUAL(log.fds.size(), 2U);
+      BOOST_CHECK_EQUAL(log.fds[1], fds[0]);
+      BOOST_CHECK((log.io_events[1] & sheratan::process_impl::posix::io_events::READABLE) != 0);
+
+      // watched events changed
+      r.modify_io(fds[0], sheratan::process_impl::posix::io_events::NONE);
+      BOOST_CHECK_EQUAL(r.run_one(true), 0U);
+      r.modify_io(fds[0], sheratan::process_impl::posix::io_events::READABLE);
+      BOOST_CHECK_EQUAL(r.run_one(), 1U);
+      BOOST_REQUIRE_EQUAL(::read(fds[0], &c, 1), 1);
+
+      // timers are delivered through the same backend
+      r.add_timer(boost::posix_time::milliseconds(1), boost::bind(&event_log::on_timer, &log));
+      BOOST_CHECK_EQUAL(r.run_one(), 1U);
+      BOOST_CHECK_EQUAL(log.timers, 1);
+
+      r.unwatch_io(fds[0]);
+      BOOST_CHECK_EQUAL(r.empty(), true);
+      ::close(fds[0]);
+      ::close(fds[1]);
+    }
+  }
+
+BOOST_AUTO_TEST_SUITE_END() // reactor
+
+
+} // anonymous namespace
+
+
+// vim: set ts=2 sw=2 et:
@@ -0,0 +1,92 @@
+/// \file process/sub/posix/test/readiness_notifier_test.cpp
+/// \brief Readiness notifier POSIX implementation unit-test file.
+/// \ingroup sheratan_process_posix_test
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include "sheratan/errhdl/exception.hpp"
+#include "sheratan/process/posix/readiness_notifier.hpp"
+
+
+namespace {
+
+
+/// \brief Name of environment variable holding notification socket.
+static const char notify_socket_env[] = "NOTIFY_SOCKET";
+
+
+/// \brief Receive notification.
+/// \param fd Notification socket.
+/// \return Received notification.
+static std::string receive_notification(int fd)
+{
+  char buffer[256];
+  ssize_t rc_recv = ::recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+  BOOST_REQUIRE_GE(rc_recv, 0);
+  return std::string(buffer, static_cast<std::size_t>(rc_recv));
+}
+
+
+BOOST_AUTO_TEST_SUITE(readiness_notifier)
+
+  /// \brief Unit-test case: Notification socket not set.
+  BOOST_AUTO_TEST_CASE(disabled)
+  {
+    BOOST_REQUIRE_EQUAL(::unsetenv(notify_socket_env), 0);
+    sheratan::process_impl::posix::readiness_notifier notifier;
+    BOOST_CHECK_EQUAL(notifier.enabled(), false);
+    BOOST_CHECK_NO_THROW(notifier.stage("init"));
+    BOOST_CHECK_NO_THROW(notifier.ready());
+  }
+
+  /// \brief Unit-test case: Notifications.
+  BOOST_AUTO_TEST_CASE(notifications)
+  {
+    // bind notification socket to abstract name chosen by the kernel
+    int fd = ::socket(AF_UNIX, SOCK_DGRAM, 0);
+    BOOST_REQUIRE_GE(fd, 0);
+    struct sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    socklen_t address_length = sizeof(address);
+    BOOST_REQUIRE_EQUAL(::bind(fd, reinterpret_cast<struct sockaddr *>(&address), sizeof(sa_family_t)), 0);
+    BOOST_REQUIRE_EQUAL(::getsockname(fd, reinterpret_cast<struct sockaddr *>(&address), &address_length), 0);
+    std::string name = "@" + std::string(address.sun_path + 1, address_length - offsetof(struct sockaddr_un, sun_path) - 1);
+    BOOST_REQUIRE_EQUAL(::setenv(notify_socket_env, name.c_str(), 1), 0);
+
+    // notifications are sent in sd_notify format
+    sheratan::process_impl::posix::readiness_notifier notifier;
+    BOOST_CHECK_EQUAL(notifier.enabled(), true);
+    notifier.stage("init");
+    BOOST_CHECK_EQUAL(receive_notification(fd), "STAGE=init");
+    notifier.notify("STATUS=serving\nREADY=1");
+    BOOST_CHECK_EQUAL(receive_notification(fd), "STATUS=serving\nREADY=1");
+    notifier.ready();
+    BOOST_CHECK_EQUAL(receive_notification(fd), "READY=1");
+
+    // invalid stage names
+    BOOST_CHECK_THROW(notifier.stage(""), sheratan::errhdl::logic_error);
+    BOOST_CHECK_THROW(notifier.stage("a\nb"), sheratan::errhdl::logic_error);
+
+    ::unsetenv(notify_socket_env);
+    ::close(fd);
+  }
+
+BOOST_AUTO_TEST_SUITE_END() // readiness_notifier
+
+
+} // anonymous namespace
+
+
+// vim: set ts=2 sw=2 et:
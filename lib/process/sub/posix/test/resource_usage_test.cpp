@@ -0,0 +1,96 @@
+/// \file process/sub/posix/test/resource_usage_test.cpp
+/// \brief Process resource usage POSIX implementation unit-test file.
+/// \ingroup sheratan_process_posix_test
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#include <cstring>
+
+#include <sys/resource.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include "sheratan/process/posix/resource_usage.hpp"
+#include "accessor.hpp"
+
+
+namespace {
+
+
+/// \brief Create resource usage.
+/// \param seconds Seconds of CPU time (both user and system).
+/// \param max_rss Maximum resident set size.
+/// \param faults Number of page faults (both minor and major).
+/// \return Resource usage.
+static sheratan::process_impl::posix::test::accessor::resource_usage_ptr make_usage(long seconds, long max_rss, long faults)
+{
+  struct rusage ru;
+  std::memset(&ru, 0, sizeof(ru));
+  ru.ru_utime.tv_sec = seconds;
+  ru.ru_utime.tv_usec = 250000;
+  ru.ru_stime.tv_sec = seconds;
+  ru.ru_maxrss = max_rss;
+  ru.ru_minflt = faults;
+  ru.ru_majflt = faults;
+  ru.ru_nvcsw = 3;
+  ru.ru_nivcsw = 5;
+  return sheratan::process_impl::posix::test::accessor::resource_usage__resource_usage(ru);
+}
+
+
+BOOST_AUTO_TEST_SUITE(resource_usage)
+
+  /// \brief Unit-test case: Construction.
+  BOOST_AUTO_TEST_CASE(construction)
+  {
+    // default construction
+    sheratan::process_impl::posix::resource_usage default_constructed;
+    BOOST_CHECK_EQUAL(default_constructed.get_user_time().ticks(), 0);
+    BOOST_CHECK_EQUAL(default_constructed.get_system_time().ticks(), 0);
+    BOOST_CHECK_EQUAL(default_constructed.get_max_rss(), 0);
+    BOOST_CHECK_EQUAL(default_constructed.get_minor_faults(), 0);
+    BOOST_CHECK_EQUAL(default_constructed.get_major_faults(), 0);
+    BOOST_CHECK_EQUAL(default_constructed.get_voluntary_context_switches(), 0);
+    BOOST_CHECK_EQUAL(default_constructed.get_involuntary_context_switches(), 0);
+
+    // construction from resource usage reported by the kernel
+    sheratan::process_impl::posix::test::accessor::resource_usage_ptr usage = make_usage(2, 1024, 7);
+    BOOST_CHECK(usage->get_user_time() == boost::posix_time::milliseconds(2250));
+    BOOST_CHECK(usage->get_system_time() == boost::posix_time::seconds(2));
+    BOOST_CHECK_EQUAL(usage->get_max_rss(), 1024);
+    BOOST_CHECK_EQUAL(usage->get_minor_faults(), 7);
+    BOOST_CHECK_EQUAL(usage->get_major_faults(), 7);
+    BOOST_CHECK_EQUAL(usage->get_voluntary_context_switches(), 3);
+    BOOST_CHECK_EQUAL(usage->get_involuntary_context_switches(), 5);
+  }
+
+  /// \brief Unit-test case: Accumulation.
+  BOOST_AUTO_TEST_CASE(accumulation)
+  {
+    sheratan::process_impl::posix::test::accessor::resource_usage_ptr usage_1 = make_usage(1, 4096, 10);
+    sheratan::process_impl::posix::test::accessor::resource_usage_ptr usage_2 = make_usage(2, 1024, 20);
+
+    // times and counters are summed up, maximum resident set size is the maximum
+    sheratan::process_impl::posix::resource_usage total = *usage_1 + *usage_2;
+    BOOST_CHECK(total.get_user_time() == boost::posix_time::milliseconds(3500));
+    BOOST_CHECK(total.get_system_time() == boost::posix_time::seconds(3));
+    BOOST_CHECK_EQUAL(total.get_max_rss(), 4096);
+    BOOST_CHECK_EQUAL(total.get_minor_faults(), 30);
+    BOOST_CHECK_EQUAL(total.get_major_faults(), 30);
+    BOOST_CHECK_EQUAL(total.get_voluntary_context_switches(), 6);
+    BOOST_CHECK_EQUAL(total.get_involuntary_context_switches(), 10);
+
+    // accumulation into default constructed instance
+    sheratan::process_impl::posix::resource_usage acc;
+    acc += *usage_2;
+    BOOST_CHECK_EQUAL(acc.get_max_rss(), 1024);
+    BOOST_CHECK_EQUAL(acc.get_minor_faults(), 20);
+  }
+
+BOOST_AUTO_TEST_SUITE_END() // resource_usage
+
+
+} // anonymous namespace
+
+
+// vim: set ts=2 sw=2 et:
@@ -0,0 +1,210 @@
+/// \file process/sub/posix/test/signal_dispatcher_test.cpp
+/// \brief Signal dispatcher POSIX implementation unit-test file.
+/// \ingroup sheratan_process_posix_test
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#include <vector>
+
+#include <poll.h>
+#include <signal.h>
+#include <pthread.h>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/bind/bind.hpp>
+
+#include "sheratan/errhdl/exception.hpp"
+#include "sheratan/process/posix/signal_dispatcher.hpp"
+
+
+namespace {
+
+
+/// \brief Record of dispatched signals.
+struct signal_log
+{
+  /// \brief Record signal.
+  /// \param subscriber Subscriber number.
+  /// \param signal Signal number.
+  void on_signal(int subscriber, sheratan::process_impl::posix::signal_number_type signal)
+  {
+    subscribers.push_back(subscriber);
+    signals.push_back(signal);
+  }
+
+  /// \brief Record signal and cancel subscription.
+  /// \param dispatcher Signal dispatcher.
+  /// \param subscription_id Subscription to be cancelled.
+  /// \param signal Signal number.
+  void on_signal_unsubscribe(
+    sheratan::process_impl::posix::signal_dispatcher *dispatcher,
+    const sheratan::process_impl::posix::signal_dispatcher::subscription_id_type *subscription_id,
+    sheratan::process_impl::posix::signal_number_type signal
+  )
+  {
+    dispatcher->unsubscribe(*subscription_id);
+    subscribers.push_back(0);
+    signals.push_back(signal);
+  }
+
+  /// \brief Subscribers.
+  std::vector<int> subscribers;
+
+  /// \brief Signals.
+  std::vector<sheratan::process_impl::posix::signal_number_type> signals;
+};
+
+
+/// \brief Determine whether signal is blocked in the calling thread.
+/// \param signal Signal number.
+/// \retval true Signal is blocked.
+/// \retval false Signal is not blocked.
+static bool is_blocked(sheratan::process_impl::posix::signal_number_type signal)
+{
+  sigset_t mask;
+  BOOST_REQUIRE_EQUAL(::pthread_sigmask(SIG_BLOCK, NULL, &mask), 0);
+  return ::sigismember(&mask, signal) == 1;
+}
+
+
+BOOST_AUTO_TEST_SUITE(signal_dispatcher)
+
+  /// \brief Unit-test case: Default construction.
+  BOOST_AUTO_TEST_CASE(default_construction)
+  {
+    sheratan::process_impl::posix::signal_dispatcher d;
+    BOOST_CHECK_EQUAL(d.empty(), true);
+    BOOST_CHECK_EQUAL(d.size(), 0U);
+    BOOST_CHECK(d.native_handle() != -1);
+    BOOST_CHECK_EQUAL(d.dispatch(true), 0U);
+  }
+
+  /// \brief Unit-test case: Subscription.
+  BOOST_AUTO_TEST_CASE(subscription)
+  {
+    signal_log log;
+    {
+      sheratan::process_impl::posix::signal_dispatcher d;
+      sheratan::process_impl::posix::signal_dispatcher::subscription_id_type id_1 = d.subscribe(SIGUSR1, boost::bind(&signal_log::on_signal, &log, 1, boost::placeholders::_1));
+      sheratan::process_impl::posix::signal_dispatcher::subscription_id_type id_2 = d.subscribe(SIGUSR1, boost::bind(&signal_log::on_signal, &log, 2, boost::placeholders::_1));
+      BOOST_CHECK(id_1 != 0);
+      BOOST_CHECK(id_2 != 0);
+      BOOST_CHECK(id_1 != id_2);
+      BOOST_CHECK_EQUAL(d.size(), 2U);
+      BOOST_CHECK_EQUAL(d.subscribed(SIGUSR1), true);
+      BOOST_CHECK_EQUAL(d.subscribed(SIGUSR2), false);
+      BOOST_CHECK_EQUAL(is_blocked(SIGUSR1), true);
+      BOOST_CHECK_THROW(d.subscribe(0, boost::bind(&signal_log::on_signal, &log, 3, boost::placeholders::_1)), sheratan::errhdl::runtime_error);
+      BOOST_CHECK_EQUAL(d.size(), 2U);
+
+      // signal is blocked, so it is delivered via signalfd to all subscribers in order of their subscription
+      BOOST_REQUIRE_EQUAL(::raise(SIGUSR1), 0);
+      BOOST_CHECK_EQUAL(d.dispatch(), 1U);
+      BOOST_REQUIRE_EQUAL(log.signals.size(), 2U);
+      BOOST_CHECK_EQUAL(log.subscribers[0], 1);
+      BOOST_CHECK_EQUAL(log.subscribers[1], 2);
+      BOOST_CHECK_EQUAL(log.signals[0], SIGUSR1);
+      BOOST_CHECK_EQUAL(log.signals[1], SIGUSR1);
+
+      // cancelled subscriber is not invoked anymore
+      d.unsubscribe(id_1);
+      d.unsubscribe(id_1);
+      BOOST_CHECK_EQUAL(d.size(), 1U);
+      BOOST_CHECK_EQUAL(d.subscribed(SIGUSR1), true);
+      BOOST_REQUIRE_EQUAL(::raise(SIGUSR1), 0);
+      BOOST_CHECK_EQUAL(d.dispatch(true), 1U);
+      BOOST_REQUIRE_EQUAL(log.signals.size(), 3U);
+      BOOST_CHECK_EQUAL(log.subscribers[2], 2);
+
+      // signal is unblocked once it has no subscriber, its pending instance is discarded
+      BOOST_REQUIRE_EQUAL(::raise(SIGUSR1), 0);
+      d.unsubscribe(id_2);
+      BOOST_CHECK_EQUAL(d.empty(), true);
+      BOOST_CHECK_EQUAL(d.subscribed(SIGUSR1), false);
+      BOOST_CHECK_EQUAL(is_blocked(SIGUSR1), false);
+      BOOST_CHECK_EQUAL(d.dispatch(true), 0U);
+      BOOST_CHECK_EQUAL(log.signals.size(), 3U);
+
+      // signal is blocked again by new subscription
+      d.subscribe(SIGUSR2, boost::bind(&signal_log::on_signal, &log, 4, boost::placeholders::_1));
+      BOOST_CHECK_EQUAL(is_blocked(SIGUSR2), true);
+      BOOST_CHECK_EQUAL(is_blocked(SIGUSR1), false);
+    }
+
+    // signal is unblocked again once the dispatcher is destroyed
+    BOOST_CHECK_EQUAL(is_blocked(SIGUSR2), false);
+  }
+
+  /// \brief Unit-test case: Signal blocked before subscription.
+  BOOST_AUTO_TEST_CASE(preblocked)
+  {
+    sigset_t mask;
+    ::sigemptyset(&mask);
+    ::sigaddset(&mask, SIGUSR1);
+    BOOST_REQUIRE_EQUAL(::pthread_sigmask(SIG_BLOCK, &mask, NULL), 0);
+    {
+      signal_log log;
+      sheratan::process_impl::posix::signal_dispatcher d;
+      sheratan::process_impl::posix::signal_dispatcher::subscription_id_type id = d.subscribe(SIGUSR1, boost::bind(&signal_log::on_signal, &log, 1, boost::placeholders::_1));
+      d.unsubscribe(id);
+
+      // signal was not blocked by the dispatcher, so it stays blocked
+      BOOST_CHECK_EQUAL(is_blocked(SIGUSR1), true);
+    }
+    BOOST_CHECK_EQUAL(is_blocked(SIGUSR1), true);
+    BOOST_REQUIRE_EQUAL(::pthread_sigmask(SIG_UNBLOCK, &mask, NULL), 0);
+  }
+
+  /// \brief Unit-test case: Batch dispatch.
+  BOOST_AUTO_TEST_CASE(batch)
+  {
+    signal_log log;
+    sheratan::process_impl::posix::signal_dispatcher d;
+    d.subscribe(SIGUSR1, boost::bind(&signal_log::on_signal, &log, 1, boost::placeholders::_1));
+    d.subscribe(SIGUSR2, boost::bind(&signal_log::on_signal, &log, 2, boost::placeholders::_1));
+
+    // native handle is readable once some signal is pending
+    struct pollfd pfd;
+    pfd.fd = d.native_handle();
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    BOOST_CHECK_EQUAL(::poll(&pfd, 1, 0), 0);
+    BOOST_REQUIRE_EQUAL(::raise(SIGUSR2), 0);
+    BOOST_REQUIRE_EQUAL(::raise(SIGUSR1), 0);
+    BOOST_CHECK_EQUAL(::poll(&pfd, 1, 0), 1);
+
+    // all pending signals are dispatched at once
+    BOOST_CHECK_EQUAL(d.dispatch(true), 2U);
+    BOOST_CHECK_EQUAL(log.signals.size(), 2U);
+    BOOST_CHECK_EQUAL(d.dispatch(true), 0U);
+    BOOST_CHECK_EQUAL(::poll(&pfd, 1, 0), 0);
+  }
+
+  /// \brief Unit-test case: Subscriber cancelling subscriptions.
+  BOOST_AUTO_TEST_CASE(unsubscribe_from_handler)
+  {
+    signal_log log;
+    sheratan::process_impl::posix::signal_dispatcher d;
+
+    // first subscriber cancels subscription of the third one
+    sheratan::process_impl::posix::signal_dispatcher::subscription_id_type id_3 = 0;
+    d.subscribe(SIGUSR1, boost::bind(&signal_log::on_signal_unsubscribe, &log, &d, &id_3, boost::placeholders::_1));
+    d.subscribe(SIGUSR1, boost::bind(&signal_log::on_signal, &log, 2, boost::placeholders::_1));
+    id_3 = d.subscribe(SIGUSR1, boost::bind(&signal_log::on_signal, &log, 3, boost::placeholders::_1));
+    BOOST_CHECK_EQUAL(d.size(), 3U);
+
+    BOOST_REQUIRE_EQUAL(::raise(SIGUSR1), 0);
+    BOOST_CHECK_EQUAL(d.dispatch(true), 1U);
+    BOOST_REQUIRE_EQUAL(log.signals.size(), 2U);
+    BOOST_CHECK_EQUAL(log.subscribers[0], 0);
+    BOOST_CHECK_EQUAL(log.subscribers[1], 2);
+    BOOST_CHECK_EQUAL(d.size(), 2U);
+  }
+
+BOOST_AUTO_TEST_SUITE_END()
+
+
+} // anonymous namespace
+
+
+// vim: set ts=2 sw=2 et:
@@ -0,0 +1,162 @@
+/// \file process/sub/posix/test/spawn_test.cpp
+/// \brief Spawn methods POSIX implementation unit-test file.
+/// \ingroup sheratan_process_posix_test
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#include <cerrno>
+
+#include <boost/test/unit_test.hpp>
+#include "boost_test_sigchld_suppressor.hpp"
+
+#include "sheratan/errhdl/exception.hpp"
+#include "sheratan/process/posix/error_category.hpp"
+#include "sheratan/process/posix/exec_ctl.hpp"
+#include "sheratan/process/posix/process_template.hpp"
+#include "test_sync_fork_ctl.hpp"
+
+
+using namespace sheratan::process_impl::posix::test;
+
+
+namespace {
+
+
+/// \brief Test process type definition.
+typedef sheratan::process_impl::posix::process_template<struct test_spawn_process_tag> test_spawn_process;
+
+/// \brief All spawn methods.
+static const sheratan::process_impl::posix::spawn_method::value_type all_spawn_methods[] = {
+  sheratan::process_impl::posix::spawn_method::FORK,
+  sheratan::process_impl::posix::spawn_method::VFORK,
+  sheratan::process_impl::posix::spawn_method::CLONE_VM_VFORK,
+  sheratan::process_impl::posix::spawn_method::POSIX_SPAWN
+};
+
+/// \brief Spawn methods sharing address space with the parent.
+static const sheratan::process_impl::posix::spawn_method::value_type shared_spawn_methods[] = {
+  sheratan::process_impl::posix::spawn_method::VFORK,
+  sheratan::process_impl::posix::spawn_method::CLONE_VM_VFORK,
+  sheratan::process_impl::posix::spawn_method::POSIX_SPAWN
+};
+
+/// \brief Create shell command exec controller.
+/// \param command Shell command.
+/// \return Exec controller.
+static sheratan::process_impl::posix::exec_ctl shell_exec_ctl(const std::string &command)
+{
+  sheratan::process_impl::posix::exec_ctl::string_list_type args;
+  args.push_back("sh");
+  args.push_back("-c");
+  args.push_back(command);
+  return sheratan::process_impl::posix::exec_ctl("/bin/sh", args);
+}
+
+
+BOOST_AUTO_TEST_SUITE(spawn)
+
+  /// \brief Unit-test case: Exec with all spawn methods.
+  BOOST_AUTO_TEST_CASE(exec)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    for(std::size_t i = 0; i < sizeof(all_spawn_methods) / sizeof(all_spawn_methods[0]); ++i) {
+      BOOST_TEST_MESSAGE("spawn method: " << all_spawn_methods[i]);
+
+      // create child process
+      test_spawn_process child(shell_exec_ctl("exit 42"), all_spawn_methods[i]);
+      BOOST_CHECK_EQUAL(child.valid(), true);
+      BOOST_CHECK_NE(child.get_pid(), sheratan::process_impl::posix::process_id());
+
+      // wait for the child process
+      sheratan::process_impl::posix::exit_status exit_status = child.join();
+      BOOST_CHECK_EQUAL(child.valid(), false);
+      BOOST_CHECK_EQUAL(exit_status.exited(), true);
+      BOOST_CHECK_EQUAL(exit_status.get_status(), 42);
+    }
+  }
+
+  /// \brief Unit-test case: Exec with explicit environment.
+  BOOST_AUTO_TEST_CASE(exec_env)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    sheratan::process_impl::posix::exec_ctl::string_list_type args;
+    args.push_back("sh");
+    args.push_back("-c");
+    args.push_back("exit $SHERATAN_TEST_STATUS");
+    sheratan::process_impl::posix::exec_ctl::string_list_type env;
+    env.push_back("SHERATAN_TEST_STATUS=23");
+
+    for(std::size_t i = 0; i < sizeof(all_spawn_methods) / sizeof(all_spawn_methods[0]); ++i) {
+      BOOST_TEST_MESSAGE("spawn method: " << all_spawn_methods[i]);
+
+      test_spawn_process child(sheratan::process_impl::posix::exec_ctl("/bin/sh", args, env), all_spawn_methods[i]);
+      sheratan::process_impl::posix::exit_status exit_status = child.join();
+      BOOST_CHECK_EQUAL(exit_status.exited(), true);
+      BOOST_CHECK_EQUAL(exit_status.get_status(), 23);
+    }
+  }
+
+  /// \brief Unit-test case: Exec failure.
+  BOOST_AUTO_TEST_CASE(exec_failure)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    sheratan::process_impl::posix::exec_ctl::string_list_type args;
+    args.push_back("sheratan_nonexistent");
+    sheratan::process_impl::posix::exec_ctl ec("/nonexistent/sheratan_nonexistent", args);
+
+    // plain fork: failure is reported by exit status of the child
+    {
+      test_spawn_process child(ec, sheratan::process_impl::posix::spawn_method::FORK);
+      sheratan::process_impl::posix::exit_status exit_status = child.join();
+      BOOST_CHECK_EQUAL(exit_status.exited(), true);
+      BOOST_CHECK_EQUAL(exit_status.get_status(), sheratan::process_impl::posix::exec_ctl::EXEC_FAILURE);
+    }
+
+    // shared address space: failure is reported by exception
+    for(std::size_t i = 0; i < sizeof(shared_spawn_methods) / sizeof(shared_spawn_methods[0]); ++i) {
+      BOOST_TEST_MESSAGE("spawn method: " << shared_spawn_methods[i]);
+
+      try {
+        test_spawn_process child(ec, shared_spawn_methods[i]);
+        BOOST_ERROR("exception expected");
+        child.join();
+      }
+      catch(sheratan::errhdl::runtime_error &ex) {
+        BOOST_CHECK(get_code(ex).get_category() == sheratan::process_impl::posix::get_error_category());
+        BOOST_CHECK_EQUAL(get_code(ex).get_errnum(), sheratan::process_impl::posix::errnum::POSIX_SYSTEM);
+        BOOST_CHECK_EQUAL(sheratan::process_impl::posix::get_posix_errnum(ex), ENOENT);
+      }
+    }
+  }
+
+  /// \brief Unit-test case: Spawn method sharing address space requires exec controller.
+  BOOST_AUTO_TEST_CASE(requires_exec_ctl)
+  {
+    BOOST_CHECK_THROW(
+      test_spawn_process child(test_sync_fork_ctl(0, false), sheratan::process_impl::posix::spawn_method::VFORK),
+      sheratan::errhdl::logic_error
+    );
+  }
+
+BOOST_AUTO_TEST_SUITE_END() // spawn
+
+
+} // anonymous namespace
+
+
+// vim: set ts=2 sw=2 et:
@@ -0,0 +1,120 @@
+/// \file process/sub/posix/test/terminate_test.cpp
+/// \brief Process termination POSIX implementation unit-test file.
+/// \ingroup sheratan_process_posix_test
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#include <signal.h>
+#include <poll.h>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include "boost_test_sigchld_suppressor.hpp"
+
+#include "sheratan/errhdl/exception.hpp"
+#include "sheratan/process/posix/process.hpp"
+#include "sheratan/process/posix/process_template.hpp"
+#include "sheratan/process/posix/terminate.hpp"
+#include "test_sync_fork_ctl.hpp"
+
+
+using namespace sheratan::process_impl::posix::test;
+
+
+namespace {
+
+
+/// \brief Test process type definition.
+typedef sheratan::process_impl::posix::process_template<struct test_terminate_process_tag> test_terminate_process;
+
+
+BOOST_AUTO_TEST_SUITE(terminate)
+
+  /// \brief Unit-test case: Process exits on termination signal.
+  BOOST_AUTO_TEST_CASE(graceful)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    // child process blocks until it is unblocked, which never happens
+    test_terminate_process child(test_sync_fork_ctl(0, false));
+    test_sync_fork_ctl &fc = dynamic_cast<test_sync_fork_ctl &>(child.get_fork_ctl());
+
+    // call returns as soon as the child exits, long before the grace period expires
+    boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+    sheratan::process_impl::posix::exit_status status = sheratan::process_impl::posix::terminate(child, boost::posix_time::seconds(30));
+    boost::posix_time::time_duration elapsed = boost::posix_time::microsec_clock::universal_time() - start;
+    BOOST_CHECK_EQUAL(child.valid(), false);
+    BOOST_CHECK_EQUAL(status.signaled(), true);
+    BOOST_CHECK_EQUAL(status.get_term_signal(), SIGTERM);
+    BOOST_CHECK(elapsed < boost::posix_time::seconds(5));
+    fc.finalize();
+
+    // invalid process
+    BOOST_CHECK_THROW(sheratan::process_impl::posix::terminate(child, boost::posix_time::seconds(1)), sheratan::errhdl::logic_error);
+  }
+
+  /// \brief Unit-test case: Process ignores termination signal.
+  BOOST_AUTO_TEST_CASE(escalation)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    // child process inherits ignored SIGTERM
+    struct sigaction ignore;
+    struct sigaction orig;
+    ignore.sa_handler = SIG_IGN;
+    ::sigemptyset(&ignore.sa_mask);
+    ignore.sa_flags = 0;
+    BOOST_REQUIRE_EQUAL(::sigaction(SIGTERM, &ignore, &orig), 0);
+    test_terminate_process child(test_sync_fork_ctl(0, false));
+    BOOST_REQUIRE_EQUAL(::sigaction(SIGTERM, &orig, NULL), 0);
+    test_sync_fork_ctl &fc = dynamic_cast<test_sync_fork_ctl &>(child.get_fork_ctl());
+
+    // child process is killed once the grace period expires
+    boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+    sheratan::process_impl::posix::exit_status status = sheratan::process_impl::posix::terminate(child, boost::posix_time::milliseconds(100));
+    boost::posix_time::time_duration elapsed = boost::posix_time::microsec_clock::universal_time() - start;
+    BOOST_CHECK_EQUAL(child.valid(), false);
+    BOOST_CHECK_EQUAL(status.signaled(), true);
+    BOOST_CHECK_EQUAL(status.get_term_signal(), SIGKILL);
+    BOOST_CHECK(elapsed >= boost::posix_time::milliseconds(100));
+    BOOST_CHECK(elapsed < boost::posix_time::seconds(5));
+    fc.finalize();
+  }
+
+  /// \brief Unit-test case: Process has already exited.
+  BOOST_AUTO_TEST_CASE(already_exited)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    test_terminate_process child(test_sync_fork_ctl(42, false));
+    test_sync_fork_ctl &fc = dynamic_cast<test_sync_fork_ctl &>(child.get_fork_ctl());
+    fc.unblock_child();
+    fc.finalize();
+    BOOST_REQUIRE_EQUAL(::poll(NULL, 0, 100), 0);
+
+    // exit status is reported as it is, no signal is sent
+    sheratan::process_impl::posix::exit_status status = sheratan::process_impl::posix::terminate(child, boost::posix_time::seconds(30));
+    BOOST_CHECK_EQUAL(child.valid(), false);
+    BOOST_CHECK_EQUAL(status.exited(), true);
+    BOOST_CHECK_EQUAL(status.get_status(), 42);
+  }
+
+BOOST_AUTO_TEST_SUITE_END() // terminate
+
+
+} // anonymous namespace
+
+
+// vim: set ts=2 sw=2 et:
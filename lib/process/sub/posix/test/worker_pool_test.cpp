@@ -0,0 +1,232 @@
+/// \file process/sub/posix/test/worker_pool_test.cpp
+/// \brief Worker pool POSIX implementation unit-test file.
+/// \ingroup sheratan_process_posix_test
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#include <cstddef>
+#include <vector>
+
+#include <unistd.h>
+#include <signal.h>
+
+#include <boost/bind/bind.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include "boost_test_sigchld_suppressor.hpp"
+
+#include "sheratan/errhdl/exception.hpp"
+#include "sheratan/process/posix/fork_ctl.hpp"
+#include "sheratan/process/posix/reactor.hpp"
+#include "sheratan/process/posix/worker_pool.hpp"
+
+
+namespace {
+
+
+/// \brief Fork controller of test worker.
+/// \note Worker either waits for a signal, or it exits immediately.
+class test_worker_fork_ctl : public sheratan::process_impl::posix::fork_ctl
+{
+  public:
+
+    explicit test_worker_fork_ctl(bool crash)
+    : crash_(crash)
+    {
+    }
+
+    virtual sheratan::process_impl::posix::fork_ctl * clone() const
+    {
+      return new test_worker_fork_ctl(*this);
+    }
+
+    virtual void prefork()
+    {
+    }
+
+    virtual void postfork(sheratan::process_impl::posix::process &)
+    {
+    }
+
+    virtual sheratan::process_impl::posix::exit_status::value_type child()
+    {
+      if(this->crash_) {
+        return 1;
+      }
+      for(;;) {
+        ::pause();
+      }
+    }
+
+  private:
+
+    /// \brief Whether worker exits immediately.
+    bool crash_;
+};
+
+
+/// \brief Record of terminated workers.
+struct exit_log
+{
+  /// \brief Record termination of worker.
+  /// \param index Index of the worker.
+  /// \param status Exit status.
+  void on_exit(std::size_t index, const sheratan::process_impl::posix::exit_status &status)
+  {
+    indices.push_back(index);
+    statuses.push_back(status);
+  }
+
+  /// \brief Indices of terminated workers.
+  std::vector<std::size_t> indices;
+
+  /// \brief Exit statuses.
+  std::vector<sheratan::process_impl::posix::exit_status> statuses;
+};
+
+
+BOOST_AUTO_TEST_SUITE(worker_pool)
+
+  /// \brief Unit-test case: Respawn.
+  BOOST_AUTO_TEST_CASE(respawn)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    sheratan::process_impl::posix::reactor r;
+    exit_log log;
+    sheratan::process_impl::posix::worker_pool pool(
+      r,
+      test_worker_fork_ctl(false),
+      3,
+      boost::posix_time::seconds(0),
+      boost::posix_time::milliseconds(100),
+      boost::posix_time::seconds(30),
+      boost::bind(&exit_log::on_exit, &log, boost::placeholders::_1, boost::placeholders::_2)
+    );
+    BOOST_CHECK_EQUAL(pool.size(), 3U);
+    BOOST_CHECK_EQUAL(pool.running(), 0U);
+    BOOST_CHECK_EQUAL(pool.get_worker(0).valid(), false);
+    pool.start();
+    BOOST_CHECK_EQUAL(pool.running(), 3U);
+    BOOST_CHECK_THROW(pool.start(), sheratan::errhdl::logic_error);
+
+    // worker, which has run long enough, is respawned immediately
+    sheratan::process_impl::posix::process_id killed_pid = pool.get_worker(1).get_pid();
+    BOOST_REQUIRE_EQUAL(::kill(killed_pid.get_value(), SIGKILL), 0);
+    while(pool.get_respawn_count() < 1) {
+      r.run_one();
+    }
+    BOOST_CHECK_EQUAL(pool.running(), 3U);
+    BOOST_CHECK_EQUAL(pool.get_worker(1).valid(), true);
+    BOOST_CHECK_NE(pool.get_worker(1).get_pid(), killed_pid);
+    BOOST_REQUIRE_EQUAL(log.indices.size(), 1U);
+    BOOST_CHECK_EQUAL(log.indices[0], 1U);
+    BOOST_CHECK_EQUAL(log.statuses[0].signaled(), true);
+    BOOST_CHECK_EQUAL(log.statuses[0].get_term_signal(), SIGKILL);
+
+    // broadcast signal terminates all the workers, they are respawned again
+    pool.broadcast(SIGUSR1);
+    while(pool.get_respawn_count() < 4) {
+      r.run_one();
+    }
+    BOOST_CHECK_EQUAL(pool.running(), 3U);
+    BOOST_REQUIRE_EQUAL(log.statuses.size(), 4U);
+    for(std::size_t i = 1; i < log.statuses.size(); ++i) {
+      BOOST_CHECK_EQUAL(log.statuses[i].get_term_signal(), SIGUSR1);
+    }
+
+    // all the workers are shut down, none of them is respawned
+    pool.shutdown();
+    BOOST_CHECK_EQUAL(pool.running(), 0U);
+    BOOST_CHECK_EQUAL(pool.get_respawn_count(), 4U);
+    BOOST_REQUIRE_EQUAL(log.statuses.size(), 7U);
+    for(std::size_t i = 0; i < pool.size(); ++i) {
+      BOOST_CHECK_EQUAL(pool.get_worker(i).valid(), false);
+      BOOST_CHECK_EQUAL(log.statuses[4 + i].get_term_signal(), SIGTERM);
+    }
+    BOOST_CHECK_EQUAL(r.empty(), true);
+    BOOST_CHECK_NO_THROW(pool.shutdown());
+  }
+
+  /// \brief Unit-test case: Crash loop backoff.
+  BOOST_AUTO_TEST_CASE(backoff)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    sheratan::process_impl::posix::reactor r;
+    exit_log log;
+    sheratan::process_impl::posix::worker_pool pool(
+      r,
+      test_worker_fork_ctl(true),
+      1,
+      boost::posix_time::seconds(10),
+      boost::posix_time::milliseconds(20),
+      boost::posix_time::milliseconds(80),
+      boost::bind(&exit_log::on_exit, &log, boost::placeholders::_1, boost::placeholders::_2)
+    );
+    pool.start();
+
+    // respawn delays are 20, 40, 80, 80, ... milliseconds
+    r.add_timer(boost::posix_time::milliseconds(300), boost::bind(&sheratan::process_impl::posix::reactor::stop, &r));
+    r.run();
+    BOOST_CHECK_GE(log.statuses.size(), 3U);
+    BOOST_CHECK_LE(log.statuses.size(), 7U);
+    for(std::size_t i = 0; i < log.statuses.size(); ++i) {
+      BOOST_CHECK_EQUAL(log.statuses[i].exited(), true);
+      BOOST_CHECK_EQUAL(log.statuses[i].get_status(), 1);
+    }
+
+    // pending respawn is cancelled by shutdown (worker may just be running)
+    std::size_t exits = log.statuses.size();
+    pool.shutdown(SIGTERM, boost::posix_time::milliseconds(100));
+    BOOST_CHECK_EQUAL(pool.running(), 0U);
+    BOOST_CHECK_LE(log.statuses.size(), exits + 1);
+    BOOST_CHECK_EQUAL(r.empty(), true);
+  }
+
+  /// \brief Unit-test case: Shutdown grace period.
+  BOOST_AUTO_TEST_CASE(grace)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    sheratan::process_impl::posix::reactor r;
+    exit_log log;
+    sheratan::process_impl::posix::worker_pool pool(
+      r,
+      test_worker_fork_ctl(false),
+      2,
+      boost::posix_time::seconds(1),
+      boost::posix_time::milliseconds(100),
+      boost::posix_time::seconds(30),
+      boost::bind(&exit_log::on_exit, &log, boost::placeholders::_1, boost::placeholders::_2)
+    );
+    pool.start();
+
+    // workers ignore the signal, they are killed once grace period expires
+    pool.shutdown(SIGCONT, boost::posix_time::milliseconds(50));
+    BOOST_CHECK_EQUAL(pool.running(), 0U);
+    BOOST_REQUIRE_EQUAL(log.statuses.size(), 2U);
+    BOOST_CHECK_EQUAL(log.statuses[0].get_term_signal(), SIGKILL);
+    BOOST_CHECK_EQUAL(log.statuses[1].get_term_signal(), SIGKILL);
+    BOOST_CHECK_EQUAL(r.empty(), true);
+  }
+
+BOOST_AUTO_TEST_SUITE_END() // worker_pool
+
+
+} // anonymous namespace
+
+
+// vim: set ts=2 sw=2 et:
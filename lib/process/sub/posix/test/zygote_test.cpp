@@ -0,0 +1,153 @@
+/// \file process/sub/posix/test/zygote_test.cpp
+/// \brief Zygote POSIX implementation unit-test file.
+/// \ingroup sheratan_process_posix_test
+/// \author Marek Balint \c (mareq[A]balint[D]eu)
+
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+#include <signal.h>
+
+#include <boost/test/unit_test.hpp>
+#include "boost_test_sigchld_suppressor.hpp"
+
+#include "sheratan/errhdl/exception.hpp"
+#include "sheratan/process/posix/error_category.hpp"
+#include "sheratan/process/posix/process_template.hpp"
+#include "sheratan/process/posix/zygote.hpp"
+
+
+namespace {
+
+
+/// \brief Test worker process type definition.
+typedef sheratan::process_impl::posix::process_template<struct test_zygote_worker_tag> test_zygote_worker;
+
+
+/// \brief Zygote controller of test zygote.
+/// \note Worker exits with status given by its request, provided that
+/// it has inherited state initialized by the zygote. In case it is asked
+/// to fail, zygote initialization throws an exception.
+class test_zygote_ctl : public sheratan::process_impl::posix::zygote_ctl
+{
+  public:
+
+    explicit test_zygote_ctl(bool fail)
+    : fail_(fail)
+    , zygote_pid_(0)
+    {
+    }
+
+    virtual sheratan::process_impl::posix::zygote_ctl * clone() const
+    {
+      return new test_zygote_ctl(*this);
+    }
+
+    virtual void init()
+    {
+      if(this->fail_) {
+        SHERATAN_THROW_EXCEPTION(sheratan::errhdl::runtime_error(), sheratan::errhdl::error_code(sheratan::process_impl::posix::errnum::UNKNOWN, sheratan::process_impl::posix::get_error_category()));
+      }
+      this->zygote_pid_ = ::getpid();
+    }
+
+    virtual sheratan::process_impl::posix::exit_status::value_type worker(const std::string &request)
+    {
+      // worker is distinct process forked by initialized zygote
+      if((this->zygote_pid_ == 0) || (this->zygote_pid_ == ::getpid())) {
+        return 1;
+      }
+      return std::atoi(request.c_str());
+    }
+
+  private:
+
+    /// \brief Whether zygote initialization fails.
+    bool fail_;
+
+    /// \brief Process ID of zygote (set by its initialization).
+    pid_t zygote_pid_;
+};
+
+
+BOOST_AUTO_TEST_SUITE(zygote)
+
+  /// \brief Unit-test case: Spawning workers.
+  BOOST_AUTO_TEST_CASE(spawn)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    sheratan::process_impl::posix::zygote z((test_zygote_ctl(false)));
+    BOOST_REQUIRE_EQUAL(z.get_process().valid(), true);
+
+    // workers are children of this process, so they can be joined via their process file descriptors
+    std::vector<test_zygote_worker *> workers;
+    for(int i = 0; i < 4; ++i) {
+      workers.push_back(new test_zygote_worker());
+      z.spawn(*workers.back(), std::string(1, static_cast<char>('1' + i)));
+      BOOST_CHECK_EQUAL(workers.back()->valid(), true);
+      BOOST_CHECK_NE(workers.back()->get_pid(), z.get_process().get_pid());
+      BOOST_CHECK_GE(workers.back()->native_handle(), 0);
+    }
+    for(int i = 0; i < 4; ++i) {
+      sheratan::process_impl::posix::exit_status exit_status = workers[i]->join();
+      BOOST_CHECK_EQUAL(exit_status.exited(), true);
+      BOOST_CHECK_EQUAL(exit_status.get_status(), i + 1);
+      delete workers[i];
+    }
+
+    // spawning worker into valid process object and too long request are not allowed
+    test_zygote_worker worker;
+    z.spawn(worker, "42");
+    BOOST_CHECK_THROW(z.spawn(worker), sheratan::errhdl::logic_error);
+    BOOST_CHECK_EQUAL(worker.join().get_status(), 42);
+    BOOST_CHECK_THROW(z.spawn(worker, std::string(sheratan::process_impl::posix::zygote::MAX_REQUEST + 1, '0')), sheratan::errhdl::logic_error);
+    BOOST_CHECK_EQUAL(worker.valid(), false);
+  }
+
+  /// \brief Unit-test case: Failed zygote.
+  BOOST_AUTO_TEST_CASE(failure)
+  {
+    // ignore SIGCHLD in order to make Boost.Test shut up
+    // about child process exiting with nonzero status
+    sheratan::process_impl::posix::test::boost_test_sigchld_suppressor sigchld_suppressor;
+    // make compiler shut up about unused variable sigchld_suppressor
+    sigchld_suppressor.no_op();
+
+    // zygote initialization fails
+    try {
+      sheratan::process_impl::posix::zygote z((test_zygote_ctl(true)));
+      BOOST_ERROR("zygote initialization failure not reported");
+    }
+    catch(sheratan::errhdl::runtime_error &ex) {
+      BOOST_CHECK_EQUAL(get_code(ex).get_errnum(), sheratan::process_impl::posix::errnum::ZYGOTE_FAILED);
+    }
+
+    // zygote is gone
+    sheratan::process_impl::posix::zygote z((test_zygote_ctl(false)));
+    ::kill(z.get_process().get_pid().get_value(), SIGKILL);
+    test_zygote_worker worker;
+    try {
+      z.spawn(worker);
+      BOOST_ERROR("gone zygote not reported");
+    }
+    catch(sheratan::errhdl::runtime_error &ex) {
+      BOOST_CHECK_EQUAL(get_code(ex).get_errnum(), sheratan::process_impl::posix::errnum::ZYGOTE_FAILED);
+    }
+    BOOST_CHECK_EQUAL(worker.valid(), false);
+  }
+
+BOOST_AUTO_TEST_SUITE_END() // zygote
+
+
+} // anonymous namespace
+
+
+// vim: set ts=2 sw=2 et: